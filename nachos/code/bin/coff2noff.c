@@ -15,6 +15,13 @@
  *	.data	-- initialized data
  *	.bss/.sbss -- uninitialized data (should be zero'd on program startup)
  *
+ * Normally the segments are packed back to back in the NOFF file.  With
+ * -p, each one starts on a page boundary in the file instead, and the
+ * program must have been linked so that it does in memory too (see
+ * test/script.paged).  Then no page holds both code and data, so Nachos
+ * can load every page straight from the file, make the code pages 
+ * read-only and share them between processes.
+ *
  * Copyright (c) 1992-1993 The Regents of the University of California.
  * All rights reserved.  See copyright.h for copyright notice and limitation 
  * of liability and disclaimer of warranty provisions.
@@ -90,17 +97,44 @@ void Write(int fd, char *buf, int nBytes)
     }
 }
 
+/* pad the output with zeros to the next page boundary */
+int PadToPage(int fd, int inNoffFile)
+{
+    static char zeros[NOFFPAGESIZE];
+    int pad = (NOFFPAGESIZE - inNoffFile % NOFFPAGESIZE) % NOFFPAGESIZE;
+
+    Write(fd, zeros, pad);
+    return inNoffFile + pad;
+}
+
+/* is "addr" on a page boundary?  complain if not */
+void CheckAligned(char *name, int addr)
+{
+    if (addr % NOFFPAGESIZE != 0) {
+	fprintf(stderr, "Segment %s at 0x%x does not start on a page boundary;"
+		" link with test/script.paged\n", name, addr);
+	unlink(noffFileName);
+	exit(1);
+    }
+}
+
 main (int argc, char **argv)
 {
-    int fdIn, fdOut, numsections, i, inNoffFile;
+    int fdIn, fdOut, numsections, i, inNoffFile, paged = 0;
     struct filehdr fileh;
     struct aouthdr systemh;
     struct scnhdr *sections;
     char *buffer;
     NoffHeader noffH;
 
-    if (argc < 2) {
-	fprintf(stderr, "Usage: %s <coffFileName> <noffFileName>\n", argv[0]);
+    if ((argc > 1) && !strcmp(argv[1], "-p")) {
+	paged = 1;
+	argc--;
+	argv++;
+    }
+    if (argc < 3) {
+	fprintf(stderr, "Usage: %s [-p] <coffFileName> <noffFileName>\n", 
+		argv[0]);
 	exit(1);
     }
     
@@ -153,7 +187,7 @@ main (int argc, char **argv)
  /* initialize the NOFF header, in case not all the segments are defined
   * in the COFF file
   */
-    noffH.noffMagic = NOFFMAGIC;
+    noffH.noffMagic = paged ? NOFFPAGEDMAGIC : NOFFMAGIC;
     noffH.code.size = 0;
     noffH.initData.size = 0;
     noffH.uninitData.size = 0;
@@ -161,6 +195,8 @@ main (int argc, char **argv)
  /* Copy the segments in */
     inNoffFile = sizeof(NoffHeader);
     lseek(fdOut, inNoffFile, 0);
+    if (paged)
+	inNoffFile = PadToPage(fdOut, inNoffFile);
     printf("Loading %d sections:\n", numsections);
     for (i = 0; i < numsections; i++) {
 	printf("\t\"%s\", filepos 0x%x, mempos 0x%x, size 0x%x\n",
@@ -169,6 +205,10 @@ main (int argc, char **argv)
 	if (sections[i].s_size == 0) {
 		/* do nothing! */	
 	} else if (!strcmp(sections[i].s_name, ".text")) {
+	    if (paged) {
+		CheckAligned(".text", sections[i].s_paddr);
+		inNoffFile = PadToPage(fdOut, inNoffFile);
+	    }
 	    noffH.code.virtualAddr = sections[i].s_paddr;
 	    noffH.code.inFileAddr = inNoffFile;
 	    noffH.code.size = sections[i].s_size;
@@ -187,6 +227,10 @@ main (int argc, char **argv)
 	        unlink(noffFileName);
 	        exit(1);
 	    }
+	    if (paged) {
+		CheckAligned(sections[i].s_name, sections[i].s_paddr);
+		inNoffFile = PadToPage(fdOut, inNoffFile);
+	    }
 	    noffH.initData.virtualAddr = sections[i].s_paddr;
 	    noffH.initData.inFileAddr = inNoffFile;
 	    noffH.initData.size = sections[i].s_size;
@@ -220,6 +264,10 @@ main (int argc, char **argv)
 	    exit(1);
 	}
     }
+    if (paged && (noffH.code.size > 0) && (noffH.uninitData.size > 0) 
+		&& (noffH.initData.size == 0))
+	CheckAligned("bss", noffH.uninitData.virtualAddr);
+			/* else it shares a page with the code */
     lseek(fdOut, 0, 0);
     Write(fdOut, (char *)&noffH, sizeof(NoffHeader));
     close(fdIn);
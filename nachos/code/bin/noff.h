@@ -8,6 +8,16 @@
 #define NOFFMAGIC	0xbadfad 	/* magic number denoting Nachos 
 					 * object code file 
 					 */
+#define NOFFPAGEDMAGIC	0xbadfae	/* the same, with every segment 
+					 * starting on a page boundary, both 
+					 * in the file and in memory, and no 
+					 * page holding both code and data 
+					 * (coff2noff -p)
+					 */
+#define NOFFPAGESIZE	128		/* page size of the paged layout; 
+					 * must match PageSize in 
+					 * machine/machine.h 
+					 */
 
 typedef struct segment {
   int virtualAddr;		/* location of segment in virt addr space */
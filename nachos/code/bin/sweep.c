@@ -0,0 +1,279 @@
+/* sweep.c
+ *
+ * This program runs a batch of Nachos simulations in parallel, one host
+ * process per simulation, and collects their statistics into one CSV
+ * table.
+ *
+ * Every Nachos run is a separate process, so each one gets its own copy
+ * of the kernel globals (stats, interrupt, scheduler, machine, ...) and
+ * runs on its own host core.  The simulated results do not depend on how
+ * many runs are going on at the same time.
+ *
+ * Usage: sweep [-j <jobs>] <nachos> <matrix file> <output file>
+ *
+ * Each non-empty line of the matrix file that does not start with '#'
+ * describes one configuration:
+ *
+ *	<batch file> <scheduling algorithm> <replacement algorithm> <frames>
+ *
+ * For example, from the userprog directory:
+ *
+ *	../test/batch_scripts/inputmix_1.txt 3 2 32
+ *
+ * The scheduling algorithm replaces the one on the first line of the
+ * batch file.  Configuration i is run as
+ *
+ *	nachos -M <frames> -csv <output>.<i>.csv -R <repl> -F <output>.<i>.batch
+ *
+ * with its console output in <output>.<i>.log.  The output file gets
+ * one line per configuration; a configuration whose run did not halt
+ * cleanly has its status set but no counters.
+ *
+ * -j sets the number of simulations that run at the same time; the
+ * default is the number of host processors.
+ *
+ * Copyright (c) 1992-1993 The Regents of the University of California.
+ * All rights reserved.  See copyright.h for copyright notice and limitation
+ * of liability and disclaimer of warranty provisions.
+ */
+
+#define MAIN
+#include "copyright.h"
+#undef MAIN
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MaxConfigs	1024
+#define MaxLine		1024
+#define MaxCSVLine	4096	/* header or counters of nachos -csv */
+
+typedef struct {
+    char batch[MaxLine];	/* batch file */
+    int sched;			/* scheduling algorithm (-A) */
+    int repl;			/* replacement algorithm (-R) */
+    int frames;			/* physical memory size (-M) */
+    int pid;			/* host process running it, 0 if none */
+    int status;			/* exit status of that process */
+    char values[MaxCSVLine];	/* counters, as written by nachos -csv */
+} Config;
+
+Config configs[MaxConfigs];
+int numConfigs = 0;
+char *outputName;
+
+/* Name of a per-configuration file: <output>.<i>.<suffix> */
+void
+ConfigFileName(char *buf, int i, char *suffix)
+{
+    sprintf(buf, "%s.%d.%s", outputName, i, suffix);
+}
+
+/* Read the matrix file into configs[] */
+void
+ReadMatrix(char *name)
+{
+    FILE *f = fopen(name, "r");
+    char line[MaxLine];
+    Config *c;
+
+    if (f == NULL) {
+	perror(name);
+	exit(1);
+    }
+    while (fgets(line, MaxLine, f) != NULL) {
+	if (line[0] == '#' || line[0] == '\n')
+	    continue;
+	if (numConfigs == MaxConfigs) {
+	    fprintf(stderr, "Too many configurations, at most %d\n", MaxConfigs);
+	    exit(1);
+	}
+	c = &configs[numConfigs];
+	if (sscanf(line, "%s %d %d %d", c->batch, &c->sched, &c->repl,
+						&c->frames) != 4) {
+	    fprintf(stderr, "Bad matrix line: %s", line);
+	    exit(1);
+	}
+	c->pid = 0;
+	c->status = -1;
+	numConfigs++;
+    }
+    fclose(f);
+}
+
+/* Copy the batch file of configuration i, with its scheduling algorithm
+ * replaced by the one from the matrix.
+ */
+void
+WriteBatchCopy(int i)
+{
+    char name[MaxLine], line[MaxLine];
+    FILE *in, *out;
+
+    in = fopen(configs[i].batch, "r");
+    if (in == NULL) {
+	perror(configs[i].batch);
+	exit(1);
+    }
+    ConfigFileName(name, i, "batch");
+    out = fopen(name, "w");
+    if (out == NULL) {
+	perror(name);
+	exit(1);
+    }
+    fgets(line, MaxLine, in);		/* skip the original algorithm */
+    fprintf(out, "%d\n", configs[i].sched);
+    while (fgets(line, MaxLine, in) != NULL)
+	fputs(line, out);
+    fclose(in);
+    fclose(out);
+}
+
+/* Start the Nachos process for configuration i */
+void
+StartConfig(char *nachos, int i)
+{
+    char batch[MaxLine], csv[MaxLine], log[MaxLine];
+    char frames[16], repl[16];
+    int pid, fd;
+
+    WriteBatchCopy(i);
+    ConfigFileName(batch, i, "batch");
+    ConfigFileName(csv, i, "csv");
+    ConfigFileName(log, i, "log");
+    unlink(csv);
+    sprintf(frames, "%d", configs[i].frames);
+    sprintf(repl, "%d", configs[i].repl);
+
+    pid = fork();
+    if (pid == -1) {
+	perror("fork");
+	exit(1);
+    }
+    if (pid == 0) {
+	fd = open(log, O_WRONLY|O_CREAT|O_TRUNC, 0666);
+	if (fd == -1) {
+	    perror(log);
+	    _exit(1);
+	}
+	dup2(fd, 1);
+	dup2(fd, 2);
+	close(fd);
+	execl(nachos, nachos, "-M", frames, "-csv", csv, "-R", repl,
+						"-F", batch, (char *) NULL);
+	perror(nachos);
+	_exit(1);
+    }
+    configs[i].pid = pid;
+}
+
+/* Wait for any running configuration to finish */
+void
+WaitConfig()
+{
+    int pid, status, i;
+
+    pid = wait(&status);
+    if (pid == -1) {
+	perror("wait");
+	exit(1);
+    }
+    for (i = 0; i < numConfigs; i++) {
+	if (configs[i].pid == pid) {
+	    configs[i].pid = 0;
+	    configs[i].status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+	    fprintf(stderr, "sweep: %s %d %d %d done, status %d\n",
+		configs[i].batch, configs[i].sched, configs[i].repl,
+		configs[i].frames, configs[i].status);
+	}
+    }
+}
+
+/* Read back the counters written by configuration i.  "header" gets the
+ * counter names, if the run produced any.  A line too long for the
+ * buffers counts as no result, rather than being split in two.
+ */
+void
+ReadResult(int i, char *header)
+{
+    char name[MaxLine];
+    FILE *in;
+
+    ConfigFileName(name, i, "csv");
+    in = fopen(name, "r");
+    header[0] = configs[i].values[0] = '\0';
+    if (in != NULL) {
+	if (fgets(header, MaxCSVLine, in) == NULL ||
+			strchr(header, '\n') == NULL ||
+			fgets(configs[i].values, MaxCSVLine, in) == NULL ||
+			strchr(configs[i].values, '\n') == NULL)
+	    header[0] = configs[i].values[0] = '\0';
+	fclose(in);
+	unlink(name);
+    }
+    ConfigFileName(name, i, "batch");
+    unlink(name);
+}
+
+main (int argc, char **argv)
+{
+    int jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    int running = 0, i;
+    char header[MaxCSVLine], h[MaxCSVLine];
+    FILE *out;
+
+    if (argc > 2 && !strcmp(argv[1], "-j")) {
+	jobs = atoi(argv[2]);
+	argc -= 2;
+	argv += 2;
+    }
+    if (argc != 4 || jobs < 1) {
+	fprintf(stderr, "Usage: sweep [-j <jobs>] <nachos> <matrix file> <output file>\n");
+	exit(1);
+    }
+    outputName = argv[3];
+    ReadMatrix(argv[2]);
+
+    for (i = 0; i < numConfigs; i++) {
+	if (running == jobs) {
+	    WaitConfig();
+	    running--;
+	}
+	StartConfig(argv[1], i);
+	running++;
+    }
+    while (running > 0) {
+	WaitConfig();
+	running--;
+    }
+
+    header[0] = '\0';
+    for (i = 0; i < numConfigs; i++) {
+	ReadResult(i, h);
+	if (header[0] == '\0')
+	    strcpy(header, h);
+    }
+
+    out = fopen(outputName, "w");
+    if (out == NULL) {
+	perror(outputName);
+	exit(1);
+    }
+    fprintf(out, "batch,sched,repl,frames,status%s%s",
+		(header[0] != '\0') ? "," : "\n", header);
+    for (i = 0; i < numConfigs; i++) {
+	fprintf(out, "%s,%d,%d,%d,%d", configs[i].batch, configs[i].sched,
+		configs[i].repl, configs[i].frames, configs[i].status);
+	if (configs[i].values[0] != '\0')
+	    fprintf(out, ",%s", configs[i].values);
+	else
+	    fprintf(out, "\n");
+    }
+    fclose(out);
+    exit(0);
+}
@@ -7,14 +7,18 @@
 //	of each directory entry means that we have the restriction
 //	of a fixed maximum size for file names.
 //
+//	The table is hashed on the file name, with linear probing, so
+//	finding a name takes a constant number of probes.  Deleted
+//	entries keep their "wasUsed" mark, since later names may have
+//	been probed past them; Add rehashes the table to get rid of them,
+//	and doubles it when it gets too full.
+//
 //	The constructor initializes an empty directory of a certain size;
-//	we use ReadFrom/WriteBack to fetch the contents of the directory
+//	we use FetchFrom/WriteBack to fetch the contents of the directory
 //	from disk, and to write back any modifications back to disk.
 //
-//	Also, this implementation has the restriction that the size
-//	of the directory cannot expand.  In other words, once all the
-//	entries in the directory are used, no more files can be created.
-//	Fixing this is one of the parts to the assignment.
+//	We also implement the cache of directory lookups used by the
+//	file system to resolve path names.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -25,6 +29,21 @@
 #include "filehdr.h"
 #include "directory.h"
 
+//----------------------------------------------------------------------
+// HashName
+// 	Hash the part of a file name that is stored in a directory entry.
+//----------------------------------------------------------------------
+
+static unsigned int
+HashName(char *name)
+{
+    unsigned int hash = 0;
+
+    for (int i = 0; i < FileNameMaxLen && name[i] != '\0'; i++)
+	hash = hash * 31 + (unsigned char) name[i];
+    return hash;
+}
+
 //----------------------------------------------------------------------
 // Directory::Directory
 // 	Initialize a directory; initially, the directory is completely
@@ -40,7 +59,8 @@ Directory::Directory(int size)
     table = new DirectoryEntry[size];
     tableSize = size;
     for (int i = 0; i < tableSize; i++)
-	table[i].inUse = FALSE;
+	table[i].inUse = table[i].wasUsed = FALSE;
+    numInUse = numWasUsed = 0;
 }
 
 //----------------------------------------------------------------------
@@ -55,7 +75,8 @@ Directory::~Directory()
 
 //----------------------------------------------------------------------
 // Directory::FetchFrom
-// 	Read the contents of the directory from disk.
+// 	Read the contents of the directory from disk.  The table takes
+//	the size of the file, which grows with the directory.
 //
 //	"file" -- file containing the directory contents
 //----------------------------------------------------------------------
@@ -63,12 +84,28 @@ Directory::~Directory()
 void
 Directory::FetchFrom(OpenFile *file)
 {
+    int size = file->Length() / sizeof(DirectoryEntry);
+
+    ASSERT(size > 0);
+    if (size != tableSize) {
+	delete [] table;
+	table = new DirectoryEntry[size];
+	tableSize = size;
+    }
     (void) file->ReadAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    numInUse = numWasUsed = 0;
+    for (int i = 0; i < tableSize; i++) {
+	if (table[i].inUse)
+	    numInUse++;
+	if (table[i].wasUsed)
+	    numWasUsed++;
+    }
 }
 
 //----------------------------------------------------------------------
 // Directory::WriteBack
-// 	Write any modifications to the directory back to disk
+// 	Write any modifications to the directory back to disk.  The
+//	caller must first extend the file to Size() bytes.
 //
 //	"file" -- file to contain the new directory contents
 //----------------------------------------------------------------------
@@ -76,6 +113,7 @@ Directory::FetchFrom(OpenFile *file)
 void
 Directory::WriteBack(OpenFile *file)
 {
+    ASSERT(file->Length() >= Size());
     (void) file->WriteAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
 }
 
@@ -83,6 +121,8 @@ Directory::WriteBack(OpenFile *file)
 // Directory::FindIndex
 // 	Look up file name in directory, and return its location in the table of
 //	directory entries.  Return -1 if the name isn't in the directory.
+//	The search starts at the entry picked by the hash of the name,
+//	and stops at the first entry that was never used.
 //
 //	"name" -- the file name to look up
 //----------------------------------------------------------------------
@@ -90,9 +130,13 @@ Directory::WriteBack(OpenFile *file)
 int
 Directory::FindIndex(char *name)
 {
-    for (int i = 0; i < tableSize; i++)
+    int i = HashName(name) % tableSize;
+
+    for (int n = 0; n < tableSize && table[i].wasUsed; n++) {
         if (table[i].inUse && !strncmp(table[i].name, name, FileNameMaxLen))
 	    return i;
+	i = (i + 1) % tableSize;
+    }
     return -1;		// name not in directory
 }
 
@@ -115,31 +159,150 @@ Directory::Find(char *name)
     return -1;
 }
 
+//----------------------------------------------------------------------
+// Directory::Lookup
+// 	Look up file name in the directory stored in "file", without
+//	reading the whole directory into memory: only the entries on the
+//	probe sequence of the name are read.  Return the disk sector
+//	number of the file's header, or -1 if the name isn't there.
+//
+//	"file" -- file containing the directory contents
+//	"name" -- the file name to look up
+//	"isDirectory" -- set to whether the name is a directory
+//----------------------------------------------------------------------
+
+int
+Directory::Lookup(OpenFile *file, char *name, bool *isDirectory)
+{
+    int size = file->Length() / sizeof(DirectoryEntry);
+    int i = HashName(name) % size;
+    DirectoryEntry entry;
+
+    for (int n = 0; n < size; n++) {
+	(void) file->ReadAt((char *)&entry, sizeof(DirectoryEntry),
+						i * sizeof(DirectoryEntry));
+	if (!entry.wasUsed)
+	    break;
+        if (entry.inUse && !strncmp(entry.name, name, FileNameMaxLen)) {
+	    *isDirectory = entry.isDirectory;
+	    return entry.sector;
+	}
+	i = (i + 1) % size;
+    }
+    return -1;		// name not in directory
+}
+
+//----------------------------------------------------------------------
+// Directory::Rehash
+// 	Move all the entries in use into a fresh table of "newSize"
+//	entries, dropping the deleted ones.
+//
+//	"newSize" -- the number of entries in the new table
+//----------------------------------------------------------------------
+
+void
+Directory::Rehash(int newSize)
+{
+    DirectoryEntry *oldTable = table;
+    int oldSize = tableSize;
+    int i, j;
+
+    DEBUG('f', "Rehashing directory of %d entries into %d\n", oldSize,
+								newSize);
+    table = new DirectoryEntry[newSize];
+    tableSize = newSize;
+    for (i = 0; i < tableSize; i++)
+	table[i].inUse = table[i].wasUsed = FALSE;
+    for (i = 0; i < oldSize; i++)
+	if (oldTable[i].inUse) {
+	    for (j = HashName(oldTable[i].name) % tableSize; table[j].inUse;
+						j = (j + 1) % tableSize)
+		;
+	    table[j] = oldTable[i];
+	}
+    numWasUsed = numInUse;
+    delete [] oldTable;
+}
+
+//----------------------------------------------------------------------
+// Directory::RehashSize
+// 	Return the number of entries of the table that Add is to rehash
+//	the table into, before adding a name: 0 if the table is not
+//	getting full, or -1 if it cannot grow any more, and there is no
+//	room for another name.  The table is rehashed into one twice as
+//	big if more than half of it is in use, and up to MaxDirEntries
+//	entries; otherwise, it keeps its size, and loses the deleted
+//	entries.
+//----------------------------------------------------------------------
+
+int
+Directory::RehashSize()
+{
+    if ((numWasUsed + 1) * 4 <= tableSize * 3)
+	return 0;
+    if (((numInUse + 1) * 2 > tableSize) && (tableSize * 2 <= MaxDirEntries))
+	return tableSize * 2;
+    if ((numInUse + 1) * 4 > tableSize * 3)
+	return -1;			// full
+    return tableSize;
+}
+
+//----------------------------------------------------------------------
+// Directory::RehashSectors
+// 	Return the number of sectors of the table that the next Add 
+//	rewrites, by rehashing it, or 0 if it does not rehash.  The 
+//	journal has to have room for all of them.
+//----------------------------------------------------------------------
+
+int
+Directory::RehashSectors()
+{
+    int newSize = RehashSize();
+
+    if (newSize <= 0)
+	return 0;
+    return divRoundUp(newSize * sizeof(DirectoryEntry), SectorSize);
+}
+
 //----------------------------------------------------------------------
 // Directory::Add
 // 	Add a file into the directory.  Return TRUE if successful;
-//	return FALSE if the file name is already in the directory, or if
-//	the directory is completely full, and has no more space for
-//	additional file names.
+//	return FALSE if the file name is already in the directory, or
+//	if the directory is full.  If the table is getting full, it is
+//	first rehashed (cf. RehashSize); the caller then has to extend
+//	the directory file to Size() bytes.
 //
 //	"name" -- the name of the file being added
 //	"newSector" -- the disk sector containing the added file's header
+//	"isDirectory" -- is the added file a directory?
 //----------------------------------------------------------------------
 
 bool
-Directory::Add(char *name, int newSector)
+Directory::Add(char *name, int newSector, bool isDirectory)
 { 
+    int i, newSize;
+
     if (FindIndex(name) != -1)
 	return FALSE;
 
-    for (int i = 0; i < tableSize; i++)
-        if (!table[i].inUse) {
-            table[i].inUse = TRUE;
-            strncpy(table[i].name, name, FileNameMaxLen); 
-            table[i].sector = newSector;
-        return TRUE;
-	}
-    return FALSE;	// no space.  Fix when we have extensible files.
+    newSize = RehashSize();
+    if (newSize == -1)
+	return FALSE;			// directory full
+    if (newSize > 0)
+	Rehash(newSize);
+
+    for (i = HashName(name) % tableSize; table[i].inUse;
+						i = (i + 1) % tableSize)
+	;
+    if (!table[i].wasUsed)
+	numWasUsed++;
+    numInUse++;
+    table[i].inUse = table[i].wasUsed = TRUE;
+    table[i].isDirectory = isDirectory;
+    strncpy(table[i].name, name, FileNameMaxLen); 
+    table[i].name[FileNameMaxLen] = '\0';
+    table[i].sector = newSector;
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -157,13 +320,15 @@ Directory::Remove(char *name)
 
     if (i == -1)
 	return FALSE; 		// name not in directory
-    table[i].inUse = FALSE;
+    table[i].inUse = FALSE;	// but leave wasUsed, for FindIndex
+    numInUse--;
     return TRUE;	
 }
 
 //----------------------------------------------------------------------
 // Directory::List
-// 	List all the file names in the directory. 
+// 	List all the file names in the directory.  Directories are
+//	listed with a trailing '/'.
 //----------------------------------------------------------------------
 
 void
@@ -171,7 +336,7 @@ Directory::List()
 {
    for (int i = 0; i < tableSize; i++)
 	if (table[i].inUse)
-	    printf("%s\n", table[i].name);
+	    printf("%s%s\n", table[i].name, table[i].isDirectory ? "/" : "");
 }
 
 //----------------------------------------------------------------------
@@ -188,10 +353,104 @@ Directory::Print()
     printf("Directory contents:\n");
     for (int i = 0; i < tableSize; i++)
 	if (table[i].inUse) {
-	    printf("Name: %s, Sector: %d\n", table[i].name, table[i].sector);
+	    printf("Name: %s%s, Sector: %d\n", table[i].name,
+			table[i].isDirectory ? "/" : "", table[i].sector);
 	    hdr->FetchFrom(table[i].sector);
 	    hdr->Print();
 	}
     printf("\n");
     delete hdr;
 }
+
+//----------------------------------------------------------------------
+// DirectoryCache::DirectoryCache
+// 	Initialize an empty cache of directory lookups.
+//
+//	"size" is the number of lookups the cache can hold
+//----------------------------------------------------------------------
+
+DirectoryCache::DirectoryCache(int size)
+{
+    table = new DirectoryCacheEntry[size];
+    tableSize = size;
+    for (int i = 0; i < tableSize; i++)
+	table[i].valid = FALSE;
+}
+
+//----------------------------------------------------------------------
+// DirectoryCache::~DirectoryCache
+// 	De-allocate the cache.
+//----------------------------------------------------------------------
+
+DirectoryCache::~DirectoryCache()
+{
+    delete [] table;
+}
+
+//----------------------------------------------------------------------
+// DirectoryCache::Hash
+// 	Return the slot that holds the lookup of "name" in the directory
+//	whose header is at sector "parent".
+//----------------------------------------------------------------------
+
+int
+DirectoryCache::Hash(int parent, char *name)
+{
+    return (HashName(name) + (unsigned int) parent * 2654435761U) % tableSize;
+}
+
+//----------------------------------------------------------------------
+// DirectoryCache::Find
+// 	Return the header sector of "name" in directory "parent", if the
+//	lookup is cached, or -1 if it is not.
+//
+//	"parent" -- header sector of the directory
+//	"name" -- the file name to look up
+//	"isDirectory" -- set to whether the name is a directory
+//----------------------------------------------------------------------
+
+int
+DirectoryCache::Find(int parent, char *name, bool *isDirectory)
+{
+    DirectoryCacheEntry *e = &table[Hash(parent, name)];
+
+    if (!e->valid || e->parent != parent
+			|| strncmp(e->name, name, FileNameMaxLen))
+	return -1;
+    *isDirectory = e->isDirectory;
+    return e->sector;
+}
+
+//----------------------------------------------------------------------
+// DirectoryCache::Enter
+// 	Remember that "name" in directory "parent" has its header at
+//	"sector", replacing whatever lookup had the same slot.
+//----------------------------------------------------------------------
+
+void
+DirectoryCache::Enter(int parent, char *name, int sector, bool isDirectory)
+{
+    DirectoryCacheEntry *e = &table[Hash(parent, name)];
+
+    e->valid = TRUE;
+    e->parent = parent;
+    strncpy(e->name, name, FileNameMaxLen);
+    e->name[FileNameMaxLen] = '\0';
+    e->sector = sector;
+    e->isDirectory = isDirectory;
+}
+
+//----------------------------------------------------------------------
+// DirectoryCache::Remove
+// 	Forget the lookup of "name" in directory "parent", if cached.
+//----------------------------------------------------------------------
+
+void
+DirectoryCache::Remove(int parent, char *name)
+{
+    DirectoryCacheEntry *e = &table[Hash(parent, name)];
+
+    if (e->valid && e->parent == parent
+			&& !strncmp(e->name, name, FileNameMaxLen))
+	e->valid = FALSE;
+}
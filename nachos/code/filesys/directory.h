@@ -4,7 +4,12 @@
 //      A directory is a table of pairs: <file name, sector #>,
 //	giving the name of each file in the directory, and 
 //	where to find its file header (the data structure describing
-//	where to find the file's data blocks) on disk.
+//	where to find the file's data blocks) on disk.  A directory
+//	entry may itself name a directory, making a tree of directories.
+//
+//	Recently looked up names are remembered in a cache of
+//	<directory, file name> -> sector # triples, so that opening the
+//	same path again does not read any directory sectors.
 //
 //      We assume mutual exclusion is provided by the caller.
 //
@@ -21,6 +26,9 @@
 
 #define FileNameMaxLen 		9	// for simplicity, we assume 
 					// file names are <= 9 characters long
+#define MaxDirEntries		512	// Largest directory table; growing
+					// a directory to it must fit in the
+					// journal (cf. journal.h)
 
 // The following class defines a "directory entry", representing a file
 // in the directory.  Each entry gives the name of the file, and where
@@ -32,6 +40,9 @@
 class DirectoryEntry {
   public:
     bool inUse;				// Is this directory entry in use?
+    bool wasUsed;			// Was it ever used?  Lookups have to
+					// go past deleted entries
+    bool isDirectory;			// Does it name a directory?
     int sector;				// Location on disk to find the 
 					//   FileHeader for this file 
     char name[FileNameMaxLen + 1];	// Text name for file, with +1 for 
@@ -41,12 +52,20 @@ class DirectoryEntry {
 // The following class defines a UNIX-like "directory".  Each entry in
 // the directory describes a file, and where to find it on disk.
 //
+// The table is a hash table with linear probing: a name is stored at
+// the first unused entry from the one its hash value picks.  Add grows
+// the table once it is three quarters full, so a lookup reads only one
+// or two entries, up to MaxDirEntries entries; a directory can hold
+// three quarters as many files.
+//
 // The directory data structure can be stored in memory, or on disk.
-// When it is on disk, it is stored as a regular Nachos file.
+// When it is on disk, it is stored as a regular Nachos file, which
+// the caller extends to Size() bytes before WriteBack.
 //
 // The constructor initializes a directory structure in memory; the
 // FetchFrom/WriteBack operations shuffle the directory information
-// from/to disk. 
+// from/to disk.  Lookup finds a single name on disk, reading only the
+// entries it probes.
 
 class Directory {
   public:
@@ -60,11 +79,21 @@ class Directory {
 
     int Find(char *name);		// Find the sector number of the 
 					// FileHeader for file: "name"
+    static int Lookup(OpenFile *file, char *name, bool *isDirectory);
+					// Same, straight from the directory
+					// stored in "file"
 
-    bool Add(char *name, int newSector);  // Add a file name into the directory
+    bool Add(char *name, int newSector, bool isDirectory);
+					// Add a file name into the directory
+    int RehashSectors();		// Sectors of the new table, if Add
+					// is to rehash the table, else 0
 
     bool Remove(char *name);		// Remove a file from the directory
 
+    bool IsEmpty() { return numInUse == 0; }
+    int Size() { return tableSize * sizeof(DirectoryEntry); }
+					// Bytes needed to store the directory
+
     void List();			// Print the names of all the files
 					//  in the directory
     void Print();			// Verbose print of the contents
@@ -75,9 +104,53 @@ class Directory {
     int tableSize;			// Number of directory entries
     DirectoryEntry *table;		// Table of pairs: 
 					// <file name, file header location> 
+    int numInUse;			// Entries in use
+    int numWasUsed;			// Entries in use or deleted
 
     int FindIndex(char *name);		// Find the index into the directory 
 					//  table corresponding to "name"
+    void Rehash(int newSize);		// Move the entries in use to a 
+					//  new table of "newSize" entries
+    int RehashSize();			// Size of the table Add rehashes
+					//  into, 0 if none, -1 if full
+};
+
+// The following class defines a cache of directory lookups.  Each
+// entry maps a file name in a given directory (known by the sector of
+// its file header) to the sector of the file's header.  The cache is
+// direct mapped: a new entry replaces whatever was in its slot.
+//
+// Only successful lookups are cached, and removing a file removes its
+// entry, so an entry is never out of date.  An empty directory has no
+// entries in the cache, so reusing the sector of a removed directory
+// cannot bring back stale names.
+
+class DirectoryCacheEntry {
+  public:
+    bool valid;				// Does this slot hold a lookup?
+    int parent;				// Header sector of the directory
+    char name[FileNameMaxLen + 1];	// File name in that directory
+    int sector;				// Header sector of the file
+    bool isDirectory;			// Is the file a directory?
+};
+
+class DirectoryCache {
+  public:
+    DirectoryCache(int size);		// Initialize an empty cache
+    ~DirectoryCache();
+
+    int Find(int parent, char *name, bool *isDirectory);
+					// Return the sector for "name" in
+					// "parent", or -1 if not cached
+    void Enter(int parent, char *name, int sector, bool isDirectory);
+					// Remember a lookup
+    void Remove(int parent, char *name); // Forget a lookup
+
+  private:
+    int tableSize;
+    DirectoryCacheEntry *table;
+
+    int Hash(int parent, char *name);	// Slot for <parent, name>
 };
 
 #endif // DIRECTORY_H
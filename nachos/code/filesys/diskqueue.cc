@@ -0,0 +1,220 @@
+// diskqueue.cc 
+//	Routines to queue and reorder requests to the raw disk.
+//
+//	Requests are kept on a singly linked list in order of arrival.
+//	Each time the disk finishes a request, the policy picks the next
+//	one to serve by looking at the position of the head (the sector of
+//	the last request) -- the list is short enough that a linear scan
+//	beats keeping it sorted.  Distances are measured in sectors, which
+//	orders requests by track first since sectors are numbered track 
+//	by track.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "diskqueue.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// DiskQueueDone
+// 	Disk interrupt handler.  Need this to be a C routine, because 
+//	C++ can't handle pointers to member functions.
+//----------------------------------------------------------------------
+
+static void
+DiskQueueDone (int arg)
+{
+    DiskQueue* queue = (DiskQueue *)arg;
+
+    queue->RequestDone();
+}
+
+//----------------------------------------------------------------------
+// DiskQueue::DiskQueue
+// 	Initialize an empty request queue, and the physical disk behind it.
+//
+//	"name" -- UNIX file name to be used as storage for the disk data
+//	"order" -- the order in which to serve requests (DISK_*)
+//	"ioMode" -- how the disk gets at the UNIX file (DISK_IO_*)
+//----------------------------------------------------------------------
+
+DiskQueue::DiskQueue(char* name, int order, int ioMode)
+{
+    ASSERT((order >= DISK_FCFS) && (order <= DISK_CLOOK));
+    policy = order;
+    pending = NULL;
+    numPending = 0;
+    active = NULL;
+    headSector = 0;
+    goingUp = TRUE;
+    disk = new Disk(name, DiskQueueDone, (int) this, ioMode);
+}
+
+//----------------------------------------------------------------------
+// DiskQueue::~DiskQueue
+// 	De-allocate the queue.  Requests still pending are dropped.
+//----------------------------------------------------------------------
+
+DiskQueue::~DiskQueue()
+{
+    DiskRequest *req;
+
+    while (pending != NULL) {
+	req = pending;
+	pending = pending->next;
+	delete req;
+    }
+    delete active;
+    delete disk;
+}
+
+//----------------------------------------------------------------------
+// DiskQueue::Submit
+// 	Queue a request to read or write a run of consecutive disk sectors.
+//	If the disk is idle, the request is sent to it right away.
+//
+//	"firstSector", "numSectors" -- the disk sectors to read/write
+//	"data" -- data[i] is the buffer for sector firstSector + i; the
+//		array must stay around until the request is complete
+//	"writing" -- TRUE for a write request
+//	"callWhenDone", "callArg" -- called once the request is complete
+//----------------------------------------------------------------------
+
+void
+DiskQueue::Submit(int firstSector, int numSectors, char** data, 
+		  bool writing, VoidFunctionPtr callWhenDone, int callArg)
+{
+    DiskRequest *req = new DiskRequest, **tail;
+    IntStatus oldLevel;
+
+    ASSERT((firstSector >= 0) && (numSectors > 0)
+			&& ((firstSector + numSectors) <= NumSectors));
+    req->sector = firstSector;
+    req->numSectors = numSectors;
+    req->data = data;
+    req->writing = writing;
+    req->callWhenDone = callWhenDone;
+    req->callArg = callArg;
+    req->next = NULL;
+
+    oldLevel = interrupt->SetLevel(IntOff);
+    req->arrival = stats->totalTicks;
+    for (tail = &pending; *tail != NULL; tail = &(*tail)->next)
+	;
+    *tail = req;
+    numPending++;
+
+    // Queue depth as seen by the new request, counting the one being
+    // served
+    stats->numDiskRequests++;
+    stats->diskQueueDepthSum += numPending + ((active != NULL) ? 1 : 0);
+    if (numPending > stats->maxDiskQueueDepth)
+	stats->maxDiskQueueDepth = numPending;
+    DEBUG('d', "Queued %s of %d sectors at %d, %d pending\n", 
+		writing ? "write" : "read", numSectors, firstSector, numPending);
+
+    if (active == NULL)
+	StartNext();
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// DiskQueue::PickNext
+// 	Remove and return the pending request that the policy wants to
+//	serve next.  The pending list must not be empty.
+//
+//	DISK_FCFS takes the oldest request.  DISK_SSTF takes the one
+//	nearest to the head.  DISK_SCAN takes the nearest one in the
+//	direction the head is sweeping, turning around when there is
+//	none left that way.  DISK_CLOOK only sweeps upwards; when nothing
+//	is left above the head, it goes back to the lowest pending sector.
+//	Ties go to the oldest request, which also keeps requests for the
+//	same sector in order.
+//----------------------------------------------------------------------
+
+DiskRequest *
+DiskQueue::PickNext()
+{
+    DiskRequest **best = &pending, **p;
+    DiskRequest *req;
+    int distance, bestDistance = -1;
+
+    ASSERT(pending != NULL);
+    if (policy == DISK_SCAN) {
+	// Turn around if nothing is left in the current direction
+	for (p = &pending; *p != NULL; p = &(*p)->next)
+	    if (goingUp ? ((*p)->sector >= headSector)
+			: ((*p)->sector <= headSector))
+		break;
+	if (*p == NULL)
+	    goingUp = !goingUp;
+    }
+    if (policy != DISK_FCFS) {
+	for (p = &pending; *p != NULL; p = &(*p)->next) {
+	    distance = (*p)->sector - headSector;
+	    switch (policy) {
+	      case DISK_SSTF:
+		distance = abs(distance);
+		break;
+	      case DISK_SCAN:
+		if (!goingUp) distance = -distance;
+		if (distance < 0) continue;	// behind the head
+		break;
+	      case DISK_CLOOK:
+		if (distance < 0) distance += NumSectors;	// next sweep
+		break;
+	    }
+	    if ((bestDistance == -1) || (distance < bestDistance)) {
+		best = p;
+		bestDistance = distance;
+	    }
+	}
+    }
+    req = *best;
+    *best = req->next;
+    numPending--;
+    return req;
+}
+
+//----------------------------------------------------------------------
+// DiskQueue::StartNext
+// 	Send the next request, if any, to the (idle) disk.  Called with
+//	interrupts disabled.
+//----------------------------------------------------------------------
+
+void
+DiskQueue::StartNext()
+{
+    ASSERT(active == NULL);
+    if (pending == NULL)
+	return;
+    active = PickNext();
+    stats->diskSeekTracks += abs(active->sector / SectorsPerTrack
+					- headSector / SectorsPerTrack);
+    headSector = active->sector + active->numSectors - 1;
+    if (active->writing)
+	disk->WriteVector(active->sector, active->numSectors, active->data);
+    else
+	disk->ReadVector(active->sector, active->numSectors, active->data);
+}
+
+//----------------------------------------------------------------------
+// DiskQueue::RequestDone
+// 	Disk interrupt handler.  Tell the owner of the request that it is
+//	done, and keep the disk busy with the next one.
+//----------------------------------------------------------------------
+
+void
+DiskQueue::RequestDone()
+{
+    DiskRequest *req = active;
+
+    ASSERT(req != NULL);
+    active = NULL;
+    stats->diskResponseTicks += stats->totalTicks - req->arrival;
+    StartNext();
+    (*req->callWhenDone)(req->callArg);
+    delete req;
+}
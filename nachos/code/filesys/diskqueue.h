@@ -0,0 +1,82 @@
+// diskqueue.h 
+//	Data structures to queue requests in front of the raw disk.
+//
+//	The physical disk accepts one request at a time, and its latency
+//	depends on how far the head has to move.  When several threads
+//	use the disk at once, the order in which their requests are sent
+//	to it decides how much of the time goes to seeking.  A DiskQueue
+//	accepts any number of requests, and sends them to the disk one at
+//	a time in the order chosen by a disk scheduling policy.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef DISKQUEUE_H
+#define DISKQUEUE_H
+
+#include "disk.h"
+
+// Disk scheduling policies (-ds)
+#define DISK_FCFS	0	// in order of arrival
+#define DISK_SSTF	1	// nearest sector first
+#define DISK_SCAN	2	// elevator: sweep up, then down
+#define DISK_CLOOK	3	// sweep up only, then jump back to the
+				// lowest pending sector
+
+// The following class defines a pending disk request, for a run of
+// consecutive sectors.  When the disk is done with it, 
+// (*callWhenDone)(callArg) is invoked from the disk interrupt handler.
+
+class DiskRequest {
+  public:
+    int sector;				// first sector to read or write
+    int numSectors;			// number of sectors
+    char **data;			// where each sector goes or comes from
+    bool writing;			// write request?
+    VoidFunctionPtr callWhenDone;	// completion callback
+    int callArg;			// and its argument
+    int arrival;			// when the request was queued
+    DiskRequest *next;			// next pending request
+};
+
+// The following class defines an asynchronous disk request queue.
+// As with the raw disk, Submit returns at once, and the completion
+// callback is called later on, with interrupts disabled.
+
+class DiskQueue {
+  public:
+    DiskQueue(char* name, int order, int ioMode);
+					// Create the queue and the raw
+					// disk behind it
+    ~DiskQueue();
+
+    void Submit(int firstSector, int numSectors, char** data, 
+		bool writing, VoidFunctionPtr callWhenDone, int callArg);
+					// Queue a request; never blocks
+
+    void Flush() { disk->Flush(); }	// Make sure completed writes are
+					// in the UNIX file
+
+    void RequestDone();			// Called by the disk interrupt
+					// handler when the request being
+					// served is complete
+
+  private:
+    Disk *disk;				// Raw disk device
+    int policy;				// One of DISK_*
+    DiskRequest *pending;		// Requests not yet sent to the disk,
+					// in order of arrival
+    int numPending;			// Length of the pending list
+    DiskRequest *active;		// Request the disk is serving, or NULL
+    int headSector;			// Last sector of the last request sent
+    bool goingUp;			// Direction of the sweep (DISK_SCAN)
+
+    DiskRequest *PickNext();		// Remove the next request to serve
+					// from the pending list
+    void StartNext();			// Send it to the disk
+};
+
+#endif // DISKQUEUE_H
@@ -3,12 +3,12 @@
 //	would be called the i-node).
 //
 //	The file header is used to locate where on disk the 
-//	file's data is stored.  We implement this as a fixed size
-//	table of pointers -- each entry in the table points to the 
-//	disk sector containing that portion of the file data
-//	(in other words, there are no indirect or doubly indirect 
-//	blocks). The table size is chosen so that the file header
-//	will be just big enough to fit in one disk sector, 
+//	file's data is stored.  We implement this as a table of extents
+//	-- each entry in the table gives the first disk sector and the 
+//	number of sectors of a run of the file data that is contiguous
+//	on disk.  The first few extents are in the header sector; the
+//	rest go in a single indirect block and, for very fragmented files,
+//	in indirect blocks found through a double indirect block.
 //
 //      Unlike in a real system, we do not keep track of file permissions, 
 //	ownership, last modification date, etc., in the file header. 
@@ -27,33 +27,135 @@
 #include "system.h"
 #include "filehdr.h"
 
+// The part of FileHeader stored in the header sector
+#define HeaderSize	(6 * sizeof(int) + NumDirect * sizeof(Extent))
+
+//----------------------------------------------------------------------
+// FileHeader::FileHeader
+// 	Initialize an empty file header; it gets its contents from 
+//	Allocate or FetchFrom.
+//----------------------------------------------------------------------
+
+FileHeader::FileHeader()
+{
+    numBytes = numSectors = numExtents = 0;
+    indirect = doubleIndirect = -1;
+    extents = NULL;
+    blocks = NULL;
+    lastExtent = lastExtentFirst = 0;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::~FileHeader
+// 	De-allocate the in-memory extent table.
+//----------------------------------------------------------------------
+
+FileHeader::~FileHeader()
+{
+    delete [] extents;
+    delete [] blocks;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::NumBlocks, FileHeader::BlocksFor
+// 	Return how many indirect blocks (single, double, and those under
+//	the double) are needed to hold numExtents, or "extents", extents.
+//----------------------------------------------------------------------
+
+int
+FileHeader::NumBlocks()
+{
+    return BlocksFor(numExtents);
+}
+
+int
+FileHeader::BlocksFor(int extents)
+{
+    int beyond = extents - (int) NumDirect;
+
+    if (beyond <= 0)
+	return 0;
+    if (beyond <= (int) ExtentsPerBlock)
+	return 1;
+    return 2 + divRoundUp(beyond - ExtentsPerBlock, ExtentsPerBlock);
+}
+
+//----------------------------------------------------------------------
+// FileHeader::MaxBlocks
+// 	Return how many indirect blocks a file of "fileSize" bytes needs
+//	if its free sectors are as scattered as can be, one extent each.
+//	Creating the file modifies them all, so this is what the journal
+//	must make room for.
+//----------------------------------------------------------------------
+
+int
+FileHeader::MaxBlocks(int fileSize)
+{
+    return BlocksFor(min(divRoundUp(fileSize, SectorSize), (int) MaxExtents));
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Allocate
 // 	Initialize a fresh file header for a newly created file.
-//	Allocate data blocks for the file out of the map of free disk blocks.
+//	Allocate data blocks for the file out of the map of free disk blocks,
+//	as few runs of consecutive sectors as possible.
 //	Return FALSE if there are not enough free blocks to accomodate
-//	the new file.
+//	the new file, or if they are too scattered for the extent table,
+//	or for "maxBlocks" indirect blocks.
 //
 //	"freeMap" is the bit map of free disk sectors
-//	"fileSize" is the bit map of free disk sectors
+//	"fileSize" is the size of the new file, in bytes
+//	"maxBlocks" is the most indirect blocks the caller can write back
+//	  (MaxBlocks(fileSize), if there is no limit)
 //----------------------------------------------------------------------
 
 bool
-FileHeader::Allocate(BitMap *freeMap, int fileSize)
+FileHeader::Allocate(BitMap *freeMap, int fileSize, int maxBlocks)
 { 
+    int remaining, length, i;
+
     numBytes = fileSize;
     numSectors  = divRoundUp(fileSize, SectorSize);
+    numExtents = 0;
+    indirect = doubleIndirect = -1;
+    delete [] extents;
+    delete [] blocks;
+    extents = new Extent[MaxExtents];
+    blocks = new int[BlocksPerDouble];
+    lastExtent = lastExtentFirst = 0;
     if (freeMap->NumClear() < numSectors)
 	return FALSE;		// not enough space
 
-    for (int i = 0; i < numSectors; i++)
-	dataSectors[i] = freeMap->Find();
+    for (remaining = numSectors; remaining > 0; remaining -= length) {
+	if (numExtents == (int) MaxExtents) {
+	    Deallocate(freeMap);	// too fragmented
+	    return FALSE;
+	}
+	extents[numExtents].start = freeMap->FindRun(remaining, &length);
+	extents[numExtents].length = length;
+	numExtents++;
+    }
+    DEBUG('f', "Allocated %d sectors in %d extents\n", numSectors, numExtents);
+
+    // Now the indirect blocks, if the extents do not fit in the header
+    if ((NumBlocks() > maxBlocks) || (freeMap->NumClear() < NumBlocks())) {
+	Deallocate(freeMap);
+	return FALSE;
+    }
+    if (NumBlocks() > 0)
+	indirect = freeMap->Find();
+    if (NumBlocks() > 1) {
+	doubleIndirect = freeMap->Find();
+	for (i = 0; i < NumBlocks() - 2; i++)
+	    blocks[i] = freeMap->Find();
+    }
     return TRUE;
 }
 
 //----------------------------------------------------------------------
 // FileHeader::Deallocate
-// 	De-allocate all the space allocated for data blocks for this file.
+// 	De-allocate all the space allocated for data blocks for this file,
+//	and for its indirect blocks.
 //
 //	"freeMap" is the bit map of free disk sectors
 //----------------------------------------------------------------------
@@ -61,15 +163,96 @@ FileHeader::Allocate(BitMap *freeMap, int fileSize)
 void 
 FileHeader::Deallocate(BitMap *freeMap)
 {
-    for (int i = 0; i < numSectors; i++) {
-	ASSERT(freeMap->Test((int) dataSectors[i]));  // ought to be marked!
-	freeMap->Clear((int) dataSectors[i]);
+    int i, j;
+
+    for (i = 0; i < numExtents; i++) {
+	for (j = 0; j < extents[i].length; j++) {
+	    ASSERT(freeMap->Test(extents[i].start + j));  // ought to be marked!
+	    freeMap->Clear(extents[i].start + j);
+	}
+    }
+    if (indirect != -1)
+	freeMap->Clear(indirect);
+    if (doubleIndirect != -1) {
+	freeMap->Clear(doubleIndirect);
+	for (i = 0; i < NumBlocks() - 2; i++)
+	    freeMap->Clear(blocks[i]);
+    }
+}
+
+//----------------------------------------------------------------------
+// FileHeader::Extend
+// 	Grow the file to "newSize" bytes, allocating the new data blocks
+//	out of the map of free disk blocks.  The last extent is lengthened
+//	in place while the sectors after it are free; the rest goes in
+//	new extents, allocated the same way as in Allocate.
+//
+//	Return FALSE if there is not enough space.  In that case both the
+//	header and "freeMap" are left partly changed, and the caller must
+//	throw them away rather than write them back, as for any failed
+//	file system operation.
+//
+//	"freeMap" is the bit map of free disk sectors
+//	"newSize" is the new size of the file, in bytes
+//----------------------------------------------------------------------
+
+bool
+FileHeader::Extend(BitMap *freeMap, int newSize)
+{
+    int more = divRoundUp(newSize, SectorSize) - numSectors;
+    int oldBlocks = NumBlocks();
+    int next, length, i;
+    Extent *all;
+
+    if (newSize <= numBytes)
+	return TRUE;
+    if (freeMap->NumClear() < more)
+	return FALSE;		// not enough space
+
+    all = new Extent[MaxExtents];	// FetchFrom sizes the table exactly
+    bcopy((char *) extents, (char *) all, numExtents * sizeof(Extent));
+    delete [] extents;
+    extents = all;
+
+    if (numExtents > 0) {
+	next = extents[numExtents - 1].start + extents[numExtents - 1].length;
+	while (more > 0 && next < NumSectors && !freeMap->Test(next)) {
+	    freeMap->Mark(next++);
+	    extents[numExtents - 1].length++;
+	    numSectors++;
+	    more--;
+	}
+    }
+    for (; more > 0; more -= length) {
+	if (numExtents == (int) MaxExtents)
+	    return FALSE;		// too fragmented
+	extents[numExtents].start = freeMap->FindRun(more, &length);
+	extents[numExtents].length = length;
+	numExtents++;
+	numSectors += length;
     }
+
+    // New indirect blocks, for the extents that no longer fit
+    if (freeMap->NumClear() < NumBlocks() - oldBlocks)
+	return FALSE;
+    for (i = oldBlocks; i < NumBlocks(); i++) {
+	if (i == 0)
+	    indirect = freeMap->Find();
+	else if (i == 1)
+	    doubleIndirect = freeMap->Find();
+	else
+	    blocks[i - 2] = freeMap->Find();
+    }
+    numBytes = newSize;
+    DEBUG('f', "Extended file to %d sectors in %d extents\n", numSectors,
+								numExtents);
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
 // FileHeader::FetchFrom
-// 	Fetch contents of file header from disk. 
+// 	Fetch contents of file header from disk, along with its indirect
+//	blocks.
 //
 //	"sector" is the disk sector containing the file header
 //----------------------------------------------------------------------
@@ -77,12 +260,41 @@ FileHeader::Deallocate(BitMap *freeMap)
 void
 FileHeader::FetchFrom(int sector)
 {
-    synchDisk->ReadSector(sector, (char *)this);
+    char buf[SectorSize];
+    int i, count;
+
+    sectorCache->Read(sector, buf, 0, SectorSize, TRUE);
+    bcopy(buf, (char *) &numBytes, HeaderSize);
+    delete [] extents;
+    delete [] blocks;
+    extents = new Extent[numExtents];
+    blocks = new int[BlocksPerDouble];
+    lastExtent = lastExtentFirst = 0;
+
+    bcopy((char *) direct, (char *) extents, 
+		min(numExtents, (int) NumDirect) * sizeof(Extent));
+    if (indirect != -1) {
+	count = min(numExtents - NumDirect, ExtentsPerBlock);
+	sectorCache->Read(indirect, (char *) &extents[NumDirect], 0,
+				count * sizeof(Extent), TRUE);
+    }
+    if (doubleIndirect != -1) {
+	sectorCache->Read(doubleIndirect, (char *) blocks, 0,
+				(NumBlocks() - 2) * sizeof(int), TRUE);
+	for (i = 0; i < NumBlocks() - 2; i++) {
+	    count = min(numExtents - NumDirect - (i + 1) * ExtentsPerBlock,
+							ExtentsPerBlock);
+	    sectorCache->Read(blocks[i], 
+			(char *) &extents[NumDirect + (i + 1) * ExtentsPerBlock],
+			0, count * sizeof(Extent), TRUE);
+	}
+    }
 }
 
 //----------------------------------------------------------------------
 // FileHeader::WriteBack
-// 	Write the modified contents of the file header back to disk. 
+// 	Write the modified contents of the file header back to disk,
+//	along with its indirect blocks.
 //
 //	"sector" is the disk sector to contain the file header
 //----------------------------------------------------------------------
@@ -90,7 +302,34 @@ FileHeader::FetchFrom(int sector)
 void
 FileHeader::WriteBack(int sector)
 {
-    synchDisk->WriteSector(sector, (char *)this); 
+    char buf[SectorSize];
+    int i, count;
+
+    bzero(buf, SectorSize);
+    bcopy((char *) extents, (char *) direct, 
+		min(numExtents, (int) NumDirect) * sizeof(Extent));
+    bcopy((char *) &numBytes, buf, HeaderSize);
+    sectorCache->Write(sector, buf, 0, SectorSize, TRUE);
+
+    if (indirect != -1) {
+	bzero(buf, SectorSize);
+	count = min(numExtents - NumDirect, ExtentsPerBlock);
+	bcopy((char *) &extents[NumDirect], buf, count * sizeof(Extent));
+	sectorCache->Write(indirect, buf, 0, SectorSize, TRUE);
+    }
+    if (doubleIndirect != -1) {
+	bzero(buf, SectorSize);
+	bcopy((char *) blocks, buf, (NumBlocks() - 2) * sizeof(int));
+	sectorCache->Write(doubleIndirect, buf, 0, SectorSize, TRUE);
+	for (i = 0; i < NumBlocks() - 2; i++) {
+	    bzero(buf, SectorSize);
+	    count = min(numExtents - NumDirect - (i + 1) * ExtentsPerBlock,
+							ExtentsPerBlock);
+	    bcopy((char *) &extents[NumDirect + (i + 1) * ExtentsPerBlock], 
+				buf, count * sizeof(Extent));
+	    sectorCache->Write(blocks[i], buf, 0, SectorSize, TRUE);
+	}
+    }
 }
 
 //----------------------------------------------------------------------
@@ -106,7 +345,37 @@ FileHeader::WriteBack(int sector)
 int
 FileHeader::ByteToSector(int offset)
 {
-    return(dataSectors[offset / SectorSize]);
+    int runLength;
+
+    return ByteToSectorRun(offset, &runLength);
+}
+
+//----------------------------------------------------------------------
+// FileHeader::ByteToSectorRun
+// 	Return which disk sector is storing a particular byte within the 
+//	file, and how many sectors from that one to the end of its extent
+//	follow each other on disk.  The search starts from the extent 
+//	found last time, so sequential access costs nothing.
+//
+//	"offset" is the location within the file of the byte in question
+//	"runLength" is where to put the number of consecutive sectors
+//----------------------------------------------------------------------
+
+int
+FileHeader::ByteToSectorRun(int offset, int *runLength)
+{
+    int fileSector = offset / SectorSize;
+
+    ASSERT((fileSector >= 0) && (fileSector < numSectors));
+    if (fileSector < lastExtentFirst) {
+	lastExtent = lastExtentFirst = 0;	// going backwards: start over
+    }
+    while (fileSector >= (lastExtentFirst + extents[lastExtent].length)) {
+	lastExtentFirst += extents[lastExtent].length;
+	lastExtent++;
+    }
+    *runLength = extents[lastExtent].length - (fileSector - lastExtentFirst);
+    return extents[lastExtent].start + (fileSector - lastExtentFirst);
 }
 
 //----------------------------------------------------------------------
@@ -129,15 +398,16 @@ FileHeader::FileLength()
 void
 FileHeader::Print()
 {
-    int i, j, k;
+    int i, j, k, sector;
     char *data = new char[SectorSize];
 
-    printf("FileHeader contents.  File size: %d.  File blocks:\n", numBytes);
-    for (i = 0; i < numSectors; i++)
-	printf("%d ", dataSectors[i]);
+    printf("FileHeader contents.  File size: %d.  File extents:\n", numBytes);
+    for (i = 0; i < numExtents; i++)
+	printf("%d+%d ", extents[i].start, extents[i].length);
     printf("\nFile contents:\n");
     for (i = k = 0; i < numSectors; i++) {
-	synchDisk->ReadSector(dataSectors[i], data);
+	sector = ByteToSector(i * SectorSize);
+	sectorCache->Read(sector, data, 0, SectorSize, FALSE);
         for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++) {
 	    if ('\040' <= data[j] && data[j] <= '\176')   // isprint(data[j])
 		printf("%c", data[j]);
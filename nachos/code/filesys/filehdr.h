@@ -17,31 +17,62 @@
 #include "disk.h"
 #include "bitmap.h"
 
-#define NumDirect 	((SectorSize - 2 * sizeof(int)) / sizeof(int))
-#define MaxFileSize 	(NumDirect * SectorSize)
+// An extent is a run of consecutive disk sectors holding consecutive
+// data of a file.
+
+class Extent {
+  public:
+    int start;				// First disk sector of the run
+    int length;				// Number of sectors in the run
+};
+
+#define NumDirect 	((SectorSize - 6 * sizeof(int)) / sizeof(Extent))
+					// Extents in the header sector
+#define ExtentsPerBlock	(SectorSize / sizeof(Extent))
+					// Extents in an indirect block
+#define BlocksPerDouble	(SectorSize / sizeof(int))
+					// Indirect blocks listed by the
+					// double indirect block
+#define MaxExtents	(NumDirect + ExtentsPerBlock \
+				+ BlocksPerDouble * ExtentsPerBlock)
+#define MaxFileSize 	(NumSectors * SectorSize)
 
 // The following class defines the Nachos "file header" (in UNIX terms,  
 // the "i-node"), describing where on disk to find all of the data in the file.
-// The file header is organized as a simple table of pointers to
-// data blocks. 
+// The file header is organized as a table of extents, in file order.
+// The first NumDirect extents are in the header itself; the next 
+// ExtentsPerBlock are in a single indirect block, and the rest in
+// indirect blocks listed by a double indirect block.  Files are laid 
+// out contiguously whenever the free map allows, so most files need
+// only one or two extents, and a file may be as large as the disk.
 //
 // The file header data structure can be stored in memory or on disk.
-// When it is on disk, it is stored in a single sector -- this means
-// that we assume the size of this data structure to be the same
-// as one disk sector.  Without indirect addressing, this
-// limits the maximum file length to just under 4K bytes.
+// When it is on disk, it is stored in a single sector (plus the 
+// indirect blocks).  In memory, we also keep the whole extent table
+// in one array, and remember the last extent looked up, so that 
+// sequential access finds its sector right away.
 //
-// There is no constructor; rather the file header can be initialized
-// by allocating blocks for the file (if it is a new file), or by
-// reading it from disk.
+// The file header is initialized by allocating blocks for the file 
+// (if it is a new file), or by reading it from disk.
 
 class FileHeader {
   public:
-    bool Allocate(BitMap *bitMap, int fileSize);// Initialize a file header, 
-						//  including allocating space 
-						//  on disk for the file data
+    FileHeader();			// Create an empty file header
+    ~FileHeader();
+
+    bool Allocate(BitMap *bitMap, int fileSize, int maxBlocks);
+					// Initialize a file header, 
+					//  including allocating space 
+					//  on disk for the file data, in
+					//  at most "maxBlocks" indirect 
+					//  blocks
+    static int MaxBlocks(int fileSize);	// Indirect blocks a file of
+					//  "fileSize" bytes needs, at worst
     void Deallocate(BitMap *bitMap);  		// De-allocate this file's 
 						//  data blocks
+    bool Extend(BitMap *bitMap, int newSize);	// Allocate more data blocks,
+						//  to make the file "newSize"
+						//  bytes long
 
     void FetchFrom(int sectorNumber); 	// Initialize file header from disk
     void WriteBack(int sectorNumber); 	// Write modifications to file header
@@ -50,6 +81,10 @@ class FileHeader {
     int ByteToSector(int offset);	// Convert a byte offset into the file
 					// to the disk sector containing
 					// the byte
+    int ByteToSectorRun(int offset, int *runLength);
+					// Same, and put in "runLength" how
+					// many sectors from that one on are
+					// consecutive on the disk
 
     int FileLength();			// Return the length of the file 
 					// in bytes
@@ -57,10 +92,27 @@ class FileHeader {
     void Print();			// Print the contents of the file.
 
   private:
+    // Stored in the header sector
     int numBytes;			// Number of bytes in the file
     int numSectors;			// Number of data sectors in the file
-    int dataSectors[NumDirect];		// Disk sector numbers for each data 
-					// block in the file
+    int numExtents;			// Number of extents
+    int indirect;			// Sector of the indirect block,
+					// or -1
+    int doubleIndirect;			// Sector of the double indirect
+					// block, or -1
+    int unused;
+    Extent direct[NumDirect];		// The first extents
+
+    // In memory only
+    Extent *extents;			// All the extents
+    int *blocks;			// Sectors of the indirect blocks
+					// under the double indirect block
+    int lastExtent;			// Last extent looked up, and the
+    int lastExtentFirst;		// file sector it starts at
+
+    int NumBlocks();			// Number of indirect blocks needed
+					// for numExtents extents
+    static int BlocksFor(int extents);	// Same, for "extents" extents
 };
 
 #endif // FILEHDR_H
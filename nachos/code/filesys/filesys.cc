@@ -11,33 +11,39 @@
 //
 // 	The file system consists of several data structures:
 //	   A bitmap of free disk sectors (cf. bitmap.h)
-//	   A directory of file names and file headers
+//	   A tree of directories of file names and file headers
 //
-//      Both the bitmap and the directory are represented as normal
-//	files.  Their file headers are located in specific sectors
-//	(sector 0 and sector 1), so that the file system can find them 
-//	on bootup.
+//      Both the bitmap and the directories are represented as normal
+//	files.  The file headers of the bitmap and of the root directory
+//	are located in specific sectors (sector 0 and sector 1), so that
+//	the file system can find them on bootup.  Other directories are
+//	found by name, like any other file.
+//
+//	A file name is a path of directory names ending with the name of
+//	the file, separated by '/'.  Paths are always taken from the root
+//	directory, so "a" and "/a" are the same file.  Each name in a path
+//	is looked up first in a cache of recent lookups, and then in the
+//	hashed directory on disk.
 //
 //	The file system assumes that the bitmap and directory files are
 //	kept "open" continuously while Nachos is running.
 //
 //	For those operations (such as Create, Remove) that modify the
 //	directory and/or bitmap, if the operation succeeds, the changes
-//	are written immediately back to disk (the two files are kept
-//	open during all this time).  If the operation fails, and we have
-//	modified part of the directory and/or bitmap, we simply discard
-//	the changed version, without writing it back to disk.
+//	are written immediately back to the sector cache (the two files
+//	are kept open during all this time), as one journal transaction.
+//	If the operation fails, and we have modified part of the directory
+//	and/or bitmap, we simply discard the changed version, without
+//	writing it back.
 //
 // 	Our implementation at this point has the following restrictions:
 //
 //	   there is no synchronization for concurrent accesses
 //	   files have a fixed size, set when the file is created
-//	   files cannot be bigger than about 3KB in size
-//	   there is no hierarchical directory structure, and only a limited
-//	     number of files can be added to the system
-//	   there is no attempt to make the system robust to failures
-//	    (if Nachos exits in the middle of an operation that modifies
-//	    the file system, it may corrupt the disk)
+//	     (except for directories, which grow as they fill up)
+//	   only the metadata is made robust to failures: the operations
+//	    that change the bitmap, directories and file headers are
+//	    journaled (cf. journal.h), but the data in files is not
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -50,6 +56,7 @@
 #include "directory.h"
 #include "filehdr.h"
 #include "filesys.h"
+#include "system.h"
 
 // Sectors containing the file headers for the bitmap of free sectors,
 // and the directory of files.  These file headers are placed in well-known 
@@ -57,13 +64,33 @@
 #define FreeMapSector 		0
 #define DirectorySector 	1
 
-// Initial file sizes for the bitmap and directory; until the file system
-// supports extensible files, the directory size sets the maximum number 
-// of files that can be loaded onto the disk.
+// Initial file sizes for the bitmap and directories; a directory file
+// is extended when its table has to grow.
 #define FreeMapFileSize 	(NumSectors / BitsInByte)
-#define NumDirEntries 		10
+#define NumDirEntries 		16
 #define DirectoryFileSize 	(sizeof(DirectoryEntry) * NumDirEntries)
 
+// Number of lookups remembered by the directory lookup cache
+#define DirCacheSize		128
+
+//----------------------------------------------------------------------
+// LogReservation
+// 	Return the number of metadata sectors that creating a file may
+//	modify, if it grows its directory to a table of "tableSectors" 
+//	sectors (0 if it does not): on top of the usual ones, the new
+//	table, and the indirect blocks of the directory file that may
+//	list its new sectors, if they take one extent each.
+//----------------------------------------------------------------------
+
+static int
+LogReservation(int tableSectors)
+{
+    if (tableSectors == 0)
+	return MaxOpSectors;
+    return MaxOpSectors + tableSectors 
+		+ divRoundUp(tableSectors, ExtentsPerBlock) + 2;
+}
+
 //----------------------------------------------------------------------
 // FileSystem::FileSystem
 // 	Initialize the file system.  If format = TRUE, the disk has
@@ -80,6 +107,11 @@
 FileSystem::FileSystem(bool format)
 { 
     DEBUG('f', "Initializing the file system.\n");
+    // The largest directory growth, and one ordinary operation next to
+    // it, must fit in a group, or they would wait for each other forever
+    ASSERT(LogReservation(divRoundUp(MaxDirEntries * sizeof(DirectoryEntry),
+			SectorSize)) + MaxOpSectors <= MaxGroupSectors);
+    dirCache = new DirectoryCache(DirCacheSize);
     if (format) {
         BitMap *freeMap = new BitMap(NumSectors);
         Directory *directory = new Directory(NumDirEntries);
@@ -88,16 +120,21 @@ FileSystem::FileSystem(bool format)
 
         DEBUG('f', "Formatting the file system.\n");
 
-    // First, allocate space for FileHeaders for the directory and bitmap
-    // (make sure no one else grabs these!)
+    // First, allocate space for FileHeaders for the directory and bitmap,
+    // and for the journal (make sure no one else grabs these!)
 	freeMap->Mark(FreeMapSector);	    
 	freeMap->Mark(DirectorySector);
+	for (int i = JournalSector; i < LogSector + JournalSize; i++)
+	    freeMap->Mark(i);
+	journal->Format();
 
     // Second, allocate space for the data blocks containing the contents
     // of the directory and bitmap files.  There better be enough space!
 
-	ASSERT(mapHdr->Allocate(freeMap, FreeMapFileSize));
-	ASSERT(dirHdr->Allocate(freeMap, DirectoryFileSize));
+	ASSERT(mapHdr->Allocate(freeMap, FreeMapFileSize, 
+				FileHeader::MaxBlocks(FreeMapFileSize)));
+	ASSERT(dirHdr->Allocate(freeMap, DirectoryFileSize, 
+				FileHeader::MaxBlocks(DirectoryFileSize)));
 
     // Flush the bitmap and directory FileHeaders back to disk
     // We need to do this before we can "Open" the file, since open
@@ -114,6 +151,8 @@ FileSystem::FileSystem(bool format)
 
         freeMapFile = new OpenFile(FreeMapSector);
         directoryFile = new OpenFile(DirectorySector);
+        freeMapFile->KeepResident();
+        directoryFile->KeepResident();
      
     // Once we have the files "open", we can write the initial version
     // of each file back to disk.  The directory at this point is completely
@@ -135,10 +174,14 @@ FileSystem::FileSystem(bool format)
 	delete dirHdr;
 	}
     } else {
-    // if we are not formatting the disk, just open the files representing
+    // if we are not formatting the disk, finish any operations committed
+    // to the journal before a crash, then just open the files representing
     // the bitmap and directory; these are left open while Nachos is running
+	journal->Recover();
         freeMapFile = new OpenFile(FreeMapSector);
         directoryFile = new OpenFile(DirectorySector);
+        freeMapFile->KeepResident();
+        directoryFile->KeepResident();
     }
 }
 
@@ -148,44 +191,98 @@ FileSystem::FileSystem(bool format)
 //	Since we can't increase the size of files dynamically, we have
 //	to give Create the initial size of the file.
 //
+//	Return TRUE if everything goes ok, otherwise, return FALSE.
+//	See CreateEntry for how it is done.
+//
+//	"name" -- path of file to be created
+//	"initialSize" -- size of file to be created
+//----------------------------------------------------------------------
+
+bool
+FileSystem::Create(char *name, int initialSize)
+{
+    DEBUG('f', "Creating file %s, size %d\n", name, initialSize);
+    return CreateEntry(name, initialSize, FALSE);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::MakeDirectory
+// 	Create an empty directory in the Nachos file system (similar to 
+//	UNIX mkdir).  Return TRUE if everything goes ok, otherwise, 
+//	return FALSE.
+//
+//	"name" -- path of directory to be created
+//----------------------------------------------------------------------
+
+bool
+FileSystem::MakeDirectory(char *name)
+{
+    DEBUG('f', "Creating directory %s\n", name);
+    return CreateEntry(name, DirectoryFileSize, TRUE);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::CreateEntry
+// 	Create a file or a directory.
+//
 //	The steps to create a file are:
+//	  Find the directory that is to hold it
 //	  Make sure the file doesn't already exist
 //        Allocate a sector for the file header
-// 	  Allocate space on disk for the data blocks for the file
 //	  Add the name to the directory
+// 	  Allocate space on disk for the data blocks for the file
+//	  Extend the directory file, if its table grew
 //	  Store the new file header on disk 
 //	  Flush the changes to the bitmap and the directory back to disk
 //
+//	A new directory also gets an empty table written into it.
+//
 //	Return TRUE if everything goes ok, otherwise, return FALSE.
 //
 // 	Create fails if:
+//		a directory on the path does not exist
 //   		file is already in directory
 //	 	no free space for file header
-//	 	no free entry for file in directory
 //	 	no free space for data blocks for the file 
+//		free space too scattered for the room left in the journal
+//		  group (only for very large files)
+//		no free space to grow the directory
 //
 // 	Note that this implementation assumes there is no concurrent access
 //	to the file system!
 //
-//	"name" -- name of file to be created
+//	"name" -- path of file to be created
 //	"initialSize" -- size of file to be created
+//	"isDirectory" -- is it a directory?
 //----------------------------------------------------------------------
 
 bool
-FileSystem::Create(char *name, int initialSize)
+FileSystem::CreateEntry(char *name, int initialSize, bool isDirectory)
 {
     Directory *directory;
     BitMap *freeMap;
     FileHeader *hdr;
-    int sector;
+    OpenFile *dirFile, *newFile;
+    char last[FileNameMaxLen + 1];
+    int parent, sector, reservation, maxBlocks;
     bool success;
 
-    DEBUG('f', "Creating file %s, size %d\n", name, initialSize);
+    parent = FindParent(name, last);
+    if (parent == -1 || last[0] == '\0')
+	return FALSE;			// no such directory, or no name
 
+    dirFile = OpenDirectory(parent);
     directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
-
-    if (directory->Find(name) != -1)
+    directory->FetchFrom(dirFile);
+    reservation = LogReservation(directory->RehashSectors());
+    maxBlocks = min(FileHeader::MaxBlocks(initialSize), 
+			MaxGroupSectors - reservation);
+    reservation += maxBlocks;
+    journal->Begin(reservation);	// room for all of the table, if
+					// it is to grow, and for the
+					// indirect blocks of the file
+
+    if (directory->Find(last) != -1)
       success = FALSE;			// file is already in directory
     else {	
         freeMap = new BitMap(NumSectors);
@@ -193,24 +290,38 @@ FileSystem::Create(char *name, int initialSize)
         sector = freeMap->Find();	// find a sector to hold the file header
     	if (sector == -1) 		
             success = FALSE;		// no free block for file header 
-        else if (!directory->Add(name, sector))
+        else if (!directory->Add(last, sector, isDirectory))
             success = FALSE;	// no space in directory
 	else {
     	    hdr = new FileHeader;
-	    if (!hdr->Allocate(freeMap, initialSize))
+	    if (!hdr->Allocate(freeMap, initialSize, maxBlocks))
             	success = FALSE;	// no space on disk for data
+	    else if (!dirFile->Extend(freeMap, directory->Size()))
+		success = FALSE;	// no space to grow the directory
 	    else {	
 	    	success = TRUE;
 		// everthing worked, flush all changes back to disk
     	    	hdr->WriteBack(sector); 		
-    	    	directory->WriteBack(directoryFile);
+		if (isDirectory) {
+		    Directory *empty = new Directory(NumDirEntries);
+
+		    newFile = new OpenFile(sector);
+		    newFile->KeepResident();	// journal its table
+		    empty->WriteBack(newFile);
+		    delete newFile;
+		    delete empty;
+		}
+    	    	directory->WriteBack(dirFile);
     	    	freeMap->WriteBack(freeMapFile);
+		dirCache->Enter(parent, last, sector, isDirectory);
 	    }
             delete hdr;
 	}
         delete freeMap;
     }
     delete directory;
+    CloseDirectory(dirFile);
+    journal->End(reservation);
     return success;
 }
 
@@ -218,40 +329,43 @@ FileSystem::Create(char *name, int initialSize)
 // FileSystem::Open
 // 	Open a file for reading and writing.  
 //	To open a file:
-//	  Find the location of the file's header, using the directory 
+//	  Find the location of the file's header, using the directories 
 //	  Bring the header into memory
 //
-//	"name" -- the text name of the file to be opened
+//	"name" -- the path of the file to be opened
 //----------------------------------------------------------------------
 
 OpenFile *
 FileSystem::Open(char *name)
 { 
-    Directory *directory = new Directory(NumDirEntries);
     OpenFile *openFile = NULL;
-    int sector;
+    char last[FileNameMaxLen + 1];
+    int parent, sector = -1;
+    bool isDirectory;
 
     DEBUG('f', "Opening file %s\n", name);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name); 
+    parent = FindParent(name, last);
+    if (parent != -1 && last[0] != '\0')
+	sector = LookupName(parent, last, &isDirectory);
     if (sector >= 0) 		
 	openFile = new OpenFile(sector);	// name was found in directory 
-    delete directory;
     return openFile;				// return NULL if not found
 }
 
 //----------------------------------------------------------------------
 // FileSystem::Remove
 // 	Delete a file from the file system.  This requires:
-//	    Remove it from the directory
+//	    Remove it from its directory
 //	    Delete the space for its header
 //	    Delete the space for its data blocks
 //	    Write changes to directory, bitmap back to disk
 //
+//	A directory can only be removed once it is empty.
+//
 //	Return TRUE if the file was deleted, FALSE if the file wasn't
-//	in the file system.
+//	in the file system, or is a directory that is not empty.
 //
-//	"name" -- the text name of the file to be removed
+//	"name" -- the path of the file to be removed
 //----------------------------------------------------------------------
 
 bool
@@ -260,15 +374,32 @@ FileSystem::Remove(char *name)
     Directory *directory;
     BitMap *freeMap;
     FileHeader *fileHdr;
-    int sector;
+    OpenFile *dirFile;
+    char last[FileNameMaxLen + 1];
+    int parent, sector;
+    bool isDirectory, empty;
     
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name);
-    if (sector == -1) {
-       delete directory;
+    parent = FindParent(name, last);
+    if (parent == -1 || last[0] == '\0')
+	return FALSE;			 // no such directory
+    sector = LookupName(parent, last, &isDirectory);
+    if (sector == -1)
        return FALSE;			 // file not found 
+    if (isDirectory) {
+	dirFile = OpenDirectory(sector);
+	directory = new Directory(NumDirEntries);
+	directory->FetchFrom(dirFile);
+	empty = directory->IsEmpty();
+	delete directory;
+	CloseDirectory(dirFile);
+	if (!empty)
+	    return FALSE;		 // directory still has files
     }
+
+    journal->Begin(MaxOpSectors);
+    dirFile = OpenDirectory(parent);
+    directory = new Directory(NumDirEntries);
+    directory->FetchFrom(dirFile);
     fileHdr = new FileHeader;
     fileHdr->FetchFrom(sector);
 
@@ -277,19 +408,125 @@ FileSystem::Remove(char *name)
 
     fileHdr->Deallocate(freeMap);  		// remove data blocks
     freeMap->Clear(sector);			// remove header block
-    directory->Remove(name);
+    directory->Remove(last);
+    dirCache->Remove(parent, last);
 
     freeMap->WriteBack(freeMapFile);		// flush to disk
-    directory->WriteBack(directoryFile);        // flush to disk
+    directory->WriteBack(dirFile);		// flush to disk
     delete fileHdr;
     delete directory;
     delete freeMap;
+    CloseDirectory(dirFile);
+    journal->End(MaxOpSectors);
     return TRUE;
 } 
 
+//----------------------------------------------------------------------
+// FileSystem::FindParent
+// 	Follow a path from the root directory down to the directory
+//	that holds its last component.  Return the header sector of 
+//	that directory, or -1 if a directory on the way is missing, or
+//	is not a directory.  Empty components, as in "a//b" or "/a/",
+//	are skipped; names are cut to FileNameMaxLen characters, as in
+//	the directory itself.
+//
+//	"name" -- the path to follow
+//	"last" -- where to put the last component of the path; it is
+//		empty if the path names the root directory
+//----------------------------------------------------------------------
+
+int
+FileSystem::FindParent(char *name, char *last)
+{
+    int parent = DirectorySector;
+    int length;
+    bool isDirectory;
+
+    for (;;) {
+	while (*name == '/')
+	    name++;
+	for (length = 0; name[length] != '\0' && name[length] != '/'; length++)
+	    ;
+	strncpy(last, name, min(length, FileNameMaxLen));
+	last[min(length, FileNameMaxLen)] = '\0';
+	name += length;
+	while (*name == '/')
+	    name++;
+	if (*name == '\0')
+	    return parent;		// "last" was the last component
+
+	parent = LookupName(parent, last, &isDirectory);
+	if (parent == -1 || !isDirectory)
+	    return -1;
+    }
+}
+
+//----------------------------------------------------------------------
+// FileSystem::LookupName
+// 	Return the header sector of "name" in the directory whose header
+//	is at "parent", or -1 if it is not there.  Lookups are cached, so
+//	that opening the same files over and over again (as exec does
+//	with program files) does not read the directories each time.
+//
+//	"parent" -- header sector of the directory
+//	"name" -- the file name to look up
+//	"isDirectory" -- set to whether the name is a directory
+//----------------------------------------------------------------------
+
+int
+FileSystem::LookupName(int parent, char *name, bool *isDirectory)
+{
+    OpenFile *dirFile;
+    int sector;
+
+    sector = dirCache->Find(parent, name, isDirectory);
+    if (sector != -1) {
+	DEBUG('f', "Found %s in directory %d in the lookup cache\n", name,
+								parent);
+	return sector;
+    }
+    dirFile = OpenDirectory(parent);
+    sector = Directory::Lookup(dirFile, name, isDirectory);
+    CloseDirectory(dirFile);
+    if (sector != -1)
+	dirCache->Enter(parent, name, sector, *isDirectory);
+    return sector;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::OpenDirectory
+// 	Return an open file for the directory whose header is at "sector".
+//	The root directory is always open; other directories are opened
+//	for the time of one operation.
+//----------------------------------------------------------------------
+
+OpenFile *
+FileSystem::OpenDirectory(int sector)
+{
+    OpenFile *file;
+
+    if (sector == DirectorySector)
+	return directoryFile;
+    file = new OpenFile(sector);
+    file->KeepResident();
+    return file;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::CloseDirectory
+// 	Close a directory opened by OpenDirectory.
+//----------------------------------------------------------------------
+
+void
+FileSystem::CloseDirectory(OpenFile *file)
+{
+    if (file != directoryFile)
+	delete file;
+}
+
 //----------------------------------------------------------------------
 // FileSystem::List
-// 	List all the files in the file system directory.
+// 	List all the files in the root directory.
 //----------------------------------------------------------------------
 
 void
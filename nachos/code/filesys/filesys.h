@@ -20,9 +20,9 @@
 //	file system (in a file named "DISK"). 
 //
 //	In the "real" implementation, there are two key data structures used 
-//	in the file system.  There is a single "root" directory, listing
-//	all of the files in the file system; unlike UNIX, the baseline
-//	system does not provide a hierarchical directory structure.  
+//	in the file system.  There is a "root" directory, listing the
+//	files and the directories at the top of a UNIX-like tree of
+//	directories; file names are paths such as "/usr/bin/sort".
 //	In addition, there is a bitmap for allocating
 //	disk sectors.  Both the root directory and the bitmap are themselves
 //	stored as files in the Nachos file system -- this causes an interesting
@@ -37,6 +37,7 @@
 
 #include "copyright.h"
 #include "openfile.h"
+#include "directory.h"
 
 #ifdef FILESYS_STUB 		// Temporarily implement file system calls as 
 				// calls to UNIX, until the real file system
@@ -79,9 +80,13 @@ class FileSystem {
 
     OpenFile* Open(char *name); 	// Open a file (UNIX open)
 
-    bool Remove(char *name);  		// Delete a file (UNIX unlink)
+    bool MakeDirectory(char *name);	// Create a directory (UNIX mkdir)
 
-    void List();			// List all the files in the file system
+    bool Remove(char *name);  		// Delete a file, or an empty
+					// directory (UNIX unlink, rmdir)
+
+    void List();			// List all the files in the root
+					// directory
 
     void Print();			// List all the files and their contents
 
@@ -90,6 +95,19 @@ class FileSystem {
 					// represented as a file
    OpenFile* directoryFile;		// "Root" directory -- list of 
 					// file names, represented as a file
+   DirectoryCache *dirCache;		// Recent lookups of names in
+					// directories
+
+   bool CreateEntry(char *name, int initialSize, bool isDirectory);
+					// Create a file or a directory
+   int FindParent(char *name, char *last);
+					// Find the directory holding the
+					// last component of a path
+   int LookupName(int parent, char *name, bool *isDirectory);
+					// Find a name in a directory, going
+					// through the lookup cache
+   OpenFile *OpenDirectory(int sector); // Open/close the file of a 
+   void CloseDirectory(OpenFile *file);	// directory, by header sector
 };
 
 #endif // FILESYS
@@ -7,6 +7,10 @@
 //	   Perftest -- a stress test for the Nachos file system
 //		read and write a really large file in tiny chunks
 //		(won't work on baseline system!)
+//	   MetadataTest -- create and remove many small files, to
+//		measure the throughput of metadata operations
+//	   JournalTest -- grow a directory to more sectors than a group
+//		of ordinary operations logs, in one operation
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -20,6 +24,7 @@
 #include "thread.h"
 #include "disk.h"
 #include "stats.h"
+#include "journal.h"
 
 #define TransferSize 	10 	// make it small, just to be difficult
 
@@ -172,14 +177,145 @@ FileRead()
 void
 PerformanceTest()
 {
+    static char *ioModeNames[] = { "read/write", "mmap", "mmap + msync" };
+    double start, writeDone, readDone;
+
     printf("Starting file system performance test:\n");
     stats->Print();
+    start = HostTime();
     FileWrite();
+    sectorCache->Sync();		// the write is not done until then
+    writeDone = HostTime();
     FileRead();
+    readDone = HostTime();
     if (!fileSystem->Remove(FileName)) {
       printf("Perf test: unable to remove %s\n", FileName);
       return;
     }
     stats->Print();
+    printf("Host time (disk I/O by %s): write %.3f ms, read %.3f ms\n",
+	ioModeNames[diskIOMode], (writeDone - start) * 1000.0,
+	(readDone - writeDone) * 1000.0);
 }
 
+
+//----------------------------------------------------------------------
+// MetadataTest
+// 	Measure how fast files can be created and removed: create
+//	NumTestFiles small files in a fresh directory, sync, remove them
+//	all, and sync again.  The syncs are included, since an operation
+//	is not on the disk until its journal group is committed.  For 
+//	each phase, print the simulated time it took, the disk writes 
+//	it made, and how the journal grouped its operations.
+//----------------------------------------------------------------------
+
+#define TestDirectory	"mdtest"
+#define NumTestFiles	200
+#define TestFileSize	100
+
+static void
+MetadataPhase(char *what, bool creating)
+{
+    char name[2 * FileNameMaxLen + 2];
+    int ticks = stats->totalTicks, writes = stats->numDiskWrites;
+    int sectors = stats->numDiskSectors, ops = stats->numJournalOps;
+    int commits = stats->numJournalCommits;
+    double start = HostTime();
+    int i, done = 0;
+
+    for (i = 0; i < NumTestFiles; i++) {
+	sprintf(name, "%s/f%d", TestDirectory, i);
+	if (creating ? fileSystem->Create(name, TestFileSize)
+				: fileSystem->Remove(name))
+	    done++;
+    }
+    sectorCache->Sync();
+    ticks = stats->totalTicks - ticks;
+    printf("%s %d files: %d ticks (%.2f files per 1000 ticks), host %.3f ms\n",
+	what, done, ticks, (ticks > 0) ? (1000.0 * done) / ticks : 0.0,
+	(HostTime() - start) * 1000.0);
+    printf("    disk writes %d, sectors %d; %d operations in %d commits\n",
+	stats->numDiskWrites - writes, stats->numDiskSectors - sectors,
+	stats->numJournalOps - ops, stats->numJournalCommits - commits);
+}
+
+void
+MetadataTest()
+{
+    printf("Starting file system metadata test:\n");
+    if (!fileSystem->MakeDirectory(TestDirectory)) {
+	printf("Metadata test: can't create directory %s\n", TestDirectory);
+	return;
+    }
+    MetadataPhase("Created", TRUE);
+    MetadataPhase("Removed", FALSE);
+    if (!fileSystem->Remove(TestDirectory))
+	printf("Metadata test: unable to remove %s\n", TestDirectory);
+    sectorCache->Sync();
+    stats->Print();
+}
+
+//----------------------------------------------------------------------
+// JournalTest
+// 	Check that growing a directory is one journal transaction: create
+//	GrowFiles files in a fresh directory, committing each of them in
+//	a group of its own, so that its table is rehashed from
+//	GrowFromEntries entries into twice as many -- the largest growth
+//	there is.  The operation that grows it rewrites the whole table,
+//	which takes many more sectors than ordinary operations reserve in
+//	the log; all of them must be in its group, the group must still
+//	fit in the sector cache, and every file must still be found 
+//	afterwards.
+//----------------------------------------------------------------------
+
+#define GrowDirectory	"jtest"
+#define GrowFromEntries	(MaxDirEntries / 2)
+#define GrowFiles	(GrowFromEntries * 3 / 4 + 1)
+
+void
+JournalTest()
+{
+    char name[2 * FileNameMaxLen + 2];
+    int i, sectors, largest = 0, found = 0;
+    int oldSectors = divRoundUp(GrowFromEntries * sizeof(DirectoryEntry),
+					SectorSize);
+    OpenFile *file;
+
+    printf("Starting file system journal test:\n");
+    if (!fileSystem->MakeDirectory(GrowDirectory)) {
+	printf("Journal test: can't create directory %s\n", GrowDirectory);
+	return;
+    }
+    sectorCache->Sync();
+    for (i = 0; i < GrowFiles; i++) {
+	sprintf(name, "%s/f%d", GrowDirectory, i);
+	sectors = stats->numJournalSectors;
+	if (!fileSystem->Create(name, 0)) {
+	    printf("Journal test: can't create file %s\n", name);
+	    break;
+	}
+	sectorCache->Sync();		// one group per operation
+	sectors = stats->numJournalSectors - sectors;
+	if (sectors > largest)
+	    largest = sectors;
+    }
+    for (i = 0; i < GrowFiles; i++) {
+	sprintf(name, "%s/f%d", GrowDirectory, i);
+	if ((file = fileSystem->Open(name)) != NULL) {
+	    found++;
+	    delete file;
+	}
+	fileSystem->Remove(name);
+    }
+    fileSystem->Remove(GrowDirectory);
+    sectorCache->Sync();
+
+    printf("Journal test: %d of %d files found; largest group %d sectors, "
+	"table of %d sectors before growing\n", found, GrowFiles, largest,
+	oldSectors);
+    if ((found == GrowFiles) && (largest > oldSectors) 
+				&& (largest <= MaxGroupSectors))
+	printf("Journal test: passed\n");
+    else
+	printf("Journal test: FAILED\n");
+}
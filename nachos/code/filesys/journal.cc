@@ -0,0 +1,282 @@
+// journal.cc 
+//	Routines to make file system operations atomic, with a write-ahead
+//	journal of metadata sectors.
+//
+//	Committing a group goes like this:
+//	   wait for the operations in progress to end
+//	   copy the new contents of the logged sectors out of the cache,
+//	     and write them to the log, with one disk request
+//	   write the journal header, listing where they belong -- once
+//	     its first sector is on the disk, the group is committed
+//	   write the sectors to their real place ("checkpoint")
+//	   write the journal header again, with an empty log
+//
+//	Until the group is committed, the sector cache holds on to the
+//	logged sectors, so the old contents stay on the disk.  If Nachos
+//	dies before the header reaches the disk, none of the group's
+//	changes are seen; if it dies after, Recover finishes the job.
+//
+//	Only metadata is journaled; the data of files goes straight to
+//	its place, as before.  Each operation reserves room in the log
+//	for all the sectors it may modify, so its changes are either all
+//	in a group or none of them are; an operation that grows a 
+//	directory reserves room for the whole new table.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "journal.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// Journal::Journal
+// 	Initialize an empty journal.  Format or Recover must be called
+//	before the file system is used.
+//----------------------------------------------------------------------
+
+Journal::Journal()
+{
+    header = new JournalHeader;
+    header->magic = JournalMagic;
+    header->sequence = header->numSectors = 0;
+    numOps = outstanding = reserved = 0;
+    committing = FALSE;
+    lock = new Lock("journal");
+    changed = new Condition("journal changed");
+}
+
+//----------------------------------------------------------------------
+// Journal::~Journal
+// 	De-allocate the journal.
+//----------------------------------------------------------------------
+
+Journal::~Journal()
+{
+    delete changed;
+    delete lock;
+    delete header;
+}
+
+//----------------------------------------------------------------------
+// Journal::Format
+// 	Write an empty journal header to the disk, when the disk is 
+//	being formatted.
+//----------------------------------------------------------------------
+
+void
+Journal::Format()
+{
+    header->magic = JournalMagic;
+    header->sequence = header->numSectors = 0;
+    WriteHeader();
+}
+
+//----------------------------------------------------------------------
+// Journal::WriteHeader
+// 	Write the journal header to the disk: as many of its sectors as
+//	the list of logged sectors takes.  The first sector, with the
+//	number of sectors in the log, is written last, so that a crash
+//	in the middle leaves the header as it was.
+//----------------------------------------------------------------------
+
+void
+Journal::WriteHeader()
+{
+    char *data[JournalHeaderSectors];
+    int i, n = divRoundUp((3 + header->numSectors) * sizeof(int), SectorSize);
+
+    for (i = 0; i < n; i++)
+	data[i] = &((char *) header)[i * SectorSize];
+    if (n > 1)
+	synchDisk->WriteSectors(JournalSector + 1, n - 1, &data[1]);
+    synchDisk->WriteSector(JournalSector, data[0]);
+}
+
+//----------------------------------------------------------------------
+// Journal::Recover
+// 	Read the journal header when the file system is mounted.  If it
+//	lists a committed group, copy the sectors in the log to their 
+//	real place, and empty the log.  Doing this again, after a crash
+//	in the middle of it, does no harm.
+//
+//	This goes straight to the disk: nothing is in the sector cache
+//	yet.
+//----------------------------------------------------------------------
+
+void
+Journal::Recover()
+{
+    char *data[JournalSize];
+    char *images;
+    int i, n;
+
+    synchDisk->ReadSector(JournalSector, (char *) header);
+    ASSERT(header->magic == JournalMagic);	// disk needs formatting?
+    if (header->numSectors == 0)
+	return;
+    n = divRoundUp((3 + header->numSectors) * sizeof(int), SectorSize);
+    for (i = 1; i < n; i++)			// rest of the list
+	data[i] = &((char *) header)[i * SectorSize];
+    if (n > 1)
+	synchDisk->ReadSectors(JournalSector + 1, n - 1, &data[1]);
+
+    DEBUG('f', "Journal: replaying %d sectors of group %d\n", 
+		header->numSectors, header->sequence);
+    images = new char[header->numSectors * SectorSize];
+    for (i = 0; i < header->numSectors; i++)
+	data[i] = &images[i * SectorSize];
+    synchDisk->ReadSectors(LogSector, header->numSectors, data);
+    for (i = 0; i < header->numSectors; i++)
+	synchDisk->WriteSector(header->sectors[i], data[i]);
+    header->numSectors = 0;
+    WriteHeader();
+    synchDisk->Flush();
+    delete [] images;
+}
+
+//----------------------------------------------------------------------
+// Journal::Begin
+// 	Start a file system operation.  Wait while a group is being 
+//	committed, and make sure the log has room for what this 
+//	operation may log, on top of the operations already in progress,
+//	within MaxGroupSectors; if it does not, the current group is 
+//	committed first.
+//
+//	"sectors" -- metadata sectors the operation modifies, at most
+//----------------------------------------------------------------------
+
+void
+Journal::Begin(int sectors)
+{
+    ASSERT((sectors > 0) && (sectors <= MaxGroupSectors));
+    lock->Acquire();
+    while (committing || ((header->numSectors + reserved + sectors) 
+						> MaxGroupSectors)) {
+	if (!committing && (outstanding == 0)) {
+	    lock->Release();		// group full: commit it now
+	    Commit();
+	    lock->Acquire();
+	} else
+	    changed->Wait(lock);
+    }
+    outstanding++;
+    reserved += sectors;
+    numOps++;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::End
+// 	Finish a file system operation.  Its changes are committed with
+//	the rest of its group; if the group is too full to start another
+//	operation, that is now.
+//
+//	"sectors" -- what the operation reserved, in Begin
+//----------------------------------------------------------------------
+
+void
+Journal::End(int sectors)
+{
+    bool full;
+
+    lock->Acquire();
+    ASSERT((outstanding > 0) && (reserved >= sectors));
+    outstanding--;
+    reserved -= sectors;
+    full = (outstanding == 0) && !committing
+		&& ((header->numSectors + MaxOpSectors) > MaxGroupSectors);
+    changed->Broadcast(lock);
+    lock->Release();
+    if (full)
+	Commit();
+}
+
+//----------------------------------------------------------------------
+// Journal::Log
+// 	Record that the current group modifies "sector".  Called by the
+//	sector cache, with its lock held, each time a metadata sector
+//	changes.  A sector is logged once per group, however many times 
+//	it changes.
+//
+//	Return TRUE if the sector is now part of the group, so the cache
+//	must not write it back until Checkpoint; FALSE if there is no
+//	operation in progress.  The operations reserved room for every
+//	sector they log, so the group never outgrows MaxGroupSectors.
+//----------------------------------------------------------------------
+
+bool
+Journal::Log(int sector)
+{
+    bool logged = TRUE;
+    int i;
+
+    lock->Acquire();
+    if (outstanding == 0)
+	logged = FALSE;
+    else {
+	for (i = 0; i < header->numSectors; i++)
+	    if (header->sectors[i] == sector)
+		break;
+	if (i == header->numSectors) {
+	    ASSERT(header->numSectors < MaxGroupSectors); // reservation too
+	    header->sectors[header->numSectors++] = sector;	// small
+	}
+    }
+    lock->Release();
+    return logged;
+}
+
+//----------------------------------------------------------------------
+// Journal::Commit
+// 	Commit the current group, if it logged anything, and write its
+//	sectors to their real place.  See the comment at the top of the
+//	file.  If another thread is committing, wait for it, since the 
+//	caller may count on the group it was in being on the disk.
+//----------------------------------------------------------------------
+
+void
+Journal::Commit()
+{
+    char *data[JournalSize];
+    char *images;
+    int i, n;
+
+    lock->Acquire();
+    while (committing)
+	changed->Wait(lock);
+    if (header->numSectors == 0) {
+	lock->Release();
+	return;
+    }
+    committing = TRUE;
+    while (outstanding > 0)
+	changed->Wait(lock);
+    n = header->numSectors;
+    lock->Release();
+
+    DEBUG('f', "Journal: committing %d operations, %d sectors\n", numOps, n);
+    images = new char[n * SectorSize];
+    for (i = 0; i < n; i++) {
+	data[i] = &images[i * SectorSize];
+	sectorCache->Read(header->sectors[i], data[i], 0, SectorSize, TRUE);
+    }
+    synchDisk->WriteSectors(LogSector, n, data);
+    header->sequence++;
+    WriteHeader();				// committed
+
+    sectorCache->Checkpoint(header->sectors, n);
+    header->numSectors = 0;
+    WriteHeader();				// log is free
+    delete [] images;
+
+    lock->Acquire();
+    stats->numJournalOps += numOps;
+    stats->numJournalCommits++;
+    stats->numJournalSectors += n;
+    numOps = 0;
+    committing = FALSE;
+    changed->Broadcast(lock);
+    lock->Release();
+}
@@ -0,0 +1,108 @@
+// journal.h 
+//	Data structures for a write-ahead journal of file system metadata.
+//
+//	Creating or removing a file changes several metadata sectors --
+//	the free map, the file header, the directory -- which must reach
+//	the disk together, or the file system is left inconsistent if
+//	Nachos dies in between.  Each such operation is made a
+//	transaction: the new contents of the metadata sectors it changes
+//	are first written to a log on the disk, and only then to their 
+//	real place.  After a crash, the log is replayed when the file
+//	system is mounted.
+//
+//	The transactions of many operations are committed together
+//	("group commit"), with one sequential write to the log, so that
+//	sectors changed by each of them -- the free map, a directory --
+//	are written once for the whole group.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "disk.h"
+#include "synch.h"
+#include "sectorcache.h"
+
+// The journal takes the sectors right after the headers of the free
+// map and of the root directory: the journal header, followed by the
+// log.  The log is big enough for an operation that rewrites the
+// largest directory table (cf. MaxDirEntries).
+#define JournalSector	2
+#define JournalHeaderSectors 4		// Sectors in the journal header
+#define JournalSize	((int) ((JournalHeaderSectors * SectorSize \
+				- 3 * sizeof(int)) / sizeof(int)))
+					// Sectors in the log
+#define LogSector	(JournalSector + JournalHeaderSectors)
+#define MaxOpSectors	8		// Metadata sectors changed by one
+					// operation that does not grow a
+					// directory, at most, not counting
+					// the indirect blocks of a new file
+
+// The sector cache keeps every sector logged by a group until the
+// group is committed, so a group may not log more sectors than the
+// cache can spare.
+#define MaxGroupSectors	min(JournalSize, SECTOR_CACHE_SIZE - CACHE_UNPINNED)
+#define JournalMagic	0x4a524e34
+
+// The following class defines the journal header, as stored on disk.
+// It lists where each sector in the log belongs; when "numSectors" 
+// is not 0, the log holds a committed group that may not have been 
+// written to its real place yet.  Only the first sector of the header
+// is read or written when the log is empty.
+
+class JournalHeader {
+  public:
+    int magic;				// JournalMagic, on a formatted disk
+    int sequence;			// Number of the last group committed
+    int numSectors;			// Sectors in the log
+    int sectors[JournalSize];		// Where each of them belongs
+};
+
+// The following class defines the journal.  A file system operation
+// is bracketed by Begin and End, which reserve and give back room in
+// the log for as many sectors as the operation may modify.  In between,
+// every metadata sector it modifies in the sector cache is reported to
+// Log, and the cache keeps it until the group holding the operation is
+// committed.
+//
+// A group is committed when it cannot take another operation (it is
+// limited to MaxGroupSectors), and whenever the sector cache is synced
+// (so at least every CACHE_FLUSH_PERIOD ticks, by the flusher thread).  Committing waits
+// for the operations in progress to End, and holds off new ones.
+
+class Journal {
+  public:
+    Journal();				// Create an empty journal
+    ~Journal();
+
+    void Format();			// Write an empty journal to the disk
+    void Recover();			// Replay the log, if it holds a group 
+					// that was committed
+
+    void Begin(int sectors);		// Start an operation that modifies
+					// at most "sectors" sectors
+    void End(int sectors);		// Finish it
+    bool Log(int sector);		// Record that the current group
+					// modifies "sector"; return FALSE if
+					// there is no operation in progress
+    void Commit();			// Commit the current group
+
+  private:
+    JournalHeader *header;		// The header being built
+    int numOps;				// Operations in the current group
+    int outstanding;			// Operations in progress
+    int reserved;			// Sectors reserved by them
+    bool committing;			// Is a commit in progress?
+    Lock *lock;				// Protects all of the above
+    Condition *changed;			// Signalled when an operation ends,
+					// or a commit is done
+
+    void WriteHeader();			// Write the header to the disk
+};
+
+#endif // JOURNAL_H
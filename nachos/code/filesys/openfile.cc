@@ -28,7 +28,9 @@ OpenFile::OpenFile(int sector)
 { 
     hdr = new FileHeader;
     hdr->FetchFrom(sector);
+    hdrSector = sector;
     seekPosition = 0;
+    metadata = FALSE;
 }
 
 //----------------------------------------------------------------------
@@ -41,6 +43,31 @@ OpenFile::~OpenFile()
     delete hdr;
 }
 
+//----------------------------------------------------------------------
+// OpenFile::Extend
+// 	Grow the file to "newSize" bytes, and write its new header back
+//	to disk.  Files never shrink, so this does nothing if the file is
+//	already that long.  Return FALSE if there is no space; the header
+//	in memory is then read back from disk, but "freeMap" must be
+//	thrown away by the caller (cf. FileHeader::Extend).
+//
+//	"freeMap" -- the bit map of free disk sectors
+//	"newSize" -- the new length of the file, in bytes
+//----------------------------------------------------------------------
+
+bool
+OpenFile::Extend(BitMap *freeMap, int newSize)
+{
+    if (newSize <= hdr->FileLength())
+	return TRUE;
+    if (!hdr->Extend(freeMap, newSize)) {
+	hdr->FetchFrom(hdrSector);
+	return FALSE;
+    }
+    hdr->WriteBack(hdrSector);
+    return TRUE;
+}
+
 //----------------------------------------------------------------------
 // OpenFile::Seek
 // 	Change the current location within the open file -- the point at
@@ -92,16 +119,12 @@ OpenFile::Write(char *into, int numBytes)
 //
 //	There is no guarantee the request starts or ends on an even disk sector
 //	boundary; however the disk only knows how to read/write a whole disk
-//	sector at a time.  Thus:
-//
-//	For ReadAt:
-//	   We read in all of the full or partial sectors that are part of the
-//	   request, but we only copy the part we are interested in.
-//	For WriteAt:
-//	   We must first read in any sectors that will be partially written,
-//	   so that we don't overwrite the unmodified portion.  We then copy
-//	   in the data that will be modified, and write back all the full
-//	   or partial sectors that are part of the request.
+//	sector at a time.  We go through the sector cache, one sector at a
+//	time, and copy just the part of each sector that is in the request;
+//	the cache takes care of reading in sectors that are only partially
+//	written.  For ReadAt, each run of sectors that are consecutive on
+//	the disk is first brought into the cache with a single disk request;
+//	for WriteAt, the cache gathers such runs when it writes them back.
 //
 //	"into" -- the buffer to contain the data to be read from disk 
 //	"from" -- the buffer containing the data to be written to disk 
@@ -114,8 +137,7 @@ int
 OpenFile::ReadAt(char *into, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    char *buf;
+    int i, n, runEnd, sector, firstSector, lastSector, start, end;
 
     if ((numBytes <= 0) || (position >= fileLength))
     	return 0; 				// check request
@@ -126,17 +148,22 @@ OpenFile::ReadAt(char *into, int numBytes, int position)
 
     firstSector = divRoundDown(position, SectorSize);
     lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
-
-    // read in all the full and partial sectors that we need
-    buf = new char[numSectors * SectorSize];
-    for (i = firstSector; i <= lastSector; i++)	
-        synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize), 
-					&buf[(i - firstSector) * SectorSize]);
 
-    // copy the part we want
-    bcopy(&buf[position - (firstSector * SectorSize)], into, numBytes);
-    delete [] buf;
+    // copy the part we want out of each full or partial sector
+    runEnd = firstSector;
+    for (i = firstSector; i <= lastSector; i++) {
+	sector = hdr->ByteToSectorRun(i * SectorSize, &n);
+	if (i == runEnd) {		// start of the next run
+	    n = min(n, min(lastSector - i + 1, CACHE_MAX_RUN));
+	    if (n > 1)
+		sectorCache->ReadAhead(sector, n);
+	    runEnd = i + n;
+	}
+	start = max(position, i * SectorSize);
+	end = min(position + numBytes, (i + 1) * SectorSize);
+        sectorCache->Read(sector, &into[start - position], 
+			start - (i * SectorSize), end - start, metadata);
+    }
     return numBytes;
 }
 
@@ -144,9 +171,7 @@ int
 OpenFile::WriteAt(char *from, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    bool firstAligned, lastAligned;
-    char *buf;
+    int i, firstSector, lastSector, start, end;
 
     if ((numBytes <= 0) || (position >= fileLength))
 	return 0;				// check request
@@ -157,28 +182,15 @@ OpenFile::WriteAt(char *from, int numBytes, int position)
 
     firstSector = divRoundDown(position, SectorSize);
     lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
-
-    buf = new char[numSectors * SectorSize];
-
-    firstAligned = (position == (firstSector * SectorSize));
-    lastAligned = ((position + numBytes) == ((lastSector + 1) * SectorSize));
-
-// read in first and last sector, if they are to be partially modified
-    if (!firstAligned)
-        ReadAt(buf, SectorSize, firstSector * SectorSize);	
-    if (!lastAligned && ((firstSector != lastSector) || firstAligned))
-        ReadAt(&buf[(lastSector - firstSector) * SectorSize], 
-				SectorSize, lastSector * SectorSize);	
-
-// copy in the bytes we want to change 
-    bcopy(from, &buf[position - (firstSector * SectorSize)], numBytes);
 
-// write modified sectors back
-    for (i = firstSector; i <= lastSector; i++)	
-        synchDisk->WriteSector(hdr->ByteToSector(i * SectorSize), 
-					&buf[(i - firstSector) * SectorSize]);
-    delete [] buf;
+    // copy in the bytes we want to change, sector by sector
+    for (i = firstSector; i <= lastSector; i++) {
+	start = max(position, i * SectorSize);
+	end = min(position + numBytes, (i + 1) * SectorSize);
+        sectorCache->Write(hdr->ByteToSector(i * SectorSize), 
+			&from[start - position], start - (i * SectorSize),
+			end - start, metadata);
+    }
     return numBytes;
 }
 
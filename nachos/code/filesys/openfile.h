@@ -60,6 +60,7 @@ class OpenFile {
 
 #else // FILESYS
 class FileHeader;
+class BitMap;
 
 class OpenFile {
   public:
@@ -85,10 +86,21 @@ class OpenFile {
 					// file (this interface is simpler 
 					// than the UNIX idiom -- lseek to 
 					// end of file, tell, lseek back 
+
+    bool Extend(BitMap *freeMap, int newSize);
+					// Grow the file to "newSize" bytes,
+					// allocating from "freeMap"
+
+    void KeepResident() { metadata = TRUE; }
+					// Treat the contents of the file as
+					// file system metadata, which the
+					// sector cache tries to keep
     
   private:
     FileHeader *hdr;			// Header for this file 
+    int hdrSector;			// Where the header is on disk
     int seekPosition;			// Current position within the file
+    bool metadata;			// Free map or directory file?
 };
 
 #endif // FILESYS
@@ -0,0 +1,508 @@
+// sectorcache.cc 
+//	Routines to cache disk sectors in memory.
+//
+//	All the bookkeeping is protected by one lock, which is never held
+//	across a disk request: an entry being read in or written back is
+//	marked busy instead, and threads that want it wait on "ioDone".
+//	So any number of cache misses can be waiting for the disk at once,
+//	and the disk queue gets to reorder them.
+//
+//	Entries are kept on a doubly linked list in LRU order, linked by
+//	index.  Since the disk is small, a sector is looked up with a
+//	plain array indexed by sector number.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "sectorcache.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// FlusherThread
+// 	Start routine of the flusher thread.  Need this to be a C routine, 
+//	because C++ can't handle pointers to member functions.
+//----------------------------------------------------------------------
+
+static void
+FlusherThread (int arg)
+{
+    SectorCache* cache = (SectorCache *)arg;
+
+    cache->Flusher();
+}
+
+//----------------------------------------------------------------------
+// SectorCache::SectorCache
+// 	Initialize an empty sector cache, and start the flusher thread.
+//----------------------------------------------------------------------
+
+SectorCache::SectorCache()
+{
+    NachOSThread *flusher;
+    int i;
+
+    entries = new CacheEntry[SECTOR_CACHE_SIZE];
+    entryOf = new int[NumSectors];
+    for (i = 0; i < NumSectors; i++)
+	entryOf[i] = -1;
+    mru = lru = -1;
+    for (i = 0; i < SECTOR_CACHE_SIZE; i++) {
+	entries[i].sector = -1;
+	entries[i].dirty = entries[i].busy = entries[i].metadata = FALSE;
+	entries[i].prefetched = entries[i].logged = FALSE;
+	entries[i].prev = entries[i].next = -1;
+	MakeMRU(i);
+    }
+    numDirty = 0;
+    lock = new Lock("sector cache");
+    ioDone = new Condition("sector cache I/O");
+    flushRequest = new Semaphore("sector cache flush", 0);
+    flushPending = FALSE;
+
+    // The flusher never exits; it must not keep Nachos from halting
+    // once all the other threads have exited.
+    flusher = new NachOSThread("cache flusher", MIN_NICE_PRIORITY);
+    MarkThreadExited(flusher->GetPID());
+    flusher->ThreadFork(FlusherThread, (int) this);
+}
+
+//----------------------------------------------------------------------
+// SectorCache::~SectorCache
+// 	De-allocate the cache.  Modified sectors must have been written 
+//	back already, or be logged by a group that is dropped (see Shutdown).
+//----------------------------------------------------------------------
+
+SectorCache::~SectorCache()
+{
+    delete flushRequest;
+    delete ioDone;
+    delete lock;
+    delete [] entryOf;
+    delete [] entries;
+}
+
+//----------------------------------------------------------------------
+// SectorCache::Unlink, SectorCache::MakeMRU
+// 	Maintain the LRU list.
+//----------------------------------------------------------------------
+
+void
+SectorCache::Unlink(int e)
+{
+    if (entries[e].prev != -1) entries[entries[e].prev].next = entries[e].next;
+    else mru = entries[e].next;
+    if (entries[e].next != -1) entries[entries[e].next].prev = entries[e].prev;
+    else lru = entries[e].prev;
+}
+
+void
+SectorCache::MakeMRU(int e)
+{
+    if (mru == e) return;
+    if ((entries[e].prev != -1) || (entries[e].next != -1) || (lru == e))
+	Unlink(e);			// already on the list
+    entries[e].prev = -1;
+    entries[e].next = mru;
+    if (mru != -1) entries[mru].prev = e;
+    mru = e;
+    if (lru == -1) lru = e;
+}
+
+//----------------------------------------------------------------------
+// SectorCache::PickVictim
+// 	Return the entry to reuse for a sector that is not in the cache:
+//	the least recently used one that is neither busy nor logged, 
+//	preferring ordinary data to metadata.  Return -1 if there is none.
+//----------------------------------------------------------------------
+
+int
+SectorCache::PickVictim()
+{
+    int e, pass;
+
+    for (pass = 0; pass < 2; pass++) {
+	for (e = lru; e != -1; e = entries[e].prev) {
+	    if (entries[e].busy || entries[e].logged) continue;
+	    if ((pass == 0) && entries[e].metadata) continue;
+	    return e;
+	}
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// SectorCache::Install
+// 	Make the (clean, not busy) entry "e" hold "sector" from now on.
+//	The caller fills in the contents.
+//----------------------------------------------------------------------
+
+void
+SectorCache::Install(int e, int sector)
+{
+    ASSERT(!entries[e].dirty && !entries[e].busy);
+    if (entries[e].sector != -1)
+	entryOf[entries[e].sector] = -1;
+    entries[e].sector = sector;
+    entries[e].metadata = entries[e].prefetched = FALSE;
+    entryOf[sector] = e;
+    MakeMRU(e);
+    DEBUG('f', "Sector cache: sector %d goes in entry %d\n", sector, e);
+}
+
+//----------------------------------------------------------------------
+// SectorCache::WriteBack
+// 	Write modified entry "e" to the disk.  Called with the lock held;
+//	the lock is released while waiting for the disk, so the caller 
+//	must look at the cache again afterwards.
+//----------------------------------------------------------------------
+
+void
+SectorCache::WriteBack(int e)
+{
+    ASSERT(entries[e].dirty && !entries[e].busy);
+    entries[e].busy = TRUE;
+    lock->Release();
+    synchDisk->WriteSector(entries[e].sector, entries[e].data);
+    lock->Acquire();
+    entries[e].busy = FALSE;
+    entries[e].dirty = FALSE;
+    numDirty--;
+    stats->numCacheWriteBacks++;
+    ioDone->Broadcast(lock);
+}
+
+//----------------------------------------------------------------------
+// SectorCache::Find
+// 	Return the entry holding "sector", bringing it into the cache if
+//	needed.  Called with the lock held.  The entry returned is not
+//	busy, and stays valid until the caller releases the lock.
+//
+//	"fill" -- if FALSE, the caller is about to overwrite the whole
+//		sector, so there is no need to read it from the disk
+//	"metadata" -- is this a free map, directory or file header sector?
+//	"fresh" -- if not NULL, set to whether the entry was just taken 
+//		for the sector without reading it, so that it holds garbage
+//----------------------------------------------------------------------
+
+int
+SectorCache::Find(int sector, bool fill, bool metadata, bool *fresh)
+{
+    int e;
+
+    if (fresh != NULL)
+	*fresh = FALSE;
+
+    ASSERT((sector >= 0) && (sector < NumSectors));
+    e = entryOf[sector];
+    if (e == -1)
+	stats->numCacheMisses++;
+    else if (entries[e].prefetched)
+	entries[e].prefetched = FALSE;	// ReadAhead counted the miss
+    else
+	stats->numCacheHits++;
+
+    while (TRUE) {
+	e = entryOf[sector];
+	if (e != -1) {
+	    if (!entries[e].busy)
+		break;
+	    ioDone->Wait(lock);		// being read in or written back
+	    continue;
+	}
+	e = PickVictim();
+	if (e == -1) {
+	    ioDone->Wait(lock);		// everything is busy
+	    continue;
+	}
+	if (entries[e].dirty) {
+	    WriteBack(e);		// the lock was dropped, so the
+	    continue;			// sector may be here by now
+	}
+	Install(e, sector);
+	if (fill) {
+	    entries[e].busy = TRUE;
+	    lock->Release();
+	    synchDisk->ReadSector(sector, entries[e].data);
+	    lock->Acquire();
+	    entries[e].busy = FALSE;
+	    ioDone->Broadcast(lock);
+	} else if (fresh != NULL)
+	    *fresh = TRUE;
+	break;
+    }
+    if (metadata)
+	entries[e].metadata = TRUE;
+    MakeMRU(e);
+    return e;
+}
+
+//----------------------------------------------------------------------
+// SectorCache::Read
+// 	Copy part of a sector out of the cache.
+//
+//	"sector" -- the disk sector to read from
+//	"into" -- where to put the bytes
+//	"offset", "numBytes" -- which bytes of the sector we want
+//	"metadata" -- is this a free map, directory or file header sector?
+//----------------------------------------------------------------------
+
+void
+SectorCache::Read(int sector, char *into, int offset, int numBytes,
+		  bool metadata)
+{
+    int e;
+
+    ASSERT((offset >= 0) && (numBytes >= 0) 
+			&& ((offset + numBytes) <= SectorSize));
+    lock->Acquire();
+    e = Find(sector, TRUE, metadata, NULL);
+    bcopy(&entries[e].data[offset], into, numBytes);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SectorCache::Write
+// 	Copy bytes into part of a sector in the cache.  The sector is
+//	written back to the disk later on.
+//
+//	"sector" -- the disk sector to write to
+//	"from" -- the new bytes
+//	A metadata sector is only modified if its contents change -- 
+//	the file system writes back whole directories and free maps to 
+//	change a few bytes -- and is then logged by the journal.
+//
+//	"offset", "numBytes" -- which bytes of the sector to change
+//	"metadata" -- is this a free map, directory or file header sector?
+//----------------------------------------------------------------------
+
+void
+SectorCache::Write(int sector, char *from, int offset, int numBytes,
+		   bool metadata)
+{
+    int e;
+    bool fresh;
+
+    ASSERT((offset >= 0) && (numBytes >= 0) 
+			&& ((offset + numBytes) <= SectorSize));
+    lock->Acquire();
+    e = Find(sector, (offset != 0) || (numBytes != SectorSize), metadata,
+								&fresh);
+    if (metadata && !fresh 
+		&& !bcmp(from, &entries[e].data[offset], numBytes)) {
+	lock->Release();		// no change
+	return;
+    }
+    bcopy(from, &entries[e].data[offset], numBytes);
+    if (!entries[e].dirty) {
+	entries[e].dirty = TRUE;
+	numDirty++;
+    }
+    if (metadata && !entries[e].logged && journal->Log(sector))
+	entries[e].logged = TRUE;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SectorCache::ReadAhead
+// 	Bring the sectors "firstSector" to "firstSector + numSectors - 1"
+//	into the cache.  Each run of them that is not there already is 
+//	read with a single disk request, straight into the entries that
+//	will hold them.  This is only a hint: we give up on whatever does
+//	not fit without writing back modified sectors, and the caller 
+//	still has to Read the sectors one by one.
+//----------------------------------------------------------------------
+
+void
+SectorCache::ReadAhead(int firstSector, int numSectors)
+{
+    char *data[CACHE_MAX_RUN];
+    int run[CACHE_MAX_RUN];
+    int i, j, e, start, count;
+
+    ASSERT((firstSector >= 0) && (numSectors <= CACHE_MAX_RUN)
+			&& ((firstSector + numSectors) <= NumSectors));
+    lock->Acquire();
+    i = 0;
+    while (i < numSectors) {
+	if (entryOf[firstSector + i] != -1) {
+	    i++;			// here already
+	    continue;
+	}
+
+	// Claim entries for the sectors missing from here on
+	start = firstSector + i;
+	count = 0;
+	while ((i < numSectors) && (entryOf[firstSector + i] == -1)) {
+	    e = PickVictim();
+	    if ((e == -1) || entries[e].dirty)
+		break;
+	    Install(e, firstSector + i);
+	    entries[e].busy = entries[e].prefetched = TRUE;
+	    run[count] = e;
+	    data[count] = entries[e].data;
+	    count++;
+	    i++;
+	}
+	if (count == 0)
+	    break;			// no room
+
+	lock->Release();
+	synchDisk->ReadSectors(start, count, data);
+	lock->Acquire();
+	for (j = 0; j < count; j++)
+	    entries[run[j]].busy = FALSE;
+	stats->numCacheMisses += count;
+	ioDone->Broadcast(lock);
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SectorCache::Sync
+// 	Commit the journal, and write back every modified sector, 
+//	returning once they are all on the disk.
+//----------------------------------------------------------------------
+
+void
+SectorCache::Sync()
+{
+    journal->Commit();
+    lock->Acquire();
+    WriteDirty();
+    lock->Release();
+    synchDisk->Flush();
+}
+
+//----------------------------------------------------------------------
+// SectorCache::Checkpoint
+// 	Called by the journal once it has committed a group: the logged
+//	sectors in "sectors" may go to their real place now.  Write them
+//	back, along with every other modified sector.
+//
+//	"sectors" -- the sectors logged by the group
+//	"numSectors" -- how many there are
+//----------------------------------------------------------------------
+
+void
+SectorCache::Checkpoint(int *sectors, int numSectors)
+{
+    int i, e;
+
+    lock->Acquire();
+    for (i = 0; i < numSectors; i++) {
+	e = entryOf[sectors[i]];
+	ASSERT((e != -1) && entries[e].logged);	// never evicted
+	entries[e].logged = FALSE;
+    }
+    WriteDirty();
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SectorCache::WriteDirty
+// 	Write back every modified sector that is not logged.  We go 
+//	through the disk in sector order, and write each run of modified
+//	sectors with a single disk request.  Called with the lock held;
+//	it is released during the disk requests.
+//----------------------------------------------------------------------
+
+void
+SectorCache::WriteDirty()
+{
+    char *data[CACHE_MAX_RUN];
+    int run[CACHE_MAX_RUN];
+    int sector, e, i, count;
+
+    for (sector = 0; sector < NumSectors; sector++) {
+	while (((e = entryOf[sector]) != -1) && entries[e].busy)
+	    ioDone->Wait(lock);
+	if ((e == -1) || !entries[e].dirty || entries[e].logged)
+	    continue;
+
+	// Gather the modified sectors that follow
+	count = 0;
+	while ((count < CACHE_MAX_RUN) && ((sector + count) < NumSectors)
+		&& ((e = entryOf[sector + count]) != -1)
+		&& entries[e].dirty && !entries[e].busy && !entries[e].logged) {
+	    entries[e].busy = TRUE;
+	    run[count] = e;
+	    data[count] = entries[e].data;
+	    count++;
+	}
+
+	lock->Release();
+	synchDisk->WriteSectors(sector, count, data);
+	lock->Acquire();
+	for (i = 0; i < count; i++) {
+	    entries[run[i]].busy = entries[run[i]].dirty = FALSE;
+	    numDirty--;
+	}
+	stats->numCacheWriteBacks += count;
+	ioDone->Broadcast(lock);
+	sector += count - 1;
+    }
+}
+
+//----------------------------------------------------------------------
+// SectorCache::Shutdown
+// 	Write back the modified sectors when Nachos is halting.  The
+//	thread calling us may be on its way out, so we cannot block on
+//	locks or semaphores; instead we poll the disk, and do not care
+//	about the entries being busy -- nobody will touch them again.
+//	For the same reason the journal cannot commit, so logged sectors
+//	are left alone: they belong to a group that is not committed,
+//	and writing them in place could leave half of an operation on
+//	the disk.  That group is lost, like it would be in a crash; the
+//	next Recover replays only the groups that were committed.
+//----------------------------------------------------------------------
+
+void
+SectorCache::Shutdown()
+{
+    int e;
+
+    for (e = 0; e < SECTOR_CACHE_SIZE; e++) {
+	if (entries[e].dirty && !entries[e].logged) {
+	    synchDisk->WriteSectorPolled(entries[e].sector, entries[e].data);
+	    entries[e].dirty = FALSE;
+	    numDirty--;
+	    stats->numCacheWriteBacks++;
+	}
+    }
+    synchDisk->Flush();
+}
+
+//----------------------------------------------------------------------
+// SectorCache::Flusher
+// 	Body of the flusher thread: each time the timer wakes it up, write
+//	back whatever has been modified.
+//----------------------------------------------------------------------
+
+void
+SectorCache::Flusher()
+{
+    while (TRUE) {
+	flushRequest->P();
+	DEBUG('f', "Sector cache: flushing %d modified sectors\n", numDirty);
+	Sync();
+	flushPending = FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// SectorCache::WakeFlusher
+// 	Called from the timer interrupt handler every CACHE_FLUSH_PERIOD
+//	ticks.  Wake up the flusher, if there is something to write back
+//	and it is not busy with that already.
+//----------------------------------------------------------------------
+
+void
+SectorCache::WakeFlusher()
+{
+    if ((numDirty > 0) && !flushPending) {
+	flushPending = TRUE;
+	flushRequest->V();
+    }
+}
@@ -0,0 +1,114 @@
+// sectorcache.h 
+//	Data structures for caching disk sectors in memory.
+//
+//	The file system reads and writes the disk a sector at a time,
+//	and keeps going back to the same few sectors: the free map, the
+//	directory, the headers of open files.  The sector cache keeps
+//	recently used sectors in memory, so that most of these accesses
+//	never reach the disk, and holds on to modified sectors until they
+//	are written back in the background ("write-back").
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef SECTORCACHE_H
+#define SECTORCACHE_H
+
+#include "disk.h"
+#include "synch.h"
+
+#define SECTOR_CACHE_SIZE	128	// Sectors kept in memory
+#define CACHE_UNPINNED		16	// Entries the journal never pins,
+					// for the reads of the operations
+					// in progress
+#define CACHE_FLUSH_PERIOD	10000	// Ticks between background flushes
+#define CACHE_MAX_RUN		16	// Most sectors moved by one request
+
+// The following class defines one cached sector.
+
+class CacheEntry {
+  public:
+    int sector;				// Sector held here, -1 if none
+    char data[SectorSize];		// Its contents
+    bool dirty;				// Modified since it was last written?
+    bool busy;				// Being read or written right now?
+    bool metadata;			// Free map, directory or file header?
+    bool prefetched;			// Brought in by ReadAhead, not yet
+					// looked up?
+    bool logged;			// Modified by a journal group that
+					// is not committed yet?
+    int prev, next;			// Neighbours in LRU order
+};
+
+// The following class defines the sector cache.  Read and Write copy 
+// (part of) one sector out of or into the cache, going to the disk 
+// only on a miss.  Modified sectors are written back when they are 
+// evicted, by the flusher thread every CACHE_FLUSH_PERIOD ticks, and 
+// by Sync.  Modified sectors that are next to each other on the disk
+// are written back together, with one disk request.
+//
+// Eviction takes the least recently used sector, but passes over
+// metadata sectors as long as there are others to take, so that the
+// hot file system structures stay resident.
+//
+// Metadata sectors changed inside a journal transaction are "logged":
+// they are neither evicted nor written back until the journal has 
+// committed them, and calls Checkpoint.
+
+class SectorCache {
+  public:
+    SectorCache();			// Create an empty cache, and start
+					// the flusher thread
+    ~SectorCache();
+
+    void Read(int sector, char *into, int offset, int numBytes, 
+		bool metadata);		// Copy "numBytes" bytes at "offset"
+					// in "sector" into "into"
+    void Write(int sector, char *from, int offset, int numBytes,
+		bool metadata);		// Copy them from "from" into "sector"
+    void ReadAhead(int firstSector, int numSectors);
+					// Bring a run of consecutive sectors
+					// into the cache, with one disk
+					// request for those missing
+
+    void Sync();			// Commit the journal, and write back
+					// every modified sector
+    void Checkpoint(int *sectors, int numSectors);
+					// Write back the modified sectors,
+					// now that the journal has committed
+					// the logged ones in "sectors"
+    void Shutdown();			// Same, when Nachos is halting and
+					// the caller cannot block; logged
+					// sectors are not written
+
+    void Flusher();			// Body of the flusher thread
+    void WakeFlusher();			// Called from the timer interrupt
+					// handler
+
+  private:
+    CacheEntry *entries;		// The cached sectors
+    int *entryOf;			// Entry holding each sector, or -1
+    int mru, lru;			// Ends of the LRU list
+    int numDirty;			// Number of modified entries
+    Lock *lock;				// Protects all of the above
+    Condition *ioDone;			// Signalled when an entry stops 
+					// being busy
+    Semaphore *flushRequest;		// To wake up the flusher
+    bool flushPending;			// Flusher woken up, not done yet?
+
+    int Find(int sector, bool fill, bool metadata, bool *fresh);
+					// Return the entry for "sector",
+					// reading it in if "fill"
+    int PickVictim();			// Entry to reuse, -1 if all are busy
+    void Install(int e, int sector);	// Make entry "e" hold "sector"
+    void WriteBack(int e);		// Write entry "e" to the disk
+    void WriteDirty();			// Write all modified entries that
+					// are not logged to the disk
+    void Unlink(int e);			// Take "e" off the LRU list
+    void MakeMRU(int e);		// Put "e" at the front of it
+};
+
+#endif // SECTORCACHE_H
@@ -5,10 +5,11 @@
 //	the disk providing a synchronous interface (requests wait until
 //	the request completes).
 //
-//	Use a semaphore to synchronize the interrupt handlers with the
-//	pending requests.  And, because the physical disk can only
-//	handle one operation at a time, use a lock to enforce mutual
-//	exclusion.
+//	Each request has its own semaphore to synchronize the interrupt 
+//	handler with the thread waiting for it.  The physical disk can 
+//	only handle one operation at a time, but the DiskQueue below us
+//	queues the others, so any number of threads may have a request
+//	outstanding.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -16,19 +17,35 @@
 
 #include "copyright.h"
 #include "synchdisk.h"
+#include "system.h"
 
 //----------------------------------------------------------------------
 // DiskRequestDone
-// 	Disk interrupt handler.  Need this to be a C routine, because 
-//	C++ can't handle pointers to member functions.
+// 	Disk interrupt handler.  Wake up the thread waiting for the disk
+//	request to finish.
+//
+//	"arg" -- the semaphore it is waiting on
 //----------------------------------------------------------------------
 
 static void
 DiskRequestDone (int arg)
 {
-    SynchDisk* disk = (SynchDisk *)arg;
+    Semaphore* done = (Semaphore *)arg;
+
+    done->V();
+}
+
+//----------------------------------------------------------------------
+// PolledRequestDone
+// 	Disk interrupt handler for WriteSectorPolled.
+//
+//	"arg" -- the flag to set once the request is done
+//----------------------------------------------------------------------
 
-    disk->RequestDone();
+static void
+PolledRequestDone (int arg)
+{
+    *(bool *)arg = TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -38,13 +55,13 @@ DiskRequestDone (int arg)
 //
 //	"name" -- UNIX file name to be used as storage for the disk data
 //	   (usually, "DISK")
+//	"policy" -- the disk scheduling policy (DISK_*, see diskqueue.h)
+//	"ioMode" -- how to get at the UNIX file (DISK_IO_*, see disk.h)
 //----------------------------------------------------------------------
 
-SynchDisk::SynchDisk(char* name)
+SynchDisk::SynchDisk(char* name, int policy, int ioMode)
 {
-    semaphore = new Semaphore("synch disk", 0);
-    lock = new Lock("synch disk lock");
-    disk = new Disk(name, DiskRequestDone, (int) this);
+    queue = new DiskQueue(name, policy, ioMode);
 }
 
 //----------------------------------------------------------------------
@@ -55,9 +72,7 @@ SynchDisk::SynchDisk(char* name)
 
 SynchDisk::~SynchDisk()
 {
-    delete disk;
-    delete lock;
-    delete semaphore;
+    delete queue;
 }
 
 //----------------------------------------------------------------------
@@ -72,10 +87,11 @@ SynchDisk::~SynchDisk()
 void
 SynchDisk::ReadSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->ReadRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
-    lock->Release();
+    Semaphore done("synch disk read", 0);
+
+    queue->Submit(sectorNumber, 1, &data, FALSE, DiskRequestDone, 
+								(int) &done);
+    done.P();				// wait for interrupt
 }
 
 //----------------------------------------------------------------------
@@ -90,20 +106,63 @@ SynchDisk::ReadSector(int sectorNumber, char* data)
 void
 SynchDisk::WriteSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->WriteRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
-    lock->Release();
+    Semaphore done("synch disk write", 0);
+
+    queue->Submit(sectorNumber, 1, &data, TRUE, DiskRequestDone, 
+								(int) &done);
+    done.P();				// wait for interrupt
 }
 
 //----------------------------------------------------------------------
-// SynchDisk::RequestDone
-// 	Disk interrupt handler.  Wake up any thread waiting for the disk
-//	request to finish.
+// SynchDisk::ReadSectors/WriteSectors
+// 	Read/write a run of consecutive disk sectors, scattering them into
+//	/ gathering them from separate buffers, with a single disk request.
+//	Return only after the data has been read/written.
+//
+//	"firstSector", "numSectors" -- the disk sectors to read/write
+//	"data" -- data[i] holds the contents of sector firstSector + i
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadSectors(int firstSector, int numSectors, char** data)
+{
+    Semaphore done("synch disk read", 0);
+
+    queue->Submit(firstSector, numSectors, data, FALSE, DiskRequestDone, 
+								(int) &done);
+    done.P();				// wait for interrupt
+}
+
+void
+SynchDisk::WriteSectors(int firstSector, int numSectors, char** data)
+{
+    Semaphore done("synch disk write", 0);
+
+    queue->Submit(firstSector, numSectors, data, TRUE, DiskRequestDone, 
+								(int) &done);
+    done.P();				// wait for interrupt
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::WriteSectorPolled
+// 	Write the contents of a buffer into a disk sector, without putting
+//	the calling thread to sleep: we run the interrupt handlers 
+//	ourselves, advancing the simulated time, until the request is 
+//	done.  Used to write back cached sectors when Nachos is halting.
+//
+//	"sectorNumber" -- the disk sector to be written
+//	"data" -- the new contents of the disk sector
 //----------------------------------------------------------------------
 
 void
-SynchDisk::RequestDone()
-{ 
-    semaphore->V();
+SynchDisk::WriteSectorPolled(int sectorNumber, char* data)
+{
+    bool done = FALSE;
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    queue->Submit(sectorNumber, 1, &data, TRUE, PolledRequestDone, 
+								(int) &done);
+    while (!done)
+	interrupt->Idle();		// fire the next pending interrupt
+    (void) interrupt->SetLevel(oldLevel);
 }
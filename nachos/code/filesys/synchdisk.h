@@ -11,7 +11,7 @@
 #ifndef SYNCHDISK_H
 #define SYNCHDISK_H
 
-#include "disk.h"
+#include "diskqueue.h"
 #include "synch.h"
 
 // The following class defines a "synchronous" disk abstraction.
@@ -19,35 +19,45 @@
 // requests to read or write portions of the disk return immediately,
 // and an interrupt occurs later to signal that the operation completed.
 // (Also, the physical characteristics of the disk device assume that
-// only one operation can be requested at a time).
+// only one operation can be requested at a time; the DiskQueue in
+// front of it takes care of that, and of the order of the requests).
 //
 // This class provides the abstraction that for any individual thread
 // making a request, it waits around until the operation finishes before
-// returning.
+// returning.  Several threads may be waiting at once.
 class SynchDisk {
   public:
-    SynchDisk(char* name);    		// Initialize a synchronous disk,
-					// by initializing the raw Disk.
+    SynchDisk(char* name, int policy, int ioMode);
+					// Initialize a synchronous disk,
+					// by initializing the disk queue
+					// with scheduling "policy", and
+					// the raw disk with "ioMode".
     ~SynchDisk();			// De-allocate the synch disk data
     
     void ReadSector(int sectorNumber, char* data);
     					// Read/write a disk sector, returning
     					// only once the data is actually read 
 					// or written.  These call
-    					// Disk::ReadRequest/WriteRequest and
-					// then wait until the request is done.
+    					// DiskQueue::Submit and then wait 
+					// until the request is done.
     void WriteSector(int sectorNumber, char* data);
-    
-    void RequestDone();			// Called by the disk device interrupt
-					// handler, to signal that the
-					// current disk operation is complete.
+
+    void ReadSectors(int firstSector, int numSectors, char** data);
+    void WriteSectors(int firstSector, int numSectors, char** data);
+					// Same for a run of consecutive
+					// sectors, the i-th one in data[i],
+					// as one disk request
+
+    void Flush() { queue->Flush(); }	// Make sure completed writes are
+					// in the UNIX file
+
+    void WriteSectorPolled(int sectorNumber, char* data);
+					// Same, but busy-wait for the disk
+					// instead of blocking; only for when
+					// Nachos is halting
 
   private:
-    Disk *disk;		  		// Raw disk device
-    Semaphore *semaphore; 		// To synchronize requesting thread 
-					// with the interrupt handler
-    Lock *lock;		  		// Only one read/write request
-					// can be sent to the disk at a time
+    DiskQueue *queue;	  		// Requests to the raw disk device
 };
 
 #endif // SYNCHDISK_H
@@ -38,9 +38,12 @@ static void DiskDone(int arg) { ((Disk *)arg)->HandleInterrupt(); }
 //	"callWhenDone" -- interrupt handler to be called when disk read/write
 //	   request completes
 //	"callArg" -- argument to pass the interrupt handler
+//	"mode" -- DISK_IO_FILE to access the file with read and write
+//	   system calls, DISK_IO_MAP or DISK_IO_MAP_SYNC to map it into
+//	   memory and copy sectors in and out
 //----------------------------------------------------------------------
 
-Disk::Disk(char* name, VoidFunctionPtr callWhenDone, int callArg)
+Disk::Disk(char* name, VoidFunctionPtr callWhenDone, int callArg, int mode)
 {
     int magicNum;
     int tmp = 0;
@@ -64,6 +67,11 @@ Disk::Disk(char* name, VoidFunctionPtr callWhenDone, int callArg)
         Lseek(fileno, DiskSize - sizeof(int), 0);	
 	WriteFile(fileno, (char *)&tmp, sizeof(int));  
     }
+    ioMode = mode;
+    if (ioMode == DISK_IO_FILE)
+	image = NULL;
+    else
+	image = MapFile(fileno, DiskSize);
     active = FALSE;
 }
 
@@ -75,9 +83,27 @@ Disk::Disk(char* name, VoidFunctionPtr callWhenDone, int callArg)
 
 Disk::~Disk()
 {
+    if (image != NULL) {
+	Flush();
+	UnmapFile(image, DiskSize);
+    }
     Close(fileno);
 }
 
+//----------------------------------------------------------------------
+// Disk::Flush()
+// 	Make sure everything written to the disk so far is in the UNIX 
+//	file.  With read and write system calls, it already is; with
+//	DISK_IO_MAP we leave it to the host to write the mapping back.
+//----------------------------------------------------------------------
+
+void
+Disk::Flush()
+{
+    if (ioMode == DISK_IO_MAP_SYNC)
+	SyncMappedFile(image, DiskSize);
+}
+
 //----------------------------------------------------------------------
 // Disk::PrintSector()
 // 	Dump the data in a disk read/write request, for debugging.
@@ -115,40 +141,85 @@ PrintSector (bool writing, int sector, char *data)
 void
 Disk::ReadRequest(int sectorNumber, char* data)
 {
-    int ticks = ComputeLatency(sectorNumber, FALSE);
-
-    ASSERT(!active);				// only one request at a time
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
-    
-    DEBUG('d', "Reading from sector %d\n", sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    Read(fileno, data, SectorSize);
-    if (DebugIsEnabled('d'))
-	PrintSector(FALSE, sectorNumber, data);
-    
-    active = TRUE;
-    UpdateLast(sectorNumber);
-    stats->numDiskReads++;
-    interrupt->Schedule(DiskDone, (int) this, ticks, DiskInt);
+    Transfer(sectorNumber, 1, &data, FALSE);
 }
 
 void
 Disk::WriteRequest(int sectorNumber, char* data)
 {
-    int ticks = ComputeLatency(sectorNumber, TRUE);
+    Transfer(sectorNumber, 1, &data, TRUE);
+}
+
+//----------------------------------------------------------------------
+// Disk::ReadVector/WriteVector
+// 	Simulate a request to read/write a run of consecutive disk sectors,
+//	scattering them into / gathering them from separate buffers.  The
+//	whole run is one request: one UNIX system call, and one interrupt
+//	when it is done.
+//
+//	"firstSector" -- the first disk sector to read/write
+//	"numSectors" -- how many sectors
+//	"data" -- data[i] holds the bytes of sector firstSector + i
+//----------------------------------------------------------------------
+
+void
+Disk::ReadVector(int firstSector, int numSectors, char** data)
+{
+    Transfer(firstSector, numSectors, data, FALSE);
+}
 
-    ASSERT(!active);
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+void
+Disk::WriteVector(int firstSector, int numSectors, char** data)
+{
+    Transfer(firstSector, numSectors, data, TRUE);
+}
+
+//----------------------------------------------------------------------
+// Disk::Transfer
+// 	Do the work of a read or write request: move the data to/from the
+//	UNIX file right away, and schedule the interrupt for when the
+//	simulated disk would be done.
+//----------------------------------------------------------------------
+
+void
+Disk::Transfer(int firstSector, int numSectors, char** data, bool writing)
+{
+    int ticks = ComputeLatency(firstSector, numSectors, writing);
+    int i;
+
+    ASSERT(!active);				// only one request at a time
+    ASSERT((firstSector >= 0) && (numSectors > 0) 
+			&& ((firstSector + numSectors) <= NumSectors));
     
-    DEBUG('d', "Writing to sector %d\n", sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    WriteFile(fileno, data, SectorSize);
+    DEBUG('d', "%s %d sectors at sector %d\n", writing ? "Writing" : "Reading",
+			numSectors, firstSector);
+    if (image != NULL) {
+	for (i = 0; i < numSectors; i++) {
+	    char *sector = &image[SectorSize * (firstSector + i) + MagicSize];
+	    if (writing)
+		bcopy(data[i], sector, SectorSize);
+	    else
+		bcopy(sector, data[i], SectorSize);
+	}
+    } else if (writing)
+	WriteVectorAt(fileno, data, SectorSize, numSectors, 
+			SectorSize * firstSector + MagicSize);
+    else
+	ReadVectorAt(fileno, data, SectorSize, numSectors, 
+			SectorSize * firstSector + MagicSize);
     if (DebugIsEnabled('d'))
-	PrintSector(TRUE, sectorNumber, data);
+	for (i = 0; i < numSectors; i++)
+	    PrintSector(writing, firstSector + i, data[i]);
     
     active = TRUE;
-    UpdateLast(sectorNumber);
-    stats->numDiskWrites++;
+    UpdateLast(firstSector);
+    if (numSectors > 1)
+	UpdateLast(firstSector + numSectors - 1);
+    if (writing)
+	stats->numDiskWrites++;
+    else
+	stats->numDiskReads++;
+    stats->numDiskSectors += numSectors;
     interrupt->Schedule(DiskDone, (int) this, ticks, DiskInt);
 }
 
@@ -252,6 +323,29 @@ Disk::ComputeLatency(int newSector, bool writing)
     return(seek + rotation + RotationTime);
 }
 
+//----------------------------------------------------------------------
+// Disk::ComputeLatency()
+// 	Return how long will it take to read/write a run of consecutive 
+//	sectors: the latency of the first one, then one RotationTime per
+//	sector as they pass under the head.  Moving on to the next track
+//	takes a one-track seek, by the end of which the start of the track
+//	has just gone by, so we wait for it to come around again.
+//----------------------------------------------------------------------
+
+int
+Disk::ComputeLatency(int firstSector, int numSectors, bool writing)
+{
+    int ticks = ComputeLatency(firstSector, writing);
+
+    for (int sector = firstSector + 1; sector < firstSector + numSectors; 
+								sector++) {
+	if ((sector % SectorsPerTrack) == 0)	// next track
+	    ticks += SeekTime + (SectorsPerTrack - 1) * RotationTime;
+	ticks += RotationTime;
+    }
+    return ticks;
+}
+
 //----------------------------------------------------------------------
 // Disk::UpdateLast
 //   	Keep track of the most recently requested sector.  So we can know
@@ -52,12 +52,19 @@
 #define NumSectors 		(SectorsPerTrack * NumTracks)
 					// total # of sectors per disk
 
+// How the simulated disk gets at the UNIX file (-dio)
+#define DISK_IO_FILE		0	// read and write system calls
+#define DISK_IO_MAP		1	// file mapped into memory
+#define DISK_IO_MAP_SYNC	2	// same, and Flush waits for the
+					// mapping to reach the file
+
 class Disk {
   public:
-    Disk(char* name, VoidFunctionPtr callWhenDone, int callArg);
-    					// Create a simulated disk.  
+    Disk(char* name, VoidFunctionPtr callWhenDone, int callArg, 
+	 int mode);			// Create a simulated disk.  
 					// Invoke (*callWhenDone)(callArg) 
 					// every time a request completes.
+					// "mode" is one of DISK_IO_*
     ~Disk();				// Deallocate the disk.
     
     void ReadRequest(int sectorNumber, char* data);
@@ -67,6 +74,15 @@ class Disk {
     					// Only one request allowed at a time!
     void WriteRequest(int sectorNumber, char* data);
 
+    void ReadVector(int firstSector, int numSectors, char** data);
+    					// Read/write "numSectors" consecutive
+					// sectors, the i-th one from/to 
+					// data[i], as a single request
+    void WriteVector(int firstSector, int numSectors, char** data);
+
+    void Flush();			// Make sure what was written so far
+					// is in the UNIX file
+
     void HandleInterrupt();		// Interrupt handler, invoked when
 					// disk request finishes.
 
@@ -74,9 +90,14 @@ class Disk {
     					// Return how long a request to 
 					// newSector will take: 
 					// (seek + rotational delay + transfer)
+    int ComputeLatency(int firstSector, int numSectors, bool writing);
+					// Same for a run of sectors
 
   private:
     int fileno;				// UNIX file number for simulated disk 
+    int ioMode;				// How we get at the file (DISK_IO_*)
+    char *image;			// The file, mapped into memory, or
+					// NULL for DISK_IO_FILE
     VoidFunctionPtr handler;		// Interrupt handler, to be invoked 
 					// when any disk request finishes
     int handlerArg;			// Argument to interrupt handler 
@@ -88,6 +109,8 @@ class Disk {
     int TimeToSeek(int newSector, int *rotate); // time to get to the new track
     int ModuloDiff(int to, int from);        // # sectors between to and from
     void UpdateLast(int newSector);
+    void Transfer(int firstSector, int numSectors, char** data, 
+		  bool writing);	// Common part of the requests
 };
 
 #endif // DISK_H
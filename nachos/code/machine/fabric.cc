@@ -0,0 +1,217 @@
+// fabric.cc
+//	Routines to emulate a network joining several machines that all
+//	run in this Nachos process.  See fabric.h.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "fabric.h"
+
+// Dummy function because C++ can't call member functions indirectly
+static void FabricArrive(int arg)
+{ fabric->Arrive((FabricPacket *) arg); }
+
+//----------------------------------------------------------------------
+// Fabric::Fabric
+// 	Join "nodes" machines with links of the default latency, unlimited
+//	bandwidth, and the given chance of delivering each packet.
+//----------------------------------------------------------------------
+
+Fabric::Fabric(int nodes, double reliability)
+{
+    int i;
+
+    ASSERT((nodes > 0) && (nodes <= MaxFabricNodes));
+    if (reliability < 0) reliability = 0;
+    else if (reliability > 1) reliability = 1;
+
+    numNodes = nodes;
+    links = new FabricLink[numNodes * numNodes];
+    for (i = 0; i < numNodes * numNodes; i++) {
+	links[i].seed = i + 1;
+	links[i].busyUntil = 0;
+    }
+    SetLinks(-1, -1, NetworkTime, 0, 1 - reliability);
+
+    arrivedHead = new FabricPacket*[numNodes];
+    arrivedTail = new FabricPacket*[numNodes];
+    for (i = 0; i < numNodes; i++)
+	arrivedHead[i] = arrivedTail[i] = NULL;
+    freePackets = NULL;
+}
+
+//----------------------------------------------------------------------
+// Fabric::~Fabric
+// 	Free the links and the packets that have arrived or are free.
+//	Packets still on a link belong to interrupts that will never
+//	happen, since Nachos is halting.
+//----------------------------------------------------------------------
+
+Fabric::~Fabric()
+{
+    FabricPacket *pkt;
+    int i;
+
+    for (i = 0; i < numNodes; i++)
+	while ((pkt = arrivedHead[i]) != NULL) {
+	    arrivedHead[i] = pkt->next;
+	    delete pkt;
+	}
+    while ((pkt = freePackets) != NULL) {
+	freePackets = pkt->next;
+	delete pkt;
+    }
+    delete [] arrivedHead;
+    delete [] arrivedTail;
+    delete [] links;
+}
+
+//----------------------------------------------------------------------
+// Fabric::SetLinks
+// 	Set the latency, bandwidth and loss rate of the links from "from"
+//	to "to"; either may be -1, for all machines.
+//----------------------------------------------------------------------
+
+void
+Fabric::SetLinks(int from, int to, int latency, int ticksPerByte,
+		double lossRate)
+{
+    int i, j;
+
+    ASSERT((from >= -1) && (from < numNodes) && (to >= -1) && (to < numNodes));
+    ASSERT((latency > 0) && (ticksPerByte >= 0)
+		&& (lossRate >= 0) && (lossRate <= 1));
+    for (i = 0; i < numNodes; i++)
+	for (j = 0; j < numNodes; j++)
+	    if (((from == -1) || (from == i)) && ((to == -1) || (to == j))) {
+		Link(i, j)->latency = latency;
+		Link(i, j)->ticksPerByte = ticksPerByte;
+		Link(i, j)->lossRate = lossRate;
+	    }
+}
+
+//----------------------------------------------------------------------
+// Fabric::ReadLinks
+// 	Set up the links from the file "fileName".  Each line that is not
+//	empty and does not start with '#' is
+//
+//		<from> <to> <latency> <ticks per byte> <loss rate>
+//
+//	where <from> and <to> are machine ids, or '*' for all machines.
+//	Later lines override earlier ones, so a file can start with a
+//	default for every link and then list the exceptions.
+//----------------------------------------------------------------------
+
+void
+Fabric::ReadLinks(char *fileName)
+{
+    FILE *f = fopen(fileName, "r");
+    char line[256], from[16], to[16];
+    int latency, ticksPerByte;
+    double lossRate;
+
+    if (f == NULL) {
+	printf("Unable to open link file %s\n", fileName);
+	ASSERT(FALSE);
+    }
+    while (fgets(line, sizeof(line), f) != NULL) {
+	if ((line[0] == '#') || (line[0] == '\n'))
+	    continue;
+	if (sscanf(line, "%15s %15s %d %d %lf", from, to, &latency,
+				&ticksPerByte, &lossRate) != 5) {
+	    printf("Bad line in link file %s: %s", fileName, line);
+	    ASSERT(FALSE);
+	}
+	SetLinks(strcmp(from, "*") ? atoi(from) : -1,
+			strcmp(to, "*") ? atoi(to) : -1,
+			latency, ticksPerByte, lossRate);
+    }
+    fclose(f);
+}
+
+//----------------------------------------------------------------------
+// Fabric::Send
+// 	Put a packet on the link to its destination.  The packet waits
+//	for the packets ahead of it to leave, takes ticksPerByte for each
+//	of its bytes to leave, and arrives "latency" ticks later -- unless
+//	the link drops it.
+//
+//	"wire" -- the packet header, followed by the data
+//	"size" -- bytes in "wire"
+//----------------------------------------------------------------------
+
+void
+Fabric::Send(char *wire, int size)
+{
+    PacketHeader *hdr = (PacketHeader *) wire;
+    FabricLink *link;
+    FabricPacket *pkt;
+    int start;
+
+    ASSERT((hdr->from < numNodes) && (hdr->to < numNodes)
+		&& (size <= MaxWireSize));
+    link = Link(hdr->from, hdr->to);
+
+    start = (link->busyUntil > stats->totalTicks) ? link->busyUntil
+						  : stats->totalTicks;
+    link->busyUntil = start + size * link->ticksPerByte;
+
+    link->seed = link->seed * 1103515245 + 12345;
+    if (((link->seed >> 16) & 0x7fff) < link->lossRate * 0x8000) {
+	DEBUG('n', "Fabric lost packet from %d to %d\n", hdr->from, hdr->to);
+	stats->numPacketsLost++;
+	return;
+    }
+
+    if (freePackets != NULL) {
+	pkt = freePackets;
+	freePackets = pkt->next;
+    } else
+	pkt = new FabricPacket;
+    pkt->to = hdr->to;
+    pkt->size = size;
+    bcopy(wire, pkt->wire, size);
+    interrupt->Schedule(FabricArrive, (int) pkt,
+		link->busyUntil + link->latency - stats->totalTicks,
+		NetworkRecvInt);
+}
+
+//----------------------------------------------------------------------
+// Fabric::Arrive
+// 	A packet has got to the end of its link; queue it for its
+//	destination, whose network device will find it when it next polls.
+//----------------------------------------------------------------------
+
+void
+Fabric::Arrive(FabricPacket *pkt)
+{
+    pkt->next = NULL;
+    if (arrivedHead[pkt->to] == NULL)
+	arrivedHead[pkt->to] = pkt;
+    else
+	arrivedTail[pkt->to]->next = pkt;
+    arrivedTail[pkt->to] = pkt;
+}
+
+//----------------------------------------------------------------------
+// Fabric::Receive
+// 	Copy the oldest packet that has arrived at machine "addr" into
+//	"wire", and return its size, or 0 if no packet has arrived.
+//----------------------------------------------------------------------
+
+int
+Fabric::Receive(NetworkAddress addr, char *wire)
+{
+    FabricPacket *pkt = arrivedHead[addr];
+
+    if (pkt == NULL)
+	return 0;
+    arrivedHead[addr] = pkt->next;
+    bcopy(pkt->wire, wire, pkt->size);
+    pkt->next = freePackets;
+    freePackets = pkt;
+    return pkt->size;
+}
@@ -0,0 +1,106 @@
+// fabric.h
+//	Data structures to emulate a network joining several machines
+//	that all run inside this one Nachos process.
+//
+//	Normally each Nachos machine is a separate UNIX process, and the
+//	network devices talk to each other over UNIX sockets.  With the
+//	fabric, every machine's network device is attached to the fabric
+//	instead, and packets go from one device to another through
+//	queues in memory.  All the machines share one simulated clock,
+//	so the simulation stays in step without any synchronization:
+//	a packet is never delivered before the time it was sent, plus the
+//	latency of its link (the same guarantee a conservative parallel
+//	simulator would give), and the results are the same on every run.
+//
+//	Each pair of machines is joined by a one-way link with its own
+//	latency, bandwidth and loss rate.  The queues need no locks: they
+//	are only touched by the network devices and by the fabric's
+//	interrupt handler, and Nachos runs them one at a time.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FABRIC_H
+#define FABRIC_H
+
+#include "copyright.h"
+#include "network.h"
+
+#define MaxFabricNodes	64	// most machines in one process
+
+// The following class defines a one-way link between two machines.
+
+class FabricLink {
+  public:
+    int latency;		// Ticks from leaving the link to arriving
+    int ticksPerByte;		// Time to put one byte on the link; 0
+				//   means the bandwidth is unlimited
+    double lossRate;		// Chance that the link drops a packet
+    unsigned seed;		// State of the generator choosing which
+				//   packets to drop; each link has its own,
+				//   so the losses on one link do not depend
+				//   on the traffic on the others
+    int busyUntil;		// When the packets already on the link
+				//   have all left the sender
+};
+
+// The following class defines a packet travelling through the fabric,
+// as it came off the wire: packet header, then data.
+
+class FabricPacket {
+  public:
+    NetworkAddress to;		// Machine it is going to
+    int size;			// Bytes in "wire"
+    char wire[MaxWireSize];
+    FabricPacket *next;		// Next in its arrival queue, or on the
+				//   free list
+};
+
+// The following class defines the fabric.  Machine i's network device
+// sends with Send and polls with Receive, in place of the UNIX socket
+// named SOCKET_i.
+
+class Fabric {
+  public:
+    Fabric(int nodes, double reliability);
+				// Join "nodes" machines, numbered from 0;
+				// every link starts out with a latency of
+				// NetworkTime, unlimited bandwidth, and
+				// drops packets with a chance of
+				// 1 - "reliability"
+    ~Fabric();
+
+    int NumNodes() { return numNodes; }
+
+    void ReadLinks(char *fileName);
+				// Set up the links from a file; see
+				// fabric.cc for the format
+
+    void Send(char *wire, int size);
+				// Put the packet in "wire" on the link to
+				// the machine named in its header
+    int Receive(NetworkAddress addr, char *wire);
+				// Take the oldest packet that has arrived
+				// at machine "addr", and return its size;
+				// return 0 if none has arrived
+
+    void Arrive(FabricPacket *pkt);
+				// Interrupt handler, called when a packet
+				// gets to the end of its link
+
+  private:
+    int numNodes;		// Machines joined by the fabric
+    FabricLink *links;		// Link from i to j is links[i*numNodes+j]
+    FabricPacket **arrivedHead;	// Packets that have arrived at each
+    FabricPacket **arrivedTail;	//   machine, oldest first
+    FabricPacket *freePackets;	// Packets that can be used again
+
+    FabricLink *Link(int from, int to) { return &links[from*numNodes+to]; }
+    void SetLinks(int from, int to, int latency, int ticksPerByte,
+				double lossRate);
+				// Set the links from "from" to "to"; -1
+				// stands for every machine
+};
+
+#endif // FABRIC_H
@@ -23,6 +23,7 @@
 #include "copyright.h"
 #include "interrupt.h"
 #include "system.h"
+#include "synch.h"
 
 // String definitions for debugging messages
 
@@ -63,6 +64,7 @@ Interrupt::Interrupt()
     pending = new List();
     inHandler = FALSE;
     yieldOnReturn = FALSE;
+    switchCPUOnReturn = FALSE;
     status = SystemMode;
 }
 
@@ -176,6 +178,12 @@ Interrupt::OneTick()
 	currentThread->YieldCPU();
 	status = old;
     }
+    if (switchCPUOnReturn) {		// same for a switch to another CPU
+	switchCPUOnReturn = FALSE;
+ 	status = SystemMode;
+	scheduler->SwitchCPU();
+	status = old;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -196,6 +204,21 @@ Interrupt::YieldOnReturn()
     yieldOnReturn = TRUE; 
 }
 
+//----------------------------------------------------------------------
+// Interrupt::SwitchCPUOnReturn
+// 	Called from within the timer interrupt handler, when more than
+//	one CPU is simulated, to go on with another CPU once the handler
+//	returns.  As with YieldOnReturn, the switch cannot be done from
+//	inside the handler.
+//----------------------------------------------------------------------
+
+void
+Interrupt::SwitchCPUOnReturn()
+{ 
+    ASSERT(inHandler == TRUE);  
+    switchCPUOnReturn = TRUE; 
+}
+
 //----------------------------------------------------------------------
 // Interrupt::Idle
 // 	Routine called when there is nothing in the ready queue.
@@ -240,56 +263,32 @@ Interrupt::Idle()
 void
 Interrupt::Halt()
 {
-    int max_completion=0, min_completion=stats->totalTicks, total_completion=0;
-    float avg_completion, var_completion=0;
-    unsigned i;
+    double avg_completion = 0, var_completion = 0;
 
     printf("Machine halting!\n\n");
+#ifdef FILESYS
+    sectorCache->Shutdown();		// write back cached disk sectors
+#endif
+    scheduler->FinishCPUStats();
     stats->Print();
+    PrintLockStats();
+    if (csvFileName != NULL) stats->WriteCSV(csvFileName);
 
     if (schedulingAlgo == NON_PREEMPTIVE_SJF) {
        printf("Error in burst estimate over average burst length: %.2f\n", ((float)stats->burstEstimateError)/stats->cpu_time);
     }
 
-    if (excludeMainThread) {
-       for (i=1; i<thread_index; i++) {
-          if (exitThreadArray[i]) {
-             ASSERT(completionTimeArray[i] != -1);
-             total_completion += completionTimeArray[i];
-             if (completionTimeArray[i] > max_completion) max_completion = completionTimeArray[i];
-             if (completionTimeArray[i] < min_completion) min_completion = completionTimeArray[i];
-          }
-       }
-
-       avg_completion = (float)total_completion/(thread_index-1);
-    
-       for (i=1; i<thread_index; i++) {
-          var_completion += ((completionTimeArray[i] - avg_completion)*(completionTimeArray[i] - avg_completion));
-       }
-
-       var_completion = var_completion/(thread_index-1);
+    if (stats->numCompleted > 0) {
+       avg_completion = stats->totalCompletion/stats->numCompleted;
+       var_completion = stats->totalCompletionSquares/stats->numCompleted - avg_completion*avg_completion;
+    }
+    else stats->minCompletion = 0;
 
-       printf("Completion time statistics for all but main thread: Max: %d, Min: %d, Avg: %.2f, Variance: %.2f\n", max_completion, min_completion, avg_completion, var_completion);
+    if (excludeMainThread) {
+       printf("Completion time statistics for all but main thread: Max: %d, Min: %d, Avg: %.2f, Variance: %.2f\n", stats->maxCompletion, stats->minCompletion, avg_completion, var_completion);
     }
     else {
-       for (i=0; i<thread_index; i++) {
-          if (exitThreadArray[i]) {
-             ASSERT(completionTimeArray[i] != -1);
-             total_completion += completionTimeArray[i];
-             if (completionTimeArray[i] > max_completion) max_completion = completionTimeArray[i];
-             if (completionTimeArray[i] < min_completion) min_completion = completionTimeArray[i];
-          }
-       }
-
-       avg_completion = (float)total_completion/thread_index;
-
-       for (i=1; i<thread_index; i++) {
-          var_completion += ((completionTimeArray[i] - avg_completion)*(completionTimeArray[i] - avg_completion));
-       }
-
-       var_completion = var_completion/thread_index;
-
-       printf("Completion time statistics for all threads: Max: %d, Min: %d, Avg: %.2f, Variance: %.2f\n", max_completion, min_completion, avg_completion, var_completion);
+       printf("Completion time statistics for all threads: Max: %d, Min: %d, Avg: %.2f, Variance: %.2f\n", stats->maxCompletion, stats->minCompletion, avg_completion, var_completion);
     }
 
     Cleanup();     // Never returns.
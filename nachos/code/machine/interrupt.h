@@ -95,6 +95,9 @@ class Interrupt {
     void YieldOnReturn();		// cause a context switch on return 
 					// from an interrupt handler
 
+    void SwitchCPUOnReturn();		// move on to another simulated CPU
+					// on return from an interrupt handler
+
     MachineStatus getStatus() { return status; } // idle, kernel, user
     void setStatus(MachineStatus st) { status = st; }
 
@@ -119,6 +122,8 @@ class Interrupt {
     bool inHandler;		// TRUE if we are running an interrupt handler
     bool yieldOnReturn; 	// TRUE if we are to context switch
 				// on return from the interrupt handler
+    bool switchCPUOnReturn;	// TRUE if we are to switch to another
+				// CPU on return from the interrupt handler
     MachineStatus status;	// idle, kernel mode, user mode
 
     // these functions are internal to the interrupt simulation code
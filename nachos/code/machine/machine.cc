@@ -17,10 +17,9 @@ static char* exceptionNames[] = { "no exception", "syscall",
 				"page fault/no TLB entry", "page read only",
 				"bus error", "address error", "overflow",
 				"illegal instruction" };
-extern bool sharedPages[NumPhysPages];
 extern void pt();
-extern int thPID[NumPhysPages];
-extern int thVPN[NumPhysPages];
+
+int numPhysPages = DefaultNumPhysPages;	// number of physical page frames
 
 //----------------------------------------------------------------------
 // CheckEndian
@@ -63,6 +62,9 @@ Machine::Machine(bool debug)
     for (i = 0; i < NumTotalRegs; i++)
         registers[i] = 0;
     mainMemory = new char[MemorySize];
+    sharedPages = new bool[NumPhysPages];
+    threadPID = new int[NumPhysPages];
+    threadVPN = new int[NumPhysPages];
     referenceBit = new bool[NumPhysPages];
     LRUTimeStamp = new long long int[NumPhysPages];
     for (i = 0; i < MemorySize; i++)
@@ -89,6 +91,7 @@ Machine::Machine(bool debug)
     KernelPageTable = NULL;
 #endif
 
+    linked = FALSE;
     singleStep = debug;
     CheckEndian();
 }
@@ -101,7 +104,11 @@ Machine::Machine(bool debug)
 Machine::~Machine()
 {
     delete [] mainMemory;
-    //delete [] sharedPages;
+    delete [] sharedPages;
+    delete [] threadPID;
+    delete [] threadVPN;
+    delete [] referenceBit;
+    delete [] LRUTimeStamp;
     if (tlb != NULL)
         delete [] tlb;
 }
@@ -124,6 +131,7 @@ Machine::RaiseException(ExceptionType which, int badVAddr)
 //  ASSERT(interrupt->getStatus() == UserMode);
     registers[BadVAddrReg] = badVAddr;
     DelayedLoad(0, 0);			// finish anything in progress
+    linked = FALSE;			// a pending SC must fail
     interrupt->setStatus(SystemMode);
     ExceptionHandler(which);		// interrupts are enabled at this point
     interrupt->setStatus(UserMode);
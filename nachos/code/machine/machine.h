@@ -32,13 +32,14 @@
 					// the disk sector size, for
 					// simplicity
 
-#define NumPhysPages 2
-//#define NumPhysPages    1024
+#define DefaultNumPhysPages 2
+//#define DefaultNumPhysPages    1024
+#define NumPhysPages	numPhysPages	// set at startup (-M), so that one
+					// binary can simulate any memory size
 #define MemorySize 	(NumPhysPages * PageSize)
 #define TLBSize		4		// if there is a TLB, make it small
 
-extern int thPID[NumPhysPages];
-extern int thVPN[NumPhysPages];
+extern int numPhysPages;		// number of physical page frames
 
 enum ExceptionType { NoException,           // Everything ok!
 		     SyscallException,      // A program executed a system call.
@@ -132,14 +133,14 @@ class Machine {
     
     bool ReadMem(int addr, int size, int* value);
     bool WriteMem(int addr, int size, int value);
-    bool sharedPages[NumPhysPages];
+    bool *sharedPages;
     				// Read or write 1, 2, or 4 bytes of virtual 
 				// memory (at addr).  Return FALSE if a 
 				// correct translation couldn't be found.
     
     // Inverse Page table
-    int threadPID[NumPhysPages]; // PID of thread holding a page in memory
-    int threadVPN[NumPhysPages]; // Inverse Page Table mapping
+    int *threadPID;		// PID of thread holding a page in memory
+    int *threadVPN;		// Inverse Page Table mapping
 
     ExceptionType Translate(int virtAddr, int* physAddr, int size,bool writing);
     				// Translate an address, and check for 
@@ -197,6 +198,11 @@ class Machine {
     TranslationEntry *KernelPageTable;
     unsigned int KernelPageTableSize;
 
+    bool linked;			// set by LL, and cleared by SC, any
+    int linkedAddr;			// exception and context switches; SC
+					// only stores if it is still set for
+					// the same address
+
   private:
     bool singleStep;		// drop back into the debugger after each
 				// simulated instruction
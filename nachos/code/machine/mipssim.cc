@@ -279,6 +279,22 @@ Machine::OneInstruction(Instruction *instr)
 	nextLoadValue = value;
 	break;
     	
+      case OP_LL:
+	// Load linked (MIPS II): a load that also starts watching the
+	// address for the SC below
+	tmp = registers[instr->rs] + instr->extra;
+	if (tmp & 0x3) {
+	    RaiseException(AddressErrorException, tmp);
+	    return;
+	}
+	if (!machine->ReadMem(tmp, 4, &value))
+	    return;
+	nextLoadReg = instr->rt;
+	nextLoadValue = value;
+	linkedAddr = tmp;
+	linked = TRUE;
+	break;
+    	
       case OP_LWL:	  
 	tmp = registers[instr->rs] + instr->extra;
 
@@ -476,6 +492,24 @@ Machine::OneInstruction(Instruction *instr)
 	    return;
 	break;
 	
+      case OP_SC:
+	// Store conditional (MIPS II): the store only happens if nothing 
+	// could have come between it and the LL -- no exception or context
+	// switch since.  rt is set to 1 if it did, 0 if not.
+	tmp = registers[instr->rs] + instr->extra;
+	if (tmp & 0x3) {
+	    RaiseException(AddressErrorException, tmp);
+	    return;
+	}
+	if (linked && (linkedAddr == tmp)) {
+	    if (!machine->WriteMem((unsigned) tmp, 4, registers[instr->rt]))
+		return;
+	    registers[instr->rt] = 1;
+	} else
+	    registers[instr->rt] = 0;
+	linked = FALSE;
+	break;
+	
       case OP_SWL:	  
 	tmp = registers[instr->rs] + instr->extra;
 
@@ -1,6 +1,7 @@
 // network.cc 
 //	Routines to simulate a network interface, using UNIX sockets
-//	to deliver packets between multiple invocations of nachos.
+//	to deliver packets between multiple invocations of nachos, or
+//	the fabric to deliver them between machines in this one.
 //
 //  DO NOT CHANGE -- part of the machine emulation
 //
@@ -34,12 +35,19 @@ Network::Network(NetworkAddress addr, double reliability,
     readHandler = readAvail;
     handlerArg = callArg;
     sendBusy = FALSE;
-    inHdr.length = 0;
+    rxHead = rxCount = 0;
+    txHead = txCount = 0;
     
-    sock = OpenSocket();
-    sprintf(sockName, "SOCKET_%d", (int)addr);
-    AssignNameToSocket(sockName, sock);		 // Bind socket to a filename 
+    if (fabric != NULL) {			 // the fabric drops packets 
+	ASSERT(addr < fabric->NumNodes());	 // itself, link by link
+	chanceToWork = 1;
+	sock = -1;
+    } else {
+	sock = OpenSocket();
+	sprintf(sockName, "SOCKET_%d", (int)addr);
+	AssignNameToSocket(sockName, sock);	 // Bind socket to a filename 
 						 // in the current directory.
+    }
 
     // start polling for incoming packets
     interrupt->Schedule(NetworkReadPoll, (int)this, NetworkTime, NetworkRecvInt);
@@ -47,90 +55,134 @@ Network::Network(NetworkAddress addr, double reliability,
 
 Network::~Network()
 {
-    CloseSocket(sock);
-    DeAssignNameToSocket(sockName);
+    if (sock != -1) {
+	CloseSocket(sock);
+	DeAssignNameToSocket(sockName);
+    }
 }
 
-// if a packet is already buffered, we simply delay reading 
-// the incoming packet.  In real life, the incoming 
-// packet might be dropped if we can't read it in time.
+// read every packet waiting on the socket (or in the fabric) into the
+// receive ring, and 
+// tell the post office about each of them.  If the ring fills up, the 
+// rest stay in the socket until the next poll.  In real life, they 
+// might be dropped if we can't read them in time.
 void
 Network::CheckPktAvail()
 {
+    int arrived = 0;
+
     // schedule the next time to poll for a packet
     interrupt->Schedule(NetworkReadPoll, (int)this, NetworkTime, NetworkRecvInt);
 
-    if (inHdr.length != 0) 	// do nothing if packet is already buffered
-	return;		
-    if (!PollSocket(sock)) 	// do nothing if no packet to be read
-	return;
-
-    // otherwise, read packet in
-    char *buffer = new char[MaxWireSize];
-    ReadFromSocket(sock, buffer, MaxWireSize);
-
-    // divide packet into header and data
-    inHdr = *(PacketHeader *)buffer;
-    ASSERT((inHdr.to == ident) && (inHdr.length <= MaxPacketSize));
-    bcopy(buffer + sizeof(PacketHeader), inbox, inHdr.length);
-    delete []buffer ;
-
-    DEBUG('n', "Network received packet from %d, length %d...\n",
-	  				(int) inHdr.from, inHdr.length);
-    stats->numPacketsRecvd++;
+    while (rxCount < NetworkRxSlots) {
+	char *buffer = rxRing[(rxHead + rxCount) % NetworkRxSlots];
+	PacketHeader *hdr = (PacketHeader *)buffer;
+	int size;
+
+	if (fabric != NULL)
+	    size = fabric->Receive(ident, buffer);
+	else if (PollSocket(sock))
+	    size = ReadFromSocket(sock, buffer, MaxWireSize);
+	else
+	    size = 0;
+	if (size == 0)
+	    break;
+
+	ASSERT((hdr->to == ident) && (hdr->length <= MaxPacketSize)
+		&& (size == (int) (sizeof(PacketHeader) + hdr->length)));
+	DEBUG('n', "Network received packet from %d, length %d...\n",
+	  				(int) hdr->from, hdr->length);
+	rxCount++;
+	arrived++;
+	stats->numPacketsRecvd++;
+    }
+    if (arrived > 1)
+	DEBUG('n', "Network received %d packets in one poll, %d buffered\n",
+						arrived, rxCount);
 
-    // tell post office that the packet has arrived
-    (*readHandler)(handlerArg);	
+    // tell post office that the packets have arrived, once per packet
+    for (; arrived > 0; arrived--)
+	(*readHandler)(handlerArg);	
 }
 
-// notify user that another packet can be sent
+// the packet at the head of the queue is off the wire; notify user that 
+// another packet can be queued, and start on the next one
 void
 Network::SendDone()
 {
     sendBusy = FALSE;
+    txHead = (txHead + 1) % NetworkTxSlots;
+    txCount--;
     stats->numPacketsSent++;
+    if (txCount > 0)
+	StartSend();
     (*writeHandler)(handlerArg);
 }
 
-// send a packet by concatenating hdr and data, and schedule
-// an interrupt to tell the user when the next packet can be sent 
-//
-// Note we always pad out a packet to MaxWireSize before putting it into
-// the socket, because it's simpler at the receive end.
+// put the packet at the head of the queue into the socket, and schedule
+// an interrupt for when it is off the wire
 void
-Network::Send(PacketHeader hdr, char* data)
+Network::StartSend()
 {
+    char *buffer = txQueue[txHead];
+    PacketHeader *hdr = (PacketHeader *)buffer;
     char toName[32];
 
-    sprintf(toName, "SOCKET_%d", (int)hdr.to);
-    
-    ASSERT((sendBusy == FALSE) && (hdr.length > 0) 
-		&& (hdr.length <= MaxPacketSize) && (hdr.from == ident));
-    DEBUG('n', "Sending to addr %d, %d bytes... ", hdr.to, hdr.length);
-
+    ASSERT(!sendBusy && (txCount > 0));
+    sendBusy = TRUE;
     interrupt->Schedule(NetworkSendDone, (int)this, NetworkTime, NetworkSendInt);
 
+    if (fabric != NULL) {
+	fabric->Send(buffer, sizeof(PacketHeader) + hdr->length);
+	return;
+    }
     if (Random() % 100 >= chanceToWork * 100) { // emulate a lost packet
-	DEBUG('n', "oops, lost it!\n");
+	DEBUG('n', "Lost packet to addr %d\n", hdr->to);
+	stats->numPacketsLost++;
 	return;
     }
+    sprintf(toName, "SOCKET_%d", (int)hdr->to);
+    SendToSocket(sock, buffer, sizeof(PacketHeader) + hdr->length, toName);
+}
+
+// copy hdr and data into the next free buffer of the transmit queue,
+// and start sending it if the wire is idle
+//
+// Packets are no longer padded out to MaxWireSize; the receive end gets
+// the size of each one from the socket.
+void
+Network::Send(PacketHeader hdr, char* data)
+{
+    char *buffer;
 
-    // concatenate hdr and data into a single buffer, and send it out
-    char *buffer = new char[MaxWireSize];
+    ASSERT((txCount < NetworkTxSlots) && (hdr.length > 0) 
+		&& (hdr.length <= MaxPacketSize) && (hdr.from == ident));
+    DEBUG('n', "Sending to addr %d, %d bytes, %d queued\n", hdr.to, 
+						hdr.length, txCount);
+
+    buffer = txQueue[(txHead + txCount) % NetworkTxSlots];
     *(PacketHeader *)buffer = hdr;
     bcopy(data, buffer + sizeof(PacketHeader), hdr.length);
-    SendToSocket(sock, buffer, MaxWireSize, toName);
-    delete []buffer;
+    txCount++;
+    if (!sendBusy)
+	StartSend();
 }
 
-// read a packet, if one is buffered
+// take the oldest packet out of the receive ring, if there is one
 PacketHeader
 Network::Receive(char* data)
 {
-    PacketHeader hdr = inHdr;
+    PacketHeader hdr;
+    char *buffer;
 
-    inHdr.length = 0;
-    if (hdr.length != 0)
-    	bcopy(inbox, data, hdr.length);
+    if (rxCount == 0) {
+	hdr.length = 0;
+	return hdr;
+    }
+    buffer = rxRing[rxHead];
+    hdr = *(PacketHeader *)buffer;
+    bcopy(buffer + sizeof(PacketHeader), data, hdr.length);
+    rxHead = (rxHead + 1) % NetworkRxSlots;
+    rxCount--;
     return hdr;
 }
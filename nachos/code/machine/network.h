@@ -41,6 +41,8 @@ class PacketHeader {
 #define MaxPacketSize 	(MaxWireSize - sizeof(struct PacketHeader))	
 				// data "payload" of the largest packet
 
+#define NetworkRxSlots	32	// packets that can wait to be received
+#define NetworkTxSlots	16	// packets that can wait to be sent
 
 // The following class defines a physical network device.  The network
 // is capable of delivering fixed sized packets, in order but unreliably, 
@@ -51,6 +53,13 @@ class PacketHeader {
 // a packet.  Note that you can change the seed for the random number 
 // generator, by changing the arguments to RandomInit() in Initialize().
 // The random number generator is used to choose which packets to drop.
+//
+// The device has a ring of buffers for incoming packets, and a queue of
+// buffers for outgoing ones, all allocated up front.  Each poll moves
+// every packet waiting on the socket into the ring, until it is full.
+// Packets are put on the wire one at a time, NetworkTime apart, but
+// Send only has to wait for room in the queue.  Packets only take up as
+// many bytes on the wire as they need.
 
 class Network {
   public:
@@ -60,25 +69,27 @@ class Network {
     ~Network();			// De-allocate the network driver data
     
     void Send(PacketHeader hdr, char* data);
-    				// Send the packet data to a remote machine,
-				// specified by "hdr".  Returns immediately.
-    				// "writeHandler" is invoked once the next 
-				// packet can be sent.  Note that writeHandler 
+    				// Queue the packet data to be sent to a 
+				// remote machine, specified by "hdr".  
+				// Returns immediately; the queue must not be
+				// full.  "writeHandler" is invoked each time
+				// a packet leaves the queue, so there is room
+				// for one more.  Note that writeHandler 
 				// is called whether or not the packet is 
 				// dropped, and note that the "from" field of 
-				// the PacketHeader is filled in automatically 
-				// by Send().
+				// the PacketHeader must be filled in by the
+				// caller.
 
     PacketHeader Receive(char* data);
-    				// Poll the network for incoming messages.  
-				// If there is a packet waiting, copy the 
-				// packet into "data" and return the header.
-				// If no packet is waiting, return a header 
-				// with length 0.
+    				// Take the oldest packet out of the receive
+				// ring.  If there is a packet waiting, copy
+				// the packet into "data" and return the 
+				// header.  If no packet is waiting, return a
+				// header with length 0.
 
     void SendDone();		// Interrupt handler, called when message is 
 				// sent
-    void CheckPktAvail();	// Check if there is an incoming packet
+    void CheckPktAvail();	// Move the incoming packets into the ring
 
   private:
     NetworkAddress ident;	// This machine's network address
@@ -92,10 +103,20 @@ class Network {
     int handlerArg;		// Argument to be passed to interrupt handler
 				//   (pointer to post office)
     bool sendBusy;		// Packet is being sent.
-    bool packetAvail;		// Packet has arrived, can be pulled off of
-				//   network
-    PacketHeader inHdr;		// Information about arrived packet
-    char inbox[MaxPacketSize];  // Data for arrived packet
+
+    char rxRing[NetworkRxSlots][MaxWireSize];
+				// Arrived packets, header and data, as they
+				//   came off the wire
+    int rxHead;			// Slot of the oldest arrived packet
+    int rxCount;		// Arrived packets not yet received
+
+    char txQueue[NetworkTxSlots][MaxWireSize];
+				// Packets waiting to go out, header and data
+    int txHead;			// Slot of the packet on the wire
+    int txCount;		// Packets queued, including that one
+
+    void StartSend();		// Put the packet at the head of the queue
+				//   on the wire
 };
 
 #endif // NETWORK_H
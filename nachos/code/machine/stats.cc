@@ -19,9 +19,25 @@
 Statistics::Statistics()
 {
     totalTicks = idleTicks = systemTicks = userTicks = 0;
-    numDiskReads = numDiskWrites = 0;
+    numDiskReads = numDiskWrites = numDiskSectors = 0;
+    numDiskRequests = diskQueueDepthSum = maxDiskQueueDepth = 0;
+    diskSeekTracks = diskResponseTicks = 0;
+    numCacheHits = numCacheMisses = numCacheWriteBacks = 0;
+    numJournalOps = numJournalCommits = numJournalSectors = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
-    numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numPageFaults = numPacketsSent = numPacketsRecvd = numPacketsLost = 0;
+    numSharedCodePages = numZeroFillPages = numCleanDrops = 0;
+    numZSwapStores = numZSwapSameFilled = 0;
+    zswapPageBytes = zswapCompressedBytes = 0;
+    numZSwapRejects = numZSwapHits = numZSwapMisses = numZSwapWriteBacks = 0;
+    numZeroPageMaps = numZeroPagesDropped = numPagesMerged = 0;
+    numCopyOnWrites = numMergePasses = 0;
+    numWorkingSetSamples = workingSetSum = maxWorkingSet = 0;
+    numLocalReplacements = numLoadSuspends = suspendedTicks = 0;
+    numRetransmissions = numTransportTimeouts = 0;
+    numMailDropped = numCreditWaits = numCreditProbes = 0;
+    numRemotePageOuts = numRemotePageIns = numRemotePageHits = 0;
+    remotePageInTicks = 0;
     
     total_wait_time = 0;
     cpu_time = 0;
@@ -34,7 +50,44 @@ Statistics::Statistics()
     nonpreemptive_switch = 0;
 
     burstEstimateError = 0;
+
+    numTotalThreads = 0;
+    numCompleted = 0;
+    maxCompletion = 0;
+    minCompletion = 0x7fffffff;
+    totalCompletion = totalCompletionSquares = 0;
     totalPageFaults = 0;
+
+    numCPUs = 1;
+    for (int i = 0; i < MAX_CPUS; i++) {
+        cpuBusyTicks[i] = 0;
+        cpuSteals[i] = 0;
+    }
+
+    threadAllocs = threadReuses = 0;
+    stackAllocs = stackReuses = 0;
+    spaceAllocs = spaceReuses = 0;
+    mailAllocs = mailReuses = 0;
+
+    numLockAcquires = numLockWaits = lockWaitTicks = 0;
+    numConditionWaits = 0;
+}
+
+//----------------------------------------------------------------------
+// Statistics::RecordCompletion
+// 	Account for a thread that completed at time "ticks".  Only the
+//	running sums are kept, since pids (and so any table indexed by
+//	them) are reused.
+//----------------------------------------------------------------------
+
+void
+Statistics::RecordCompletion(int ticks)
+{
+    numCompleted++;
+    totalCompletion += ticks;
+    totalCompletionSquares += (double)ticks*ticks;
+    if (ticks > maxCompletion) maxCompletion = ticks;
+    if (ticks < minCompletion) minCompletion = ticks;
 }
 
 //----------------------------------------------------------------------
@@ -48,12 +101,68 @@ Statistics::Print()
 {
     printf("Ticks: total %d, idle %d, system %d, user %d\n", totalTicks, 
 	idleTicks, systemTicks, userTicks);
-    printf("Disk I/O: reads %d, writes %d\n", numDiskReads, numDiskWrites);
+    printf("Disk I/O: reads %d, writes %d, sectors %d\n", numDiskReads, 
+	numDiskWrites, numDiskSectors);
+    if (numDiskRequests > 0)
+	printf("Disk queue: mean depth %.2f, max waiting %d, tracks seeked %d, mean response %.2f\n",
+	    (float)diskQueueDepthSum/numDiskRequests, maxDiskQueueDepth,
+	    diskSeekTracks, (float)diskResponseTicks/numDiskRequests);
+    if ((numCacheHits + numCacheMisses) > 0)
+	printf("Sector cache: hits %d, misses %d, hit rate %.2f%%, write-backs %d\n",
+	    numCacheHits, numCacheMisses,
+	    (100.0*numCacheHits)/(numCacheHits + numCacheMisses),
+	    numCacheWriteBacks);
+    if (numJournalCommits > 0)
+	printf("Journal: operations %d, commits %d, sectors logged %d\n",
+	    numJournalOps, numJournalCommits, numJournalSectors);
     printf("Console I/O: reads %d, writes %d\n", numConsoleCharsRead, 
 	numConsoleCharsWritten);
     printf("Paging: faults %d\n", totalPageFaults);
-    printf("Network I/O: packets received %d, sent %d\n", numPacketsRecvd, 
-	numPacketsSent);
+    if ((numSharedCodePages + numZeroFillPages + numCleanDrops) > 0)
+	printf("Paged executables: shared code pages %d, zero-filled pages %d, "
+	    "pages dropped unchanged %d\n", numSharedCodePages,
+	    numZeroFillPages, numCleanDrops);
+    if ((numZSwapStores + numZSwapRejects) > 0)
+	printf("Compressed swap: pages stored %d (same-filled %d), rejected "
+	    "%d, ratio %.2f, hits %d, misses %d, hit rate %.2f%%, "
+	    "written back %d\n", numZSwapStores, numZSwapSameFilled,
+	    numZSwapRejects, (zswapCompressedBytes > 0) ?
+	    (float) zswapPageBytes / zswapCompressedBytes : 0,
+	    numZSwapHits, numZSwapMisses,
+	    (numZSwapHits + numZSwapMisses) > 0 ?
+	    (100.0*numZSwapHits)/(numZSwapHits + numZSwapMisses) : 0,
+	    numZSwapWriteBacks);
+    if ((numZeroPageMaps + numPagesMerged) > 0)
+	printf("Page merging: zero frame mappings %d, pages of zeros not "
+	    "saved %d, pages merged %d in %d passes, copy-on-writes %d\n",
+	    numZeroPageMaps, numZeroPagesDropped, numPagesMerged,
+	    numMergePasses, numCopyOnWrites);
+    if (numWorkingSetSamples > 0)
+	printf("Working sets: mean %.2f, max %d, local replacements %d, "
+	    "suspensions %d, ticks suspended %d\n",
+	    (float) workingSetSum / numWorkingSetSamples, maxWorkingSet,
+	    numLocalReplacements, numLoadSuspends, suspendedTicks);
+    printf("Network I/O: packets received %d, sent %d, lost %d\n",
+	numPacketsRecvd, numPacketsSent, numPacketsLost);
+    if (numTransportTimeouts > 0)
+	printf("Transport: timeouts %d, segments sent again %d\n",
+	    numTransportTimeouts, numRetransmissions);
+    if ((numMailDropped + numCreditWaits) > 0)
+	printf("Mailboxes: mail dropped %d, sends waiting for credits %d, "
+	    "credit probes %d\n", numMailDropped, numCreditWaits,
+	    numCreditProbes);
+    if (numRemotePageOuts > 0)
+	printf("Remote paging: pages out %d, in %d, found before they were "
+	    "sent %d, average fetch %d ticks (local swap %d)\n",
+	    numRemotePageOuts, numRemotePageIns, numRemotePageHits,
+	    (numRemotePageIns > 0) ? remotePageInTicks / numRemotePageIns : 0,
+	    SwapTime);
+    printf("Kernel allocations (requested/from heap): threads %d/%d, stacks %d/%d, address spaces %d/%d, messages %d/%d\n",
+	threadAllocs + threadReuses, threadAllocs, stackAllocs + stackReuses,
+	stackAllocs, spaceAllocs + spaceReuses, spaceAllocs,
+	mailAllocs + mailReuses, mailAllocs);
+    printf("Locks: acquisitions %d, waits %d, wait ticks %d, condition waits %d\n",
+	numLockAcquires, numLockWaits, lockWaitTicks, numConditionWaits);
 
     printf("\nTotal simulated ticks: %d\n", totalTicks - start_time);
     printf("Total CPU busy time: %d\n", cpu_time);
@@ -61,4 +170,71 @@ Statistics::Print()
     printf("Number of context switches through yield or preemption: %d, Number of non-preemptive context switches: %d\n", preemptive_switch, nonpreemptive_switch);
     printf("Total time for which the ready queue is empty: %d\n", empty_ready_queue_time);
     printf("Wait time in ready queue: Total: %d, Average: %.2f\n\n", total_wait_time, (float)total_wait_time/numTotalThreads);
+    if (numCPUs > 1) {
+        for (int i = 0; i < numCPUs; i++) {
+            printf("CPU %d: busy %d, idle %d, utilization %.2f%%, threads stolen %d\n", i,
+                cpuBusyTicks[i], totalTicks - start_time - cpuBusyTicks[i],
+                (100.0*cpuBusyTicks[i])/(totalTicks - start_time), cpuSteals[i]);
+        }
+        printf("\n");
+    }
+}
+
+//----------------------------------------------------------------------
+// Statistics::WriteCSV
+// 	Write the counters to "fileName" as one CSV header line and one
+//	CSV value line, so that the results of many runs (see bin/sweep.c)
+//	can be collected into a single table.
+//----------------------------------------------------------------------
+
+void
+Statistics::WriteCSV(char *fileName)
+{
+    char *buffer = new char[2048];
+    int fd = OpenForWrite(fileName);
+
+    sprintf(buffer, "totalTicks,idleTicks,systemTicks,userTicks,simulatedTicks,"
+	"cpuTime,cpuBursts,maxCpuBurst,minCpuBurst,preemptiveSwitches,"
+	"nonpreemptiveSwitches,emptyReadyQueueTime,totalWaitTime,threads,"
+	"diskReads,diskWrites,consoleReads,consoleWrites,pageFaults,"
+	"packetsRecvd,packetsSent,threadAllocs,threadReuses,stackAllocs,"
+	"stackReuses,spaceAllocs,spaceReuses,lockAcquires,lockWaits,"
+	"lockWaitTicks,conditionWaits,diskRequests,diskQueueDepthSum,"
+	"maxDiskQueueDepth,diskSeekTracks,diskResponseTicks,cacheHits,"
+	"cacheMisses,cacheWriteBacks,diskSectors,journalOps,journalCommits,"
+	"journalSectors,retransmissions,transportTimeouts,packetsLost,"
+	"remotePageOuts,remotePageIns,remotePageHits,remotePageInTicks,"
+	"mailDropped,creditWaits,creditProbes,mailAllocs,mailReuses,"
+	"sharedCodePages,zeroFillPages,cleanDrops,zswapStores,"
+	"zswapSameFilled,zswapPageBytes,zswapCompressedBytes,zswapRejects,zswapHits,"
+	"zswapMisses,zswapWriteBacks,zeroPageMaps,zeroPagesDropped,"
+	"pagesMerged,copyOnWrites,mergePasses,workingSetSamples,"
+	"workingSetSum,maxWorkingSet,localReplacements,loadSuspends,"
+	"suspendedTicks\n");
+    WriteFile(fd, buffer, strlen(buffer));
+    sprintf(buffer, "%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d\n",
+	totalTicks, idleTicks, systemTicks, userTicks, totalTicks - start_time,
+	cpu_time, cpu_burst_count, max_cpu_burst,
+	(cpu_burst_count > 0) ? min_cpu_burst : 0, preemptive_switch,
+	nonpreemptive_switch, empty_ready_queue_time, total_wait_time,
+	numTotalThreads, numDiskReads, numDiskWrites, numConsoleCharsRead,
+	numConsoleCharsWritten, totalPageFaults, numPacketsRecvd, numPacketsSent,
+	threadAllocs, threadReuses, stackAllocs, stackReuses, spaceAllocs,
+	spaceReuses, numLockAcquires, numLockWaits, lockWaitTicks,
+	numConditionWaits, numDiskRequests, diskQueueDepthSum,
+	maxDiskQueueDepth, diskSeekTracks, diskResponseTicks, numCacheHits,
+	numCacheMisses, numCacheWriteBacks, numDiskSectors, numJournalOps,
+	numJournalCommits, numJournalSectors, numRetransmissions,
+	numTransportTimeouts, numPacketsLost, numRemotePageOuts,
+	numRemotePageIns, numRemotePageHits, remotePageInTicks,
+	numMailDropped, numCreditWaits, numCreditProbes, mailAllocs,
+	mailReuses, numSharedCodePages, numZeroFillPages, numCleanDrops,
+	numZSwapStores, numZSwapSameFilled, zswapPageBytes, zswapCompressedBytes,
+	numZSwapRejects, numZSwapHits, numZSwapMisses, numZSwapWriteBacks,
+	numZeroPageMaps, numZeroPagesDropped, numPagesMerged, numCopyOnWrites,
+	numMergePasses, numWorkingSetSamples, workingSetSum, maxWorkingSet,
+	numLocalReplacements, numLoadSuspends, suspendedTicks);
+    WriteFile(fd, buffer, strlen(buffer));
+    Close(fd);
+    delete [] buffer;
 }
@@ -13,6 +13,8 @@
 
 #include "copyright.h"
 
+#define MAX_CPUS	16	// Upper limit on simulated processors
+
 // The following class defines the statistics that are to be kept
 // about Nachos behavior -- how much time (ticks) elapsed, how
 // many user instructions executed, etc.
@@ -41,19 +43,93 @@ class Statistics {
 
     int numTotalThreads;	// Total number of created threads
 
+    int numCompleted;		// Threads whose completion time is recorded
+    int maxCompletion, minCompletion;	// Extremes of the completion times
+    double totalCompletion;	// Sum of the completion times
+    double totalCompletionSquares;	// Sum of their squares, for the variance
+
     int burstEstimateError;	// Keeps track of the squared error in burst estimates
 
     int numDiskReads;		// number of disk read requests
     int numDiskWrites;		// number of disk write requests
+    int numDiskSectors;		// sectors moved by those requests
+    int numDiskRequests;	// requests queued in front of the disk
+    int diskQueueDepthSum;	// sum of the queue depths they found
+    int maxDiskQueueDepth;	// most requests waiting at once
+    int diskSeekTracks;		// tracks the head moved across
+    int diskResponseTicks;	// ticks from queueing to completion
+    int numCacheHits;		// sector cache lookups found in memory
+    int numCacheMisses;		// and those that were not
+    int numCacheWriteBacks;	// modified sectors written to the disk
+    int numJournalOps;		// file system operations journaled
+    int numJournalCommits;	// groups of them committed
+    int numJournalSectors;	// sectors written to the log
     int numConsoleCharsRead;	// number of characters read from the keyboard
     int numConsoleCharsWritten; // number of characters written to the display
     int numPageFaults;		// number of virtual memory page faults
+    int numSharedCodePages;	// code pages found in another process's
+				// frame, instead of read in
+    int numZeroFillPages;	// pages filled with zeros, not read in
+    int numCleanDrops;		// replaced pages that were not written
+				// back, since they had not changed
+    int numZSwapStores;		// evicted pages kept compressed
+    int numZSwapSameFilled;	// of those, pages of one repeated word
+    int zswapPageBytes;		// bytes of those pages
+    int zswapCompressedBytes;	// bytes they were compressed to, counting
+				// the word of a same-filled page
+    int numZSwapRejects;	// evicted pages that did not compress
+    int numZSwapHits;		// faults on pages found compressed
+    int numZSwapMisses;		// faults on swapped pages that were not
+    int numZSwapWriteBacks;	// compressed pages pushed out to the
+				// backup store, to make room
+    int numZeroPageMaps;	// faults served by mapping the zero frame
+    int numZeroPagesDropped;	// evicted pages of zeros, not saved
+    int numPagesMerged;		// pages merged into another frame
+    int numCopyOnWrites;	// writes to the zero frame or a merged frame
+    int numMergePasses;		// merge passes made
+    int numWorkingSetSamples;	// working sets measured, one per process
+				// per sample
+    int workingSetSum;		// pages in them, summed
+    int maxWorkingSet;		// pages in the largest one
+    int numLocalReplacements;	// pages replaced by their own process
+    int numLoadSuspends;	// processes suspended by load control
+    int suspendedTicks;		// ticks they spent suspended
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
+    int numPacketsLost;		// packets dropped by the network
+    int numRemotePageOuts;	// pages sent to the memory server
+    int numRemotePageIns;	// pages fetched back from it
+    int numRemotePageHits;	// pages needed again before they were sent
+    int remotePageInTicks;	// total time spent fetching pages
+    int numRetransmissions;	// segments sent again by the transport
+    int numTransportTimeouts;	// retransmission timeouts
+    int numMailDropped;		// mail for a full or missing mailbox
+    int numCreditWaits;		// sends that waited for credits
+    int numCreditProbes;	// times a sender asked for its credits
     int totalPageFaults;
+
+    int numCPUs;		// Number of simulated CPUs
+    int cpuBusyTicks[MAX_CPUS];	// Ticks each CPU spent running a thread
+    int cpuSteals[MAX_CPUS];	// Threads each CPU took from other queues
+
+    int threadAllocs, threadReuses;	// Thread control blocks taken from
+					// the heap, and recycled (see pool.h)
+    int stackAllocs, stackReuses;	// Same for thread stacks
+    int spaceAllocs, spaceReuses;	// Same for address spaces, page
+					// tables and backup arrays
+    int mailAllocs, mailReuses;		// Same for network messages
+
+    int numLockAcquires;	// Lock acquisitions, all locks together
+    int numLockWaits;		// Acquisitions that had to wait
+    int lockWaitTicks;		// Ticks spent waiting for locks
+    int numConditionWaits;	// Waits on condition variables
+
     Statistics(); 		// initialize everything to zero
 
+    void RecordCompletion(int ticks);	// a thread completed at "ticks"
     void Print();		// print collected statistics
+    void WriteCSV(char *fileName);	// write the counters as a CSV header
+				// line and a CSV value line
 };
 
 // Constants used to reflect the relative time an operation would
@@ -70,6 +146,8 @@ class Statistics {
 #define SeekTime 	500    	// time disk takes to seek past one track
 #define ConsoleTime 	100	// time to read or write one character
 #define NetworkTime 	100   	// time to send or receive one packet
+#define SwapTime	1000	// time to bring a page back from swap
+#define ZSwapTime	50	// time to decompress a page
 #define TimerTicks 	100   	// (average) time between timer interrupts
 
 #endif // STATS_H
@@ -35,6 +35,7 @@ extern "C" {
 #include <sys/file.h>
 #include <sys/un.h>
 #include <sys/mman.h>
+#include <sys/uio.h>
 #ifdef HOST_i386
 #include <sys/time.h>
 #endif
@@ -221,6 +222,46 @@ Lseek(int fd, int offset, int whence)
     ASSERT(retVal >= 0);
 }
 
+//----------------------------------------------------------------------
+// ReadVectorAt/WriteVectorAt
+// 	Read/write "numBuffers" buffers of "bufSize" bytes each, from/to
+//	consecutive locations of an open file starting at "offset", with
+//	a single system call.  The file position is not used.  Abort on
+//	error.
+//----------------------------------------------------------------------
+
+static struct iovec *
+MakeIOVector(char **buffers, int bufSize, int numBuffers)
+{
+    struct iovec *iov = new struct iovec[numBuffers];
+
+    for (int i = 0; i < numBuffers; i++) {
+	iov[i].iov_base = buffers[i];
+	iov[i].iov_len = bufSize;
+    }
+    return iov;
+}
+
+void
+ReadVectorAt(int fd, char **buffers, int bufSize, int numBuffers, int offset)
+{
+    struct iovec *iov = MakeIOVector(buffers, bufSize, numBuffers);
+    int retVal = preadv(fd, iov, numBuffers, offset);
+
+    ASSERT(retVal == bufSize * numBuffers);
+    delete [] iov;
+}
+
+void
+WriteVectorAt(int fd, char **buffers, int bufSize, int numBuffers, int offset)
+{
+    struct iovec *iov = MakeIOVector(buffers, bufSize, numBuffers);
+    int retVal = pwritev(fd, iov, numBuffers, offset);
+
+    ASSERT(retVal == bufSize * numBuffers);
+    delete [] iov;
+}
+
 //----------------------------------------------------------------------
 // Tell
 // 	Report the current location within an open file.
@@ -260,6 +301,45 @@ Unlink(char *name)
     return unlink(name);
 }
 
+//----------------------------------------------------------------------
+// MapFile
+// 	Map "size" bytes of an open file into our address space, shared,
+//	so that stores to the mapping end up in the file.  Abort on error.
+//----------------------------------------------------------------------
+
+char *
+MapFile(int fd, int size)
+{
+    void *addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    ASSERT(addr != MAP_FAILED);
+    return (char *) addr;
+}
+
+//----------------------------------------------------------------------
+// SyncMappedFile
+// 	Wait until the contents of a mapping are written to the file.
+//----------------------------------------------------------------------
+
+void
+SyncMappedFile(char *addr, int size)
+{
+    int retVal = msync(addr, size, MS_SYNC);
+    ASSERT(retVal >= 0);
+}
+
+//----------------------------------------------------------------------
+// UnmapFile
+// 	Remove a mapping made by MapFile.
+//----------------------------------------------------------------------
+
+void
+UnmapFile(char *addr, int size)
+{
+    int retVal = munmap(addr, size);
+    ASSERT(retVal >= 0);
+}
+
 //----------------------------------------------------------------------
 // OpenSocket
 // 	Open an interprocess communication (IPC) connection.  For now, 
@@ -344,9 +424,10 @@ PollSocket(int sockID)
 
 //----------------------------------------------------------------------
 // ReadFromSocket
-// 	Read a fixed size packet off the IPC port.  Abort on error.
+// 	Read a packet of at most "packetSize" bytes off the IPC port, and
+//	return its size.  Abort on error.
 //----------------------------------------------------------------------
-void
+int
 ReadFromSocket(int sockID, char *buffer, int packetSize)
 {
     int retVal;
@@ -357,16 +438,17 @@ ReadFromSocket(int sockID, char *buffer, int packetSize)
     retVal = recvfrom(sockID, buffer, packetSize, 0,
 				   (struct sockaddr *) &uName, (socklen_t*)&size);
 
-    if (retVal != packetSize) {
+    if (retVal <= 0) {
         perror("in recvfrom");
         printf("called: %p, got back %d, %d\n", buffer, retVal, errno);
     }
-    ASSERT(retVal == packetSize);
+    ASSERT(retVal > 0);
+    return retVal;
 }
 
 //----------------------------------------------------------------------
 // SendToSocket
-// 	Transmit a fixed size packet to another Nachos' IPC port.
+// 	Transmit a packet to another Nachos' IPC port.
 //	Abort on error.
 //----------------------------------------------------------------------
 void
@@ -407,6 +489,21 @@ Delay(int seconds)
     (void) sleep((unsigned) seconds);
 }
 
+//----------------------------------------------------------------------
+// HostTime
+// 	Return the wall clock time of the host, in seconds.  Only useful
+//	to measure how long the simulator itself takes.
+//----------------------------------------------------------------------
+
+double
+HostTime()
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
 //----------------------------------------------------------------------
 // Abort
 // 	Quit and drop core.
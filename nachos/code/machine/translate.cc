@@ -244,7 +244,7 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 
     // if the pageFrame is too big, there is something really wrong! 
     // An invalid translation was loaded into the page table or TLB. 
-    if (pageFrame >= NumPhysPages) { 
+    if (pageFrame >= (unsigned) NumPhysPages) { 
 	DEBUG('a', "*** frame %d > %d!\n", pageFrame, NumPhysPages);
     //printf("Frame = %d, max frame = %d\n", pageFrame, NumPhysPages);
 	return BusErrorException;
@@ -280,7 +280,7 @@ Machine::GetPA (unsigned vaddr)
    if ((vpn < KernelPageTableSize) && KernelPageTable[vpn].valid) {
       entry = &KernelPageTable[vpn];
       pageFrame = entry->physicalPage;
-      if (pageFrame >= NumPhysPages) return -1;
+      if (pageFrame >= (unsigned) NumPhysPages) return -1;
       return pageFrame * PageSize + offset;
    }
    else return -1;
@@ -42,6 +42,10 @@ class TranslationEntry {
 			// page is modified.
     bool shared; // check whether the page is shared
     bool loadFromSwap; // check whether the page should be loaded from swap memory
+    bool zeroFilled;	// held only zeros when it was last evicted; it 
+			// comes back as the zero frame (see pagemerge.h)
+    int lastUse;	// when "use" was last seen set, -1 if never (see
+			// workingset.h)
 
 };
 
@@ -6,6 +6,16 @@
 //	  1. Two copies of Nachos must be running, with machine ID's 0 and 1:
 //		./nachos -m 0 -o 1 &
 //		./nachos -m 1 -o 0 &
+//	     or, for the reliable transport benchmark, with the packet
+//	     loss rate set by -l on both sides:
+//		./nachos -m 0 -l 0.9 -rt 1 &
+//		./nachos -m 1 -l 0.9 -rt 0 &
+//	     The fabric test needs only one, which runs all the machines,
+//	     optionally with the links described by a file (see fabric.cc):
+//		./nachos -fabric 32 -ft
+//	     and so does the mailbox test, with two machines, and with
+//	     lost packets if -n is less than 1:
+//		./nachos -fabric 2 -n 0.9 -mbt
 //
 //	  2. You need an implementation of condition variables,
 //	     which is *not* provided as part of the baseline threads 
@@ -22,6 +32,7 @@
 #include "network.h"
 #include "post.h"
 #include "interrupt.h"
+#include "transport.h"
 
 // Test out message delivery, by doing the following:
 //	1. send a message to the machine with ID "farAddr", at mail box #0
@@ -70,3 +81,309 @@ MailTest(int farAddr)
     // Then we're done!
     interrupt->Halt();
 }
+
+// Benchmark the reliable transport, by doing the following on a
+// connection for each window size in "testWindows":
+//	1. the machine with the lower ID sends NumPings short messages,
+//	   each of which the other machine sends back -- the round trip
+//	   time is the latency
+//	2. it then sends NumBulk messages of BulkSize bytes; the other
+//	   machine checks them, and answers once it has them all -- this
+//	   gives the throughput
+// Each window size uses its own pair of mailboxes, starting at 2.
+// Run it with different loss rates (-l) to see how the transport 
+// copes with lost packets.
+
+#define NumPings	50
+#define PingSize	8
+#define NumBulk		20
+#define BulkSize	1000
+
+static int testWindows[] = { 1, 4, 16 };
+#define NumTestWindows	(int) (sizeof(testWindows) / sizeof(int))
+
+static void
+TransportClient(Connection *conn, int window)
+{
+    char ping[PingSize], *bulk = new char[BulkSize];
+    int i, j, start, pingTicks, bulkTicks, retransmissions;
+
+    bzero(ping, PingSize);
+    retransmissions = stats->numRetransmissions;
+    start = stats->totalTicks;
+    for (i = 0; i < NumPings; i++) {
+	if (!conn->Send(ping, PingSize) || (conn->Receive(ping, PingSize) < 0))
+	    break;
+    }
+    pingTicks = stats->totalTicks - start;
+
+    start = stats->totalTicks;
+    for (i = 0; i < NumBulk; i++) {
+	for (j = 0; j < BulkSize; j++)
+	    bulk[j] = (char) (i + j);
+	if (!conn->Send(bulk, BulkSize))
+	    break;
+    }
+    if (conn->Receive(ping, PingSize) < 0)
+	i = 0;				// never answered
+    bulkTicks = stats->totalTicks - start;
+
+    printf("Window %2d: round trip %d ticks, %.1f bytes per 1000 ticks, "
+	"%d segments sent again\n", window, pingTicks / NumPings,
+	(bulkTicks > 0) ? (1000.0 * i * BulkSize) / bulkTicks : 0.0,
+	stats->numRetransmissions - retransmissions);
+    delete [] bulk;
+}
+
+static void
+TransportServer(Connection *conn, int window)
+{
+    char ping[PingSize], *bulk = new char[BulkSize];
+    int i, j, length, bad = 0;
+
+    for (i = 0; i < NumPings; i++) {
+	length = conn->Receive(ping, PingSize);
+	if ((length < 0) || !conn->Send(ping, length))
+	    break;
+    }
+    for (i = 0; i < NumBulk; i++) {
+	if (conn->Receive(bulk, BulkSize) != BulkSize) {
+	    bad++;
+	    continue;
+	}
+	for (j = 0; j < BulkSize; j++)
+	    if (bulk[j] != (char) (i + j)) {
+		bad++;
+		break;
+	    }
+    }
+    conn->Send(ping, PingSize);
+    conn->Flush();
+    printf("Window %2d: received %d messages, %d of them wrong\n", window,
+	NumBulk, bad);
+    delete [] bulk;
+}
+
+void
+TransportTest(int farAddr)
+{
+    bool client = (postOffice->GetAddress() < farAddr);
+    Connection *conn;
+    int w;
+
+    for (w = 0; w < NumTestWindows; w++) {
+	conn = new Connection(postOffice, 2 + w, farAddr, 2 + w, testWindows[w]);
+	if (client)
+	    TransportClient(conn, testWindows[w]);
+	else
+	    TransportServer(conn, testWindows[w]);
+    }
+    stats->Print();
+    fflush(stdout);
+    interrupt->Halt();
+}
+
+// Test the fabric, with every machine in this process sending to the
+// next one around a ring over a reliable connection, all at once:
+// machine i sends FabricMessages messages of BulkSize bytes from its
+// mailbox 2 to mailbox 3 of machine i+1, which checks them.  The links
+// can be made slow or lossy with -links.
+
+#define FabricMessages	10
+#define FabricWindow	8
+
+static Semaphore *fabricDone;		// V'ed as each sender or receiver
+					// finishes
+static int fabricBad;			// Messages that came out wrong
+
+static void
+FabricSender(int node)
+{
+    int nodes = fabric->NumNodes();
+    Connection *conn = new Connection(postOffices[node], 2,
+				(node + 1) % nodes, 3, FabricWindow);
+    char *bulk = new char[BulkSize];
+    int i, j;
+
+    for (i = 0; i < FabricMessages; i++) {
+	for (j = 0; j < BulkSize; j++)
+	    bulk[j] = (char) (node + i + j);
+	if (!conn->Send(bulk, BulkSize))
+	    break;
+    }
+    conn->Flush();
+    delete [] bulk;
+    fabricDone->V();
+}
+
+static void
+FabricReceiver(int node)
+{
+    int nodes = fabric->NumNodes();
+    int from = (node + nodes - 1) % nodes;
+    Connection *conn = new Connection(postOffices[node], 3, from, 2,
+				FabricWindow);
+    char *bulk = new char[BulkSize];
+    int i, j;
+
+    for (i = 0; i < FabricMessages; i++) {
+	if (conn->Receive(bulk, BulkSize) != BulkSize) {
+	    fabricBad++;
+	    continue;
+	}
+	for (j = 0; j < BulkSize; j++)
+	    if (bulk[j] != (char) (from + i + j)) {
+		fabricBad++;
+		break;
+	    }
+    }
+    delete [] bulk;
+    fabricDone->V();
+}
+
+void
+FabricTest()
+{
+    NachOSThread *t;
+    int nodes, i, start;
+
+    ASSERT(fabric != NULL);		// needs -fabric
+    nodes = fabric->NumNodes();
+    fabricDone = new Semaphore("fabric test done", 0);
+    fabricBad = 0;
+    start = stats->totalTicks;
+    for (i = 0; i < nodes; i++) {
+	t = new NachOSThread("fabric receiver", MIN_NICE_PRIORITY);
+	t->ThreadFork(FabricReceiver, i);
+	t = new NachOSThread("fabric sender", MIN_NICE_PRIORITY);
+	t->ThreadFork(FabricSender, i);
+    }
+    for (i = 0; i < 2 * nodes; i++)
+	fabricDone->P();
+
+    printf("Fabric: %d machines, %d messages each, %d of them wrong, "
+	"%d ticks\n", nodes, FabricMessages, fabricBad,
+	stats->totalTicks - start);
+    stats->Print();
+    fflush(stdout);
+    interrupt->Halt();
+}
+
+// Test mailboxes made while the post office runs, and the credits that
+// keep senders from overrunning them, with machine 0 of the fabric
+// sending to machine 1:
+//	1. make a mailbox, throw it away, and check that it is gone
+//	2. make another one, and send BoxMessages numbered messages to it,
+//	   while the receiver takes them out slowly -- the sender runs out
+//	   of credits, and has to wait for them; if -n drops packets,
+//	   credits it never hears about are recovered by asking for them
+//	3. throw the mailbox away, and send to it again -- the mail is
+//	   dropped, and the sender gets its credits back by asking
+
+#define BoxMessages	(4 * MailBoxSlots)
+#define SlowYields	20		// Yields between two messages taken
+#define DrainYields	1000		// Yields with nothing arriving, once
+					// the sender is done
+
+static int testBox;			// The receiver's mailbox
+static bool senderDone;			// Has the sender sent them all?
+static Semaphore *boxSenderDone;	// V'ed when it has
+
+static void
+BoxSender(int count)
+{
+    PacketHeader pktHdr;
+    MailHeader mailHdr;
+    int i;
+
+    pktHdr.to = 1;
+    mailHdr.to = testBox;
+    mailHdr.from = 0;
+    mailHdr.length = sizeof(int);
+    for (i = 0; i < count; i++)
+	postOffices[0]->Send(pktHdr, mailHdr, (char *) &i);
+    senderDone = TRUE;
+    boxSenderDone->V();
+}
+
+static void
+StartBoxSender(int count)
+{
+    NachOSThread *t = new NachOSThread("mailbox sender", MIN_NICE_PRIORITY);
+
+    senderDone = FALSE;
+    t->ThreadFork(BoxSender, count);
+}
+
+void
+MailBoxTest()
+{
+    PacketHeader pktHdr;
+    MailHeader mailHdr;
+    char buffer[MaxMailSize];
+    int i, box, next = 0, received = 0, idle = 0, waits, probes, dropped;
+    bool ok = TRUE;
+
+    ASSERT((fabric != NULL) && (fabric->NumNodes() >= 2));	// -fabric 2
+    boxSenderDone = new Semaphore("mailbox sender done", 0);
+
+    // 1. make and destroy a mailbox
+    box = postOffices[1]->CreateBox();
+    if ((box == -1) || !postOffices[1]->HasBox(box))
+	ok = FALSE;
+    else {
+	postOffices[1]->DestroyBox(box);
+	if (postOffices[1]->HasBox(box))
+	    ok = FALSE;
+    }
+    printf("Mailbox %d made and destroyed: %s\n", box, ok ? "ok" : "FAILED");
+
+    // 2. fill a mailbox against a slow receiver
+    testBox = postOffices[1]->CreateBox();
+    ASSERT(testBox != -1);
+    waits = stats->numCreditWaits;
+    probes = stats->numCreditProbes;
+    StartBoxSender(BoxMessages);
+    while (!senderDone || (idle < DrainYields)) {
+	if (!postOffices[1]->TryReceive(testBox, &pktHdr, &mailHdr, buffer)) {
+	    if (senderDone)
+		idle++;
+	    currentThread->YieldCPU();
+	    continue;
+	}
+	idle = 0;
+	if (*(int *) buffer < next) {	// out of order, or twice
+	    printf("Message %d after message %d\n", *(int *) buffer, next - 1);
+	    ok = FALSE;
+	}
+	next = *(int *) buffer + 1;
+	received++;
+	for (i = 0; i < SlowYields; i++)
+	    currentThread->YieldCPU();
+    }
+    boxSenderDone->P();
+    waits = stats->numCreditWaits - waits;
+    if (waits == 0)			// the receiver was not slow enough
+	ok = FALSE;
+    printf("Slow receiver: %d of %d messages received, sender waited for "
+	"credits %d times, asked for them %d times\n", received, BoxMessages,
+	waits, stats->numCreditProbes - probes);
+
+    // 3. send to a mailbox that is gone
+    postOffices[1]->DestroyBox(testBox);
+    probes = stats->numCreditProbes;
+    dropped = stats->numMailDropped;
+    StartBoxSender(2 * MailBoxSlots);
+    boxSenderDone->P();
+    probes = stats->numCreditProbes - probes;
+    if (probes == 0)			// credits came back on their own?
+	ok = FALSE;
+    printf("Destroyed mailbox: %d messages dropped, sender asked for "
+	"credits %d times\n", stats->numMailDropped - dropped, probes);
+
+    printf("Mailbox test: %s\n", ok ? "passed" : "FAILED");
+    delete boxSenderDone;
+    stats->Print();
+    fflush(stdout);
+    interrupt->Halt();
+}
@@ -12,12 +12,25 @@
 // 	The implementation synchronizes incoming messages with threads
 //	waiting for those messages.
 //
+//	Credits are counted from the start, in both directions, so that
+//	a lost credit message is made up for by the next one.  A sender
+//	that waits CreditTimeout ticks for credits sends the receiver a
+//	probe with the number of messages it has sent; the receiver
+//	counts those that never arrived as lost, and answers with its
+//	credits.  The network delivers the packets from one machine to
+//	another in order, so every message sent before the probe that
+//	has not arrived by then never will.
+//
+//	The credit lines are shared with the timer interrupt handler, so
+//	they are only touched with interrupts off.
+//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
 #include "post.h"
+#include "system.h"
 
 //----------------------------------------------------------------------
 // Mail::Mail
@@ -38,18 +51,44 @@ Mail::Mail(PacketHeader pktH, MailHeader mailH, char *msgData)
     bcopy(msgData, data, mailHdr.length);
 }
 
+//----------------------------------------------------------------------
+// Mail::operator new
+// Mail::operator delete
+// 	Messages come from mailPool, so that a busy mailbox reuses the
+//	memory of the messages taken out of it.
+//----------------------------------------------------------------------
+
+void *
+Mail::operator new(size_t size)
+{
+    return mailPool->Get(size);
+}
+
+void
+Mail::operator delete(void *ptr, size_t size)
+{
+    mailPool->Put((char *) ptr, size);
+}
+
 //----------------------------------------------------------------------
 // MailBox::MailBox
 //      Initialize a single mail box within the post office, so that it
 //	can receive incoming messages.
 //
 //	Just initialize a list of messages, representing the mailbox.
+//
+//	"po" -- the post office it belongs to
+//	"addr" -- its number there
 //----------------------------------------------------------------------
 
 
-MailBox::MailBox()
+MailBox::MailBox(PostOffice *po, MailBoxAddress addr)
 { 
+    office = po;
+    boxAddr = addr;
     messages = new SynchList(); 
+    numMessages = 0;
+    senders = NULL;
 }
 
 //----------------------------------------------------------------------
@@ -62,7 +101,16 @@ MailBox::MailBox()
 
 MailBox::~MailBox()
 { 
+    Mail *mail;
+    MailSender *sender;
+
+    while ((mail = (Mail *) messages->TryRemove()) != NULL)
+	delete mail;
     delete messages; 
+    while ((sender = senders) != NULL) {
+	senders = sender->next;
+	delete sender;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -89,6 +137,9 @@ PrintHeader(PacketHeader pktHdr, MailHeader mailHdr)
 //	We need to reconstruct the Mail message (by concatenating the headers
 //	to the data), to simplify queueing the message on the SynchList.
 //
+//	If the mailbox is full, the message is dropped instead, and its
+//	credit is given back to the sender.
+//
 //	"pktHdr" -- source, destination machine ID's
 //	"mailHdr" -- source, destination mailbox ID's
 //	"data" -- payload message data
@@ -97,8 +148,19 @@ PrintHeader(PacketHeader pktHdr, MailHeader mailHdr)
 void 
 MailBox::Put(PacketHeader pktHdr, MailHeader mailHdr, char *data)
 { 
-    Mail *mail = new Mail(pktHdr, mailHdr, data); 
-
+    MailSender *sender = FindSender(pktHdr.from);
+    Mail *mail;
+
+    sender->arrived++;
+    if (numMessages >= MailBoxSlots) {
+	DEBUG('n', "Mailbox %d full, dropping mail from %d\n", boxAddr,
+							pktHdr.from);
+	stats->numMailDropped++;
+	Taken(sender);
+	return;
+    }
+    mail = new Mail(pktHdr, mailHdr, data); 
+    numMessages++;
     messages->Append((void *)mail);	// put on the end of the list of 
 					// arrived messages, and wake up 
 					// any waiters
@@ -123,17 +185,149 @@ MailBox::Get(PacketHeader *pktHdr, MailHeader *mailHdr, char *data)
     Mail *mail = (Mail *) messages->Remove();	// remove message from list;
 						// will wait if list is empty
 
-    *pktHdr = mail->pktHdr;
-    *mailHdr = mail->mailHdr;
+    TakeOut(mail, pktHdr, mailHdr, data);
     if (DebugIsEnabled('n')) {
 	printf("Got mail from mailbox: ");
 	PrintHeader(*pktHdr, *mailHdr);
     }
+}
+
+//----------------------------------------------------------------------
+// MailBox::TryGet
+// 	Get a message from a mailbox, if there is one, as for Get.
+//	Return FALSE, without waiting, if the mailbox is empty.
+//----------------------------------------------------------------------
+
+bool
+MailBox::TryGet(PacketHeader *pktHdr, MailHeader *mailHdr, char *data) 
+{ 
+    Mail *mail = (Mail *) messages->TryRemove();
+
+    if (mail == NULL)
+	return FALSE;
+    TakeOut(mail, pktHdr, mailHdr, data);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// MailBox::TakeOut
+// 	Parse a message removed from the mailbox into the packet header,
+//	mailbox header, and data, throw it away, and count its credit.
+//----------------------------------------------------------------------
+
+void
+MailBox::TakeOut(Mail *mail, PacketHeader *pktHdr, MailHeader *mailHdr,
+			char *data)
+{
+    numMessages--;
+    *pktHdr = mail->pktHdr;
+    *mailHdr = mail->mailHdr;
     bcopy(mail->data, data, mail->mailHdr.length);
 					// copy the message data into
 					// the caller's buffer
     delete mail;			// we've copied out the stuff we
 					// need, we can now discard the message
+    Taken(FindSender(pktHdr->from));
+}
+
+//----------------------------------------------------------------------
+// MailBox::FindSender
+// 	Return what we know about machine "from", starting to keep track
+//	of it the first time it sends to us.
+//----------------------------------------------------------------------
+
+MailSender *
+MailBox::FindSender(NetworkAddress from)
+{
+    MailSender *sender;
+
+    for (sender = senders; sender != NULL; sender = sender->next)
+	if (sender->addr == from)
+	    return sender;
+    sender = new MailSender;
+    sender->addr = from;
+    sender->arrived = sender->taken = sender->reported = 0;
+    sender->next = senders;
+    senders = sender;
+    return sender;
+}
+
+//----------------------------------------------------------------------
+// MailBox::Taken
+// 	A message from "sender" has been taken out of the mailbox, or
+//	dropped.  Return the credits owed to the sender once there are
+//	MailCreditBatch of them.  The sender cannot be waiting for fewer:
+//	it has MailBoxSlots credits, so the rest of its messages are
+//	still in the mailbox, and will be taken out, or were lost, and
+//	it will ask about them.
+//----------------------------------------------------------------------
+
+void
+MailBox::Taken(MailSender *sender)
+{
+    sender->taken++;
+    if (sender->taken - sender->reported >= MailCreditBatch) {
+	sender->reported = sender->taken;
+	office->SendControl(sender->addr, MailCredit, boxAddr, sender->taken);
+    }
+}
+
+//----------------------------------------------------------------------
+// MailBox::Probed
+// 	Machine "from" has sent "sent" messages to the mailbox.  Those
+//	that have not arrived were lost: count them as taken out, and
+//	return how many have been taken out in all.
+//----------------------------------------------------------------------
+
+int
+MailBox::Probed(NetworkAddress from, int sent)
+{
+    MailSender *sender = FindSender(from);
+
+    if (sent > sender->arrived) {
+	DEBUG('n', "Mailbox %d: %d messages from %d were lost\n", boxAddr,
+				sent - sender->arrived, from);
+	sender->taken += sent - sender->arrived;
+	sender->arrived = sent;
+    }
+    sender->reported = sender->taken;
+    return sender->taken;
+}
+
+//----------------------------------------------------------------------
+// CreditTimer
+// 	Dummy function because C++ can't indirectly invoke member
+//	functions; the interrupt handler of a credit line's timer.
+//
+//	"arg" -- pointer to the credit line
+//----------------------------------------------------------------------
+
+static void CreditTimer(int arg)
+{ MailCreditLine *line = (MailCreditLine *) arg; line->TimerExpired(); }
+
+//----------------------------------------------------------------------
+// MailCreditLine::TimerExpired
+// 	Interrupt handler of the credit timer.  If the threads waiting
+//	for credits have waited until the deadline, wake them up to ask
+//	the receiver for them; if they started waiting again since, wait
+//	until the new deadline.
+//----------------------------------------------------------------------
+
+void
+MailCreditLine::TimerExpired()
+{
+    timerPending = FALSE;
+    if (waiters == 0)
+	return;				// credits arrived
+    if (stats->totalTicks < deadline) {
+	timerPending = TRUE;
+	interrupt->Schedule(CreditTimer, (int) this,
+			deadline - stats->totalTicks, NetworkSendInt);
+	return;
+    }
+    probe = TRUE;
+    for (; waiters > 0; waiters--)
+	creditArrived->V();
 }
 
 //----------------------------------------------------------------------
@@ -173,15 +367,22 @@ static void WriteDone(int arg)
 
 PostOffice::PostOffice(NetworkAddress addr, double reliability, int nBoxes)
 {
+    int i;
+
+    ASSERT(nBoxes <= MaxMailBoxes);
+
 // First, initialize the synchronization with the interrupt handlers
     messageAvailable = new Semaphore("message available", 0);
-    messageSent = new Semaphore("message sent", 0);
-    sendLock = new Lock("message send lock");
+    messageSent = new Semaphore("message sent", NetworkTxSlots);
 
 // Second, initialize the mailboxes
     netAddr = addr; 
-    numBoxes = nBoxes;
-    boxes = new MailBox[nBoxes];
+    boxes = new MailBox*[MaxMailBoxes];
+    for (i = 0; i < MaxMailBoxes; i++)
+	boxes[i] = (i < nBoxes) ? new MailBox(this, i) : NULL;
+    firstFreeBox = nBoxes;
+    boxLock = new Lock("mailbox table");
+    lines = NULL;
 
 // Third, initialize the network; tell it which interrupt handlers to call
     network = new Network(addr, reliability, ReadAvail, WriteDone, (int) this);
@@ -189,7 +390,7 @@ PostOffice::PostOffice(NetworkAddress addr, double reliability, int nBoxes)
 
 // Finally, create a thread whose sole job is to wait for incoming messages,
 //   and put them in the right mailbox. 
-    NachOSThread *t = new NachOSThread("postal worker");
+    NachOSThread *t = new NachOSThread("postal worker", MIN_NICE_PRIORITY);
 
     t->ThreadFork(PostalHelper, (int) this);
 }
@@ -201,19 +402,32 @@ PostOffice::PostOffice(NetworkAddress addr, double reliability, int nBoxes)
 
 PostOffice::~PostOffice()
 {
+    MailCreditLine *line;
+
     delete network;
+    for (int i = 0; i < MaxMailBoxes; i++)
+	if (boxes[i] != NULL)
+	    delete boxes[i];
     delete [] boxes;
+    delete boxLock;
+    while ((line = lines) != NULL) {
+	lines = line->next;
+	delete line->creditArrived;
+	delete line;
+    }
     delete messageAvailable;
     delete messageSent;
-    delete sendLock;
 }
 
 //----------------------------------------------------------------------
 // PostOffice::PostalDelivery
 // 	Wait for incoming messages, and put them in the right mailbox.
 //
-//      Incoming messages have had the PacketHeader stripped off,
+//	Incoming messages have had the PacketHeader stripped off,
 //	but the MailHeader is still tacked on the front of the data.
+//
+//	Credit and probe messages are handled here, and mail for a
+//	mailbox that does not exist is dropped.
 //----------------------------------------------------------------------
 
 void
@@ -222,6 +436,8 @@ PostOffice::PostalDelivery()
     PacketHeader pktHdr;
     MailHeader mailHdr;
     char *buffer = new char[MaxPacketSize];
+    CreditMessage *msg = (CreditMessage *) (buffer + sizeof(MailHeader));
+    int count;
 
     for (;;) {
         // first, wait for a message
@@ -234,12 +450,32 @@ PostOffice::PostalDelivery()
 	    PrintHeader(pktHdr, mailHdr);
         }
 
+	if (mailHdr.to == MailCredit) {
+	    CreditReturned(pktHdr.from, msg);
+	    continue;
+	}
+	boxLock->Acquire();
+	if (mailHdr.to == MailProbe) {
+	    // a box we do not have has taken out everything sent to it
+	    count = HasBox(msg->box) ? boxes[msg->box]->Probed(pktHdr.from,
+							msg->count)
+				     : msg->count;
+	    boxLock->Release();
+	    SendControl(pktHdr.from, MailCredit, msg->box, count);
+	    continue;
+	}
+
 	// check that arriving message is legal!
-	ASSERT(0 <= mailHdr.to && mailHdr.to < numBoxes);
 	ASSERT(mailHdr.length <= MaxMailSize);
 
 	// put into mailbox
-        boxes[mailHdr.to].Put(pktHdr, mailHdr, buffer + sizeof(MailHeader));
+	if (HasBox(mailHdr.to))
+	    boxes[mailHdr.to]->Put(pktHdr, mailHdr, buffer + sizeof(MailHeader));
+	else {
+	    DEBUG('n', "No mailbox %d, dropping mail\n", mailHdr.to);
+	    stats->numMailDropped++;
+	}
+	boxLock->Release();
     }
 }
 
@@ -251,6 +487,12 @@ PostOffice::PostalDelivery()
 //	Note that the MailHeader + data looks just like normal payload
 //	data to the Network.
 //
+//	The Network copies the packet into its transmit queue, so we
+//	only wait if the queue is full, not for the packet to go out --
+//	or if we have used up our credits for the mailbox.  The data is
+//	copied before we wait for a credit, so the caller may pass memory
+//	that can change meanwhile, such as a user program's page.
+//
 //	"pktHdr" -- source, destination machine ID's
 //	"mailHdr" -- source, destination mailbox ID's
 //	"data" -- payload message data
@@ -259,15 +501,77 @@ PostOffice::PostalDelivery()
 void
 PostOffice::Send(PacketHeader pktHdr, MailHeader mailHdr, char* data)
 {
-    char* buffer = new char[MaxPacketSize];	// space to hold concatenated
-						// mailHdr + data
+    char payload[MaxMailSize];		// copy of the data, if we wait
+
+    ASSERT(0 <= mailHdr.to && mailHdr.to < MaxMailBoxes);
+    ASSERT(mailHdr.length <= MaxMailSize);
+    if (!TakeCredit(pktHdr, mailHdr, FALSE)) {
+	bcopy(data, payload, mailHdr.length);
+	data = payload;
+	TakeCredit(pktHdr, mailHdr, TRUE);
+    }
+    Transmit(pktHdr, mailHdr, data);
+}
+
+//----------------------------------------------------------------------
+// PostOffice::TrySend
+// 	Send a message, as for Send, if we have a credit for the mailbox;
+//	otherwise return FALSE at once.  For messages that may as well
+//	be lost as wait, like acknowledgements.
+//----------------------------------------------------------------------
+
+bool
+PostOffice::TrySend(PacketHeader pktHdr, MailHeader mailHdr, char* data)
+{
+    ASSERT(0 <= mailHdr.to && mailHdr.to < MaxMailBoxes);
+    if (!TakeCredit(pktHdr, mailHdr, FALSE))
+	return FALSE;
+    Transmit(pktHdr, mailHdr, data);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// PostOffice::SendControl
+// 	Send a credit or probe message, which takes no credits.
+//
+//	"to" -- machine to send it to
+//	"type" -- MailCredit or MailProbe
+//	"box", "count" -- what it says
+//----------------------------------------------------------------------
+
+void
+PostOffice::SendControl(NetworkAddress to, int type, int box, int count)
+{
+    PacketHeader pktHdr;
+    MailHeader mailHdr;
+    CreditMessage msg;
+
+    msg.box = box;
+    msg.count = count;
+    pktHdr.to = to;
+    mailHdr.to = type;
+    mailHdr.from = box;
+    mailHdr.length = sizeof(CreditMessage);
+    Transmit(pktHdr, mailHdr, (char *) &msg);
+}
+
+//----------------------------------------------------------------------
+// PostOffice::Transmit
+// 	Concatenate the MailHeader to the front of the data, and pass 
+//	the result to the Network, waiting for room in its queue.
+//----------------------------------------------------------------------
+
+void
+PostOffice::Transmit(PacketHeader pktHdr, MailHeader mailHdr, char* data)
+{
+    char buffer[MaxPacketSize];		// space to hold concatenated
+					// mailHdr + data
 
     if (DebugIsEnabled('n')) {
 	printf("Post send: ");
 	PrintHeader(pktHdr, mailHdr);
     }
     ASSERT(mailHdr.length <= MaxMailSize);
-    ASSERT(0 <= mailHdr.to && mailHdr.to < numBoxes);
     
     // fill in pktHdr, for the Network layer
     pktHdr.from = netAddr;
@@ -277,15 +581,150 @@ PostOffice::Send(PacketHeader pktHdr, MailHeader mailHdr, char* data)
     bcopy(&mailHdr, buffer, sizeof(MailHeader));
     bcopy(data, buffer + sizeof(MailHeader), mailHdr.length);
 
-    sendLock->Acquire();   		// only one message can be sent
-					// to the network at any one time
+    messageSent->P();			// wait for room in the network's
+					// transmit queue
     network->Send(pktHdr, buffer);
-    messageSent->P();			// wait for interrupt to tell us
-					// ok to send the next message
-    sendLock->Release();
+}
 
-    delete [] buffer;			// we've sent the message, so
-					// we can delete our buffer
+//----------------------------------------------------------------------
+// PostOffice::FindLine
+// 	Return what we know about mailbox "box" of machine "to", starting
+//	to keep track of it, with a full set of credits, the first time
+//	we send to it.  Called with interrupts off.
+//----------------------------------------------------------------------
+
+MailCreditLine *
+PostOffice::FindLine(NetworkAddress to, MailBoxAddress box)
+{
+    MailCreditLine *line;
+
+    for (line = lines; line != NULL; line = line->next)
+	if ((line->addr == to) && (line->box == box))
+	    return line;
+    line = new MailCreditLine;
+    line->addr = to;
+    line->box = box;
+    line->sent = line->freed = line->waiters = 0;
+    line->creditArrived = new Semaphore("credit arrived", 0);
+    line->deadline = -1;
+    line->timerPending = line->probe = FALSE;
+    line->next = lines;
+    lines = line;
+    return line;
+}
+
+//----------------------------------------------------------------------
+// PostOffice::TakeCredit
+// 	Use up a credit for the mailbox a message is addressed to.  If
+//	there is none, return FALSE, or if "wait", wait for one.  A
+//	thread that has waited CreditTimeout ticks asks the receiver for
+//	its credits.
+//----------------------------------------------------------------------
+
+bool
+PostOffice::TakeCredit(PacketHeader pktHdr, MailHeader mailHdr, bool wait)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    MailCreditLine *line = FindLine(pktHdr.to, mailHdr.to);
+    bool waited = FALSE;
+
+    while (line->sent - line->freed >= MailBoxSlots) {
+	if (!wait) {
+	    (void) interrupt->SetLevel(oldLevel);
+	    return FALSE;
+	}
+	if (line->probe) {
+	    line->probe = FALSE;
+	    stats->numCreditProbes++;
+	    DEBUG('n', "No credits for (%d, %d), asking for them\n",
+						line->addr, line->box);
+	    (void) interrupt->SetLevel(oldLevel);
+	    SendControl(line->addr, MailProbe, line->box, line->sent);
+	    (void) interrupt->SetLevel(IntOff);
+	    continue;
+	}
+	if (!waited) {
+	    stats->numCreditWaits++;
+	    waited = TRUE;
+	}
+	if (line->waiters == 0) {	// start the timer
+	    line->deadline = stats->totalTicks + CreditTimeout;
+	    if (!line->timerPending) {
+		line->timerPending = TRUE;
+		interrupt->Schedule(CreditTimer, (int) line, CreditTimeout,
+							NetworkSendInt);
+	    }
+	}
+	line->waiters++;
+	line->creditArrived->P();
+    }
+    line->sent++;
+    (void) interrupt->SetLevel(oldLevel);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// PostOffice::CreditReturned
+// 	Machine "from" has taken "msg->count" messages out of mailbox
+//	"msg->box", from the start.  Wake up anyone waiting for credits
+//	for it.
+//----------------------------------------------------------------------
+
+void
+PostOffice::CreditReturned(NetworkAddress from, CreditMessage *msg)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    MailCreditLine *line = FindLine(from, msg->box);
+
+    if (msg->count > line->freed)
+	line->freed = (msg->count < line->sent) ? msg->count : line->sent;
+    for (; line->waiters > 0; line->waiters--)
+	line->creditArrived->V();
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// PostOffice::CreateBox
+// 	Make a new, empty mailbox, and return its number, or -1 if all
+//	MaxMailBoxes are in use.
+//----------------------------------------------------------------------
+
+int
+PostOffice::CreateBox()
+{
+    int box;
+
+    boxLock->Acquire();
+    for (box = firstFreeBox; box < MaxMailBoxes; box++)
+	if (boxes[box] == NULL)
+	    break;
+    if (box == MaxMailBoxes) {
+	boxLock->Release();
+	return -1;
+    }
+    boxes[box] = new MailBox(this, box);
+    boxLock->Release();
+    DEBUG('n', "Created mailbox %d\n", box);
+    return box;
+}
+
+//----------------------------------------------------------------------
+// PostOffice::DestroyBox
+// 	Throw away a mailbox, and the mail in it.  Mail that arrives for
+//	it from now on is dropped; machines still sending to it get their
+//	credits back when they ask for them.
+//----------------------------------------------------------------------
+
+void
+PostOffice::DestroyBox(int box)
+{
+    ASSERT(HasBox(box));
+
+    boxLock->Acquire();
+    delete boxes[box];
+    boxes[box] = NULL;
+    boxLock->Release();
+    DEBUG('n', "Destroyed mailbox %d\n", box);
 }
 
 //----------------------------------------------------------------------
@@ -307,12 +746,27 @@ void
 PostOffice::Receive(int box, PacketHeader *pktHdr, 
 				MailHeader *mailHdr, char* data)
 {
-    ASSERT((box >= 0) && (box < numBoxes));
+    ASSERT(HasBox(box));
 
-    boxes[box].Get(pktHdr, mailHdr, data);
+    boxes[box]->Get(pktHdr, mailHdr, data);
     ASSERT(mailHdr->length <= MaxMailSize);
 }
 
+//----------------------------------------------------------------------
+// PostOffice::TryReceive
+// 	Retrieve a message from a specific box if one is available, as
+//	for Receive; otherwise return FALSE at once.
+//----------------------------------------------------------------------
+
+bool
+PostOffice::TryReceive(int box, PacketHeader *pktHdr, 
+				MailHeader *mailHdr, char* data)
+{
+    ASSERT(HasBox(box));
+
+    return boxes[box]->TryGet(pktHdr, mailHdr, data);
+}
+
 //----------------------------------------------------------------------
 // PostOffice::IncomingPacket
 // 	Interrupt handler, called when a packet arrives from the network.
@@ -328,8 +782,8 @@ PostOffice::IncomingPacket()
 
 //----------------------------------------------------------------------
 // PostOffice::PacketSent
-// 	Interrupt handler, called when the next packet can be put onto the 
-//	network.
+// 	Interrupt handler, called when a packet has left the network's
+//	transmit queue, so the next one can be queued.
 //
 //	The name of this routine is a misnomer; if "reliability < 1",
 //	the packet could have been dropped by the network, so it won't get
@@ -19,6 +19,15 @@
 //	to which you can send an acknowledgement, if your protocol requires 
 //	this.
 //
+//	Mailboxes can be made and thrown away while the post office runs,
+//	and each one holds at most MailBoxSlots messages.  Senders are
+//	kept from overrunning a mailbox by credits: a sender may have
+//	MailBoxSlots messages outstanding to a mailbox, and the receiving
+//	post office tells it, in a control message, as messages are taken
+//	out.  Mail that arrives at a full or missing mailbox is dropped,
+//	as if the network had lost it, so a slow receiver costs a bounded
+//	amount of kernel memory.
+//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
@@ -52,6 +61,28 @@ class MailHeader {
 
 #define MaxMailSize 	(MaxPacketSize - sizeof(MailHeader))
 
+#define MaxMailBoxes	32	// Mailboxes in one post office, at most
+#define MailBoxSlots	16	// Messages a mailbox holds, and credits a
+				// sender starts with
+#define MailCreditBatch	(MailBoxSlots / 2)
+				// Messages taken out before the receiver
+				// returns their credits
+#define CreditTimeout	20000	// Ticks a sender waits for credits before
+				// asking the receiver for them
+
+// Control messages between post offices, told apart from mail by
+// their "to" mailbox
+#define MailCredit	-1	// "count" messages sent to mailbox "box"
+				// have been taken out, from the start
+#define MailProbe	-2	// "count" messages have been sent to
+				// mailbox "box", from the start
+
+class CreditMessage {
+  public:
+    MailBoxAddress box;		// The receiver's mailbox
+    int count;
+};
+
 
 // The following class defines the format of an incoming/outgoing 
 // "Mail" message.  The message format is layered: 
@@ -68,6 +99,42 @@ class Mail {
      PacketHeader pktHdr;	// Header appended by Network
      MailHeader mailHdr;	// Header appended by PostOffice
      char data[MaxMailSize];	// Payload -- message data
+
+     static void *operator new(size_t size);	// Messages are recycled
+     static void operator delete(void *ptr, size_t size);
+						// through mailPool
+};
+
+// The following class defines what a mailbox knows about one machine
+// sending to it, to return its credits.
+
+class MailSender {
+  public:
+    NetworkAddress addr;	// The sending machine
+    int arrived;		// Messages that arrived from it
+    int taken;			// Messages taken out, dropped or lost
+    int reported;		// "taken", when it was last sent back
+    MailSender *next;
+};
+
+// The following class defines what a post office knows about one
+// mailbox it sends to.
+
+class MailCreditLine {
+  public:
+    NetworkAddress addr;	// The receiving machine
+    MailBoxAddress box;		// and its mailbox
+    int sent;			// Messages sent to it
+    int freed;			// Of those, messages it has taken out
+    int waiters;		// Threads waiting for credits
+    Semaphore *creditArrived;	// and where they wait
+    int deadline;		// When they ask for credits, -1 if no
+				// one waits
+    bool timerPending;		// Timer interrupt scheduled?
+    bool probe;			// Timed out?  Then a waiter asks
+    MailCreditLine *next;
+
+    void TimerExpired();	// Interrupt handler of the timer
 };
 
 // The following class defines a single mailbox, or temporary storage
@@ -75,19 +142,45 @@ class Mail {
 // appropriate mailbox, and these messages can then be retrieved by
 // threads on this machine.
 
+class PostOffice;
+
 class MailBox {
   public: 
-    MailBox();			// Allocate and initialize mail box
+    MailBox(PostOffice *po, MailBoxAddress addr);
+				// Allocate and initialize mail box "addr"
+				// of post office "po"
     ~MailBox();			// De-allocate mail box
 
     void Put(PacketHeader pktHdr, MailHeader mailHdr, char *data);
-   				// Atomically put a message into the mailbox
+   				// Atomically put a message into the mailbox,
+				// unless it is full
     void Get(PacketHeader *pktHdr, MailHeader *mailHdr, char *data); 
    				// Atomically get a message out of the 
 				// mailbox (and wait if there is no message 
 				// to get!)
+    bool TryGet(PacketHeader *pktHdr, MailHeader *mailHdr, char *data);
+				// Get a message if there is one; return
+				// FALSE at once if not
+    int NumMessages() { return numMessages; }
+				// Messages waiting in the mailbox
+    int Probed(NetworkAddress from, int sent);
+				// Machine "from" has sent "sent" messages;
+				// return how many have been taken out
+
   private:
+    PostOffice *office;		// Post office the mailbox belongs to
+    MailBoxAddress boxAddr;	// and its number there
     SynchList *messages;	// A mailbox is just a list of arrived messages
+    int numMessages;		// Length of "messages"
+    MailSender *senders;	// Machines that have sent to the mailbox
+
+    MailSender *FindSender(NetworkAddress from);
+    void Taken(MailSender *sender);
+				// A message from "sender" is gone; return
+				// its credits if enough are owed
+    void TakeOut(Mail *mail, PacketHeader *pktHdr, MailHeader *mailHdr,
+				char *data);
+				// Copy a message out and throw it away
 };
 
 // The following class defines a "Post Office", or a collection of 
@@ -104,25 +197,53 @@ class PostOffice {
     PostOffice(NetworkAddress addr, double reliability, int nBoxes);
 				// Allocate and initialize Post Office
 				//   "reliability" is how many packets
-				//   get dropped by the underlying network
+				//   get dropped by the underlying network;
+				//   mailboxes 0 to "nBoxes"-1 are made at 
+				//   once
     ~PostOffice();		// De-allocate Post Office data
     
     void Send(PacketHeader pktHdr, MailHeader mailHdr, char *data);
     				// Send a message to a mailbox on a remote 
 				// machine.  The fromBox in the MailHeader is 
-				// the return box for ack's.
+				// the return box for ack's.  Wait if we
+				// have no credits for the mailbox.
+    bool TrySend(PacketHeader pktHdr, MailHeader mailHdr, char *data);
+				// Send a message if we have credits for
+				// the mailbox; return FALSE at once if not
     
     void Receive(int box, PacketHeader *pktHdr, 
 		MailHeader *mailHdr, char *data);
     				// Retrieve a message from "box".  Wait if
 				// there is no message in the box.
 
+    bool TryReceive(int box, PacketHeader *pktHdr, 
+		MailHeader *mailHdr, char *data);
+    				// Retrieve a message from "box" if there
+				// is one; return FALSE at once if not
+    int NumMessages(int box) { return boxes[box]->NumMessages(); }
+				// Messages waiting in "box"
+    int NumBoxes() { return MaxMailBoxes; }
+				// Mailbox numbers run from 0 to this - 1
+
+    int CreateBox();		// Make a mailbox and return its number,
+				// or -1 if there is no room
+    void DestroyBox(int box);	// Throw away a mailbox and its mail; no
+				// thread may be using it
+    bool HasBox(int box) 
+	{ return (box >= 0) && (box < MaxMailBoxes) && (boxes[box] != NULL); }
+
+    void SendControl(NetworkAddress to, int type, int box, int count);
+				// Send a MailCredit or MailProbe
+
+    NetworkAddress GetAddress() { return netAddr; }
+				// Network address of this machine
+
     void PostalDelivery();	// Wait for incoming messages, 
 				// and then put them in the correct mailbox
 
     void PacketSent();		// Interrupt handler, called when outgoing 
-				// packet has been put on network; next 
-				// packet can now be sent
+				// packet has been put on network; there
+				// is room for one more in the queue
     void IncomingPacket();	// Interrupt handler, called when incoming
    				// packet has arrived and can be pulled
 				// off of network (i.e., time to call 
@@ -131,11 +252,24 @@ class PostOffice {
   private:
     Network *network;		// Physical network connection
     NetworkAddress netAddr;	// Network address of this machine
-    MailBox *boxes;		// Table of mail boxes to hold incoming mail
-    int numBoxes;		// Number of mail boxes
+    MailBox **boxes;		// Table of mail boxes to hold incoming mail;
+				// NULL where there is none
+    int firstFreeBox;		// Where CreateBox starts looking
+    Lock *boxLock;		// Keeps a mailbox from going away while
+				// mail is put in it
+    MailCreditLine *lines;	// Mailboxes we have sent to
     Semaphore *messageAvailable;// V'ed when message has arrived from network
-    Semaphore *messageSent;	// V'ed when next message can be sent to network
-    Lock *sendLock;		// Only one outgoing message at a time
+    Semaphore *messageSent;	// Counts the free slots in the network's
+				// transmit queue
+
+    void Transmit(PacketHeader pktHdr, MailHeader mailHdr, char *data);
+				// Hand a message to the network
+    MailCreditLine *FindLine(NetworkAddress to, MailBoxAddress box);
+    bool TakeCredit(PacketHeader pktHdr, MailHeader mailHdr, bool wait);
+				// Count a message to the mailbox, waiting
+				// for credits if "wait"
+    void CreditReturned(NetworkAddress from, CreditMessage *msg);
+				// A MailCredit has arrived
 };
 
 #endif
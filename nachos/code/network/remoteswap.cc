@@ -0,0 +1,474 @@
+// remoteswap.cc
+//	Routines to page to the memory of another machine: the client,
+//	used by the address spaces instead of their backup arrays, and
+//	the memory server that keeps the pages.  See remoteswap.h.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "remoteswap.h"
+
+#define MaxSwapMessage	((int) (sizeof(SwapMessage) \
+				+ RemoteBatchPages * sizeof(SwapPage)))
+
+//----------------------------------------------------------------------
+// SendHelper, ReceiveHelper, ServeHelper
+// 	Dummy functions because C++ can't indirectly invoke member
+//	functions.  They are forked as the threads of a client or server.
+//
+//	"arg" -- pointer to the client or server
+//----------------------------------------------------------------------
+
+static void SendHelper(int arg)
+{ RemoteSwap *rs = (RemoteSwap *) arg; rs->SendRequests(); }
+static void ReceiveHelper(int arg)
+{ RemoteSwap *rs = (RemoteSwap *) arg; rs->ReceiveAnswers(); }
+static void ServeHelper(int arg)
+{ MemoryServer *ms = (MemoryServer *) arg; ms->Serve(); }
+
+//----------------------------------------------------------------------
+// RemoteSwap::RemoteSwap
+// 	Connect to the memory server, and start the threads that send
+//	requests and receive the answers.  Neither ever exits, so neither
+//	keeps Nachos from halting.
+//
+//	"po" -- the post office of this machine
+//	"server" -- the machine running the memory server
+//----------------------------------------------------------------------
+
+RemoteSwap::RemoteSwap(PostOffice *po, NetworkAddress server)
+{
+    NachOSThread *t;
+
+    conn = new Connection(po, RemoteSwapBox, server, RemoteSwapBox,
+				RemoteSwapWindow);
+    batch = NULL;
+    queueHead = queueTail = NULL;
+    waitHead = waitTail = NULL;
+    work = new Semaphore("remote swap work", 0);
+
+    t = new NachOSThread("remote swap sender", MIN_NICE_PRIORITY);
+    MarkThreadExited(t->GetPID());
+    t->ThreadFork(SendHelper, (int) this);
+    t = new NachOSThread("remote swap receiver", MIN_NICE_PRIORITY);
+    MarkThreadExited(t->GetPID());
+    t->ThreadFork(ReceiveHelper, (int) this);
+}
+
+//----------------------------------------------------------------------
+// RemoteSwap::Enqueue
+// 	Put a request at the end of the queue to be sent.  The sending
+//	thread is not woken.
+//----------------------------------------------------------------------
+
+void
+RemoteSwap::Enqueue(SwapRequest *req)
+{
+    req->next = NULL;
+    if (queueHead == NULL)
+	queueHead = req;
+    else
+	queueTail->next = req;
+    queueTail = req;
+}
+
+//----------------------------------------------------------------------
+// RemoteSwap::CloseBatch
+// 	Queue the batch being filled, if there is one, so that the
+//	requests queued after it are carried out after it.
+//----------------------------------------------------------------------
+
+void
+RemoteSwap::CloseBatch()
+{
+    if (batch != NULL) {
+	Enqueue(batch);
+	batch = NULL;
+    }
+}
+
+//----------------------------------------------------------------------
+// RemoteSwap::Store
+// 	Add an evicted page to the batch being filled, and queue the
+//	batch once it is full.  Never waits, and never lets another thread
+//	run; see remoteswap.h.
+//
+//	"pid", "vpn" -- which page it is
+//	"page" -- its contents
+//----------------------------------------------------------------------
+
+void
+RemoteSwap::Store(int pid, int vpn, char *page)
+{
+    SwapPage *p;
+
+    if (batch == NULL) {
+	batch = new SwapRequest;
+	batch->msg.op = SwapStore;
+	batch->msg.pid = batch->msg.arg = -1;
+	batch->msg.count = 0;
+	batch->pages = new SwapPage[RemoteBatchPages];
+	batch->into = NULL;
+	batch->answered = NULL;
+    }
+    p = &batch->pages[batch->msg.count++];
+    p->pid = pid;
+    p->vpn = vpn;
+    bcopy(page, p->data, PageSize);
+    DEBUG('a', "Remote swap: page %d of process %d evicted\n", vpn, pid);
+    if (batch->msg.count == RemoteBatchPages)
+	CloseBatch();
+}
+
+//----------------------------------------------------------------------
+// RemoteSwap::SendBatches
+// 	Wake the sending thread, if a batch is waiting.  The batch being
+//	filled stays behind, until it is full or another request has to
+//	go after it.
+//----------------------------------------------------------------------
+
+void
+RemoteSwap::SendBatches()
+{
+    if (queueHead != NULL)
+	work->V();
+}
+
+//----------------------------------------------------------------------
+// LatestCopy
+// 	Look for page "vpn" of process "pid" in a request that has not
+//	been sent.  Return the copy it has, "found" if it does not change
+//	which copy is the latest, or NULL if it makes the server's the
+//	latest.
+//----------------------------------------------------------------------
+
+static SwapPage *
+LatestCopy(SwapRequest *req, int pid, int vpn, SwapPage *found)
+{
+    int i;
+
+    if (req->msg.op == SwapStore) {
+	for (i = 0; i < req->msg.count; i++)
+	    if ((req->pages[i].pid == pid) && (req->pages[i].vpn == vpn))
+		found = &req->pages[i];
+    } else if ((req->msg.op == SwapCopy) && (req->msg.arg == pid))
+	found = NULL;
+    else if ((req->msg.op == SwapFree) && (req->msg.pid == pid))
+	found = NULL;
+    return found;
+}
+
+//----------------------------------------------------------------------
+// RemoteSwap::FindUnsent
+// 	If the latest copy of a page is in a request that has not been
+//	sent, copy it into "page" and return TRUE.
+//----------------------------------------------------------------------
+
+bool
+RemoteSwap::FindUnsent(int pid, int vpn, char *page)
+{
+    SwapPage *found = NULL;
+    SwapRequest *req;
+
+    for (req = queueHead; req != NULL; req = req->next)
+	found = LatestCopy(req, pid, vpn, found);
+    if (batch != NULL)
+	found = LatestCopy(batch, pid, vpn, found);
+    if (found == NULL)
+	return FALSE;
+    bcopy(found->data, page, PageSize);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// RemoteSwap::Fetch
+// 	Get back an evicted page.  Unless it has not been sent yet, ask
+//	the server for it, and wait for the answer.  Other requests,
+//	including other fetches, go on while we wait.
+//
+//	"pid", "vpn" -- which page it is
+//	"page" -- where to put it
+//----------------------------------------------------------------------
+
+void
+RemoteSwap::Fetch(int pid, int vpn, char *page)
+{
+    SwapRequest *req;
+    int start = stats->totalTicks;
+
+    if (FindUnsent(pid, vpn, page)) {
+	DEBUG('a', "Remote swap: page %d of process %d not sent yet\n",
+						vpn, pid);
+	stats->numRemotePageHits++;
+	return;
+    }
+    req = new SwapRequest;
+    req->msg.op = SwapFetch;
+    req->msg.pid = pid;
+    req->msg.arg = vpn;
+    req->msg.count = 0;
+    req->pages = NULL;
+    req->into = page;
+    req->answered = new Semaphore("page fetched", 0);
+    Enqueue(req);
+    work->V();
+    req->answered->P();
+
+    delete req->answered;
+    delete req;
+    stats->numRemotePageIns++;
+    stats->remotePageInTicks += stats->totalTicks - start;
+    DEBUG('a', "Remote swap: page %d of process %d fetched in %d ticks\n",
+					vpn, pid, stats->totalTicks - start);
+}
+
+//----------------------------------------------------------------------
+// RemoteSwap::Copy
+// 	Process "toPid" has been forked from "fromPid": have the server
+//	copy the pages of one to the other.  Must be called before any
+//	page of "toPid" can be evicted.
+//----------------------------------------------------------------------
+
+void
+RemoteSwap::Copy(int fromPid, int toPid)
+{
+    SwapRequest *req = new SwapRequest;
+
+    req->msg.op = SwapCopy;
+    req->msg.pid = fromPid;
+    req->msg.arg = toPid;
+    req->msg.count = 0;
+    req->pages = NULL;
+    req->into = NULL;
+    req->answered = NULL;
+    CloseBatch();
+    Enqueue(req);
+    work->V();
+}
+
+//----------------------------------------------------------------------
+// RemoteSwap::Free
+// 	Process "pid" is gone: have the server throw away its pages.
+//----------------------------------------------------------------------
+
+void
+RemoteSwap::Free(int pid)
+{
+    SwapRequest *req = new SwapRequest;
+
+    req->msg.op = SwapFree;
+    req->msg.pid = pid;
+    req->msg.arg = -1;
+    req->msg.count = 0;
+    req->pages = NULL;
+    req->into = NULL;
+    req->answered = NULL;
+    CloseBatch();
+    Enqueue(req);
+    work->V();
+}
+
+//----------------------------------------------------------------------
+// RemoteSwap::SendRequests
+// 	Body of the sending thread: send the queued requests, in order,
+//	without waiting for answers.  Fetches wait for theirs on a second
+//	queue, in the order they were sent, which is the order the server
+//	answers them in.
+//----------------------------------------------------------------------
+
+void
+RemoteSwap::SendRequests()
+{
+    char *buffer = new char[MaxSwapMessage];
+    SwapRequest *req;
+    int length;
+
+    for (;;) {
+	work->P();
+	while ((req = queueHead) != NULL) {
+	    queueHead = req->next;
+
+	    length = sizeof(SwapMessage) + req->msg.count * sizeof(SwapPage);
+	    bcopy(&req->msg, buffer, sizeof(SwapMessage));
+	    if (req->msg.count > 0)
+		bcopy(req->pages, buffer + sizeof(SwapMessage),
+					req->msg.count * sizeof(SwapPage));
+	    if (req->msg.op == SwapFetch) {	// before the answer can come
+		req->next = NULL;
+		if (waitHead == NULL)
+		    waitHead = req;
+		else
+		    waitTail->next = req;
+		waitTail = req;
+	    }
+
+	    if (!conn->Send(buffer, length)) {
+		printf("The memory server does not answer\n");
+		ASSERT(FALSE);
+	    }
+
+	    if (req->msg.op == SwapStore) {
+		stats->numRemotePageOuts += req->msg.count;
+		delete [] req->pages;
+	    }
+	    if (req->msg.op != SwapFetch)
+		delete req;			// the fetching thread frees
+	}					// its own
+    }
+}
+
+//----------------------------------------------------------------------
+// RemoteSwap::ReceiveAnswers
+// 	Body of the receiving thread: hand each page the server sends
+//	back to the thread waiting for it.
+//----------------------------------------------------------------------
+
+void
+RemoteSwap::ReceiveAnswers()
+{
+    char buffer[sizeof(SwapMessage) + PageSize];
+    SwapMessage *msg = (SwapMessage *) buffer;
+    SwapRequest *req;
+    int length;
+
+    for (;;) {
+	length = conn->Receive(buffer, sizeof(buffer));
+	ASSERT((length == sizeof(buffer)) && (msg->op == SwapFetch));
+
+	req = waitHead;
+	ASSERT((req != NULL) && (req->msg.pid == msg->pid)
+				&& (req->msg.arg == msg->arg));
+	waitHead = req->next;
+	bcopy(buffer + sizeof(SwapMessage), req->into, PageSize);
+	req->answered->V();
+    }
+}
+
+//----------------------------------------------------------------------
+// MemoryServer::MemoryServer
+// 	Start serving a client.  The serving thread never exits, so it
+//	does not keep Nachos from halting; a memory server runs until it
+//	is killed, or until the client halts, if they share a process.
+//
+//	"po" -- the post office of this machine
+//	"client" -- the machine that pages to us
+//----------------------------------------------------------------------
+
+MemoryServer::MemoryServer(PostOffice *po, NetworkAddress client)
+{
+    NachOSThread *t;
+    int i;
+
+    buckets = new StoredPage*[MemoryServerBuckets];
+    for (i = 0; i < MemoryServerBuckets; i++)
+	buckets[i] = NULL;
+    numPages = 0;
+    conn = new Connection(po, RemoteSwapBox, client, RemoteSwapBox,
+				RemoteSwapWindow);
+
+    t = new NachOSThread("memory server", MIN_NICE_PRIORITY);
+    MarkThreadExited(t->GetPID());
+    t->ThreadFork(ServeHelper, (int) this);
+}
+
+//----------------------------------------------------------------------
+// MemoryServer::Find
+// 	Return where in the hash table page "vpn" of process "pid" is:
+//	the link pointing to it, or the NULL link at the end of its bucket
+//	if we do not have it.
+//----------------------------------------------------------------------
+
+StoredPage **
+MemoryServer::Find(int pid, int vpn)
+{
+    StoredPage **p = &buckets[((unsigned) (pid * 31 + vpn))
+						% MemoryServerBuckets];
+
+    while ((*p != NULL) && (((*p)->page.pid != pid)
+				|| ((*p)->page.vpn != vpn)))
+	p = &(*p)->next;
+    return p;
+}
+
+//----------------------------------------------------------------------
+// MemoryServer::Put
+// 	Keep a copy of page "vpn" of process "pid".
+//----------------------------------------------------------------------
+
+void
+MemoryServer::Put(int pid, int vpn, char *data)
+{
+    StoredPage **p = Find(pid, vpn);
+
+    if (*p == NULL) {
+	*p = new StoredPage;
+	(*p)->page.pid = pid;
+	(*p)->page.vpn = vpn;
+	(*p)->next = NULL;
+	numPages++;
+    }
+    bcopy(data, (*p)->page.data, PageSize);
+}
+
+//----------------------------------------------------------------------
+// MemoryServer::Serve
+// 	Body of the serving thread: carry out the client's requests in
+//	the order they arrive, until the client goes away.
+//----------------------------------------------------------------------
+
+void
+MemoryServer::Serve()
+{
+    char *buffer = new char[MaxSwapMessage];
+    SwapMessage *msg = (SwapMessage *) buffer;
+    SwapPage *pages = (SwapPage *) (buffer + sizeof(SwapMessage));
+    StoredPage **p, *s;
+    int length, i;
+
+    for (;;) {
+	length = conn->Receive(buffer, MaxSwapMessage);
+	if (length < 0) {
+	    printf("Memory server: the client is gone; %d pages kept\n",
+						numPages);
+	    return;
+	}
+	ASSERT(length == (int) (sizeof(SwapMessage)
+					+ msg->count * sizeof(SwapPage)));
+
+	if (msg->op == SwapStore) {
+	    for (i = 0; i < msg->count; i++)
+		Put(pages[i].pid, pages[i].vpn, pages[i].data);
+	} else if (msg->op == SwapFetch) {
+	    s = *Find(msg->pid, msg->arg);
+	    if (s != NULL)
+		bcopy(s->page.data, buffer + sizeof(SwapMessage), PageSize);
+	    else {
+		DEBUG('n', "Memory server: no page %d of process %d\n",
+						msg->arg, msg->pid);
+		bzero(buffer + sizeof(SwapMessage), PageSize);
+	    }
+	    msg->count = 0;
+	    conn->Send(buffer, sizeof(SwapMessage) + PageSize);
+	} else if (msg->op == SwapCopy) {
+	    for (i = 0; i < MemoryServerBuckets; i++)
+		for (s = buckets[i]; s != NULL; s = s->next)
+		    if (s->page.pid == msg->pid)
+			Put(msg->arg, s->page.vpn, s->page.data);
+	} else if (msg->op == SwapFree) {
+	    for (i = 0; i < MemoryServerBuckets; i++)
+		for (p = &buckets[i]; *p != NULL; ) {
+		    s = *p;
+		    if (s->page.pid == msg->pid) {
+			*p = s->next;
+			delete s;
+			numPages--;
+		    } else
+			p = &s->next;
+		}
+	} else
+	    ASSERT(FALSE);
+    }
+}
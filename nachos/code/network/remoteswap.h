@@ -0,0 +1,149 @@
+// remoteswap.h
+//	Data structures for paging to the memory of another machine.
+//
+//	With remote paging, the pages a process has evicted are kept by
+//	a memory server on another Nachos machine, instead of in the
+//	process's backup array.  The client sends the server its evicted
+//	pages, and asks for them back when they are needed again, over a
+//	reliable connection.
+//
+//	Evicted pages are sent in batches of up to RemoteBatchPages, and
+//	requests are pipelined: any number of them may be waiting for an
+//	answer at a time, and the server answers them in order.  Pages
+//	that have been evicted but not sent yet are found by the client
+//	without asking the server.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef REMOTESWAP_H
+#define REMOTESWAP_H
+
+#include "transport.h"
+#include "machine.h"
+
+#define RemoteSwapBox		8	// Mailbox used at both ends
+#define RemoteSwapWindow	16	// Window of the connection
+#define RemoteBatchPages	8	// Pages sent in one message, at most
+#define MemoryServerBuckets	256	// Hash buckets of the server
+
+// Requests
+#define SwapStore	0		// Keep the "count" pages that follow
+#define SwapFetch	1		// Send back page "arg" of process
+					// "pid"; the answer has the same
+					// header, and then the page
+#define SwapCopy	2		// Copy the pages of process "pid"
+					// to process "arg"
+#define SwapFree	3		// Throw away the pages of "pid"
+
+// The following class defines the header of a request, and of the
+// answer to a SwapFetch.
+
+class SwapMessage {
+  public:
+    int op;				// One of the above
+    int pid;				// Process whose pages these are
+    int arg;				// Page, or process, for the request
+    int count;				// Pages that follow
+};
+
+// The following class defines a page, as it is sent.
+
+class SwapPage {
+  public:
+    int pid;				// Process it belongs to
+    int vpn;				// Its virtual page number there
+    char data[PageSize];
+};
+
+// The following class defines a request waiting to be sent, or, for a
+// SwapFetch, to be answered.
+
+class SwapRequest {
+  public:
+    SwapMessage msg;
+    SwapPage *pages;			// For a SwapStore, its pages
+    char *into;				// For a SwapFetch, where the page goes
+    Semaphore *answered;		// V'ed when it has gone there
+    SwapRequest *next;			// Next request in the same queue
+};
+
+// The following class defines the client, which pages to a memory
+// server.
+//
+// Store is called while the page replacement routines are choosing a
+// victim, and they expect nothing else to run until they are done; so
+// Store never waits, nor does anything that could let another thread
+// run.  The queues are only changed between such points, so they need
+// no lock.  Store only fills batches; SendBatches, called once the
+// faulting process is done with its frames, wakes the thread that
+// sends them.
+
+class RemoteSwap {
+  public:
+    RemoteSwap(PostOffice *po, NetworkAddress server);
+					// Page to the memory server on
+					// machine "server"
+
+    void Store(int pid, int vpn, char *page);
+					// Page "vpn" of process "pid" has been
+					// evicted; never waits
+    void SendBatches();			// Send the batches that are full
+    void Fetch(int pid, int vpn, char *page);
+					// Copy page "vpn" of process "pid"
+					// into "page", waiting for the server
+					// if it has it
+    void Copy(int fromPid, int toPid);	// Process "toPid" is a fork of
+					// "fromPid"; so are its pages
+    void Free(int pid);			// Process "pid" is gone
+
+    void SendRequests();		// Body of the sending thread
+    void ReceiveAnswers();		// Body of the receiving thread
+
+  private:
+    Connection *conn;			// To the memory server
+    SwapRequest *batch;			// SwapStore being filled, or NULL
+    SwapRequest *queueHead, *queueTail;	// Requests waiting to be sent
+    SwapRequest *waitHead, *waitTail;	// Fetches sent, waiting for their
+					// answers, oldest first
+    Semaphore *work;			// Wakes the sending thread
+
+    void Enqueue(SwapRequest *req);	// Queue a request to be sent
+    void CloseBatch();			// Queue the batch being filled
+    bool FindUnsent(int pid, int vpn, char *page);
+					// Copy the page from a request not
+					// sent yet, if there is one
+};
+
+// The following class defines a memory server.  It keeps the pages of
+// one client, in a hash table, and answers its requests in the order
+// they arrive.
+
+class StoredPage {
+  public:
+    SwapPage page;
+    StoredPage *next;			// Next in the same bucket
+};
+
+class MemoryServer {
+  public:
+    MemoryServer(PostOffice *po, NetworkAddress client);
+					// Serve the client on machine
+					// "client", from a thread of its own
+
+    void Serve();			// Body of the serving thread
+
+  private:
+    Connection *conn;			// To the client
+    StoredPage **buckets;		// Pages, hashed on (pid, vpn)
+    int numPages;			// Pages kept
+
+    StoredPage **Find(int pid, int vpn); // Where the page is, or would go
+    void Put(int pid, int vpn, char *data);
+					// Keep a page, replacing any old copy
+};
+
+#endif // REMOTESWAP_H
@@ -0,0 +1,477 @@
+// transport.cc
+//	Routines for reliable delivery of messages over the post office.
+//
+//	The sending side keeps the segments it has sent in a ring of
+//	"window" slots, indexed by segment number, until they are
+//	acknowledged.  When the retransmission timer goes off, every
+//	segment still in the ring is sent again ("go back N"), and the
+//	timeout is doubled.  The timeout is otherwise computed from the
+//	round trip times of the segments that were sent only once, as in
+//	TCP (Jacobson's algorithm, with Karn's rule).
+//
+//	The receiving side keeps the segments that arrive ahead of the
+//	next one expected in a ring of the same size, and acknowledges
+//	every data segment it gets, even duplicates -- the sender may
+//	have missed the first ack.  Data segments carry an ack as well.
+//
+//	Note that the two ends of a connection measure time with their
+//	own clocks; only round trips are measured, on a single clock.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "transport.h"
+#include "system.h"
+
+// A message that has been put together, waiting to be received
+class Message {
+  public:
+    char *data;
+    int length;
+};
+
+//----------------------------------------------------------------------
+// ReceiveHelper, RetransmitHelper, RetransmitTimer
+// 	Dummy functions because C++ can't indirectly invoke member 
+//	functions.  The first two are the bodies of the threads of a
+//	connection, the last is the timer interrupt handler.
+//
+//	"arg" -- pointer to the connection
+//----------------------------------------------------------------------
+
+static void ReceiveHelper(int arg)
+{ Connection *c = (Connection *) arg; c->ReceiveSegments(); }
+static void RetransmitHelper(int arg)
+{ Connection *c = (Connection *) arg; c->Retransmit(); }
+static void RetransmitTimer(int arg)
+{ Connection *c = (Connection *) arg; c->TimerExpired(); }
+
+//----------------------------------------------------------------------
+// Connection::Connection
+// 	Set up our end of a connection, and start its threads.  Neither
+//	thread ever exits, so neither keeps Nachos from halting.
+//
+//	"po" -- the post office of our machine
+//	"box" -- our mailbox; segments for us arrive here
+//	"toAddr", "toBox" -- the mailbox at the other end
+//	"windowSize" -- segments that can be in flight at once
+//----------------------------------------------------------------------
+
+Connection::Connection(PostOffice *po, int box, NetworkAddress toAddr,
+			int toBox, int windowSize)
+{
+    NachOSThread *t;
+    int i;
+
+    ASSERT((windowSize >= 1) && (windowSize <= MaxWindow));
+    office = po;
+    localBox = box;
+    remoteAddr = toAddr;
+    remoteBox = toBox;
+    window = windowSize;
+
+    sendBuf = new TransportSegment[window];
+    recvBuf = new TransportSegment[window];
+    for (i = 0; i < window; i++)
+	sendBuf[i].seq = recvBuf[i].seq = -1;
+    sendBase = nextSeq = expected = 0;
+    rto = InitialRTO;
+    srtt = rttvar = -1;
+    retries = 0;
+    broken = FALSE;
+    partial = NULL;
+    partialLength = partialSize = 0;
+    messages = new List();
+
+    lock = new Lock("connection");
+    sendLock = new Lock("connection send");
+    windowOpen = new Condition("window open");
+    messageArrived = new Condition("message arrived");
+    deadline = -1;
+    timerPending = FALSE;
+    timedOut = new Semaphore("retransmission timeout", 0);
+
+    t = new NachOSThread("transport receiver", MIN_NICE_PRIORITY);
+    MarkThreadExited(t->GetPID());
+    t->ThreadFork(ReceiveHelper, (int) this);
+    t = new NachOSThread("transport retransmitter", MIN_NICE_PRIORITY);
+    MarkThreadExited(t->GetPID());
+    t->ThreadFork(RetransmitHelper, (int) this);
+}
+
+//----------------------------------------------------------------------
+// Connection::Send
+// 	Send a message to the other end, cut into segments.  We only wait
+//	while the window is full, not for the message to be acknowledged
+//	(see Flush).  Return FALSE if the other end has stopped answering.
+//
+//	"data" -- the message
+//	"length" -- its length, in bytes; it may be 0
+//----------------------------------------------------------------------
+
+bool
+Connection::Send(char *data, int length)
+{
+    TransportSegment *seg, copy;
+    int offset = 0;
+    bool ok = TRUE;
+
+    sendLock->Acquire();
+    lock->Acquire();
+    do {
+	while (!broken && ((nextSeq - sendBase) >= window))
+	    windowOpen->Wait(lock);
+	if (broken) {
+	    ok = FALSE;
+	    break;
+	}
+
+	seg = &sendBuf[nextSeq % window];
+	seg->seq = nextSeq++;
+	seg->length = min(length - offset, MaxSegmentData);
+	seg->last = ((offset + seg->length) == length);
+	bcopy(data + offset, seg->data, seg->length);
+	offset += seg->length;
+	seg->sentAt = stats->totalTicks;
+	seg->retransmitted = FALSE;
+	copy = *seg;			// the slot may be reused as soon 
+					// as the segment is acknowledged
+	if (copy.seq == sendBase)
+	    StartTimer();		// nothing else in flight
+	lock->Release();
+	Transmit(&copy);
+	lock->Acquire();
+    } while (offset < length);
+    lock->Release();
+    sendLock->Release();
+    return ok;
+}
+
+//----------------------------------------------------------------------
+// Connection::Receive
+// 	Wait for the next message from the other end, and copy it into
+//	"data", cut to "maxLength" bytes.  Return the number of bytes 
+//	copied, or -1 if the connection is broken and every message that
+//	arrived has been received.
+//----------------------------------------------------------------------
+
+int
+Connection::Receive(char *data, int maxLength)
+{
+    Message *msg;
+    int length;
+
+    lock->Acquire();
+    while (!broken && messages->IsEmpty())
+	messageArrived->Wait(lock);
+    msg = (Message *) messages->Remove();
+    lock->Release();
+    if (msg == NULL)
+	return -1;			// broken
+
+    length = min(msg->length, maxLength);
+    bcopy(msg->data, data, length);
+    delete [] msg->data;
+    delete msg;
+    return length;
+}
+
+//----------------------------------------------------------------------
+// Connection::Flush
+// 	Wait until everything sent so far has been acknowledged.  Return
+//	FALSE if the connection broke first.
+//----------------------------------------------------------------------
+
+bool
+Connection::Flush()
+{
+    bool ok;
+
+    lock->Acquire();
+    while (!broken && (sendBase < nextSeq))
+	windowOpen->Wait(lock);
+    ok = !broken;
+    lock->Release();
+    return ok;
+}
+
+//----------------------------------------------------------------------
+// Connection::Transmit
+// 	Send a data segment to the other end, with an ack for what we 
+//	have received.  Called without the lock, with a copy of the
+//	segment.
+//----------------------------------------------------------------------
+
+void
+Connection::Transmit(TransportSegment *seg)
+{
+    PacketHeader pktHdr;
+    MailHeader mailHdr;
+    TransportHeader hdr;
+    char buffer[MaxMailSize];
+
+    hdr.seq = seg->seq;
+    hdr.ack = expected;
+    hdr.type = SegData;
+    hdr.last = seg->last;
+    bcopy((char *) &hdr, buffer, sizeof(TransportHeader));
+    bcopy(seg->data, buffer + sizeof(TransportHeader), seg->length);
+
+    pktHdr.to = remoteAddr;
+    mailHdr.to = remoteBox;
+    mailHdr.from = localBox;
+    mailHdr.length = sizeof(TransportHeader) + seg->length;
+    DEBUG('n', "Transport: sending segment %d to (%d, %d)\n", seg->seq,
+						remoteAddr, remoteBox);
+    office->Send(pktHdr, mailHdr, buffer);
+}
+
+//----------------------------------------------------------------------
+// Connection::SendAck
+// 	Tell the other end which segment we expect next.
+//----------------------------------------------------------------------
+
+void
+Connection::SendAck()
+{
+    PacketHeader pktHdr;
+    MailHeader mailHdr;
+    TransportHeader hdr;
+
+    hdr.seq = -1;
+    hdr.ack = expected;
+    hdr.type = SegAck;
+    hdr.last = FALSE;
+
+    pktHdr.to = remoteAddr;
+    mailHdr.to = remoteBox;
+    mailHdr.from = localBox;
+    mailHdr.length = sizeof(TransportHeader);
+    // Never wait for credits: the other side may be waiting for ours.
+    // The next ack says as much, and its data segments carry one.
+    (void) office->TrySend(pktHdr, mailHdr, (char *) &hdr);
+}
+
+//----------------------------------------------------------------------
+// Connection::Acknowledged
+// 	The other end has received every segment before "ack".  Free
+//	them, update the round trip time estimate, and restart the timer
+//	for what is still in flight.  Called with the lock held.
+//----------------------------------------------------------------------
+
+void
+Connection::Acknowledged(int ack)
+{
+    TransportSegment *seg;
+    int sample, s;
+
+    if ((ack <= sendBase) || (ack > nextSeq))
+	return;				// old news
+
+    seg = &sendBuf[(ack - 1) % window];
+    if (!seg->retransmitted) {
+	sample = stats->totalTicks - seg->sentAt;
+	if (srtt == -1) {
+	    srtt = sample;
+	    rttvar = sample / 2;
+	} else {
+	    rttvar = (3 * rttvar + ((srtt > sample) ? srtt - sample 
+						    : sample - srtt)) / 4;
+	    srtt = (7 * srtt + sample) / 8;
+	}
+	rto = max(MinRTO, min(MaxRTO, srtt + 4 * rttvar));
+    }
+    for (s = sendBase; s < ack; s++)
+	sendBuf[s % window].seq = -1;
+    sendBase = ack;
+    retries = 0;
+    if (sendBase == nextSeq)
+	StopTimer();
+    else
+	StartTimer();
+    windowOpen->Broadcast(lock);
+}
+
+//----------------------------------------------------------------------
+// Connection::Deliver
+// 	Add the next segment in order to the message being put together;
+//	if it is the last one, the message can be received.  Called with
+//	the lock held.
+//----------------------------------------------------------------------
+
+void
+Connection::Deliver(TransportSegment *seg)
+{
+    Message *msg;
+    char *bigger;
+
+    if ((partialLength + seg->length) > partialSize) {
+	partialSize = max(2 * partialSize, 4 * MaxSegmentData);
+	bigger = new char[partialSize];
+	if (partial != NULL) {
+	    bcopy(partial, bigger, partialLength);
+	    delete [] partial;
+	}
+	partial = bigger;
+    }
+    bcopy(seg->data, partial + partialLength, seg->length);
+    partialLength += seg->length;
+
+    if (seg->last) {
+	msg = new Message;
+	msg->data = partial;
+	msg->length = partialLength;
+	messages->Append((void *) msg);
+	partial = NULL;
+	partialLength = partialSize = 0;
+	messageArrived->Signal(lock);
+    }
+}
+
+//----------------------------------------------------------------------
+// Connection::ReceiveSegments
+// 	Body of the receiving thread: take each segment that arrives in
+//	our mailbox, process the ack it carries, and if it carries data,
+//	deliver it, or keep it until the segments before it arrive.
+//----------------------------------------------------------------------
+
+void
+Connection::ReceiveSegments()
+{
+    PacketHeader pktHdr;
+    MailHeader mailHdr;
+    TransportHeader hdr;
+    char buffer[MaxMailSize];
+    TransportSegment *slot;
+
+    for (;;) {
+	office->Receive(localBox, &pktHdr, &mailHdr, buffer);
+	bcopy(buffer, (char *) &hdr, sizeof(TransportHeader));
+
+	lock->Acquire();
+	Acknowledged(hdr.ack);
+	if (hdr.type != SegData) {
+	    lock->Release();
+	    continue;
+	}
+	if ((hdr.seq >= expected) && (hdr.seq < (expected + window))) {
+	    slot = &recvBuf[hdr.seq % window];
+	    if (slot->seq != hdr.seq) {	// not a duplicate
+		slot->seq = hdr.seq;
+		slot->length = mailHdr.length - sizeof(TransportHeader);
+		slot->last = hdr.last;
+		bcopy(buffer + sizeof(TransportHeader), slot->data, 
+							slot->length);
+	    }
+	    while ((slot = &recvBuf[expected % window])->seq == expected) {
+		Deliver(slot);
+		slot->seq = -1;
+		expected++;
+	    }
+	}
+	lock->Release();
+	SendAck();			// even for duplicates: our last 
+					// ack may have been lost
+    }
+}
+
+//----------------------------------------------------------------------
+// Connection::Retransmit
+// 	Body of the retransmitting thread: each time the timer goes off,
+//	send every unacknowledged segment again, and double the timeout.
+//	After MaxRetries timeouts in a row, give up on the other end.
+//----------------------------------------------------------------------
+
+void
+Connection::Retransmit()
+{
+    TransportSegment *copies = new TransportSegment[window];
+    int i, n, s;
+
+    for (;;) {
+	timedOut->P();
+	lock->Acquire();
+	if (broken || (sendBase == nextSeq)) {
+	    lock->Release();		// acknowledged after all
+	    continue;
+	}
+	if (++retries > MaxRetries) {
+	    DEBUG('n', "Transport: (%d, %d) is not answering\n", remoteAddr,
+								remoteBox);
+	    broken = TRUE;
+	    windowOpen->Broadcast(lock);
+	    messageArrived->Broadcast(lock);
+	    lock->Release();
+	    continue;
+	}
+	rto = min(2 * rto, MaxRTO);
+	stats->numTransportTimeouts++;
+	for (n = 0, s = sendBase; s < nextSeq; s++, n++) {
+	    sendBuf[s % window].retransmitted = TRUE;
+	    sendBuf[s % window].sentAt = stats->totalTicks;
+	    copies[n] = sendBuf[s % window];
+	}
+	StartTimer();
+	lock->Release();
+
+	DEBUG('n', "Transport: timeout, sending %d segments again\n", n);
+	for (i = 0; i < n; i++) {
+	    Transmit(&copies[i]);
+	    stats->numRetransmissions++;
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// Connection::StartTimer, Connection::StopTimer
+// 	Set the retransmission deadline to "rto" ticks from now, or clear
+//	it.  A timer interrupt is scheduled if there is none pending; if
+//	there is one, it will see the new deadline when it goes off.
+//----------------------------------------------------------------------
+
+void
+Connection::StartTimer()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    deadline = stats->totalTicks + rto;
+    if (!timerPending) {
+	timerPending = TRUE;
+	interrupt->Schedule(RetransmitTimer, (int) this, rto, NetworkSendInt);
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+void
+Connection::StopTimer()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    deadline = -1;
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Connection::TimerExpired
+// 	Interrupt handler of the retransmission timer.  If the deadline
+//	was moved later in the meantime, wait until then; if it has
+//	passed, wake up the retransmitting thread.
+//----------------------------------------------------------------------
+
+void
+Connection::TimerExpired()
+{
+    timerPending = FALSE;
+    if (deadline == -1)
+	return;				// stopped
+    if (stats->totalTicks < deadline) {
+	timerPending = TRUE;
+	interrupt->Schedule(RetransmitTimer, (int) this, 
+			deadline - stats->totalTicks, NetworkSendInt);
+	return;
+    }
+    deadline = -1;
+    timedOut->V();
+}
@@ -0,0 +1,151 @@
+// transport.h
+//	Data structures for reliable, ordered delivery of messages of any
+//	size between two mailboxes, on top of the unreliable post office.
+//
+//	A connection joins a mailbox on this machine to a mailbox on
+//	another machine.  Messages are cut into segments that fit in one
+//	packet, and each segment is numbered.  The receiver acknowledges
+//	the segments it has got with the number of the next one it
+//	expects (a "cumulative" ack); the sender keeps up to "window"
+//	segments in flight, and sends them again if they are not
+//	acknowledged in time.  Segments that arrive out of order are
+//	kept until the ones before them arrive, and messages are put
+//	back together from their segments before they are delivered.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include "post.h"
+#include "list.h"
+#include "synch.h"
+
+// Segment types
+#define SegData		0		// carries message data
+#define SegAck		1		// only acknowledges
+
+// The following class defines the transport header, prepended to the
+// data of each segment, inside the mail message.
+
+class TransportHeader {
+  public:
+    int seq;				// Number of this data segment
+    int ack;				// Next segment number expected from
+					// the other side
+    char type;				// SegData or SegAck
+    char last;				// Last segment of a message?
+};
+
+#define MaxSegmentData	((int) (MaxMailSize - sizeof(TransportHeader)))
+					// Message bytes in one segment
+#define MaxWindow	64		// Largest window, in segments
+
+// Retransmission timeout, in ticks.  It is computed from the measured
+// round trip times, as in TCP, within these bounds.
+#define InitialRTO	3000
+#define MinRTO		500
+#define MaxRTO		64000
+#define MaxRetries	10		// Timeouts in a row before the
+					// other side is given up for dead
+
+// The following class defines a segment kept by the sender until it is
+// acknowledged, or by the receiver until the segments before it arrive.
+
+class TransportSegment {
+  public:
+    int seq;				// Its number, -1 if the slot is free
+    int length;				// Bytes of data
+    bool last;				// Last segment of a message?
+    char data[MaxSegmentData];
+    int sentAt;				// When it was last sent
+    bool retransmitted;			// Sent more than once?  Then its
+					// ack says nothing about the RTT
+};
+
+// The following class defines one end of a connection.  Send and
+// Receive may be called by any number of threads; each connection has
+// two threads of its own, one handling the segments that arrive in its
+// mailbox, and one sending segments again when the retransmission
+// timer goes off.  The timer is an interrupt scheduled on the
+// interrupt queue; since scheduled interrupts cannot be cancelled, the
+// handler checks whether the deadline has moved since.
+
+class Connection {
+  public:
+    Connection(PostOffice *office, int localBox, 
+		NetworkAddress remoteAddr, int remoteBox, int window);
+					// Set up one end of a connection;
+					// the other end must use the same
+					// window.  Connections are never
+					// torn down: their threads run 
+					// until Nachos halts
+
+    bool Send(char *data, int length);	// Send a message, waiting only if
+					// the window is full; return FALSE
+					// if the connection is broken
+    int Receive(char *data, int maxLength);
+					// Wait for a message, and copy at
+					// most "maxLength" bytes of it into
+					// "data"; return how many, or -1 if 
+					// the connection is broken
+    bool Flush();			// Wait until every segment sent has
+					// been acknowledged
+
+    void ReceiveSegments();		// Body of the receiving thread
+    void Retransmit();			// Body of the retransmitting thread
+    void TimerExpired();		// Interrupt handler of the timer
+
+  private:
+    PostOffice *office;		// Post office of our machine
+    int localBox;			// Our mailbox
+    NetworkAddress remoteAddr;		// Machine at the other end
+    int remoteBox;			// And its mailbox
+    int window;				// Segments in flight, at most
+
+    // Sending side
+    TransportSegment *sendBuf;		// Unacknowledged segments, by
+					// seq % window
+    int sendBase;			// Oldest unacknowledged segment
+    int nextSeq;			// Number of the next segment to send
+    int rto;				// Retransmission timeout
+    int srtt, rttvar;			// Smoothed round trip time and its
+					// deviation; srtt is -1 until the
+					// first measurement
+    int retries;			// Timeouts since the last progress
+    bool broken;			// Given up on the other side?
+    Condition *windowOpen;		// Signalled when segments are
+					// acknowledged
+
+    // Receiving side
+    TransportSegment *recvBuf;		// Segments received out of order
+    int expected;			// Next segment to deliver
+    char *partial;			// Message being put together
+    int partialLength, partialSize;	// Its length, and the space for it
+    List *messages;			// Messages put together, waiting to
+					// be received
+    Condition *messageArrived;
+
+    Lock *lock;				// Protects all of the above
+    Lock *sendLock;			// Keeps the segments of a message
+					// together
+
+    // Shared with the timer interrupt handler
+    int deadline;			// When the oldest unacknowledged
+					// segment times out, -1 if none
+    bool timerPending;			// Timer interrupt scheduled?
+    Semaphore *timedOut;		// Wakes the retransmitting thread
+
+    void Transmit(TransportSegment *seg); // Send a data segment
+    void SendAck();			// Send an acknowledgement
+    void Acknowledged(int ack);		// Process a cumulative ack
+    void Deliver(TransportSegment *seg); // Add a segment to a message
+    void StartTimer();			// (Re)start the retransmission timer
+    void StopTimer();			// Stop it
+};
+
+#endif // TRANSPORT_H
@@ -0,0 +1,101 @@
+/* mutexbench.c
+ *	Compare the futex-style mutex of umutex.h with a kernel semaphore
+ *	used as a mutex.
+ *
+ *	NUM_PROCS processes share a counter and each adds NUM_ITER to it,
+ *	holding the lock for every increment.  Both phases print the final
+ *	counter, the time they took and how many times the lock code
+ *	entered the kernel.
+ */
+
+#include "syscall.h"
+#include "synchop.h"
+#include "umutex.h"
+
+#define NUM_PROCS 4
+#define NUM_ITER 200
+#define SEM_KEY 33
+
+int *shared;		/* [0]: the mutex, [1]: the counter */
+
+void
+Report (char *name, int start, int entries)
+{
+   syscall_wrapper_PrintString(name);
+   syscall_wrapper_PrintString(": counter=");
+   syscall_wrapper_PrintInt(shared[1]);
+   syscall_wrapper_PrintString(" ticks=");
+   syscall_wrapper_PrintInt(syscall_wrapper_GetTime() - start);
+   syscall_wrapper_PrintString(" kernel entries=");
+   syscall_wrapper_PrintInt(entries);
+   syscall_wrapper_PrintChar('\n');
+}
+
+/* Runs in every process; returns the number of kernel entries */
+int
+FutexWorker (void)
+{
+   int i, x;
+
+   umutexKernelEntries = 0;
+   for (i=0; i<NUM_ITER; i++) {
+      UMutexLock(&shared[0]);
+      x = shared[1];
+      syscall_wrapper_Yield();		/* make the critical section hurt */
+      shared[1] = x + 1;
+      UMutexUnlock(&shared[0]);
+   }
+   return umutexKernelEntries;
+}
+
+int
+SemWorker (int semid)
+{
+   int i, x;
+
+   for (i=0; i<NUM_ITER; i++) {
+      syscall_wrapper_SemOp(semid, -1);
+      x = shared[1];
+      syscall_wrapper_Yield();
+      shared[1] = x + 1;
+      syscall_wrapper_SemOp(semid, 1);
+   }
+   return 2*NUM_ITER;
+}
+
+int
+main()
+{
+   int pids[NUM_PROCS];
+   int i, start, entries, semid, one = 1;
+
+   shared = (int*)syscall_wrapper_ShmAllocate(2*sizeof(int));
+
+   /* Phase 1: futex mutex */
+   UMutexInit(&shared[0]);
+   shared[1] = 0;
+   start = syscall_wrapper_GetTime();
+   for (i=0; i<NUM_PROCS; i++) {
+      pids[i] = syscall_wrapper_Fork();
+      if (pids[i] == 0) syscall_wrapper_Exit(FutexWorker());
+   }
+   entries = 0;
+   for (i=0; i<NUM_PROCS; i++) entries += syscall_wrapper_Join(pids[i]);
+   Report("futex", start, entries);
+
+   /* Phase 2: semaphore */
+   semid = syscall_wrapper_SemGet(SEM_KEY);
+   syscall_wrapper_SemCtl(semid, SYNCH_SET, &one);
+   shared[1] = 0;
+   start = syscall_wrapper_GetTime();
+   for (i=0; i<NUM_PROCS; i++) {
+      pids[i] = syscall_wrapper_Fork();
+      if (pids[i] == 0) syscall_wrapper_Exit(SemWorker(semid));
+   }
+   entries = 0;
+   for (i=0; i<NUM_PROCS; i++) entries += syscall_wrapper_Join(pids[i]);
+   Report("semaphore", start, entries);
+   syscall_wrapper_SemCtl(semid, SYNCH_REMOVE, 0);
+
+   return 0;
+}
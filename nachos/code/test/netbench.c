@@ -0,0 +1,87 @@
+/* netbench.c
+ *	Measure the network system calls between two Nachos machines.
+ *
+ *	Run machine 1 (the server) first, then machine 0 (the client):
+ *
+ *		nachos -m 1 -x netbench
+ *		nachos -m 0 -x netbench
+ *
+ *	The post office does not recover lost messages, so leave the
+ *	reliability at 1.
+ *
+ *	The first phase bounces a small message back and forth and prints
+ *	the ticks per round trip.  In the second, the client streams full
+ *	messages to the server, which takes them without blocking, polling
+ *	its mailbox and yielding while it is empty, and acknowledges the
+ *	last one; the client prints the bytes moved per 1000 ticks.
+ */
+
+#include "syscall.h"
+
+#define PING_BOX 2
+#define STREAM_BOX 3
+#define NUM_PINGS 100
+#define PING_SIZE 8
+#define NUM_MESSAGES 500
+
+char data[NetMaxMessage];
+
+void
+Server (int peer)
+{
+   int i, from;
+
+   for (i=0; i<NUM_PINGS; i++) {
+      syscall_wrapper_NetReceive(PING_BOX, data, PING_SIZE, &from);
+      syscall_wrapper_NetSend(from, PING_BOX, data, PING_SIZE);
+   }
+
+   i = 0;
+   while (i < NUM_MESSAGES) {
+      if (syscall_wrapper_NetPoll(STREAM_BOX) == 0) syscall_wrapper_Yield();
+      else if (syscall_wrapper_NetTryReceive(STREAM_BOX, data,
+				NetMaxMessage, 0) >= 0) i++;
+   }
+   syscall_wrapper_NetSend(peer, STREAM_BOX, data, 1);
+}
+
+void
+Client (int peer)
+{
+   int i, start, ticks;
+
+   start = syscall_wrapper_GetTime();
+   for (i=0; i<NUM_PINGS; i++) {
+      syscall_wrapper_NetSend(peer, PING_BOX, data, PING_SIZE);
+      syscall_wrapper_NetReceive(PING_BOX, data, PING_SIZE, 0);
+   }
+   ticks = syscall_wrapper_GetTime() - start;
+   syscall_wrapper_PrintString("ping-pong: ticks per round trip=");
+   syscall_wrapper_PrintInt(ticks / NUM_PINGS);
+   syscall_wrapper_PrintChar('\n');
+
+   start = syscall_wrapper_GetTime();
+   for (i=0; i<NUM_MESSAGES; i++)
+      syscall_wrapper_NetSend(peer, STREAM_BOX, data, NetMaxMessage);
+   syscall_wrapper_NetReceive(STREAM_BOX, data, 1, 0);
+   ticks = syscall_wrapper_GetTime() - start;
+   syscall_wrapper_PrintString("stream: ticks=");
+   syscall_wrapper_PrintInt(ticks);
+   syscall_wrapper_PrintString(" bytes per 1000 ticks=");
+   syscall_wrapper_PrintInt((NUM_MESSAGES * NetMaxMessage * 10) / (ticks / 100));
+   syscall_wrapper_PrintChar('\n');
+}
+
+int
+main()
+{
+   int me = syscall_wrapper_NetAddress();
+
+   if (me < 0) {
+      syscall_wrapper_PrintString("netbench: no network\n");
+      return 1;
+   }
+   if (me == 1) Server(0);
+   else Client(1);
+   return 0;
+}
@@ -274,6 +274,105 @@ syscall_wrapper_ShmAllocate:
         j       $31
         .end syscall_wrapper_ShmAllocate
 
+	.globl syscall_wrapper_WaitOnAddress
+	.ent	syscall_wrapper_WaitOnAddress
+syscall_wrapper_WaitOnAddress:
+	addiu $2,$0,SysCall_WaitOnAddress
+	syscall
+	j	$31
+	.end syscall_wrapper_WaitOnAddress
+
+	.globl syscall_wrapper_WakeAddress
+	.ent	syscall_wrapper_WakeAddress
+syscall_wrapper_WakeAddress:
+	addiu $2,$0,SysCall_WakeAddress
+	syscall
+	j	$31
+	.end syscall_wrapper_WakeAddress
+
+	.globl syscall_wrapper_NetSend
+	.ent	syscall_wrapper_NetSend
+syscall_wrapper_NetSend:
+	addiu $2,$0,SysCall_NetSend
+	syscall
+	j	$31
+	.end syscall_wrapper_NetSend
+
+	.globl syscall_wrapper_NetReceive
+	.ent	syscall_wrapper_NetReceive
+syscall_wrapper_NetReceive:
+	addiu $2,$0,SysCall_NetReceive
+	syscall
+	j	$31
+	.end syscall_wrapper_NetReceive
+
+	.globl syscall_wrapper_NetTryReceive
+	.ent	syscall_wrapper_NetTryReceive
+syscall_wrapper_NetTryReceive:
+	addiu $2,$0,SysCall_NetTryReceive
+	syscall
+	j	$31
+	.end syscall_wrapper_NetTryReceive
+
+	.globl syscall_wrapper_NetPoll
+	.ent	syscall_wrapper_NetPoll
+syscall_wrapper_NetPoll:
+	addiu $2,$0,SysCall_NetPoll
+	syscall
+	j	$31
+	.end syscall_wrapper_NetPoll
+
+	.globl syscall_wrapper_NetAddress
+	.ent	syscall_wrapper_NetAddress
+syscall_wrapper_NetAddress:
+	addiu $2,$0,SysCall_NetAddress
+	syscall
+	j	$31
+	.end syscall_wrapper_NetAddress
+
+/* -------------------------------------------------------------
+ * Atomic operations on a word of user memory, which run entirely in
+ * user mode.  They are built on the MIPS II load linked / store
+ * conditional pair: the SC fails if anything (an exception, a context
+ * switch) came between it and the LL, and we try again.  Our MIPS I
+ * assembler does not know these two, so they are spelled out:
+ *
+ *	0xc0820000	ll	$2,0($4)
+ *	0xe0880000	sc	$8,0($4)
+ * -------------------------------------------------------------
+ */
+
+	.globl AtomicCompareAndSwap
+	.ent	AtomicCompareAndSwap
+AtomicCompareAndSwap:
+	.set	noreorder
+1:	.word	0xc0820000	/* ll	$2,0($4) */
+	nop			/* load delay */
+	bne	$2,$5,2f	/* not the expected value: give up */
+	move	$8,$6
+	.word	0xe0880000	/* sc	$8,0($4) */
+	beq	$8,$0,1b	/* lost the race: try again */
+	nop
+2:	j	$31
+	nop
+	.set	reorder
+	.end AtomicCompareAndSwap
+
+	.globl AtomicFetchAdd
+	.ent	AtomicFetchAdd
+AtomicFetchAdd:
+	.set	noreorder
+1:	.word	0xc0820000	/* ll	$2,0($4) */
+	nop			/* load delay */
+	addu	$8,$2,$5
+	.word	0xe0880000	/* sc	$8,0($4) */
+	beq	$8,$0,1b	/* lost the race: try again */
+	nop
+	j	$31
+	nop
+	.set	reorder
+	.end AtomicFetchAdd
+
 /* dummy function to keep gcc happy */
         .globl  __main
         .ent    __main
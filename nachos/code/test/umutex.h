@@ -0,0 +1,54 @@
+/* umutex.h
+ *	A mutex for user programs that stays out of the kernel unless
+ *	there is contention.
+ *
+ *	The mutex is a word of shared memory (see ShmAllocate) holding
+ *	0 when free, 1 when held, and 2 when held with processes possibly
+ *	sleeping on it.  Lock and unlock are done with the atomic operations
+ *	of start.s; only a contended lock goes to WaitOnAddress, and only
+ *	an unlock that finds the word at 2 calls WakeAddress.
+ */
+
+#ifndef UMUTEX_H
+#define UMUTEX_H
+
+#include "syscall.h"
+
+typedef int umutex_t;
+
+/* Number of times UMutexLock/UMutexUnlock entered the kernel */
+static int umutexKernelEntries = 0;
+
+static void
+UMutexInit (umutex_t *m)
+{
+   *m = 0;
+}
+
+static void
+UMutexLock (umutex_t *m)
+{
+   int c = AtomicCompareAndSwap(m, 0, 1);
+
+   if (c == 0) return;			/* uncontended */
+
+   /* Mark the mutex contended, then sleep until we get it as 0 -> 2 */
+   do {
+      if ((c == 2) || (AtomicCompareAndSwap(m, 1, 2) != 0)) {
+         umutexKernelEntries++;
+         syscall_wrapper_WaitOnAddress(m, 2);
+      }
+   } while ((c = AtomicCompareAndSwap(m, 0, 2)) != 0);
+}
+
+static void
+UMutexUnlock (umutex_t *m)
+{
+   if (AtomicFetchAdd(m, -1) != 1) {	/* there may be sleepers */
+      *m = 0;
+      umutexKernelEntries++;
+      syscall_wrapper_WakeAddress(m, 1);
+   }
+}
+
+#endif /* UMUTEX_H */
@@ -8,36 +8,72 @@
 //
 // 	Most of this file is not needed until later assignments.
 //
-// Usage: nachos -d <debugflags> -rs <random seed #>
-//		-s -x <nachos file> -c <consoleIn> <consoleOut>
-//		-f -cp <unix file> <nachos file>
-//		-p <nachos file> -r <nachos file> -l -D -t
+// Usage: nachos -d <debugflags> -rs <random seed #> -cpus <# of CPUs>
+//		-s -M <# of frames> -zswap <# of frames> -ksm <ticks>
+//		-ws <ticks> -rss <# of frames> -local -lc
+//		-x <nachos file> -c <consoleIn> <consoleOut>
+//		-f -ds <disk scheduling policy> -dio <disk I/O mode>
+//		-cp <unix file> <nachos file>
+//		-p <nachos file> -r <nachos file> -mkdir <nachos directory>
+//		-l -D -t -tm -tj
 //              -n <network reliability> -m <machine id>
-//              -o <other machine id>
+//              -o <other machine id> -rt <other machine id>
+//              -fabric <# of machines> -links <link file> -ft -mbt
+//              -rswap <memory server id> -memserver <client id>
 //              -z
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
+//    -cpus simulates a multiprocessor with the given number of CPUs
+//    -csv writes the statistics to the given file when Nachos halts
 //    -z prints the copyright message
 //
 //  USER_PROGRAM
 //    -s causes user programs to be executed in single-step mode
+//    -M sets the number of physical page frames
+//    -zswap keeps evicted pages compressed in the given number of those
+//	frames, in front of the backup store
+//    -ksm maps pages of zeros to one read-only frame, and merges pages
+//	with the same contents every given number of ticks (0 for never);
+//	it needs page replacement, so it must come after -R
+//    -ws sets the working-set window, in ticks
+//    -rss limits the frames each process may have; at the limit, it
+//	replaces its own pages
+//    -local makes a process replace its own pages when no frame is free
+//    -lc suspends the process with the largest working set when the
+//	working sets do not fit in memory
 //    -x runs a user program
 //    -c tests the console
 //
 //  FILESYS
 //    -f causes the physical disk to be formatted
+//    -ds sets the order of disk requests: 0 FCFS, 1 SSTF, 2 SCAN, 3 C-LOOK
+//    -dio sets how the DISK file is accessed: 0 read/write calls, 1 mmap,
+//	2 mmap and msync whenever the sector cache is synced
 //    -cp copies a file from UNIX to Nachos
 //    -p prints a Nachos file to stdout
-//    -r removes a Nachos file from the file system
-//    -l lists the contents of the Nachos directory
+//    -r removes a Nachos file, or an empty directory, from the file system
+//    -mkdir creates a Nachos directory
+//    -l lists the contents of the Nachos root directory
 //    -D prints the contents of the entire file system 
 //    -t tests the performance of the Nachos file system
+//    -tm tests how fast files can be created and removed
+//    -tj tests that growing a directory is one journal transaction
 //
 //  NETWORK
 //    -n sets the network reliability
 //    -m sets this machine's host id (needed for the network)
 //    -o runs a simple test of the Nachos network software
+//    -rt measures the latency and throughput of the reliable transport
+//    -fabric runs the given number of machines in this process, joined by
+//	an in-memory network; -m picks the one that runs the tests
+//    -links sets the latency, bandwidth and loss of the fabric's links
+//    -ft sends messages around a ring of all the fabric's machines
+//    -mbt tests mailboxes made on the fly, and their credits, between
+//	the first two of the fabric's machines
+//    -rswap pages to the memory server on the given machine, instead of
+//	to local swap; with -fabric, the server is started here
+//    -memserver keeps the pages of the given client machine
 //
 //  NOTE -- flags are ignored until the relevant assignment.
 //  Some of the flags are interpreted here; some in system.cc.
@@ -57,9 +93,11 @@
 // External functions used by this file
 
 extern void ThreadTest(void), Copy(char *unixFile, char *nachosFile);
-extern void Print(char *file), PerformanceTest(void);
+extern void Print(char *file), PerformanceTest(void), MetadataTest(void);
+extern void JournalTest(void);
 extern void LaunchUserProcess(char *file), ConsoleTest(char *in, char *out);
-extern void MailTest(int networkID);
+extern void MailTest(int networkID), TransportTest(int networkID);
+extern void FabricTest(void), MailBoxTest(void);
 
 extern void ReadInputAndFork(char *file);
 
@@ -100,8 +138,8 @@ main(int argc, char **argv)
         if (!strcmp(*argv, "-A")) {		// read scheduling algorithm
            schedulingAlgo = atoi(*(argv + 1));
            argCount = 2;
-           ASSERT((schedulingAlgo > 0) && (schedulingAlgo <= 4));
-           if ((schedulingAlgo == ROUND_ROBIN) || (schedulingAlgo == UNIX_SCHED)) {
+           ASSERT((schedulingAlgo > 0) && (schedulingAlgo <= MAX_SCHED_ALGO));
+           if (scheduler->IsPreemptive()) {
               ASSERT (SCHED_QUANTUM > 0);
            }
            if (schedulingAlgo == UNIX_SCHED) {
@@ -109,6 +147,13 @@ main(int argc, char **argv)
               currentThread->SetPriority(schedPriority+DEFAULT_BASE_PRIORITY);
               currentThread->SetUsage(0);
            }
+           else if (schedulingAlgo == MLFQ_SCHED) {
+              currentThread->SetPriority(0);
+              currentThread->SetUsage(0);
+           }
+           else if (schedulingAlgo == STRIDE_SCHED) {
+              currentThread->SetPriority(scheduler->GetMinPass());
+           }
         } else if (!strcmp(*argv, "-P")) {
             schedPriority = atoi(*(argv + 1));
             argCount = 2;
@@ -118,7 +163,13 @@ main(int argc, char **argv)
             currentThread->SetUsage(0);
         } else if(!(strcmp(*argv, "-R"))){
             replAlgo = atoi(*(argv+1));
+            argCount = 2;
             ASSERT((replAlgo>=0) && (replAlgo<=4));
+        } else if (!strcmp(*argv, "-ksm")) {	// share identical pages
+            ASSERT(argc > 1);
+            ASSERT((replAlgo != 0) && (pageMerger == NULL));
+            pageMerger = new PageMerger(atoi(*(argv + 1)));
+            argCount = 2;
         } else if (!strcmp(*argv, "-x")) {        	// run a user program
 	    ASSERT(argc > 1);
             LaunchUserProcess(*(argv + 1));
@@ -153,12 +204,20 @@ main(int argc, char **argv)
 	    ASSERT(argc > 1);
 	    fileSystem->Remove(*(argv + 1));
 	    argCount = 2;
+	} else if (!strcmp(*argv, "-mkdir")) {	// make Nachos directory
+	    ASSERT(argc > 1);
+	    fileSystem->MakeDirectory(*(argv + 1));
+	    argCount = 2;
 	} else if (!strcmp(*argv, "-l")) {	// list Nachos directory
             fileSystem->List();
 	} else if (!strcmp(*argv, "-D")) {	// print entire filesystem
             fileSystem->Print();
 	} else if (!strcmp(*argv, "-t")) {	// performance test
             PerformanceTest();
+	} else if (!strcmp(*argv, "-tm")) {	// metadata performance test
+            MetadataTest();
+	} else if (!strcmp(*argv, "-tj")) {	// journal test
+            JournalTest();
 	}
 #endif // FILESYS
 #ifdef NETWORK
@@ -169,9 +228,26 @@ main(int argc, char **argv)
 						// start up another nachos
             MailTest(atoi(*(argv + 1)));
             argCount = 2;
+        } else if (!strcmp(*argv, "-rt")) {
+	    ASSERT(argc > 1);
+            Delay(2); 				// as for -o
+            TransportTest(atoi(*(argv + 1)));
+            argCount = 2;
+        } else if (!strcmp(*argv, "-ft")) {	// no delay: all the machines
+            FabricTest();			// are in this process
+        } else if (!strcmp(*argv, "-mbt")) {	// as for -ft
+            MailBoxTest();
+        } else if (!strcmp(*argv, "-memserver")) {
+	    ASSERT(argc > 1);
+            new MemoryServer(postOffice, atoi(*(argv + 1)));
+            argCount = 2;
         }
 #endif // NETWORK
     }
+#ifdef FILESYS
+    sectorCache->Sync();		// make the file system changes
+					// above reach the disk
+#endif
 
     currentThread->FinishThread();	// NOTE: if the procedure "main" 
 				// returns, then the program "nachos"
@@ -0,0 +1,114 @@
+// pool.cc 
+//	Routines to recycle kernel buffers of a fixed set of sizes.
+//
+//	The pool is a small array searched linearly: it only ever holds
+//	a handful of buffers, and those are almost always of the size
+//	asked for next (every stack is StackSize words, a forked child's
+//	page table is the size of its parent's, ...).
+//
+//	There is no locking: like the rest of the kernel data structures,
+//	the pool is only touched with interrupts off or from code that
+//	cannot be preempted in between.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "pool.h"
+
+//----------------------------------------------------------------------
+// BufferPool::BufferPool
+// 	Initialize an empty pool.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//	"limit" is the number of freed buffers the pool will hold on to.
+//	"boundedArrays" says whether to allocate the buffers with 
+//	AllocBoundedArray, as thread stacks are.
+//	"allocs" and "reuses" are the counters to bump on a heap
+//	allocation and on a recycled buffer, respectively.
+//----------------------------------------------------------------------
+
+BufferPool::BufferPool(char* debugName, int limit, bool boundedArrays,
+			int *allocs, int *reuses)
+{
+    name = debugName;
+    maxFree = limit;
+    bounded = boundedArrays;
+    allocCount = allocs;
+    reuseCount = reuses;
+    numFree = 0;
+    freeBuffers = new char*[maxFree];
+    freeSizes = new int[maxFree];
+}
+
+//----------------------------------------------------------------------
+// BufferPool::~BufferPool
+// 	Return the cached buffers to the heap.  Buffers still in use
+//	are not affected.
+//----------------------------------------------------------------------
+
+BufferPool::~BufferPool()
+{
+    for (int i = 0; i < numFree; i++) {
+	if (bounded)
+	    DeallocBoundedArray(freeBuffers[i], freeSizes[i]);
+	else
+	    delete [] freeBuffers[i];
+    }
+    delete [] freeBuffers;
+    delete [] freeSizes;
+}
+
+//----------------------------------------------------------------------
+// BufferPool::Get
+// 	Return a buffer of "size" bytes, a cached one if there is one
+//	of exactly that size.  The contents of the buffer are undefined.
+//----------------------------------------------------------------------
+
+char *
+BufferPool::Get(int size)
+{
+    char *buf;
+
+    for (int i = numFree - 1; i >= 0; i--) {
+	if (freeSizes[i] == size) {
+	    buf = freeBuffers[i];
+	    numFree--;
+	    freeBuffers[i] = freeBuffers[numFree];
+	    freeSizes[i] = freeSizes[numFree];
+	    (*reuseCount)++;
+	    DEBUG('p', "Reusing %d bytes from pool \"%s\"\n", size, name);
+	    return buf;
+	}
+    }
+    (*allocCount)++;
+    DEBUG('p', "Allocating %d bytes for pool \"%s\"\n", size, name);
+    if (bounded)
+	return AllocBoundedArray(size);
+    return new char[size];
+}
+
+//----------------------------------------------------------------------
+// BufferPool::Put
+// 	Give back a buffer obtained from Get.  It is kept for reuse if
+//	there is room in the pool, and freed otherwise.
+//
+//	"buf" -- the buffer (NULL is ignored)
+//	"size" -- the size it was obtained with
+//----------------------------------------------------------------------
+
+void
+BufferPool::Put(char *buf, int size)
+{
+    if (buf == NULL)
+	return;
+    if (numFree < maxFree) {
+	freeBuffers[numFree] = buf;
+	freeSizes[numFree] = size;
+	numFree++;
+    } else if (bounded)
+	DeallocBoundedArray(buf, size);
+    else
+	delete [] buf;
+}
@@ -0,0 +1,53 @@
+// pool.h 
+//	Data structures for recycling kernel memory.
+//
+//	Creating and destroying a process allocates and frees the same
+//	things over and over: a thread control block, an execution stack,
+//	and for user programs an address space with its page table and
+//	backup array.  A BufferPool keeps freed buffers around, so that
+//	the next request for a buffer of the same size is handed one
+//	back instead of going to the heap.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef POOL_H
+#define POOL_H
+
+#include "copyright.h"
+#include "utility.h"
+
+// The following class defines a "buffer pool" -- a cache of up to
+// "maxFree" freed buffers, looked up by their exact size.
+//
+// Two counters are kept for the statistics: "allocCount" is bumped for
+// every buffer taken from the heap, "reuseCount" for every buffer
+// handed back out of the pool.  Without the pool, every request
+// would have been a heap allocation (allocCount + reuseCount).
+
+class BufferPool {
+  public:
+    BufferPool(char* debugName, int limit, bool boundedArrays,
+			int *allocs, int *reuses);
+					// initialize an empty pool; if 
+					// "boundedArrays", buffers are allocated 
+					// with AllocBoundedArray
+    ~BufferPool();			// free the cached buffers
+
+    char *Get(int size);		// return a buffer of "size" bytes
+    void Put(char *buf, int size);	// give a buffer back to the pool
+
+    char* getName() { return name; }
+
+  private:
+    char* name;				// useful for debugging
+    int maxFree;			// at most this many cached buffers
+    bool bounded;			// allocated by AllocBoundedArray?
+    int numFree;			// number of cached buffers
+    char **freeBuffers;			// the cached buffers
+    int *freeSizes;			// and their sizes
+    int *allocCount, *reuseCount;	// where to count requests
+};
+
+#endif // POOL_H
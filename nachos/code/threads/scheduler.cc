@@ -24,29 +24,50 @@
 
 //----------------------------------------------------------------------
 // ProcessScheduler::ProcessScheduler
-// 	Initialize the list of ready but not running threads to empty.
+// 	Initialize the lists of ready but not running threads to empty,
+//	and mark all CPUs but the boot CPU idle.
 //----------------------------------------------------------------------
 
 ProcessScheduler::ProcessScheduler()
 { 
-    listOfReadyThreads = new List;
+    int i;
+
+    for (i=0; i<MAX_CPUS; i++) {
+       listOfReadyThreads[i] = new List;
+       readyCount[i] = 0;
+       cpuThread[i] = NULL;
+       cpuTicks[i] = 0;
+       cpuBurstStartTime[i] = 0;
+       cpuSwitchInTime[i] = 0;
+       cpuSwitchInIdle[i] = 0;
+    }
+    totalReadyCount = 0;
+    nextHomeCPU = 0;
     empty_ready_queue_start_time = -1;
+    min_pass = 0;
 } 
 
 //----------------------------------------------------------------------
 // ProcessScheduler::~ProcessScheduler
-// 	De-allocate the list of ready threads.
+// 	De-allocate the lists of ready threads.
 //----------------------------------------------------------------------
 
 ProcessScheduler::~ProcessScheduler()
 { 
-    delete listOfReadyThreads; 
+    for (int i=0; i<MAX_CPUS; i++) delete listOfReadyThreads[i]; 
 } 
 
 //----------------------------------------------------------------------
 // ProcessScheduler::MoveThreadToReadyQueue
 // 	Mark a thread as ready, but not running.
-//	Put it on the ready list, for later scheduling onto the CPU.
+//	Put it on the ready list of the CPU it last ran on, for later
+//	scheduling onto that CPU.  New threads are spread over the CPUs
+//	round robin.
+//
+//	Under stride scheduling, a thread coming back from sleep, join or
+//	a page fault starts no lower than the pass of the last dispatched
+//	thread, so that it cannot claim the CPU time it missed while it
+//	was blocked.
 //
 //	"thread" is the thread to be put on the ready list.
 //----------------------------------------------------------------------
@@ -74,21 +95,34 @@ ProcessScheduler::MoveThreadToReadyQueue (NachOSThread *thread)
              stats->burstEstimateError += abs(stats->totalTicks - cpu_burst_start_time - thread->GetPriority());
              thread->SetPriority((int)(ALPHA*(stats->totalTicks - cpu_burst_start_time) + (1-ALPHA)*thread->GetPriority()));
           }
+          else if ((schedulingAlgo == MLFQ_SCHED) || (schedulingAlgo == STRIDE_SCHED)) {
+             ChargeBurst(thread, stats->totalTicks - cpu_burst_start_time);
+          }
        }
     }
+    else if (schedulingAlgo == STRIDE_SCHED) {
+       thread->SetPriority(max(thread->GetPriority(), GetMinPass()));
+    }
     thread->setStatus(READY);
     thread->SetWaitStartTime(stats->totalTicks);
-    if (listOfReadyThreads->IsEmpty() && (empty_ready_queue_start_time != -1)) {
+    if ((totalReadyCount == 0) && (empty_ready_queue_start_time != -1)) {
        stats->empty_ready_queue_time += (stats->totalTicks - empty_ready_queue_start_time);
        empty_ready_queue_start_time = -1;
     }
-    listOfReadyThreads->Append((void *)thread);
+    if (thread->GetCPU() == -1) {
+       thread->SetCPU(nextHomeCPU);
+       nextHomeCPU = (nextHomeCPU+1)%numCPUs;
+    }
+    listOfReadyThreads[thread->GetCPU()]->Append((void *)thread);
+    readyCount[thread->GetCPU()]++;
+    totalReadyCount++;
 }
 
 //----------------------------------------------------------------------
 // ProcessScheduler::SelectNextReadyThread
-// 	Return the next thread to be scheduled onto the CPU.
-//	If there are no ready threads, return NULL.
+// 	Return the next thread to be scheduled onto the current CPU.
+//	If the ready list of this CPU is empty, steal a thread from
+//	another CPU.  If there are no ready threads, return NULL.
 // Side effect:
 //	NachOSThread is removed from the ready list.
 //----------------------------------------------------------------------
@@ -96,12 +130,70 @@ ProcessScheduler::MoveThreadToReadyQueue (NachOSThread *thread)
 NachOSThread *
 ProcessScheduler::SelectNextReadyThread ()
 {
-    if ((schedulingAlgo == UNIX_SCHED) || (schedulingAlgo == NON_PREEMPTIVE_SJF)){
-       return (NachOSThread *)listOfReadyThreads->GetMinPriorityThread();
+    NachOSThread *thread = RemoveFromReadyQueue(currentCPU);
+
+    if ((thread == NULL) && (numCPUs > 1)) {
+       thread = StealThread();
+    }
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// ProcessScheduler::RemoveFromReadyQueue
+// 	Dequeue the thread the scheduling algorithm would run next from
+//	the ready list of "cpu".  Return NULL if that list is empty.
+//----------------------------------------------------------------------
+
+NachOSThread *
+ProcessScheduler::RemoveFromReadyQueue (int cpu)
+{
+    NachOSThread *thread;
+
+    if ((schedulingAlgo == UNIX_SCHED) || (schedulingAlgo == NON_PREEMPTIVE_SJF)
+                                       || (schedulingAlgo == MLFQ_SCHED)){
+       thread = (NachOSThread *)listOfReadyThreads[cpu]->GetMinPriorityThread();
+    }
+    else if (schedulingAlgo == STRIDE_SCHED) {
+       thread = (NachOSThread *)listOfReadyThreads[cpu]->GetMinPriorityThread();
+       if (thread != NULL) min_pass = thread->GetPriority();
     }
     else {
-       return (NachOSThread *)listOfReadyThreads->Remove();
+       thread = (NachOSThread *)listOfReadyThreads[cpu]->Remove();
+    }
+    if (thread != NULL) {
+       readyCount[cpu]--;
+       totalReadyCount--;
     }
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// ProcessScheduler::StealThread
+// 	The current CPU has nothing of its own to run.  Take the next
+//	thread from the longest ready list of the other CPUs, and make
+//	the current CPU its new home.  Ties go to the lowest numbered
+//	CPU, so that runs are repeatable.
+//----------------------------------------------------------------------
+
+NachOSThread *
+ProcessScheduler::StealThread ()
+{
+    NachOSThread *thread;
+    int i, victim = -1;
+
+    for (i=0; i<numCPUs; i++) {
+       if ((i != currentCPU) && (readyCount[i] > 0)) {
+          if ((victim == -1) || (readyCount[i] > readyCount[victim])) victim = i;
+       }
+    }
+    if (victim == -1) return NULL;
+
+    thread = RemoveFromReadyQueue(victim);
+    DEBUG('t', "CPU %d stealing thread \"%s\" with pid %d from CPU %d\n",
+	  currentCPU, thread->getName(), thread->GetPID(), victim);
+    thread->SetCPU(currentCPU);
+    stats->cpuSteals[currentCPU]++;
+    return thread;
 }
 
 //----------------------------------------------------------------------
@@ -122,26 +214,48 @@ void
 ProcessScheduler::ScheduleThread (NachOSThread *nextThread)
 {
     NachOSThread *oldThread = currentThread;
+
+    if ((numCPUs > 1) && (nextThread->GetWaitStartTime() > stats->totalTicks)) {
+       // The thread was made ready by a CPU whose clock is ahead of
+       // ours.  It cannot start before that, so we idle until then.
+       stats->idleTicks += (nextThread->GetWaitStartTime() - stats->totalTicks);
+       stats->totalTicks = nextThread->GetWaitStartTime();
+    }
     
     cpu_burst_start_time = stats->totalTicks;
     nextThread->SetCPUBurstStartTime(cpu_burst_start_time);
+    nextThread->SetCPU(currentCPU);
     stats->total_wait_time += (stats->totalTicks - nextThread->GetWaitStartTime());
 
+    currentThread = nextThread;		    // switch to the next thread
+    currentThread->setStatus(RUNNING);      // nextThread is now running
+
+    ContextSwitch(oldThread, nextThread);
+}
+
+//----------------------------------------------------------------------
+// ProcessScheduler::ContextSwitch
+// 	Save the state of oldThread and resume nextThread, which the
+//	caller has already made the currentThread.  This is the only
+//	place where _SWITCH is called, so every thread that gets the CPU
+//	back returns from here (or starts in Tail, if it is new).
+//----------------------------------------------------------------------
+
+void
+ProcessScheduler::ContextSwitch (NachOSThread *oldThread, NachOSThread *nextThread)
+{
 #ifdef USER_PROGRAM			// ignore until running user programs 
-    if (currentThread->space != NULL) {	// if this thread is a user program,
-        currentThread->SaveUserState(); // save the user's CPU registers
-	currentThread->space->SaveContextOnSwitch();
+    if (oldThread->space != NULL) {	// if this thread is a user program,
+        oldThread->SaveUserState(); // save the user's CPU registers
+	oldThread->space->SaveContextOnSwitch();
     }
 #endif
     
     oldThread->CheckOverflow();		    // check if the old thread
 					    // had an undetected stack overflow
-
-    currentThread = nextThread;		    // switch to the next thread
-    currentThread->setStatus(RUNNING);      // nextThread is now running
     
-    DEBUG('t', "Switching from thread \"%s\" with pid %d to thread \"%s\" with pid %d\n",
-	  oldThread->getName(), oldThread->GetPID(), nextThread->getName(), nextThread->GetPID());
+    DEBUG('t', "Switching from thread \"%s\" with pid %d to thread \"%s\" with pid %d on CPU %d\n",
+	  oldThread->getName(), oldThread->GetPID(), nextThread->getName(), nextThread->GetPID(), currentCPU);
     
     // This is a machine-dependent assembly language routine defined 
     // in switch.s.  You may have to think
@@ -206,8 +320,10 @@ ProcessScheduler::Tail ()
 void
 ProcessScheduler::Print()
 {
-    printf("Ready list contents:\n");
-    listOfReadyThreads->Mapcar((VoidFunctionPtr) ThreadPrint);
+    for (int i=0; i<numCPUs; i++) {
+       printf("Ready list contents of CPU %d:\n", i);
+       listOfReadyThreads[i]->Mapcar((VoidFunctionPtr) ThreadPrint);
+    }
 }
 
 void
@@ -249,3 +365,273 @@ ProcessScheduler::UpdateThreadPriority (void)
       }
    }
 }
+
+//-------------------------------------------------------------------------
+// ProcessScheduler::IsPreemptive
+//      Returns TRUE if the running thread must be preempted when its
+//      quantum expires.
+//--------------------------------------------------------------------------
+bool
+ProcessScheduler::IsPreemptive (void)
+{
+   return ((schedulingAlgo == ROUND_ROBIN) || (schedulingAlgo == UNIX_SCHED)
+        || (schedulingAlgo == MLFQ_SCHED) || (schedulingAlgo == STRIDE_SCHED));
+}
+
+//-------------------------------------------------------------------------
+// ProcessScheduler::RequeueBeforeSelect
+//      Returns TRUE if a yielding thread must be put back on the ready
+//      list before the next thread is picked.  This is needed by the
+//      priority based algorithms, since the yielding thread may still
+//      have the best priority once its burst has been charged.
+//--------------------------------------------------------------------------
+bool
+ProcessScheduler::RequeueBeforeSelect (void)
+{
+   return ((schedulingAlgo == UNIX_SCHED) || (schedulingAlgo == MLFQ_SCHED)
+        || (schedulingAlgo == STRIDE_SCHED));
+}
+
+//-------------------------------------------------------------------------
+// ProcessScheduler::GetQuantum
+//      Returns the quantum of the passed thread.  Under MLFQ the quantum
+//      depends on the level of the thread; everybody else uses
+//      SCHED_QUANTUM.
+//--------------------------------------------------------------------------
+int
+ProcessScheduler::GetQuantum (NachOSThread *thread)
+{
+   int level;
+
+   if (schedulingAlgo == MLFQ_SCHED) {
+      level = thread->GetPriority();
+      if (level >= MLFQ_LEVELS) level = MLFQ_LEVELS-1;
+      return MLFQ_QUANTUM(level);
+   }
+   return SCHED_QUANTUM;
+}
+
+//-------------------------------------------------------------------------
+// ProcessScheduler::ChargeBurst
+//      Charges a completed CPU burst to the passed thread.
+//
+//      MLFQ: the priority holds the level and the usage holds the ticks
+//      consumed at this level.  A thread that has used up the quantum
+//      of its level, whether in one burst or in many short ones, moves
+//      down one level.
+//
+//      Stride: the priority holds the pass, which advances by the stride
+//      of the thread scaled by the fraction of a quantum that was used.
+//--------------------------------------------------------------------------
+void
+ProcessScheduler::ChargeBurst (NachOSThread *thread, int burst)
+{
+   int level, usage;
+
+   if (schedulingAlgo == MLFQ_SCHED) {
+      level = thread->GetPriority();
+      if (level >= MLFQ_LEVELS) level = MLFQ_LEVELS-1;
+      usage = thread->GetUsage() + burst;
+      if ((usage >= MLFQ_QUANTUM(level)) && (level < MLFQ_LEVELS-1)) {
+         level++;
+         usage = 0;
+      }
+      thread->SetPriority(level);
+      thread->SetUsage(usage);
+   }
+   else if (schedulingAlgo == STRIDE_SCHED) {
+      thread->SetPriority(thread->GetPriority() + (GetStride(thread)*burst)/SCHED_QUANTUM);
+   }
+}
+
+//-------------------------------------------------------------------------
+// ProcessScheduler::BoostPriorities
+//      Moves all active threads to the top MLFQ level, so that CPU bound
+//      threads cannot starve and threads that turn interactive regain
+//      their priority.
+//--------------------------------------------------------------------------
+void
+ProcessScheduler::BoostPriorities (void)
+{
+   unsigned i;
+
+   for (i=0; i<thread_index; i++) {
+      if (!exitThreadArray[i]) {
+         ASSERT(threadArray[i] != NULL);
+         threadArray[i]->SetPriority(0);
+         threadArray[i]->SetUsage(0);
+      }
+   }
+}
+
+//-------------------------------------------------------------------------
+// ProcessScheduler::GetStride
+//      Returns the stride of the passed thread.  The number of tickets is
+//      derived from the base priority, so that the priorities given in
+//      the batch file (0 is the highest) carry over unchanged.
+//--------------------------------------------------------------------------
+int
+ProcessScheduler::GetStride (NachOSThread *thread)
+{
+   int tickets = MAX_NICE_PRIORITY + DEFAULT_BASE_PRIORITY + 1 - thread->GetBasePriority();
+
+   if (tickets < 1) tickets = 1;
+   return STRIDE_LARGE/tickets;
+}
+
+//-------------------------------------------------------------------------
+// ProcessScheduler::SaveCPU
+//      Park the CPU being simulated: remember its thread, its clock and
+//      the start of its CPU burst, and charge it for the ticks it was
+//      busy since it was last resumed.
+//--------------------------------------------------------------------------
+void
+ProcessScheduler::SaveCPU (void)
+{
+   cpuThread[currentCPU] = currentThread;
+   cpuTicks[currentCPU] = stats->totalTicks;
+   cpuBurstStartTime[currentCPU] = cpu_burst_start_time;
+   stats->cpuBusyTicks[currentCPU] += (stats->totalTicks - cpuSwitchInTime[currentCPU])
+                                    - (stats->idleTicks - cpuSwitchInIdle[currentCPU]);
+}
+
+//-------------------------------------------------------------------------
+// ProcessScheduler::LoadCPU
+//      Make "cpu" the CPU being simulated.  Simulated time becomes the
+//      clock of that CPU.  If the CPU is busy, its thread becomes the
+//      currentThread; the caller still has to switch to it.
+//--------------------------------------------------------------------------
+void
+ProcessScheduler::LoadCPU (int cpu)
+{
+   currentCPU = cpu;
+   stats->totalTicks = cpuTicks[cpu];
+   cpuSwitchInTime[cpu] = cpuTicks[cpu];
+   cpuSwitchInIdle[cpu] = stats->idleTicks;
+   if (cpuThread[cpu] != NULL) {
+      currentThread = cpuThread[cpu];
+      cpu_burst_start_time = cpuBurstStartTime[cpu];
+   }
+}
+
+//-------------------------------------------------------------------------
+// ProcessScheduler::PickNextCPU
+//      Choose the CPU to simulate next: the one whose clock is the
+//      furthest behind.  An idle CPU is a candidate only if there is
+//      ready work it could take, and it cannot start before the current
+//      time.  Ties go to idle CPUs (so that work spreads out), then to
+//      the current CPU, then to the lowest numbered CPU.
+//--------------------------------------------------------------------------
+int
+ProcessScheduler::PickNextCPU (void)
+{
+   int i, ticks, best = currentCPU, bestTicks = stats->totalTicks;
+   bool idle, bestIdle = FALSE;
+
+   for (i=0; i<numCPUs; i++) {
+      if (i == currentCPU) continue;
+      if (cpuThread[i] != NULL) {
+         ticks = cpuTicks[i];
+         idle = FALSE;
+      }
+      else if (totalReadyCount > 0) {
+         ticks = max(cpuTicks[i], stats->totalTicks);
+         idle = TRUE;
+      }
+      else continue;
+      if ((ticks < bestTicks) || ((ticks == bestTicks) && idle && !bestIdle)) {
+         best = i;
+         bestTicks = ticks;
+         bestIdle = idle;
+      }
+   }
+   return best;
+}
+
+//-------------------------------------------------------------------------
+// ProcessScheduler::SwitchCPU
+//      Called on every timer interrupt when there is more than one CPU.
+//      The running thread stays on its CPU; we only stop simulating
+//      that CPU and go on with the one picked by PickNextCPU.  Since
+//      that is always the CPU with the oldest clock, the CPUs advance
+//      in lock step, and the interleaving depends only on simulated
+//      time.
+//--------------------------------------------------------------------------
+void
+ProcessScheduler::SwitchCPU (void)
+{
+   NachOSThread *oldThread = currentThread;
+   int now = stats->totalTicks;
+   int next;
+   IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+   next = PickNextCPU();
+   if (next != currentCPU) {
+      DEBUG('t', "Switching from CPU %d at %d to CPU %d at %d\n", currentCPU, now,
+            next, (cpuThread[next] != NULL) ? cpuTicks[next] : now);
+      SaveCPU();
+      if (cpuThread[next] != NULL) {		// resume where it stopped
+         LoadCPU(next);
+         ContextSwitch(oldThread, currentThread);
+      }
+      else {					// an idle CPU picks up work
+         if (cpuTicks[next] < now) cpuTicks[next] = now;
+         LoadCPU(next);
+         ScheduleThread(SelectNextReadyThread());
+      }
+   }
+   (void) interrupt->SetLevel(oldLevel);
+}
+
+//-------------------------------------------------------------------------
+// ProcessScheduler::IdleCPU
+//      Called by a thread that is giving up the current CPU while there
+//      is nothing ready to run.  If another CPU is busy, this CPU goes
+//      idle and we go on simulating that CPU; the call returns TRUE once
+//      the caller has been woken up and dispatched again, on whatever
+//      CPU.  If no other CPU is busy, return FALSE at once: the caller
+//      has to wait for an interrupt, exactly as on a uniprocessor.
+//
+//	Assumes interrupts are disabled.
+//--------------------------------------------------------------------------
+bool
+ProcessScheduler::IdleCPU (void)
+{
+   NachOSThread *oldThread = currentThread;
+   int i, next = -1;
+
+   ASSERT(interrupt->getLevel() == IntOff);
+   if (numCPUs == 1) return FALSE;
+
+   for (i=0; i<numCPUs; i++) {
+      if ((i != currentCPU) && (cpuThread[i] != NULL)) {
+         if ((next == -1) || (cpuTicks[i] < cpuTicks[next])) next = i;
+      }
+   }
+   if (next == -1) return FALSE;
+
+   DEBUG('t', "CPU %d going idle at %d\n", currentCPU, stats->totalTicks);
+   SaveCPU();
+   cpuThread[currentCPU] = NULL;
+   LoadCPU(next);
+   ContextSwitch(oldThread, currentThread);
+   return TRUE;
+}
+
+//-------------------------------------------------------------------------
+// ProcessScheduler::FinishCPUStats
+//      Charge the running CPU for its last stretch of work and move the
+//      clock to the CPU that got furthest, so that the statistics cover
+//      the whole run.
+//--------------------------------------------------------------------------
+void
+ProcessScheduler::FinishCPUStats (void)
+{
+   int i;
+
+   if (numCPUs == 1) return;
+   SaveCPU();
+   for (i=0; i<numCPUs; i++) {
+      if (cpuTicks[i] > stats->totalTicks) stats->totalTicks = cpuTicks[i];
+   }
+}
@@ -12,6 +12,7 @@
 #include "copyright.h"
 #include "list.h"
 #include "thread.h"
+#include "stats.h"
 
 // The following class defines the scheduler/dispatcher abstraction -- 
 // the data structures and operations needed to keep track of which 
@@ -33,12 +34,55 @@ class ProcessScheduler {
     void SetEmptyReadyQueueStartTime (int ticks);
 
     void UpdateThreadPriority (void);	// Used by the UNIX scheduler
+
+    // Per-algorithm policy.  The dispatcher above is shared by all
+    // algorithms; these routines hold what differs between them.
+
+    bool IsPreemptive (void);		// Preempt on quantum expiry?
+    bool RequeueBeforeSelect (void);	// Must a yielding thread compete
+					// with the ready threads?
+    int GetQuantum (NachOSThread *thread);	// Quantum at the thread's level
+
+    void ChargeBurst (NachOSThread *thread, int burst);	// Used by MLFQ and stride
+    void BoostPriorities (void);	// Used by MLFQ
+    int GetStride (NachOSThread *thread);	// Used by stride
+    int GetMinPass (void) { return min_pass; }	// Pass given to new threads
+
+    // Simulated multiprocessor (-cpus N).  Every CPU has its own
+    // running thread, clock and ready list.  Only one CPU is simulated
+    // at a time; "currentThread" and the machine registers belong to
+    // CPU "currentCPU", and the others are parked in the arrays below.
+
+    void SwitchCPU (void);		// Move simulation to the CPU whose
+					// clock is the furthest behind
+    bool IdleCPU (void);		// Park the current CPU because it has
+					// nothing to run; FALSE if no other
+					// CPU is busy
+    void FinishCPUStats (void);		// Called once at halt
    
   private:
-    List *listOfReadyThreads;  		// queue of threads that are ready to run,
-				// but not running
+    List *listOfReadyThreads[MAX_CPUS];	// queues of threads that are ready to run,
+				// but not running, one per CPU
+    int readyCount[MAX_CPUS];		// Length of each ready queue
+    int totalReadyCount;		// Sum of the above
 
     int empty_ready_queue_start_time;
+
+    NachOSThread *cpuThread[MAX_CPUS];	// Thread on each parked CPU, NULL if idle
+    int cpuTicks[MAX_CPUS];		// Clock of each parked CPU
+    int cpuBurstStartTime[MAX_CPUS];	// cpu_burst_start_time of each parked CPU
+    int cpuSwitchInTime[MAX_CPUS];	// When the CPU was last simulated
+    int cpuSwitchInIdle[MAX_CPUS];	// stats->idleTicks at that point
+    int nextHomeCPU;			// Round robin placement of new threads
+
+    NachOSThread *StealThread (void);	// Take work from the longest queue
+    int PickNextCPU (void);		// Deterministic choice of the next CPU
+    void SaveCPU (void);		// Park the current CPU
+    void LoadCPU (int cpu);		// Resume a parked CPU
+    NachOSThread *RemoveFromReadyQueue (int cpu);	// Dequeue by algorithm
+    void ContextSwitch (NachOSThread *oldThread, NachOSThread *nextThread);
+
+    int min_pass;			// Pass of the last dispatched thread (stride)
 };
 
 #endif // SCHEDULER_H
@@ -1,8 +1,7 @@
 // synch.cc 
 //	Routines for synchronizing threads.  Three kinds of
 //	synchronization routines are defined here: semaphores, locks 
-//   	and condition variables (the implementation of the last two
-//	are left to the reader).
+//   	and condition variables.
 //
 // Any implementation of a synchronization routine needs some
 // primitive atomic operation.  We assume Nachos is running on
@@ -97,16 +96,256 @@ Semaphore::V()
     (void) interrupt->SetLevel(oldLevel);
 }
 
-// Dummy functions -- so we can compile our later assignments 
-// Note -- without a correct implementation of Condition::Wait(), 
-// the test case in the network assignment won't work!
-Lock::Lock(char* debugName) {}
-Lock::~Lock() {}
-void Lock::Acquire() {}
-void Lock::Release() {}
+//----------------------------------------------------------------------
+// Semaphore::SetValue
+// 	Set the semaphore value to "newValue", waking up all the waiters
+//	if it is positive; each one checks the value again in P().
+//----------------------------------------------------------------------
+
+void
+Semaphore::SetValue(int newValue)
+{
+    NachOSThread *thread;
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    ASSERT(newValue >= 0);
+    value = newValue;
+    if (value > 0) {
+	while ((thread = (NachOSThread *)queue->Remove()) != NULL)
+	    scheduler->MoveThreadToReadyQueue(thread);
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Semaphore::HasWaiters
+// 	Return TRUE if some thread is waiting in P().
+//----------------------------------------------------------------------
+
+bool
+Semaphore::HasWaiters()
+{
+    return !queue->IsEmpty();
+}
+
+static Lock *allLocks = NULL;		// list of all locks, for PrintLockStats
+
+//----------------------------------------------------------------------
+// Lock::Lock
+// 	Initialize a lock, so that it can be used for synchronization.
+//	The lock is initially FREE.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//----------------------------------------------------------------------
+
+Lock::Lock(char* debugName)
+{
+    name = debugName;
+    owner = NULL;
+    queue = new List;
+    numAcquires = numWaits = waitTicks = 0;
+    nextLock = allLocks;
+    allLocks = this;
+}
+
+//----------------------------------------------------------------------
+// Lock::~Lock
+// 	De-allocate a lock, when no longer needed.  Assume no one
+//	is holding or waiting on the lock!
+//----------------------------------------------------------------------
+
+Lock::~Lock()
+{
+    Lock **ptr;
+
+    ASSERT(owner == NULL);
+    for (ptr = &allLocks; *ptr != this; ptr = &(*ptr)->nextLock)
+	ASSERT(*ptr != NULL);
+    *ptr = nextLock;
+    delete queue;
+}
+
+//----------------------------------------------------------------------
+// Lock::Acquire
+// 	Wait until the lock is FREE, then set it to BUSY.  If the lock
+//	is taken, we go to sleep until Release hands it to us, so there
+//	is nothing to check once we wake up.
+//----------------------------------------------------------------------
+
+void
+Lock::Acquire()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);	// disable interrupts
+    int waitStart;
+
+    ASSERT(!isHeldByCurrentThread());			// no recursive locking
+    if (owner == NULL) {
+	owner = currentThread;
+    } else {
+	DEBUG('s', "Thread \"%s\" waits for lock \"%s\"\n",
+				currentThread->getName(), name);
+	waitStart = stats->totalTicks;
+	queue->Append((void *)currentThread);
+	currentThread->PutThreadToSleep();
+	ASSERT(owner == currentThread);			// handed over by Release
+	numWaits++;
+	waitTicks += stats->totalTicks - waitStart;
+	stats->numLockWaits++;
+	stats->lockWaitTicks += stats->totalTicks - waitStart;
+    }
+    numAcquires++;
+    stats->numLockAcquires++;
+
+    (void) interrupt->SetLevel(oldLevel);		// re-enable interrupts
+}
+
+//----------------------------------------------------------------------
+// Lock::Release
+// 	Set the lock to FREE, or if some thread is waiting for it, make
+//	that thread the owner and wake it up.
+//----------------------------------------------------------------------
+
+void
+Lock::Release()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    ASSERT(isHeldByCurrentThread());
+    owner = (NachOSThread *)queue->Remove();
+    if (owner != NULL)	   // hand the lock over
+	scheduler->MoveThreadToReadyQueue(owner);
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Lock::isHeldByCurrentThread
+// 	Return TRUE if the current thread holds the lock.
+//----------------------------------------------------------------------
+
+bool
+Lock::isHeldByCurrentThread()
+{
+    return (owner == currentThread);
+}
+
+//----------------------------------------------------------------------
+// Lock::HandOffTo
+// 	Queue "thread", which is asleep, to get the lock when it is
+//	next released.  The lock must be held by the current thread.
+//	Used by Condition::Signal.
+//----------------------------------------------------------------------
+
+void
+Lock::HandOffTo(NachOSThread *thread)
+{
+    ASSERT(interrupt->getLevel() == IntOff);
+    ASSERT(isHeldByCurrentThread());
+    queue->Append((void *)thread);
+}
+
+//----------------------------------------------------------------------
+// Lock::PrintStats
+// 	Print how often the lock was acquired, and how often and for how
+//	long threads had to wait for it.
+//----------------------------------------------------------------------
+
+void
+Lock::PrintStats()
+{
+    printf("Lock \"%s\": acquisitions %d, waits %d, wait ticks %d\n", name,
+			numAcquires, numWaits, waitTicks);
+}
+
+//----------------------------------------------------------------------
+// PrintLockStats
+// 	Print the counters of every lock some thread had to wait for.
+//----------------------------------------------------------------------
+
+void
+PrintLockStats()
+{
+    for (Lock *lock = allLocks; lock != NULL; lock = lock->nextLock) {
+	if (lock->numWaits > 0)
+	    lock->PrintStats();
+    }
+}
+
+//----------------------------------------------------------------------
+// Condition::Condition
+// 	Initialize a condition variable, with no one waiting.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//----------------------------------------------------------------------
+
+Condition::Condition(char* debugName)
+{
+    name = debugName;
+    queue = new List;
+}
+
+//----------------------------------------------------------------------
+// Condition::~Condition
+// 	De-allocate a condition variable.  Assume no one is waiting on it!
+//----------------------------------------------------------------------
+
+Condition::~Condition()
+{
+    delete queue;
+}
 
-Condition::Condition(char* debugName) { }
-Condition::~Condition() { }
-void Condition::Wait(Lock* conditionLock) { ASSERT(FALSE); }
-void Condition::Signal(Lock* conditionLock) { }
-void Condition::Broadcast(Lock* conditionLock) { }
+//----------------------------------------------------------------------
+// Condition::Wait
+// 	Atomically release "conditionLock" and go to sleep until
+//	signalled.  Signal queues us on the lock, so we have it back
+//	when we wake up.
+//----------------------------------------------------------------------
+
+void
+Condition::Wait(Lock* conditionLock)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    ASSERT(conditionLock->isHeldByCurrentThread());
+    queue->Append((void *)currentThread);
+    conditionLock->Release();
+    currentThread->PutThreadToSleep();
+    ASSERT(conditionLock->isHeldByCurrentThread());
+    stats->numConditionWaits++;
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Condition::Signal
+// 	Wake up one thread waiting on the condition, if any.  It is moved
+//	to the wait queue of "conditionLock", which we hold.
+//----------------------------------------------------------------------
+
+void
+Condition::Signal(Lock* conditionLock)
+{
+    NachOSThread *thread;
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    ASSERT(conditionLock->isHeldByCurrentThread());
+    thread = (NachOSThread *)queue->Remove();
+    if (thread != NULL)
+	conditionLock->HandOffTo(thread);
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Condition::Broadcast
+// 	Wake up all threads waiting on the condition.
+//----------------------------------------------------------------------
+
+void
+Condition::Broadcast(Lock* conditionLock)
+{
+    NachOSThread *thread;
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    ASSERT(conditionLock->isHeldByCurrentThread());
+    while ((thread = (NachOSThread *)queue->Remove()) != NULL)
+	conditionLock->HandOffTo(thread);
+    (void) interrupt->SetLevel(oldLevel);
+}
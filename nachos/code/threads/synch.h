@@ -3,9 +3,7 @@
 //
 //	Three kinds of synchronization are defined here: semaphores,
 //	locks, and condition variables.  The implementation for
-//	semaphores is given; for the latter two, only the procedure
-//	interface is given -- they are to be implemented as part of 
-//	the first assignment.
+//	semaphores, locks and condition variables is in synch.cc.
 //
 //	Note that all the synchronization objects take a "name" as
 //	part of the initialization.  This is solely for debugging purposes.
@@ -45,6 +43,10 @@ class Semaphore {
     
     void P();	 // these are the only operations on a semaphore
     void V();	 // they are both *atomic*
+
+    int GetValue() { return value; }	// for the SemCtl system call,
+    void SetValue(int newValue);	// which lets user programs read
+    bool HasWaiters();			// and set the value
     
   private:
     char* name;        // useful for debugging
@@ -63,6 +65,12 @@ class Semaphore {
 // In addition, by convention, only the thread that acquired the lock
 // may release it.  As with semaphores, you can't read the lock value
 // (because the value might change immediately after you read it).  
+//
+// Release hands the lock directly to the first waiting thread, if any,
+// so a thread woken up in Acquire never has to compete for the lock
+// again.  Each lock counts how often it was acquired and how often and
+// how long threads had to wait for it; PrintLockStats lists the locks
+// that were ever contended.
 
 class Lock {
   public:
@@ -78,11 +86,27 @@ class Lock {
 					// checking in Release, and in
 					// Condition variable ops below.
 
+    void PrintStats();			// print the contention counters
+
   private:
     char* name;				// for debugging
-    // plus some other stuff you'll need to define
+    NachOSThread *owner;		// thread holding the lock, NULL if FREE
+    List *queue;			// threads waiting in Acquire
+    int numAcquires;			// times the lock was acquired
+    int numWaits;			// times Acquire had to wait
+    int waitTicks;			// ticks spent waiting in Acquire
+    Lock *nextLock;			// all locks, for PrintLockStats
+
+    void HandOffTo(NachOSThread *thread);	// queue "thread" to get the
+						// lock on the next Release
+
+    friend class Condition;
+    friend void PrintLockStats();
 };
 
+extern void PrintLockStats();		// print the counters of all 
+					// contended locks
+
 // The following class defines a "condition variable".  A condition
 // variable does not have a value, but threads may be queued, waiting
 // on the variable.  These are only operations on a condition variable: 
@@ -114,6 +138,10 @@ class Lock {
 // The consequence of using Mesa-style semantics is that some other thread
 // can acquire the lock, and change data structures, before the woken
 // thread gets a chance to run.
+//
+// Rather than making the woken thread ready only to have it block on the 
+// lock held by the signaller, Signal moves it straight to the lock's wait
+// queue; it then gets the lock handed to it like any other waiter.
 
 class Condition {
   public:
@@ -132,6 +160,6 @@ class Condition {
 
   private:
     char* name;
-    // plus some other stuff you'll need to define
+    List *queue;			// threads waiting in Wait
 };
 #endif // SYNCH_H
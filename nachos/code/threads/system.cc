@@ -18,25 +18,31 @@ Interrupt *interrupt;			// interrupt status
 Statistics *stats;			// performance metrics
 Timer *timer;				// the hardware timer device,
 					// for invoking context switches
+BufferPool *threadPool;			// recycled thread control blocks
+BufferPool *stackPool;			// recycled thread stacks
 
 unsigned numPagesAllocated;              // number of physical frames allocated
 
-NachOSThread *threadArray[MAX_THREAD_COUNT];  // Array of thread pointers
-unsigned thread_index;			// Index into this array (also used to assign unique pid)
+NachOSThread **threadArray;		// Array of thread pointers, indexed by pid
+unsigned thread_index;			// Number of pids ever handed out
+unsigned numLiveThreads;		// Threads that have not exited yet
 bool initializedConsoleSemaphores;
-bool exitThreadArray[MAX_THREAD_COUNT];  //Marks exited threads
+bool *exitThreadArray;			// Marks exited threads (and free pids)
 int pagesAllocated;
 int LRU_Clock_ptr;
 List *FIFOQueue;
 TimeSortedWaitQueue *sleepQueueHead;	// Needed to implement syscall_wrapper_Sleep
 
 int schedulingAlgo;			// Scheduling algorithm to simulate
+char *csvFileName;			// Where to write the statistics (-csv)
+int numCPUs;				// Number of simulated CPUs
+int currentCPU;				// CPU being simulated right now
 char **batchProcesses;			// Names of batch processes
 int *priority;				// Process priority
 int replAlgo = 0;
 
 int cpu_burst_start_time;        // Records the start of current CPU burst
-int completionTimeArray[MAX_THREAD_COUNT];        // Records the completion time of all simulated threads
+int last_boost_time;		// Records the last MLFQ priority boost
 bool excludeMainThread;		// Used by completion time statistics calculation
 
 #ifdef FILESYS_NEEDED
@@ -45,16 +51,47 @@ FileSystem  *fileSystem;
 
 #ifdef FILESYS
 SynchDisk   *synchDisk;
+int diskSchedAlgo;			// Disk scheduling policy (-ds)
+int diskIOMode;				// How the disk file is accessed (-dio)
+SectorCache *sectorCache;		// Disk sectors cached in memory
+Journal *journal;			// Makes metadata updates atomic
+static int last_flush_time;		// Last wake up of the cache flusher
 #endif
 
 #ifdef USER_PROGRAM	// requires either FILESYS or FILESYS_STUB
 Machine *machine;	// user program memory and registers
+BufferPool *spacePool;	// recycled address spaces, page tables
+			// and backup arrays
+SharedCode *sharedCode;	// frames holding shared code pages
+ZSwap *zswap;		// compressed evicted pages, or NULL
+PageMerger *pageMerger;	// zero frame and merged frames, or NULL
+WorkingSets *workingSets;	// working sets and resident-set limits, or
+				// NULL
+SynchTable *semTable;	// semaphores of user programs
+SynchTable *condTable;	// condition variables of user programs
+SynchTable *futexTable;	// wait queues of WaitOnAddress, by
+			// physical address
 #endif
 
 #ifdef NETWORK
 PostOffice *postOffice;
+BufferPool *mailPool;
+Fabric *fabric;
+PostOffice **postOffices;
+RemoteSwap *remoteSwap;
 #endif
 
+// The pid table.  A pid stays allocated as long as someone may still
+// look it up: the thread itself, until it is destroyed, and its parent,
+// until it has joined with the thread or has gone away itself.  Freed
+// pids are handed out again in the order they were freed, so that a
+// pid is not reused sooner than necessary.
+
+static unsigned pidTableSize;		// Entries in threadArray and friends
+static int *pidRefs;			// References keeping each pid allocated
+static int *freePIDs;			// Circular queue of freed pids
+static unsigned firstFreePID, numFreePIDs;
+
 
 // External definition, to allow us to take a pointer to this function
 extern void Cleanup();
@@ -90,12 +127,136 @@ TimerInterruptHandler(int dummy)
            delete ptr;
         }
         //printf("[%d] Timer interrupt.\n", stats->totalTicks);
-        if ((schedulingAlgo == ROUND_ROBIN) || (schedulingAlgo == UNIX_SCHED)) {
-           if ((stats->totalTicks - cpu_burst_start_time) >= SCHED_QUANTUM) {
+        if ((schedulingAlgo == MLFQ_SCHED) && ((stats->totalTicks - last_boost_time) >= MLFQ_BOOST_PERIOD)) {
+           scheduler->BoostPriorities();
+           last_boost_time = stats->totalTicks;
+        }
+        if (scheduler->IsPreemptive()) {
+           if ((stats->totalTicks - cpu_burst_start_time) >= scheduler->GetQuantum(currentThread)) {
               ASSERT(cpu_burst_start_time == currentThread->GetCPUBurstStartTime());
 	      interrupt->YieldOnReturn();
            }
         }
+        if (numCPUs > 1) {
+           interrupt->SwitchCPUOnReturn();
+        }
+    }
+#ifdef USER_PROGRAM
+    if (pageMerger != NULL)
+       pageMerger->WakeMerger();
+    if (workingSets != NULL)
+       workingSets->Sample();
+#endif
+#ifdef FILESYS
+    // Modified sectors are written back even if the machine is idle
+    if ((stats->totalTicks - last_flush_time) >= CACHE_FLUSH_PERIOD) {
+       sectorCache->WakeFlusher();
+       last_flush_time = stats->totalTicks;
+    }
+#endif
+}
+
+//----------------------------------------------------------------------
+// GrowPIDTable
+// 	Double the size of the pid table (or create it, if there is none).
+//	Only called when no pid is free, so the free queue is empty and
+//	need not be copied.
+//----------------------------------------------------------------------
+static void
+GrowPIDTable()
+{
+    unsigned i, newSize = (pidTableSize == 0) ? INITIAL_THREAD_COUNT : 2*pidTableSize;
+    NachOSThread **newThreadArray = new NachOSThread*[newSize];
+    bool *newExitThreadArray = new bool[newSize];
+    int *newPIDRefs = new int[newSize];
+
+    ASSERT(numFreePIDs == 0);
+    DEBUG('t', "Growing the pid table to %d entries\n", newSize);
+    for (i=0; i<newSize; i++) {
+       if (i < pidTableSize) {
+          newThreadArray[i] = threadArray[i];
+          newExitThreadArray[i] = exitThreadArray[i];
+          newPIDRefs[i] = pidRefs[i];
+       }
+       else {
+          newThreadArray[i] = NULL;
+          newExitThreadArray[i] = false;
+          newPIDRefs[i] = 0;
+       }
+    }
+    delete [] threadArray;
+    delete [] exitThreadArray;
+    delete [] pidRefs;
+    delete [] freePIDs;
+    threadArray = newThreadArray;
+    exitThreadArray = newExitThreadArray;
+    pidRefs = newPIDRefs;
+    freePIDs = new int[newSize];
+    firstFreePID = 0;
+    pidTableSize = newSize;
+}
+
+//----------------------------------------------------------------------
+// AllocatePID
+// 	Pick a pid for a new thread, reusing a freed one if possible,
+//	and enter the thread in threadArray.
+//
+//	"thread" is the new thread.
+//	"hasParent" is TRUE if the thread has a parent, which holds a
+//		reference to the pid until it joins with the thread.
+//----------------------------------------------------------------------
+int
+AllocatePID(NachOSThread *thread, bool hasParent)
+{
+    int pid;
+
+    if (numFreePIDs > 0) {
+       pid = freePIDs[firstFreePID];
+       firstFreePID = (firstFreePID + 1) % pidTableSize;
+       numFreePIDs--;
+    }
+    else {
+       if (thread_index == pidTableSize) GrowPIDTable();
+       pid = thread_index;
+       thread_index++;
+    }
+    ASSERT(pidRefs[pid] == 0);
+    threadArray[pid] = thread;
+    exitThreadArray[pid] = false;
+    pidRefs[pid] = hasParent ? 2 : 1;
+    numLiveThreads++;
+    return pid;
+}
+
+//----------------------------------------------------------------------
+// MarkThreadExited
+// 	Note that thread "pid" has exited.  Once numLiveThreads drops
+//	to zero, all threads have exited.  Harmless if already marked.
+//----------------------------------------------------------------------
+void
+MarkThreadExited(int pid)
+{
+    if (!exitThreadArray[pid]) {
+       exitThreadArray[pid] = true;
+       numLiveThreads--;
+    }
+}
+
+//----------------------------------------------------------------------
+// ReleasePID
+// 	Drop one reference to "pid"; the last one puts the pid on the
+//	free queue.
+//----------------------------------------------------------------------
+void
+ReleasePID(int pid)
+{
+    ASSERT(pidRefs[pid] > 0);
+    pidRefs[pid]--;
+    if (pidRefs[pid] == 0) {
+       ASSERT(exitThreadArray[pid]);
+       threadArray[pid] = NULL;
+       freePIDs[(firstFreePID + numFreePIDs) % pidTableSize] = pid;
+       numFreePIDs++;
     }
 }
 
@@ -120,6 +281,9 @@ Initialize(int argc, char **argv)
     numPagesAllocated = 0;
 
     schedulingAlgo = NON_PREEMPTIVE_BASE;	// Default
+    numCPUs = 1;
+    currentCPU = 0;
+    csvFileName = NULL;
 
     batchProcesses = new char*[MAX_BATCH_SIZE];
     ASSERT(batchProcesses != NULL);
@@ -133,20 +297,37 @@ Initialize(int argc, char **argv)
     
     excludeMainThread = FALSE;
 
-    for (i=0; i<MAX_THREAD_COUNT; i++) { threadArray[i] = NULL; exitThreadArray[i] = false; completionTimeArray[i] = -1; }
+    threadArray = NULL;
+    exitThreadArray = NULL;
+    pidRefs = freePIDs = NULL;
+    pidTableSize = numFreePIDs = 0;
+    GrowPIDTable();
     thread_index = 0;
+    numLiveThreads = 0;
 
     sleepQueueHead = NULL;
 
 #ifdef USER_PROGRAM
     bool debugUserProg = FALSE;	// single step user program
+    int zswapFrames = 0;	// frames for compressed pages
+    int wsWindow = 0;		// working-set window, 0 for the default
+    int rssQuota = 0;		// frames a process may have, 0 for any
+    bool localRepl = FALSE;	// replace only the faulting process's pages
+    bool loadControl = FALSE;	// suspend processes to stop thrashing
 #endif
 #ifdef FILESYS_NEEDED
     bool format = FALSE;	// format disk
 #endif
+#ifdef FILESYS
+    diskSchedAlgo = DISK_FCFS;	// Default
+    diskIOMode = DISK_IO_FILE;
+#endif
 #ifdef NETWORK
     double rely = 1;		// network reliability
     int netname = 0;		// UNIX socket name
+    int fabricNodes = 0;	// machines in this process, if more than one
+    char *linkFile = NULL;	// latency, bandwidth and loss of their links
+    int swapServer = -1;	// machine to page to, if not local swap
 #endif
     
     for (argc--, argv++; argc > 0; argc -= argCount, argv += argCount) {
@@ -164,15 +345,61 @@ Initialize(int argc, char **argv)
 						// number generator
 	    randomYield = TRUE;
 	    argCount = 2;
+	} else if (!strcmp(*argv, "-cpus")) {
+	    ASSERT(argc > 1);
+	    numCPUs = atoi(*(argv + 1));	// simulated multiprocessor
+	    ASSERT((numCPUs > 0) && (numCPUs <= MAX_CPUS));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-csv")) {
+	    ASSERT(argc > 1);
+	    csvFileName = *(argv + 1);		// statistics for bin/sweep
+	    argCount = 2;
 	}
 #ifdef USER_PROGRAM
 	if (!strcmp(*argv, "-s"))
 	    debugUserProg = TRUE;
+	else if (!strcmp(*argv, "-M")) {
+	    ASSERT(argc > 1);
+	    numPhysPages = atoi(*(argv + 1));	// physical memory size, in frames
+	    ASSERT(numPhysPages > 0);
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-zswap")) {
+	    ASSERT(argc > 1);
+	    zswapFrames = atoi(*(argv + 1));	// compressed page cache size
+	    ASSERT(zswapFrames >= 0);
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-ws")) {
+	    ASSERT(argc > 1);
+	    wsWindow = atoi(*(argv + 1));	// working-set window, in ticks
+	    ASSERT(wsWindow > 0);
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-rss")) {
+	    ASSERT(argc > 1);
+	    rssQuota = atoi(*(argv + 1));	// resident-set limit, in frames
+	    ASSERT(rssQuota > 0);
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-local"))
+	    localRepl = TRUE;
+	else if (!strcmp(*argv, "-lc"))
+	    loadControl = TRUE;
 #endif
 #ifdef FILESYS_NEEDED
 	if (!strcmp(*argv, "-f"))
 	    format = TRUE;
 #endif
+#ifdef FILESYS
+	if (!strcmp(*argv, "-ds")) {
+	    ASSERT(argc > 1);
+	    diskSchedAlgo = atoi(*(argv + 1));	// disk request order
+	    ASSERT((diskSchedAlgo >= DISK_FCFS) && (diskSchedAlgo <= DISK_CLOOK));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-dio")) {
+	    ASSERT(argc > 1);
+	    diskIOMode = atoi(*(argv + 1));	// mmap the disk file?
+	    ASSERT((diskIOMode >= DISK_IO_FILE) && (diskIOMode <= DISK_IO_MAP_SYNC));
+	    argCount = 2;
+	}
+#endif
 #ifdef NETWORK
 	if (!strcmp(*argv, "-l")) {
 	    ASSERT(argc > 1);
@@ -182,18 +409,39 @@ Initialize(int argc, char **argv)
 	    ASSERT(argc > 1);
 	    netname = atoi(*(argv + 1));
 	    argCount = 2;
+	} else if (!strcmp(*argv, "-fabric")) {
+	    ASSERT(argc > 1);
+	    fabricNodes = atoi(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-links")) {
+	    ASSERT(argc > 1);
+	    linkFile = *(argv + 1);
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-rswap")) {
+	    ASSERT(argc > 1);
+	    swapServer = atoi(*(argv + 1));
+	    argCount = 2;
 	}
 #endif
     }
 
     DebugInit(debugArgs);			// initialize DEBUG messages
     stats = new Statistics();			// collect statistics
+    stats->numCPUs = numCPUs;
     interrupt = new Interrupt;			// start up interrupt handling
     scheduler = new ProcessScheduler();		// initialize the ready queue
     //if (randomYield)				// start the timer (if needed)
        timer = new Timer(TimerInterruptHandler, 0, randomYield);
 
     threadToBeDestroyed = NULL;
+    threadPool = new BufferPool("thread", THREAD_POOL_SIZE, FALSE,
+				&stats->threadAllocs, &stats->threadReuses);
+    stackPool = new BufferPool("stack", STACK_POOL_SIZE, TRUE,
+				&stats->stackAllocs, &stats->stackReuses);
+#ifdef USER_PROGRAM
+    spacePool = new BufferPool("address space", SPACE_POOL_SIZE, FALSE,
+				&stats->spaceAllocs, &stats->spaceReuses);
+#endif
 
     // We didn't explicitly allocate the current thread we are running in.
     // But if it ever tries to give up the CPU, we better have a NachOSThread
@@ -201,8 +449,10 @@ Initialize(int argc, char **argv)
     currentThread = NULL;
     currentThread = new NachOSThread("main", MIN_NICE_PRIORITY);		
     currentThread->setStatus(RUNNING);
+    currentThread->SetCPU(currentCPU);
     stats->start_time = stats->totalTicks;
     cpu_burst_start_time = stats->totalTicks;
+    last_boost_time = stats->totalTicks;
     replAlgo = 0;
     pagesAllocated = 0;
     FIFOQueue = new List;
@@ -211,10 +461,31 @@ Initialize(int argc, char **argv)
     
 #ifdef USER_PROGRAM
     machine = new Machine(debugUserProg);	// this must come first
+    pageMerger = NULL;			// see -ksm, in main.cc
+    zswap = NULL;
+    if (zswapFrames > 0) {		// the cache takes the frames at the
+	ASSERT(zswapFrames < numPhysPages);	// top of memory
+	numPhysPages -= zswapFrames;
+	zswap = new ZSwap(&machine->mainMemory[numPhysPages * PageSize],
+				zswapFrames);
+    }
+    workingSets = NULL;
+    if ((wsWindow > 0) || (rssQuota > 0) || localRepl || loadControl)
+	workingSets = new WorkingSets((wsWindow > 0) ? wsWindow
+				: WSDefaultWindow, rssQuota, localRepl,
+				loadControl);
+    sharedCode = new SharedCode();
+    semTable = new SynchTable(MAX_USER_SEMAPHORES);
+    condTable = new SynchTable(MAX_USER_CONDITIONS);
+    futexTable = new SynchTable(MAX_FUTEX_QUEUES);
 #endif
 
 #ifdef FILESYS
-    synchDisk = new SynchDisk("DISK");
+    synchDisk = new SynchDisk("DISK", diskSchedAlgo, diskIOMode);
+    sectorCache = new SectorCache();
+    journal = new Journal();		// the file system formats or
+					// recovers it
+    last_flush_time = stats->totalTicks;
 #endif
 
 #ifdef FILESYS_NEEDED
@@ -222,7 +493,29 @@ Initialize(int argc, char **argv)
 #endif
 
 #ifdef NETWORK
-    postOffice = new PostOffice(netname, rely, 10);
+    mailPool = new BufferPool("mail", MAIL_POOL_SIZE, FALSE,
+				&stats->mailAllocs, &stats->mailReuses);
+    fabric = NULL;
+    postOffices = NULL;
+    if (fabricNodes > 0) {		// all the machines live here
+	ASSERT(netname < fabricNodes);
+	fabric = new Fabric(fabricNodes, rely);
+	if (linkFile != NULL)
+	    fabric->ReadLinks(linkFile);
+	postOffices = new PostOffice*[fabricNodes];
+	for (i = 0; i < fabricNodes; i++)
+	    postOffices[i] = new PostOffice(i, rely, 10);
+	postOffice = postOffices[netname];
+    } else
+	postOffice = new PostOffice(netname, rely, 10);
+
+    remoteSwap = NULL;
+    if (swapServer >= 0) {
+	ASSERT(swapServer != netname);
+	if (fabric != NULL)		// the server is one of our machines
+	    new MemoryServer(postOffices[swapServer], netname);
+	remoteSwap = new RemoteSwap(postOffice, swapServer);
+    }
 #endif
 }
 
@@ -235,10 +528,19 @@ Cleanup()
 {
     printf("\nCleaning up...\n");
 #ifdef NETWORK
-    delete postOffice;
+    if (fabric != NULL) {
+	for (int i = 0; i < fabric->NumNodes(); i++)
+	    delete postOffices[i];
+	delete [] postOffices;
+	delete fabric;
+    } else
+	delete postOffice;
 #endif
     
 #ifdef USER_PROGRAM
+    delete zswap;
+    delete pageMerger;
+    delete workingSets;
     delete machine;
 #endif
 
@@ -247,6 +549,8 @@ Cleanup()
 #endif
 
 #ifdef FILESYS
+    delete journal;
+    delete sectorCache;
     delete synchDisk;
 #endif
     
@@ -15,18 +15,34 @@
 #include "interrupt.h"
 #include "stats.h"
 #include "timer.h"
+#include "pool.h"
 
-#define MAX_THREAD_COUNT 1000
+#define INITIAL_THREAD_COUNT 64		// Initial size of the pid table, which
+						// doubles whenever it fills up
 #define MAX_BATCH_SIZE 100
 
+#define THREAD_POOL_SIZE	16		// Freed thread control blocks kept for reuse
+#define STACK_POOL_SIZE		16		// Freed thread stacks kept for reuse
+#define SPACE_POOL_SIZE		64		// Freed address space buffers kept for reuse
+#define MAIL_POOL_SIZE		64		// Freed network messages kept for reuse
+
 // Scheduling algorithms
 #define NON_PREEMPTIVE_BASE 	1
 #define NON_PREEMPTIVE_SJF 	2
 #define ROUND_ROBIN 		3
 #define UNIX_SCHED		4
+#define MLFQ_SCHED		5		// Multilevel feedback queue with periodic priority boost
+#define STRIDE_SCHED		6		// Stride scheduling (deterministic proportional share)
+#define MAX_SCHED_ALGO		STRIDE_SCHED
 
 #define SCHED_QUANTUM		100		// If not a multiple of timer interval, quantum will overshoot
 
+#define MLFQ_LEVELS		3		// Number of MLFQ priority levels (0 is the highest)
+#define MLFQ_QUANTUM(level)	(SCHED_QUANTUM << (level))	// Quantum doubles at every lower level
+#define MLFQ_BOOST_PERIOD	5000		// Ticks between two priority boosts
+
+#define STRIDE_LARGE		10000		// Stride of a thread with a single ticket
+
 #define INITIAL_TAU		SystemTick	// Initial guess of the burst is set to the overhead of system activity
 #define ALPHA			0.5
 
@@ -48,27 +64,38 @@ extern void Initialize(int argc, char **argv); 	// Initialization,
 extern void Cleanup();				// Cleanup, called when
 						// Nachos is done.
 
+extern int AllocatePID(NachOSThread *thread, bool hasParent);
+						// Pick a pid for a new thread
+extern void MarkThreadExited(int pid);		// Called when a thread exits
+extern void ReleasePID(int pid);		// Drop a reference to a pid
+
 extern NachOSThread *currentThread;			// the thread holding the CPU
 extern NachOSThread *threadToBeDestroyed;  		// the thread that just finished
 extern ProcessScheduler *scheduler;			// the ready list
 extern Interrupt *interrupt;			// interrupt status
 extern Statistics *stats;			// performance metrics
 extern Timer *timer;				// the hardware alarm clock
+extern BufferPool *threadPool;			// recycled thread control blocks
+extern BufferPool *stackPool;			// recycled thread stacks
 extern unsigned numPagesAllocated;		// number of physical frames allocated
 extern int replAlgo;
 extern int LRU_Clock_ptr;
 extern List *FIFOQueue;
-extern NachOSThread *threadArray[];  // Array of thread pointers
-extern unsigned thread_index;                  // Index into this array (also used to assign unique pid)
+extern NachOSThread **threadArray;  // Array of thread pointers, indexed by pid
+extern unsigned thread_index;                  // Number of pids ever handed out (threadArray entries in use)
+extern unsigned numLiveThreads;		// Threads that have not exited yet
 extern bool initializedConsoleSemaphores;	// Used to initialize the semaphores for console I/O exactly once
-extern bool exitThreadArray[];		// Marks exited threads
+extern bool *exitThreadArray;		// Marks exited threads (and free pids)
 
 extern int schedulingAlgo;		// Scheduling algorithm to simulate
+extern char *csvFileName;		// Where to write the statistics (-csv)
+extern int numCPUs;			// Number of simulated CPUs
+extern int currentCPU;			// CPU being simulated right now
 extern char **batchProcesses;		// Names of batch executables
 extern int *priority;			// Process priority
 
 extern int cpu_burst_start_time;	// Records the start of current CPU burst
-extern int completionTimeArray[];	// Records the completion time of all simulated threads
+extern int last_boost_time;		// Records the last MLFQ priority boost
 extern bool excludeMainThread;		// Used by completion time statistics calculation
 
 class TimeSortedWaitQueue {		// Needed to implement syscall_wrapper_Sleep
@@ -92,6 +119,29 @@ extern TimeSortedWaitQueue *sleepQueueHead;
 #ifdef USER_PROGRAM
 #include "machine.h"
 extern Machine* machine;	// user program memory and registers
+extern BufferPool *spacePool;	// recycled address spaces, page tables
+				// and backup arrays
+extern SharedCode *sharedCode;	// frames holding code pages shared
+				// between processes
+
+#include "zswap.h"
+extern ZSwap *zswap;		// compressed evicted pages, NULL if
+				// they go straight to the backup store
+
+#include "pagemerge.h"
+extern PageMerger *pageMerger;	// the zero frame and merged frames, NULL
+				// unless -ksm
+
+#include "workingset.h"
+extern WorkingSets *workingSets;	// working sets and resident-set
+				// limits, NULL unless -ws, -rss, -local
+				// or -lc
+
+#include "usersynch.h"
+extern SynchTable *semTable;	// semaphores of user programs
+extern SynchTable *condTable;	// condition variables of user programs
+extern SynchTable *futexTable;	// wait queues of WaitOnAddress, by
+				// physical address
 #endif
 
 #ifdef FILESYS_NEEDED 		// FILESYS or FILESYS_STUB 
@@ -102,11 +152,29 @@ extern FileSystem  *fileSystem;
 #ifdef FILESYS
 #include "synchdisk.h"
 extern SynchDisk   *synchDisk;
+extern int diskSchedAlgo;		// Disk scheduling policy (-ds)
+extern int diskIOMode;			// How the disk file is accessed (-dio)
+
+#include "sectorcache.h"
+extern SectorCache *sectorCache;	// Disk sectors cached in memory
+
+#include "journal.h"
+extern Journal *journal;		// Makes metadata updates atomic
 #endif
 
 #ifdef NETWORK
 #include "post.h"
 extern PostOffice* postOffice;
+extern BufferPool *mailPool;		// recycled network messages
+
+#include "fabric.h"
+extern Fabric *fabric;			// Joins the machines in this process,
+					// NULL if there is only one (-fabric)
+extern PostOffice **postOffices;	// Post office of each of them
+
+#include "remoteswap.h"
+extern RemoteSwap *remoteSwap;		// Pages to a memory server, NULL if
+					// paging locally (-rswap)
 #endif
 
 #endif // SYSTEM_H
@@ -37,8 +37,7 @@ NachOSThread::NachOSThread(char* threadName, int nice)
 {
     int i;
 
-    name = new char[1024];
-    sprintf(name,"%s",threadName);
+    snprintf(name, ThreadNameSize, "%s", threadName);
     stackTop = NULL;
     stack = NULL;
     status = JUST_CREATED;
@@ -47,11 +46,8 @@ NachOSThread::NachOSThread(char* threadName, int nice)
     stateRestored = true;
 #endif
 
-    threadArray[thread_index] = this;
-    pid = thread_index;
-    thread_index++;
-    stats->numTotalThreads = thread_index;
-    ASSERT(thread_index < MAX_THREAD_COUNT);
+    pid = AllocatePID(this, currentThread != NULL);
+    stats->numTotalThreads++;
     if (currentThread != NULL) {
        ppid = currentThread->GetPID();
        currentThread->RegisterNewChild (pid);
@@ -64,6 +60,7 @@ NachOSThread::NachOSThread(char* threadName, int nice)
     for (i=0; i<MAX_CHILD_COUNT; i++) exitedChild[i] = false;
 
     instructionCount = 0;
+    cpu = -1;
 
     if (nice == GET_NICE_FROM_PARENT) {
        if (ppid != -1) {
@@ -80,6 +77,8 @@ NachOSThread::NachOSThread(char* threadName, int nice)
     usage = 0;
 
     if (schedulingAlgo == NON_PREEMPTIVE_SJF) schedPriority = INITIAL_TAU;
+    else if (schedulingAlgo == MLFQ_SCHED) schedPriority = 0;		// Start at the top level
+    else if (schedulingAlgo == STRIDE_SCHED) schedPriority = scheduler->GetMinPass();
 }
 
 //----------------------------------------------------------------------
@@ -103,7 +102,41 @@ NachOSThread::~NachOSThread()
 
     ASSERT(this != currentThread);
     if (stack != NULL)
-	DeallocBoundedArray((char *) stack, StackSize * sizeof(int));
+	stackPool->Put((char *) stack, StackSize * sizeof(int));
+
+    // Our control block is about to be handed to some other thread,
+    // so nobody must find us through threadArray any more
+    threadArray[pid] = NULL;
+    MarkThreadExited(pid);
+    ReleasePID(pid);
+
+    // Children we have not joined with are on their own now
+    for (unsigned i=0; i<childcount; i++) {
+       if (threadArray[childpidArray[i]] != NULL) {
+          threadArray[childpidArray[i]]->ppid = -1;
+       }
+       ReleasePID(childpidArray[i]);
+    }
+}
+
+//----------------------------------------------------------------------
+// NachOSThread::operator new
+// NachOSThread::operator delete
+// 	Thread control blocks come from threadPool, so that a thread 
+//	created after another one has been destroyed reuses its block
+//	instead of going to the heap.
+//----------------------------------------------------------------------
+
+void *
+NachOSThread::operator new(size_t size)
+{
+    return threadPool->Get(size);
+}
+
+void
+NachOSThread::operator delete(void *ptr, size_t size)
+{
+    threadPool->Put((char *) ptr, size);
 }
 
 //----------------------------------------------------------------------
@@ -260,10 +293,12 @@ NachOSThread::Exit (bool terminateSim, int exitcode)
              stats->burstEstimateError += abs(stats->totalTicks - cpu_burst_start_time - schedPriority);
              schedPriority = (int)(ALPHA*(stats->totalTicks - cpu_burst_start_time) + (1-ALPHA)*schedPriority);
           }
+          else if ((schedulingAlgo == MLFQ_SCHED) || (schedulingAlgo == STRIDE_SCHED)) {
+             scheduler->ChargeBurst(this, stats->totalTicks - cpu_burst_start_time);
+          }
        }
     }
     status = BLOCKED;
-    completionTimeArray[currentThread->GetPID()] = stats->totalTicks;
 
     // Set exit code in parent's structure provided the parent hasn't exited
     if (ppid != -1) {
@@ -284,7 +319,9 @@ NachOSThread::Exit (bool terminateSim, int exitcode)
           printf("Assuming all programs completed.\n");
           interrupt->Halt();
        }
-       else interrupt->Idle();      // no one to run, wait for an interrupt
+       else if (!scheduler->IdleCPU()) {	// let the other CPUs go on, or
+          interrupt->Idle();      // no one to run, wait for an interrupt
+       }
        nextThread = scheduler->SelectNextReadyThread();
     }
     /*TranslationEntry *delPage = space->GetPageTable();
@@ -332,17 +369,17 @@ NachOSThread::YieldCPU ()
     
     DEBUG('t', "Yielding thread \"%s\"\n", getName());
     
-    if (schedulingAlgo == UNIX_SCHED) {
+    if (scheduler->RequeueBeforeSelect()) {
        scheduler->MoveThreadToReadyQueue(this);
     }
     nextThread = scheduler->SelectNextReadyThread();
     if (nextThread != NULL) {
-        if (schedulingAlgo != UNIX_SCHED) {
+        if (!scheduler->RequeueBeforeSelect()) {
 	   scheduler->MoveThreadToReadyQueue(this);
         }
 	scheduler->ScheduleThread(nextThread);
     }
-    else if (schedulingAlgo != UNIX_SCHED) {
+    else if (!scheduler->RequeueBeforeSelect()) {
        stats->cpu_time += (stats->totalTicks - cpu_burst_start_time);
        if ((stats->totalTicks - cpu_burst_start_time) > 0) {
           stats->cpu_burst_count++;
@@ -408,6 +445,9 @@ NachOSThread::PutThreadToSleep ()
              stats->burstEstimateError += abs(stats->totalTicks - cpu_burst_start_time - schedPriority);
              schedPriority = (int)(ALPHA*(stats->totalTicks - cpu_burst_start_time) + (1-ALPHA)*schedPriority);
           }
+          else if ((schedulingAlgo == MLFQ_SCHED) || (schedulingAlgo == STRIDE_SCHED)) {
+             scheduler->ChargeBurst(this, stats->totalTicks - cpu_burst_start_time);
+          }
        }
     }
     status = BLOCKED;
@@ -416,6 +456,9 @@ NachOSThread::PutThreadToSleep ()
        scheduler->SetEmptyReadyQueueStartTime (stats->totalTicks);
     }
     while (nextThread == NULL) {
+        if (scheduler->IdleCPU()) {	// other CPUs ran until someone
+           return;			// woke us up and dispatched us
+        }
 	interrupt->Idle();	// no one to run, wait for an interrupt
         nextThread = scheduler->SelectNextReadyThread();
     }
@@ -450,7 +493,7 @@ void ThreadPrint(int arg){ NachOSThread *t = (NachOSThread *)arg; t->Print(); }
 void
 NachOSThread::CreateThreadStack (VoidFunctionPtr func, int arg)
 {
-    stack = (int *) AllocBoundedArray(StackSize * sizeof(int));
+    stack = (int *) stackPool->Get(StackSize * sizeof(int));
 
 #ifdef HOST_SNAKE
     // HP stack works from low addresses to high addresses
@@ -517,6 +560,7 @@ NachOSThread::RestoreUserState()
 {
     for (int i = 0; i < NumTotalRegs; i++)
 	machine->WriteRegister(i, userRegisters[i]);
+    machine->linked = FALSE;		// someone else may have run since our LL
     stateRestored = true;
 }
 #endif
@@ -544,12 +588,15 @@ NachOSThread::CheckIfChild (int childpid)
 //----------------------------------------------------------------------
 // NachOSThread::JoinWithChild
 //      Called by a thread as a result of syscall_wrapper_Join.
-//      Returns the exit code of the child being joined with.
+//      Returns the exit code of the child being joined with, and
+//      forgets the child, whose pid may then be reused.
 //----------------------------------------------------------------------
 
 int
 NachOSThread::JoinWithChild (int whichchild)
 {
+   int exitcode;
+
    // Has the child exited?
    if (!exitedChild[whichchild]) {
       // Put myself to sleep
@@ -560,7 +607,15 @@ NachOSThread::JoinWithChild (int whichchild)
       printf("[pid %d] After sleep in JoinWithChild.\n", pid);
       (void) interrupt->SetLevel(oldLevel);
    }
-   return childexitcode[whichchild];
+   exitcode = childexitcode[whichchild];
+
+   // The child is gone for good; let its pid be reused
+   ReleasePID(childpidArray[whichchild]);
+   childcount--;
+   childpidArray[whichchild] = childpidArray[childcount];
+   childexitcode[whichchild] = childexitcode[childcount];
+   exitedChild[whichchild] = exitedChild[childcount];
+   return exitcode;
 }
 
 #ifdef USER_PROGRAM
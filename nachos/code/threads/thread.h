@@ -57,6 +57,9 @@
 // WATCH OUT IF THIS ISN'T BIG ENOUGH!!!!!
 #define StackSize	(4 * 1024)	// in words
 
+// Size of the buffer holding the thread's name
+#define ThreadNameSize	1024
+
 
 // NachOSThread state
 enum ThreadStatus { JUST_CREATED, RUNNING, READY, BLOCKED };
@@ -89,6 +92,11 @@ class NachOSThread {
 					// must not be running when delete 
 					// is called
 
+    static void *operator new(size_t size);	// thread control blocks
+    static void operator delete(void *ptr, size_t size);
+						// are recycled through
+						// threadPool
+
     // basic thread operations
 
     void ThreadFork(VoidFunctionPtr func, int arg); 	// Make thread run (*func)(arg)
@@ -122,7 +130,7 @@ class NachOSThread {
 
     int JoinWithChild (int whichchild);			// Called by SysCall_Join
 
-    void RegisterNewChild (int childpid) { childpidArray[childcount] = childpid; childcount++; ASSERT(childcount < MAX_CHILD_COUNT); }
+    void RegisterNewChild (int childpid) { ASSERT(childcount < MAX_CHILD_COUNT); childpidArray[childcount] = childpid; exitedChild[childcount] = false; childcount++; }
 
     void ResetReturnValue ();				// Used by SysCall_Fork to set the return value of child to zero
     void Schedule ();					// Called by SysCall_Fork to enqueue the newly created child thread in the ready queue
@@ -152,6 +160,9 @@ class NachOSThread {
     void SetUsage (int usage);
     int GetUsage (void);
 
+    void SetCPU (int c) { cpu = c; }
+    int GetCPU (void) { return cpu; }
+
   private:
     // some of the private data for this class is listed above
     
@@ -160,7 +171,7 @@ class NachOSThread {
 					// (If NULL, don't deallocate stack)
     ThreadStatus status;		// ready, running or blocked
     
-    char* name;
+    char name[ThreadNameSize];
 
     int pid, ppid;			// My pid and my parent's pid
 
@@ -179,6 +190,9 @@ class NachOSThread {
 
     unsigned instructionCount;          // Keeps track of the instruction count executed by this thread
 
+    int cpu;				// CPU this thread last ran on, whose
+					// ready list it joins (-1 if none yet)
+
 #ifdef USER_PROGRAM
 // A thread running a user program actually has *two* sets of CPU registers -- 
 // one for its state while executing user code, one for its state 
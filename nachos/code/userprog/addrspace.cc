@@ -11,6 +11,26 @@
 //		(if you haven't implemented the file system yet, you
 //		don't need to do this last step)
 //
+//	Pages are loaded when they are first touched.  With the paged
+//	NOFF layout (coff2noff -p), each page is loaded by itself: code
+//	pages are read-only, and shared by every process running the
+//	program; data pages are read from the file, and only go to the
+//	swap area once they have been written to; the other pages are
+//	filled with zeros, without reading anything.  A page that has not
+//	been written to is simply dropped when its frame is replaced.
+//
+//	With -zswap, evicted pages go to a cache of compressed pages
+//	first (see zswap.h), and only reach the backup store when the
+//	cache needs the room.
+//
+//	With -ksm, pages that hold only zeros are mapped to one read-only
+//	frame, and pages with the same contents share a frame, until they
+//	are written to (see pagemerge.h).
+//
+//	With -ws, -rss, -local or -lc, the working set of each process is
+//	estimated, and can limit the frames it has, and the pages it can
+//	replace (see workingset.h).
+//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
@@ -69,7 +89,7 @@ ProcessAddressSpace::ProcessAddressSpace(OpenFile *executable, char* f, int pd)
     TranslationEntry *entry;
     unsigned int pageFrame;
     cpid = pd;
-    filename = new char[1024];
+    filename = spacePool->Get(1024);
     for (int i = 0; i < 1024; ++i)
     {
         filename[i] = f[i];
@@ -77,12 +97,28 @@ ProcessAddressSpace::ProcessAddressSpace(OpenFile *executable, char* f, int pd)
             break;        
     }
     executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
-    if ((noffH.noffMagic != NOFFMAGIC) && 
-		(WordToHost(noffH.noffMagic) == NOFFMAGIC))
+    if ((noffH.noffMagic != NOFFMAGIC) && (noffH.noffMagic != NOFFPAGEDMAGIC)
+		&& ((WordToHost(noffH.noffMagic) == NOFFMAGIC)
+		    || (WordToHost(noffH.noffMagic) == NOFFPAGEDMAGIC)))
     	SwapHeader(&noffH);
-    ASSERT(noffH.noffMagic == NOFFMAGIC);
+    ASSERT((noffH.noffMagic == NOFFMAGIC) 
+		|| (noffH.noffMagic == NOFFPAGEDMAGIC));
+    pagedLayout = (noffH.noffMagic == NOFFPAGEDMAGIC);
+    ASSERT(!pagedLayout || (PageSize == NOFFPAGESIZE));
 
 // how big is address space?
+    if (pagedLayout) {			// the segments may have gaps
+	size = noffH.code.virtualAddr + noffH.code.size;
+	if ((noffH.initData.size > 0) && 
+		((unsigned) (noffH.initData.virtualAddr + noffH.initData.size)
+								> size))
+	    size = noffH.initData.virtualAddr + noffH.initData.size;
+	if ((noffH.uninitData.size > 0) && 
+		((unsigned) (noffH.uninitData.virtualAddr 
+					+ noffH.uninitData.size) > size))
+	    size = noffH.uninitData.virtualAddr + noffH.uninitData.size;
+	size += UserStackSize;
+    } else
     size = noffH.code.size + noffH.initData.size + noffH.uninitData.size 
 			+ UserStackSize;	// we need to increase the size
 						// to leave room for the stack
@@ -96,9 +132,10 @@ ProcessAddressSpace::ProcessAddressSpace(OpenFile *executable, char* f, int pd)
 
     DEBUG('a', "Initializing address space, num pages %d, size %d\n", 
 					numVirtualPages, size);
-    backupArray = new char[size];
+    backupArray = spacePool->Get(size);
+    backupSize = size;
 // first, set up the translation 
-    KernelPageTable = new TranslationEntry[numVirtualPages];
+    KernelPageTable = (TranslationEntry *) spacePool->Get(numVirtualPages * sizeof(TranslationEntry));
     bzero(backupArray, size);
     for (i = 0; i < numVirtualPages; i++) {
    KernelPageTable[i].virtualPage = i;
@@ -106,12 +143,17 @@ ProcessAddressSpace::ProcessAddressSpace(OpenFile *executable, char* f, int pd)
 	KernelPageTable[i].valid = FALSE;
 	KernelPageTable[i].use = FALSE;
 	KernelPageTable[i].dirty = FALSE;
-	KernelPageTable[i].readOnly = FALSE;  // if the code segment was entirely on 
-					// a separate page, we could set its 
-					// pages to be read-only
+	KernelPageTable[i].readOnly = IsCodePage(i);  // only the paged
+					// layout has the code segment entirely
+					// on separate pages
     KernelPageTable[i].shared = FALSE;
     KernelPageTable[i].loadFromSwap = FALSE;
+    KernelPageTable[i].zeroFilled = FALSE;
+    KernelPageTable[i].lastUse = -1;
     }
+    workingSet = 0;
+    suspendPending = FALSE;
+    suspendedAt = -1;
 // zero out the entire address space, to zero the unitialized data segment 
 // and the stack segment
     //bzero(&machine->mainMemory[numPagesAllocated*PageSize], size);
@@ -153,7 +195,16 @@ ProcessAddressSpace::ProcessAddressSpace(ProcessAddressSpace *parentSpace, int p
 {
     numVirtualPages = parentSpace->GetNumPages();
     unsigned i, size = numVirtualPages * PageSize;
+    bool fromFile, zeroMapped, copied;
     cpid = pd;
+    pagedLayout = parentSpace->pagedLayout;
+    workingSet = parentSpace->workingSet;
+    suspendPending = FALSE;
+    suspendedAt = -1;
+#ifdef NETWORK
+    if (remoteSwap != NULL)		// before any of our pages can be 
+        remoteSwap->Copy(parentSpace->cpid, cpid);	// evicted
+#endif
 
     //ASSERT(numVirtualPages+numPagesAllocated <= NumPhysPages);                // check we're not trying
                                                                                 // to run anything too big --
@@ -164,8 +215,8 @@ ProcessAddressSpace::ProcessAddressSpace(ProcessAddressSpace *parentSpace, int p
                                         numVirtualPages, size);
     // first, set up the translation
     TranslationEntry* parentPageTable = parentSpace->GetPageTable();
-    KernelPageTable = new TranslationEntry[numVirtualPages];
-    filename = new char[1024];
+    KernelPageTable = (TranslationEntry *) spacePool->Get(numVirtualPages * sizeof(TranslationEntry));
+    filename = spacePool->Get(1024);
     noffH = parentSpace->noffH;
     for (int i = 0; i < 1024; ++i)
     {
@@ -176,11 +227,20 @@ ProcessAddressSpace::ProcessAddressSpace(ProcessAddressSpace *parentSpace, int p
     int pagesAssigned = 0;
 
     for (i = 0; i < numVirtualPages; i++) {
+        // With the paged layout, the child maps the parent's code frames
+        // (below), and reads the pages that have not been written to from
+        // the file, like the parent did, instead of copying them
+        fromFile = pagedLayout && parentPageTable[i].valid
+                && !parentPageTable[i].shared && !parentPageTable[i].dirty
+                && !parentPageTable[i].loadFromSwap;
+        // Pages mapped to the zero frame stay mapped to it
+        zeroMapped = (pageMerger != NULL) && parentPageTable[i].valid
+                && (parentPageTable[i].physicalPage == pageMerger->ZeroFrame());
         KernelPageTable[i].virtualPage = i;
         if (parentPageTable[i].shared) {
             KernelPageTable[i].physicalPage = parentPageTable[i].physicalPage;
         } else {
-            if (parentPageTable[i].valid == TRUE){
+            if (parentPageTable[i].valid == TRUE && !fromFile && !zeroMapped){
                 if(!replAlgo){
                     KernelPageTable[i].physicalPage = numPagesAllocated + pagesAssigned;
                     pagesAssigned += 1;
@@ -206,8 +266,9 @@ ProcessAddressSpace::ProcessAddressSpace(ProcessAddressSpace *parentSpace, int p
         KernelPageTable[i].shared = parentPageTable[i].shared;
         KernelPageTable[i].loadFromSwap = parentPageTable[i].loadFromSwap;*/
     }
-    backupArray = new char[size];
-    memcpy(backupArray, parentSpace->backupArray, size); // Copy parent swap to child
+    backupSize = parentSpace->backupSize;
+    backupArray = spacePool->Get(backupSize);
+    memcpy(backupArray, parentSpace->backupArray, backupSize); // Copy parent swap to child
 
     // Copy the contents
     // unsigned startAddrParent = parentPageTable[0].physicalPage*PageSize;
@@ -219,8 +280,16 @@ ProcessAddressSpace::ProcessAddressSpace(ProcessAddressSpace *parentSpace, int p
     int j;
     for (i = 0; i < numVirtualPages; i++)
     {
-        if (parentPageTable[i].shared == FALSE && parentPageTable[i].valid == TRUE)
+        fromFile = pagedLayout && parentPageTable[i].valid
+                && !parentPageTable[i].shared && !parentPageTable[i].dirty
+                && !parentPageTable[i].loadFromSwap;
+        zeroMapped = (pageMerger != NULL) && parentPageTable[i].valid
+                && (parentPageTable[i].physicalPage == pageMerger->ZeroFrame());
+        copied = FALSE;
+        if (parentPageTable[i].shared == FALSE && parentPageTable[i].valid == TRUE
+                && !fromFile && !zeroMapped)
         {
+            copied = TRUE;
             if(KernelPageTable[i].physicalPage == -1){ // If not allocated, then allocate a PPFN for the page
                 //KernelPageTable[i].valid = parentPageTable[i].valid;
                 KernelPageTable[i].physicalPage = GetPhysicalPage(i, parentPageTable[i].physicalPage);
@@ -233,14 +302,39 @@ ProcessAddressSpace::ProcessAddressSpace(ProcessAddressSpace *parentSpace, int p
         KernelPageTable[i].valid = parentPageTable[i].valid;
         KernelPageTable[i].use = parentPageTable[i].use;
         KernelPageTable[i].dirty = parentPageTable[i].dirty;
-        KernelPageTable[i].readOnly = parentPageTable[i].readOnly;  	// if the code segment was entirely on
-                                        			// a separate page, we could set its
-                                        			// pages to be read-only
+        KernelPageTable[i].readOnly = parentPageTable[i].readOnly && !copied;
+                                        // a page of a merged frame is read-only
+                                        // in the parent, but our copy is our own
         KernelPageTable[i].shared = parentPageTable[i].shared;
         KernelPageTable[i].loadFromSwap = parentPageTable[i].loadFromSwap;
+        KernelPageTable[i].zeroFilled = parentPageTable[i].zeroFilled;
+        KernelPageTable[i].lastUse = parentPageTable[i].lastUse;
+        if (zeroMapped && !fromFile)
+            KernelPageTable[i].physicalPage = pageMerger->ZeroFrame();
+        if (fromFile) {
+            KernelPageTable[i].physicalPage = -1;
+            KernelPageTable[i].valid = FALSE;
+            KernelPageTable[i].use = FALSE;
+        }
+    }
 
+    // Only now map the code frames the parent still has: we are not in
+    // threadArray yet, so if GetPhysicalPage above had replaced one we
+    // had mapped, we would not have been told
+    for (i = 0; i < numVirtualPages; i++) {
+        if (pagedLayout && parentPageTable[i].valid
+                && sharedCode->Holds(parentPageTable[i].physicalPage)) {
+            KernelPageTable[i].physicalPage = parentPageTable[i].physicalPage;
+            KernelPageTable[i].valid = TRUE;
+            sharedCode->Ref(KernelPageTable[i].physicalPage);
+        }
     }
 
+    // The parent's pages in the compressed cache, including any evicted
+    // while we were copying, are not in the backup store we copied
+    if (zswap != NULL)
+        zswap->Copy(parentSpace, this);
+
     stats->totalPageFaults++;
     numPagesAllocated+=pagesAssigned;
     // TODO: Might have to do sorted insert in wait queue
@@ -255,6 +349,13 @@ ProcessAddressSpace::~ProcessAddressSpace()
 {
     for(int i = 0; i<numVirtualPages; i++){
         if(KernelPageTable[i].shared == FALSE && KernelPageTable[i].valid == TRUE){
+            if (sharedCode->Holds(KernelPageTable[i].physicalPage)
+                    && !sharedCode->Unref(KernelPageTable[i].physicalPage))
+                continue;		// other processes still run this code
+            if ((pageMerger != NULL)
+                    && pageMerger->Holds(KernelPageTable[i].physicalPage)
+                    && !pageMerger->Unref(KernelPageTable[i].physicalPage))
+                continue;		// other pages are merged with it
             machine->threadPID[KernelPageTable[i].physicalPage] = -1;
             //thPID[KernelPageTable[i].physicalPage] = -1;
             machine->threadVPN[KernelPageTable[i].physicalPage] = -1;
@@ -263,9 +364,35 @@ ProcessAddressSpace::~ProcessAddressSpace()
         }
     }
     //printf("#################################################################################lksjdfkljsdklfjsf");
-    delete filename;
-    delete KernelPageTable;
-    delete backupArray;
+    spacePool->Put(filename, 1024);
+    spacePool->Put((char *) KernelPageTable, numVirtualPages * sizeof(TranslationEntry));
+    spacePool->Put(backupArray, backupSize);
+    if (zswap != NULL)
+        zswap->Free(this);
+#ifdef NETWORK
+    if (remoteSwap != NULL)
+        remoteSwap->Free(cpid);
+#endif
+}
+
+//----------------------------------------------------------------------
+// ProcessAddressSpace::operator new
+// ProcessAddressSpace::operator delete
+// 	Address spaces come from spacePool, like their page tables and
+//	backup arrays, so that forking after an exit reuses the memory
+//	of the exited process.
+//----------------------------------------------------------------------
+
+void *
+ProcessAddressSpace::operator new(size_t size)
+{
+    return spacePool->Get(size);
+}
+
+void
+ProcessAddressSpace::operator delete(void *ptr, size_t size)
+{
+    spacePool->Put((char *) ptr, size);
 }
 
 //----------------------------------------------------------------------
@@ -341,7 +468,7 @@ unsigned
 ProcessAddressSpace::sharedMemory(int numSharedPages)
 {
     TranslationEntry* parentPageTable = GetPageTable();
-    TranslationEntry* KernelPageTable1 = new TranslationEntry[numVirtualPages+numSharedPages];
+    TranslationEntry* KernelPageTable1 = (TranslationEntry *) spacePool->Get((numVirtualPages+numSharedPages) * sizeof(TranslationEntry));
     int i;
     for (i = 0; i < numVirtualPages; i++) {
         KernelPageTable1[i].virtualPage = i;
@@ -353,6 +480,9 @@ ProcessAddressSpace::sharedMemory(int numSharedPages)
                                         			// a separate page, we could set its
                                         			// pages to be read-only
         KernelPageTable1[i].shared = parentPageTable[i].shared;
+        KernelPageTable1[i].loadFromSwap = parentPageTable[i].loadFromSwap;
+        KernelPageTable1[i].zeroFilled = parentPageTable[i].zeroFilled;
+        KernelPageTable1[i].lastUse = parentPageTable[i].lastUse;
     }
     for (i = numVirtualPages; i < numVirtualPages+numSharedPages; ++i)
     {
@@ -365,6 +495,9 @@ ProcessAddressSpace::sharedMemory(int numSharedPages)
 	    				// a separate page, we could set its 
 	    				// pages to be read-only
         KernelPageTable1[i].shared = TRUE;
+        KernelPageTable1[i].loadFromSwap = FALSE;
+        KernelPageTable1[i].zeroFilled = FALSE;
+        KernelPageTable1[i].lastUse = -1;
         machine->sharedPages[KernelPageTable[i].physicalPage] = TRUE;
         stats->totalPageFaults++;
     }
@@ -374,19 +507,28 @@ ProcessAddressSpace::sharedMemory(int numSharedPages)
     unsigned virtualAddressStarting = numVirtualPages*PageSize;
     numVirtualPages += numSharedPages;
    RestoreContextOnSwitch();
-    delete parentPageTable;
+    spacePool->Put((char *) parentPageTable, (numVirtualPages-numSharedPages) * sizeof(TranslationEntry));
     return virtualAddressStarting;
 }
 unsigned
 ProcessAddressSpace::GetPhysicalPage(unsigned vpn, int pageToIgnore)
 {
+    int frame;
+
       if(replAlgo == 0){
         printf("num alloc = %d\n", numPagesAllocated);
-        ASSERT(numPagesAllocated < NumPhysPages);
+        ASSERT(numPagesAllocated < (unsigned) NumPhysPages);
         numPagesAllocated++;
         return numPagesAllocated-1;
     }
 
+    // At our quota, we get a frame from ourselves, even if some are free
+    if (workingSets != NULL && workingSets->OverQuota(this)) {
+        frame = LocalReplacement(vpn, pageToIgnore);
+        if (frame != -1)
+            return frame;
+    }
+
     //unsigned new_page = -1;
     for(int i = 0; i<NumPhysPages; i++){
         if(machine->threadPID[i] == -1 || machine->threadVPN[i] == -1){
@@ -408,6 +550,11 @@ ProcessAddressSpace::GetPhysicalPage(unsigned vpn, int pageToIgnore)
     }
 
     DEBUG('a', "Going for page replacement\n");
+    if (workingSets != NULL && workingSets->LocalReplacement()) {
+        frame = LocalReplacement(vpn, pageToIgnore);
+        if (frame != -1)
+            return frame;
+    }
     if(replAlgo == 1){
         return RandReplacement(vpn, pageToIgnore);
     }
@@ -423,7 +570,7 @@ ProcessAddressSpace::GetPhysicalPage(unsigned vpn, int pageToIgnore)
 }
 
 void
-ProcessAddressSpace::CopyPageData(unsigned vpn, bool useNoffH)
+ProcessAddressSpace::CopyPageData(unsigned vpn, bool useNoffH, bool compressed)
 {
     if (useNoffH)
     {
@@ -446,7 +593,13 @@ ProcessAddressSpace::CopyPageData(unsigned vpn, bool useNoffH)
             machine->mainMemory[KernelPageTable[vpn].physicalPage*PageSize + i] = backupArray[vpn*PageSize + i];
         }
         KernelPageTable[vpn].dirty = TRUE;
-        currentThread->SortedInsertInWaitQueue(1000+stats->totalTicks);
+        if (compressed)			// only had to be decompressed
+            currentThread->SortedInsertInWaitQueue(ZSwapTime+stats->totalTicks);
+        else
+#ifdef NETWORK
+        if (remoteSwap == NULL)		// else the fetch has already waited
+#endif
+        currentThread->SortedInsertInWaitQueue(SwapTime+stats->totalTicks);
         stats->totalPageFaults++;
     }
 
@@ -456,8 +609,55 @@ void
 ProcessAddressSpace::PageFaultHandler(unsigned vaddr)
 {
     unsigned vpn = vaddr/PageSize;
+    bool compressed = FALSE;
     ASSERT(vpn <= numVirtualPages);
-    unsigned ppn = GetPhysicalPage(vpn, -1);
+    if (workingSets != NULL)		// load control may suspend us
+        workingSets->Admit(this);
+    // A page that has never been touched, past the end of the executable,
+    // or that held only zeros when it was evicted, is mapped to the zero
+    // frame, without taking a frame or waiting; the first write to it
+    // gives it a frame of its own (CopyOnWrite).
+    if ((pageMerger != NULL) && (KernelPageTable[vpn].zeroFilled
+            || (!KernelPageTable[vpn].loadFromSwap && IsZeroFillPage(vpn)))) {
+        DEBUG('a', "Mapping page %d to the zero frame\n", vpn);
+        KernelPageTable[vpn].physicalPage = pageMerger->ZeroFrame();
+        KernelPageTable[vpn].valid = TRUE;
+        KernelPageTable[vpn].use = FALSE;
+        KernelPageTable[vpn].readOnly = TRUE;
+        KernelPageTable[vpn].zeroFilled = FALSE;
+        stats->numZeroPageMaps++;
+        return;
+    }
+    // A page in the compressed cache is newer than the one in the backup
+    // store; decompress it over it, before taking a frame can push it
+    // out of the cache.
+    if (zswap != NULL && KernelPageTable[vpn].loadFromSwap)
+        compressed = zswap->Load(this, vpn, &backupArray[vpn*PageSize]);
+#ifdef NETWORK
+    // Bring the page back from the memory server before taking a frame,
+    // since we may have to wait for it; backupArray is only a staging
+    // area for the page when paging remotely.
+    if (remoteSwap != NULL && KernelPageTable[vpn].loadFromSwap && !compressed)
+        remoteSwap->Fetch(cpid, vpn, &backupArray[vpn*PageSize]);
+#endif
+    unsigned ppn;
+    int codeFrame;
+
+    if (IsCodePage(vpn)) {
+        codeFrame = sharedCode->Find(filename, vpn);
+        if (codeFrame != -1) {		// another process has loaded it
+            DEBUG('a', "Sharing code page %d in frame %d\n", vpn, codeFrame);
+            sharedCode->Ref(codeFrame);
+            KernelPageTable[vpn].physicalPage = codeFrame;
+            KernelPageTable[vpn].valid = TRUE;
+            KernelPageTable[vpn].use = FALSE;
+            KernelPageTable[vpn].dirty = FALSE;
+            KernelPageTable[vpn].readOnly = TRUE;
+            stats->numSharedCodePages++;
+            return;
+        }
+    }
+    ppn = GetPhysicalPage(vpn, -1);
     //printf("ppn:%d\n",ppn);
 
     KernelPageTable[vpn].virtualPage = vpn;
@@ -470,7 +670,14 @@ ProcessAddressSpace::PageFaultHandler(unsigned vaddr)
 					// pages to be read-only
     KernelPageTable[vpn].shared = FALSE;
     DEBUG('a', "Page fault detected for %d virtual address vpn: %d. Loading Physical page into memory\n", vaddr, vpn);
-    CopyPageData(vpn, !KernelPageTable[vpn].loadFromSwap);
+    if (pagedLayout && !KernelPageTable[vpn].loadFromSwap)
+        LoadPage(vpn);
+    else
+    CopyPageData(vpn, !KernelPageTable[vpn].loadFromSwap, compressed);
+#ifdef NETWORK
+    if (remoteSwap != NULL)
+        remoteSwap->SendBatches();	// the frames are settled now
+#endif
     //RestoreContextOnSwitch();
     //pt();
 }
@@ -481,16 +688,413 @@ ProcessAddressSpace::Backup(int vpn, int pd){
     ASSERT(this->KernelPageTable[vpn].valid == TRUE);
 
     if(this->KernelPageTable[vpn].dirty){
-        memcpy(&(backupArray[vpn*PageSize]), &(machine->mainMemory[KernelPageTable[vpn].physicalPage*PageSize]), PageSize);
+        char *page = &(machine->mainMemory[KernelPageTable[vpn].physicalPage*PageSize]);
+        if (pageMerger != NULL && pageMerger->AllZero(page)) {
+            this->KernelPageTable[vpn].zeroFilled = TRUE;	// nothing to
+            stats->numZeroPagesDropped++;			// save
+        } else {
+            if (zswap == NULL || !zswap->Store(this, vpn, page))
+                WriteBackup(vpn, page);
+            this->KernelPageTable[vpn].loadFromSwap = TRUE;
+            this->KernelPageTable[vpn].zeroFilled = FALSE;
+        }
     }
-    this->KernelPageTable[vpn].loadFromSwap = TRUE;
+    else if (!this->KernelPageTable[vpn].loadFromSwap)
+        stats->numCleanDrops++;		// it comes back from the file, or 
+					// as zeros
     this->KernelPageTable[vpn].valid = FALSE;
     this->KernelPageTable[vpn].dirty = FALSE;
     this->KernelPageTable[vpn].physicalPage = -1;
 }
 
+//----------------------------------------------------------------------
+// ProcessAddressSpace::CopyOnWrite
+// 	The user program wrote to a read-only page at "vaddr".  If the
+//	page is mapped to the zero frame, or to a merged frame, give it a
+//	frame of its own, with a copy of the contents, and return TRUE;
+//	the write is then done again.  Return FALSE if the page really is
+//	read-only.
+//----------------------------------------------------------------------
+
+bool
+ProcessAddressSpace::CopyOnWrite(unsigned vaddr)
+{
+    unsigned vpn = vaddr/PageSize;
+    int ppn, frame;
+
+    if ((vpn >= numVirtualPages) || (pageMerger == NULL)
+            || !pageMerger->Holds(KernelPageTable[vpn].physicalPage))
+        return FALSE;
+    ppn = KernelPageTable[vpn].physicalPage;
+    if ((ppn != pageMerger->ZeroFrame()) && (pageMerger->Refs(ppn) == 1)) {
+        DEBUG('a', "Page %d keeps merged frame %d for itself\n", vpn, ppn);
+        pageMerger->Unmerge(ppn);	// no one else uses it any more
+        machine->threadPID[ppn] = cpid;
+        machine->threadVPN[ppn] = vpn;
+    } else {
+        frame = GetPhysicalPage(vpn, ppn);
+        DEBUG('a', "Copying page %d from frame %d to frame %d\n", vpn, ppn,
+                        frame);
+        bcopy(&machine->mainMemory[ppn * PageSize],
+                        &machine->mainMemory[frame * PageSize], PageSize);
+        (void) pageMerger->Unref(ppn);	// others are still using it
+        KernelPageTable[vpn].physicalPage = frame;
+#ifdef NETWORK
+        if (remoteSwap != NULL)
+            remoteSwap->SendBatches();
+#endif
+    }
+    KernelPageTable[vpn].readOnly = FALSE;
+    KernelPageTable[vpn].dirty = TRUE;	// the backup store does not have
+    KernelPageTable[vpn].use = TRUE;	// these contents
+    stats->numCopyOnWrites++;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// ProcessAddressSpace::IsZeroFillPage
+// 	Is page "vpn" past the end of the parts of the address space that
+//	are read from the executable?  Then it starts out as zeros.
+//----------------------------------------------------------------------
+
+bool
+ProcessAddressSpace::IsZeroFillPage(unsigned vpn)
+{
+    int end = noffH.code.virtualAddr + noffH.code.size;
+
+    if ((noffH.initData.size > 0)
+            && (noffH.initData.virtualAddr + noffH.initData.size > end))
+        end = noffH.initData.virtualAddr + noffH.initData.size;
+    return (int) (vpn * PageSize) >= end;
+}
+
+//----------------------------------------------------------------------
+// ProcessAddressSpace::WriteBackup
+// 	Put a copy of page "vpn" in our backup store: backupArray, or the
+//	memory server.  Never waits.
+//----------------------------------------------------------------------
+
+void
+ProcessAddressSpace::WriteBackup(int vpn, char *data)
+{
+#ifdef NETWORK
+    if (remoteSwap != NULL)
+        remoteSwap->Store(cpid, vpn, data);
+    else
+#endif
+    memcpy(&(backupArray[vpn*PageSize]), data, PageSize);
+}
+
+//----------------------------------------------------------------------
+// ProcessAddressSpace::EvictPage
+// 	Take frame "ppn" away from the page that has it, to replace it:
+//	save the page to its owner's backup, or, for a shared code page,
+//	unmap it from every process running the program.  A merged frame
+//	is saved for every page mapped to it.
+//----------------------------------------------------------------------
+
+void
+ProcessAddressSpace::EvictPage(int ppn)
+{
+    int pid = machine->threadPID[ppn]; // Part of inverse table
+
+    if (sharedCode->Holds(ppn))
+        sharedCode->Evict(ppn);
+    else if ((pageMerger != NULL) && pageMerger->Holds(ppn))
+        pageMerger->Evict(ppn);
+    else if(threadArray[pid]->space != NULL)
+        threadArray[pid]->space->Backup(machine->threadVPN[ppn], pid);
+    else{
+        this->Backup(machine->threadVPN[ppn], pid);
+    }
+}
+
+//----------------------------------------------------------------------
+// ProcessAddressSpace::IsCodePage
+// 	Is page "vpn" part of the code segment, with the paged layout?
+//	Then it holds nothing else.
+//----------------------------------------------------------------------
+
+bool
+ProcessAddressSpace::IsCodePage(unsigned vpn)
+{
+    return pagedLayout && (noffH.code.size > 0)
+        && (vpn >= (unsigned) (noffH.code.virtualAddr / PageSize))
+        && (vpn < (unsigned) divRoundUp(noffH.code.virtualAddr
+                                        + noffH.code.size, PageSize));
+}
+
+//----------------------------------------------------------------------
+// ProcessAddressSpace::LoadPage
+// 	Fill page "vpn", which has just been given a frame, for the paged
+//	layout: read the part of it that is in the executable, and zero
+//	the rest.  A page that is not in the executable at all (the bss 
+//	and the stack) costs no I/O.  Code pages are made read-only and
+//	offered to the other processes running the program.
+//----------------------------------------------------------------------
+
+void
+ProcessAddressSpace::LoadPage(unsigned vpn)
+{
+    unsigned ppn = KernelPageTable[vpn].physicalPage;
+    char *frame = &machine->mainMemory[ppn * PageSize];
+    int start = vpn * PageSize, inFile = 0;
+    Segment *segment = NULL;
+    OpenFile *executable;
+
+    if (IsCodePage(vpn))
+        segment = &noffH.code;
+    else if ((noffH.initData.size > 0) 
+                && (start >= noffH.initData.virtualAddr)
+                && (start < noffH.initData.virtualAddr + noffH.initData.size))
+        segment = &noffH.initData;
+
+    if (segment != NULL) {
+        inFile = segment->virtualAddr + segment->size - start;
+        if (inFile > PageSize)
+            inFile = PageSize;
+        executable = fileSystem->Open(filename);
+        executable->ReadAt(frame, inFile,
+                        segment->inFileAddr + start - segment->virtualAddr);
+        delete executable;
+    } else
+        stats->numZeroFillPages++;
+    bzero(frame + inFile, PageSize - inFile);
+
+    KernelPageTable[vpn].dirty = FALSE;
+    KernelPageTable[vpn].readOnly = IsCodePage(vpn);
+    if (IsCodePage(vpn))
+        sharedCode->Insert(ppn, filename, vpn);
+    stats->totalPageFaults++;
+    if (segment != NULL)
+        currentThread->SortedInsertInWaitQueue(1000+stats->totalTicks);
+}
+
+//----------------------------------------------------------------------
+// SharedCode::SharedCode
+// 	Initialize the table of shared code frames, with no frames.
+//----------------------------------------------------------------------
+
+SharedCode::SharedCode()
+{
+    frames = new CodeFrame*[NumPhysPages];
+    for (int i = 0; i < NumPhysPages; i++)
+        frames[i] = NULL;
+}
+
+SharedCode::~SharedCode()
+{
+    for (int i = 0; i < NumPhysPages; i++)
+        if (frames[i] != NULL) {
+            delete [] frames[i]->program;
+            delete frames[i];
+        }
+    delete [] frames;
+}
+
+//----------------------------------------------------------------------
+// SameProgram
+// 	Do two executable names match?  Address spaces keep the name as
+//	they were given it, ended by a newline or a null.
+//----------------------------------------------------------------------
+
+static bool
+SameProgram(char *a, char *b)
+{
+    for (;; a++, b++) {
+        bool aEnds = (*a == '\0') || (*a == '\n');
+        bool bEnds = (*b == '\0') || (*b == '\n');
+
+        if (aEnds || bEnds)
+            return aEnds && bEnds;
+        if (*a != *b)
+            return FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// SharedCode::Find
+// 	Return the frame holding code page "vpn" of "program", or -1 if
+//	it is not in memory.
+//----------------------------------------------------------------------
+
+int
+SharedCode::Find(char *program, unsigned vpn)
+{
+    for (int i = 0; i < NumPhysPages; i++)
+        if ((frames[i] != NULL) && (frames[i]->vpn == vpn)
+                && SameProgram(frames[i]->program, program))
+            return i;
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// SharedCode::Insert
+// 	Frame "ppn" now holds code page "vpn" of "program", mapped by the
+//	page table of the process that loaded it.
+//----------------------------------------------------------------------
+
+void
+SharedCode::Insert(int ppn, char *program, unsigned vpn)
+{
+    int length;
+
+    ASSERT(frames[ppn] == NULL);
+    for (length = 0; (program[length] != '\0') && (program[length] != '\n');
+                length++)
+        ;
+    frames[ppn] = new CodeFrame;
+    frames[ppn]->program = new char[length + 1];
+    bcopy(program, frames[ppn]->program, length);
+    frames[ppn]->program[length] = '\0';
+    frames[ppn]->vpn = vpn;
+    frames[ppn]->refs = 1;
+}
+
+//----------------------------------------------------------------------
+// SharedCode::Unref
+// 	A page table no longer maps frame "ppn".  If it was the last, 
+//	forget the frame, and return TRUE: the caller frees it.
+//----------------------------------------------------------------------
+
+bool
+SharedCode::Unref(int ppn)
+{
+    ASSERT((frames[ppn] != NULL) && (frames[ppn]->refs > 0));
+    if (--frames[ppn]->refs > 0)
+        return FALSE;
+    delete [] frames[ppn]->program;
+    delete frames[ppn];
+    frames[ppn] = NULL;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// SharedCode::Evict
+// 	Frame "ppn" is being replaced.  Unmap it from every address space
+//	that maps it; code is never written, so nothing needs saving, and
+//	the next fault on it reads it from the executable again.
+//----------------------------------------------------------------------
+
+void
+SharedCode::Evict(int ppn)
+{
+    ProcessAddressSpace *space;
+    TranslationEntry *entry;
+    unsigned pid, vpn;
+
+    DEBUG('a', "Evicting shared code frame %d\n", ppn);
+    for (pid = 0; pid < thread_index; pid++) {
+        if ((threadArray[pid] == NULL) || (threadArray[pid]->space == NULL))
+            continue;
+        space = threadArray[pid]->space;
+        for (vpn = 0; vpn < space->GetNumPages(); vpn++) {
+            entry = &space->KernelPageTable[vpn];
+            if (entry->valid && !entry->shared && (entry->physicalPage == ppn)) {
+                entry->valid = FALSE;
+                entry->physicalPage = -1;
+            }
+        }
+    }
+    stats->numCleanDrops++;
+    delete [] frames[ppn]->program;
+    delete frames[ppn];
+    frames[ppn] = NULL;
+}
 
 // Page Replacement Algorithms
+
+//----------------------------------------------------------------------
+// ProcessAddressSpace::LocalReplacement
+// 	Replace the page of ours that was used longest ago, as far as the
+//	working-set samples tell, and give its frame to page "vpn".  Frames
+//	shared with other processes are not ours to replace.  Return -1 if
+//	we have no page that can be replaced.
+//----------------------------------------------------------------------
+
+int
+ProcessAddressSpace::LocalReplacement(unsigned vpn, int pageToIgnore)
+{
+    int i, foundPage = -1, oldest = 0, lastUse;
+
+    for (i = 0; i < NumPhysPages; i++) {
+        if (machine->threadPID[i] != cpid || machine->sharedPages[i]
+                || i == pageToIgnore || sharedCode->Holds(i)
+                || (pageMerger != NULL && pageMerger->Holds(i))
+                || machine->threadVPN[i] >= (int) numVirtualPages
+                || KernelPageTable[machine->threadVPN[i]].physicalPage != i
+                || !KernelPageTable[machine->threadVPN[i]].valid)
+            continue;
+        lastUse = KernelPageTable[machine->threadVPN[i]].lastUse;
+        if (foundPage == -1 || lastUse < oldest
+                || (lastUse == oldest && machine->LRUTimeStamp[i]
+                                        < machine->LRUTimeStamp[foundPage])) {
+            foundPage = i;
+            oldest = lastUse;
+        }
+    }
+    if (foundPage == -1)
+        return -1;
+    DEBUG('a', "Replacing our own page %d, in frame %d\n",
+                machine->threadVPN[foundPage], foundPage);
+    EvictPage(foundPage);		// Save exiting page to backup
+    machine->threadPID[foundPage] = cpid;
+    machine->threadVPN[foundPage] = vpn;
+    machine->referenceBit[foundPage] = TRUE;
+    machine->LRUTimeStamp[foundPage] = stats->totalTicks;
+    stats->numLocalReplacements++;
+    return foundPage;
+}
+
+//----------------------------------------------------------------------
+// ProcessAddressSpace::ResidentPages
+// 	Return the number of frames that are ours alone.
+//----------------------------------------------------------------------
+
+int
+ProcessAddressSpace::ResidentPages()
+{
+    int i, count = 0;
+
+    for (i = 0; i < NumPhysPages; i++)
+        if (machine->threadPID[i] == cpid && !machine->sharedPages[i]
+                && !sharedCode->Holds(i)
+                && (pageMerger == NULL || !pageMerger->Holds(i)))
+            count++;
+    return count;
+}
+
+//----------------------------------------------------------------------
+// ProcessAddressSpace::ReleaseFrames
+// 	Evict all the pages that have frames of their own, and free the
+//	frames, for load control to give them to other processes.
+//----------------------------------------------------------------------
+
+void
+ProcessAddressSpace::ReleaseFrames()
+{
+    int i;
+    TranslationEntry *entry;
+
+    for (i = 0; i < NumPhysPages; i++) {
+        if (machine->threadPID[i] != cpid || machine->sharedPages[i]
+                || sharedCode->Holds(i)
+                || (pageMerger != NULL && pageMerger->Holds(i))
+                || machine->threadVPN[i] >= (int) numVirtualPages)
+            continue;
+        entry = &KernelPageTable[machine->threadVPN[i]];
+        if (!entry->valid || entry->physicalPage != i)
+            continue;
+        Backup(machine->threadVPN[i], cpid);
+        machine->threadPID[i] = -1;
+        machine->threadVPN[i] = -1;
+        pagesAllocated--;
+    }
+#ifdef NETWORK
+    if (remoteSwap != NULL)
+        remoteSwap->SendBatches();
+#endif
+}
 unsigned
 ProcessAddressSpace::RandReplacement(unsigned vpn, int pageToIgnore){
     unsigned new_ppn = Random()%(NumPhysPages);
@@ -499,8 +1103,8 @@ ProcessAddressSpace::RandReplacement(unsigned vpn, int pageToIgnore){
     }
     //printf("New PPFN = %d\n", new_ppn);
     //printf("................\n");
-    int pid = machine->threadPID[new_ppn]; // Part of inverse table
-    /*if(threadArray[pid]->space->KernelPageTable[machine->threadVPN[new_ppn]].valid == FALSE){
+    /*int pid = machine->threadPID[new_ppn]; // Part of inverse table
+    if(threadArray[pid]->space->KernelPageTable[machine->threadVPN[new_ppn]].valid == FALSE){
         printf("########################## pid %d\n", machine->threadPID[new_ppn]);
         printf("mem dump\n");
         for(int i = 0; i<NumPhysPages; i++){
@@ -508,11 +1112,7 @@ ProcessAddressSpace::RandReplacement(unsigned vpn, int pageToIgnore){
         }
     }*/
     //pt();
-    if(threadArray[pid]->space != NULL)
-        threadArray[pid]->space->Backup(machine->threadVPN[new_ppn], pid); // Save exiting page to backup
-    else{
-        this->Backup(machine->threadVPN[new_ppn], pid);
-    }
+    EvictPage(new_ppn);		// Save exiting page to backup
     //KernelPageTable[vpn].loadFromSwap = TRUE;
     machine->threadPID[new_ppn] = cpid;
     //thPID[new_ppn] = cpid;
@@ -544,12 +1144,7 @@ ProcessAddressSpace::FIFO_repl(int vpn, int pageToIgnore){
     if(tmp2)
       FIFOQueue->Prepend((void *)tmp2);
     FIFOQueue->Append((void *)tmp);
-    int pid = machine->threadPID[foundPage]; // Part of inverse table
-    if(threadArray[pid]->space != NULL)
-        threadArray[pid]->space->Backup(machine->threadVPN[foundPage], pid); // Save exiting page to backup
-    else{
-        this->Backup(machine->threadVPN[foundPage], pid);
-    }
+    EvictPage(foundPage);		// Save exiting page to backup
     machine->threadPID[foundPage] = cpid;
     machine->threadVPN[foundPage] = vpn;
     return foundPage; 
@@ -572,12 +1167,7 @@ ProcessAddressSpace::LRU_repl(int vpn, int notToReplace){
                 }
                 ASSERT(foundPage != -1);
                 machine->LRUTimeStamp[foundPage] = stats->totalTicks;
-     int pid = machine->threadPID[foundPage]; // Part of inverse table
-     if(threadArray[pid]->space != NULL)
-         threadArray[pid]->space->Backup(machine->threadVPN[foundPage]    , pid); // Save exiting page to backup
-     else{
-         this->Backup(machine->threadVPN[foundPage], pid);
-     }
+     EvictPage(foundPage);		// Save exiting page to backup
      machine->threadPID[foundPage] = cpid;
      machine->threadVPN[foundPage] = vpn;
      return foundPage;
@@ -597,12 +1187,7 @@ ProcessAddressSpace::LRU_Clock(int vpn, int notToReplace){
                 foundPage = LRU_Clock_ptr;
                 machine->referenceBit[foundPage]=TRUE;
                 LRU_Clock_ptr = (LRU_Clock_ptr+1)%NumPhysPages;
-                int pid = machine->threadPID[foundPage]; // Part of inverse table
-     if(threadArray[pid]->space != NULL)
-         threadArray[pid]->space->Backup(machine->threadVPN[foundPage]    , pid); // Save exiting page to backup
-     else{
-         this->Backup(machine->threadVPN[foundPage], pid);
-     }
+                EvictPage(foundPage);		// Save exiting page to backup
      machine->threadPID[foundPage] = cpid;
      machine->threadVPN[foundPage] = vpn;
      return foundPage;
@@ -19,6 +19,42 @@
 #include "list.h" 
 #define UserStackSize		1024 	// increase this as necessary!
 
+// The following class keeps track of the frames holding the code pages
+// of programs in the paged NOFF layout (see bin/coff2noff.c).  Every
+// process running the same program maps the same frame for each code
+// page, read-only; the frame is freed when the last of them lets go of
+// it, or taken from all of them at once when it is replaced.
+
+class CodeFrame {
+  public:
+    char *program;			// Executable the page comes from
+    unsigned vpn;			// and which page of it
+    int refs;				// Page tables mapping the frame
+};
+
+class SharedCode {
+  public:
+    SharedCode();			// No code pages in memory yet
+    ~SharedCode();
+
+    int Find(char *program, unsigned vpn);
+					// Frame holding the page, or -1
+    void Insert(int ppn, char *program, unsigned vpn);
+					// Frame "ppn" now holds the page,
+					// mapped by one page table
+    bool Holds(int ppn) { return frames[ppn] != NULL; }
+    void Ref(int ppn) { frames[ppn]->refs++; }
+					// One more page table maps it
+    bool Unref(int ppn);		// One fewer; return TRUE, and
+					// forget the frame, if no more
+    void Evict(int ppn);		// Unmap the frame everywhere, to
+					// replace it
+
+  private:
+    CodeFrame **frames;			// By frame number; NULL if the
+					// frame holds no shared code
+};
+
 class ProcessAddressSpace {
   public:
     ProcessAddressSpace(OpenFile *executable, char* buffer, int pd);	// Create an address space,
@@ -29,6 +65,10 @@ class ProcessAddressSpace {
 
     ~ProcessAddressSpace();			// De-allocate an address space
 
+    static void *operator new(size_t size);	// Address spaces are
+    static void operator delete(void *ptr, size_t size);
+						// recycled through spacePool
+
     void InitUserModeCPURegisters();		// Initialize user-level CPU registers,
 					// before jumping to user code
 
@@ -42,14 +82,39 @@ class ProcessAddressSpace {
     unsigned sharedMemory(int numSharedPages);
     void PageFaultHandler(unsigned vaddr);
     unsigned GetPhysicalPage(unsigned vpn, int pageToIgnore);
-    void CopyPageData(unsigned vpn, bool useNoffH);
+    void CopyPageData(unsigned vpn, bool useNoffH, bool compressed);
     unsigned RandReplacement(unsigned vpn, int pageToIgnore);
     void Backup(int vpn, int pid);
+    void WriteBackup(int vpn, char *data);	// Put a copy of page "vpn"
+					// in the backup store
+    bool CopyOnWrite(unsigned vaddr);	// Give a page of a merged frame
+					// a frame of its own, to write to
+    bool IsZeroFillPage(unsigned vpn);	// Page past the end of the
+					// executable's contents?
+    int LocalReplacement(unsigned vpn, int pageToIgnore);
+					// Replace one of our own pages, -1 if
+					// we have none that can be replaced
+    int ResidentPages();		// Frames we have, of our own
+    void ReleaseFrames();		// Evict all our pages
+    void EvictPage(int ppn);		// Take frame "ppn" away from
+					// whoever has it
+    bool IsCodePage(unsigned vpn);	// Page of the code segment, with
+					// the paged layout?
+    void LoadPage(unsigned vpn);	// Fill a page from the executable,
+					// or with zeros, for the paged layout
+    bool pagedLayout;			// Executable in the paged NOFF
+					// layout?
+    int workingSet;			// Pages used in the last window, at
+					// the last sample (see workingset.h)
+    bool suspendPending;		// To be suspended by load control, at
+					// the next page fault
+    int suspendedAt;			// When it was, -1 if it is running
     int cpid;
     NoffHeader noffH;
     char* filename;
 
     char *backupArray;
+    unsigned backupSize;		// Size of backupArray in bytes
     TranslationEntry *KernelPageTable;	// Assume linear page table translation
 					// for now!
     unsigned int numVirtualPages;		// Number of pages in the virtual 
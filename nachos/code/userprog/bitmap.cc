@@ -102,6 +102,44 @@ BitMap::Find()
     return -1;
 }
 
+//----------------------------------------------------------------------
+// BitMap::FindRun
+// 	Find a run of "wanted" consecutive clear bits, and set them.
+//	Take the first such run; if there is none, take the longest run
+//	of clear bits there is.  Return the number of the first bit of the
+//	run, and put its length in "found".  This is what lets the file
+//	system lay files out contiguously whenever it can.
+//
+//	If no bits are clear, return -1.
+//----------------------------------------------------------------------
+
+int
+BitMap::FindRun(int wanted, int *found)
+{
+    int i, start, length, bestStart = -1, bestLength = 0;
+
+    ASSERT(wanted > 0);
+    for (i = 0; i < numBits; i = start + length) {
+	for (start = i; (start < numBits) && Test(start); start++)
+	    ;				// skip the bits in use
+	for (length = 0; ((start + length) < numBits) && (length < wanted)
+				&& !Test(start + length); length++)
+	    ;				// measure the clear run
+	if (length > bestLength) {
+	    bestStart = start;
+	    bestLength = length;
+	    if (length == wanted)
+		break;			// first fit
+	}
+	if (length == 0)
+	    break;			// reached the end
+    }
+    for (i = 0; i < bestLength; i++)
+	Mark(bestStart + i);
+    *found = bestLength;
+    return bestStart;
+}
+
 //----------------------------------------------------------------------
 // BitMap::NumClear
 // 	Return the number of clear bits in the bitmap.
@@ -43,6 +43,10 @@ class BitMap {
     int Find();            	// Return the # of a clear bit, and as a side
 				// effect, set the bit. 
 				// If no bits are clear, return -1.
+    int FindRun(int wanted, int *found);
+				// Find and set a run of up to "wanted" 
+				// consecutive clear bits; return the first
+				// one, and the length in "found"
     int NumClear();		// Return the number of clear bits
 
     void Print();		// Print contents of bitmap
@@ -27,6 +27,30 @@
 #include "console.h"
 #include "synch.h"
 
+#ifdef NETWORK
+//----------------------------------------------------------------------
+// UserBuffer
+// 	Return where the "size" bytes of user memory at "vaddr" are in
+//	main memory, if they all lie in one page that is in memory, so that
+//	a system call can copy them in one go instead of a byte at a time
+//	through ReadMem or WriteMem.  Return NULL if they do not.
+//
+//	"writing" -- will the kernel write them?  Then the page is dirty.
+//----------------------------------------------------------------------
+
+static char *
+UserBuffer (int vaddr, int size, bool writing)
+{
+   int physAddr;
+
+   if ((size <= 0) || ((vaddr / PageSize) != ((vaddr + size - 1) / PageSize)))
+      return NULL;
+   if (machine->Translate(vaddr, &physAddr, 1, writing) != NoException)
+      return NULL;
+   return &machine->mainMemory[physAddr];
+}
+#endif
+
 //----------------------------------------------------------------------
 // ExceptionHandler
 // 	Entry point into the Nachos kernel.  Called when a user program
@@ -98,7 +122,19 @@ ExceptionHandler(ExceptionType which)
     int waitpid;		// Used in SysCall_Join
     int whichChild;		// Used in SysCall_Join
     NachOSThread *child;		// Used by SysCall_Fork
+    int key, id;		// Used by SysCall_SemGet and friends
+    Semaphore *sem;		// Used by SysCall_SemOp, SemCtl and CondOp
+    UserCondition *cond;	// Used by SysCall_CondOp and CondRemove
+    List *waiters;		// Used by SysCall_WaitOnAddress and WakeAddress
+    IntStatus oldLevel;		// Used by SysCall_WaitOnAddress
     unsigned sleeptime;		// Used by SysCall_Sleep
+#ifdef NETWORK
+    char *data;			// Used by SysCall_NetSend and NetReceive
+    int box, size;		// Used by SysCall_NetSend and friends
+    PacketHeader pktHdr;	// Used by SysCall_NetSend and NetReceive
+    MailHeader mailHdr;
+    bool received;		// Used by SysCall_NetReceive
+#endif
 
     if ((which == SyscallException) && (type == SysCall_Halt)) {
 	DEBUG('a', "Shutdown, initiated by user program.\n");
@@ -110,13 +146,11 @@ ExceptionHandler(ExceptionType which)
        // We do not wait for the children to finish.
        // The children will continue to run.
        // We will worry about this when and if we implement signals.
-       exitThreadArray[currentThread->GetPID()] = true;
+       MarkThreadExited(currentThread->GetPID());
+       stats->RecordCompletion(stats->totalTicks);
 
-       // Find out if all threads have called exit
-       for (i=0; i<thread_index; i++) {
-          if (!exitThreadArray[i]) break;
-       }
-       currentThread->Exit(i==thread_index, exitcode);
+       // Terminate if all threads have called exit
+       currentThread->Exit(numLiveThreads == 0, exitcode);
     }
     else if ((which == SyscallException) && (type == SysCall_Exec)) {
        // Copy the executable name into kernel space
@@ -302,6 +336,161 @@ ExceptionHandler(ExceptionType which)
        machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
        machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
        machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    } else if ((which == SyscallException) && (type == SysCall_SemGet)) {
+       key = machine->ReadRegister(4);
+       id = semTable->Lookup(key);
+       if (id == -1) {
+          sem = new Semaphore("user semaphore", 0);
+          id = semTable->Insert(key, sem);
+          if (id == -1) delete sem;
+       }
+       machine->WriteRegister(2, id);
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    } else if ((which == SyscallException) && (type == SysCall_SemOp)) {
+       sem = (Semaphore *)semTable->Get(machine->ReadRegister(4));
+       tempval = machine->ReadRegister(5);
+       if (sem != NULL) {
+          for (; tempval < 0; tempval++) sem->P();
+          for (; tempval > 0; tempval--) sem->V();
+       }
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    } else if ((which == SyscallException) && (type == SysCall_SemCtl)) {
+       id = machine->ReadRegister(4);
+       sem = (Semaphore *)semTable->Get(id);
+       vaddr = machine->ReadRegister(6);
+       if (sem == NULL) {
+          machine->WriteRegister(2, -1);
+       }
+       else if (machine->ReadRegister(5) == SYNCH_REMOVE) {
+          if (sem->HasWaiters()) {
+             machine->WriteRegister(2, -1);
+          }
+          else {
+             semTable->Remove(id);
+             delete sem;
+             machine->WriteRegister(2, 0);
+          }
+       }
+       else if (machine->ReadRegister(5) == SYNCH_GET) {
+          while(!machine->WriteMem(vaddr, 4, sem->GetValue()));
+          machine->WriteRegister(2, 0);
+       }
+       else if (machine->ReadRegister(5) == SYNCH_SET) {
+          while(!machine->ReadMem(vaddr, 4, &memval));
+          if (memval < 0) {
+             machine->WriteRegister(2, -1);
+          }
+          else {
+             sem->SetValue(memval);
+             machine->WriteRegister(2, 0);
+          }
+       }
+       else machine->WriteRegister(2, -1);
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    } else if ((which == SyscallException) && (type == SysCall_CondGet)) {
+       key = machine->ReadRegister(4);
+       id = condTable->Lookup(key);
+       if (id == -1) {
+          cond = new UserCondition();
+          id = condTable->Insert(key, cond);
+          if (id == -1) delete cond;
+       }
+       machine->WriteRegister(2, id);
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    } else if ((which == SyscallException) && (type == SysCall_CondOp)) {
+       cond = (UserCondition *)condTable->Get(machine->ReadRegister(4));
+       sem = (Semaphore *)semTable->Get(machine->ReadRegister(6));
+       if (cond != NULL) {
+          if ((machine->ReadRegister(5) == COND_OP_WAIT) && (sem != NULL)) cond->Wait(sem);
+          else if (machine->ReadRegister(5) == COND_OP_SIGNAL) cond->Signal();
+          else if (machine->ReadRegister(5) == COND_OP_BROADCAST) cond->Broadcast();
+       }
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    } else if ((which == SyscallException) && (type == SysCall_CondRemove)) {
+       id = machine->ReadRegister(4);
+       cond = (UserCondition *)condTable->Get(id);
+       if ((cond == NULL) || cond->HasWaiters()) {
+          machine->WriteRegister(2, -1);
+       }
+       else {
+          condTable->Remove(id);
+          delete cond;
+          machine->WriteRegister(2, 0);
+       }
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    } else if ((which == SyscallException) && (type == SysCall_WaitOnAddress)) {
+       vaddr = machine->ReadRegister(4);
+       // Comparing and going to sleep must be atomic, or a wake up
+       // could come in between
+       oldLevel = interrupt->SetLevel(IntOff);
+       while(!machine->ReadMem(vaddr, 4, &memval));
+       if (memval != machine->ReadRegister(5)) {
+          machine->WriteRegister(2, 1);
+       }
+       else {
+          key = machine->GetPA(vaddr);
+          id = futexTable->Lookup(key);
+          if (id == -1) {
+             waiters = new List;
+             id = futexTable->Insert(key, waiters);
+             if (id == -1) delete waiters;
+          }
+          if (id == -1) {
+             machine->WriteRegister(2, -1);
+          }
+          else {
+             waiters = (List *)futexTable->Get(id);
+             waiters->Append((void *)currentThread);
+             currentThread->PutThreadToSleep();
+             machine->WriteRegister(2, 0);
+          }
+       }
+       (void) interrupt->SetLevel(oldLevel);
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    } else if ((which == SyscallException) && (type == SysCall_WakeAddress)) {
+       key = machine->GetPA(machine->ReadRegister(4));
+       tempval = machine->ReadRegister(5);
+       id = (key == -1) ? -1 : futexTable->Lookup(key);
+       i = 0;
+       if (id != -1) {
+          waiters = (List *)futexTable->Get(id);
+          oldLevel = interrupt->SetLevel(IntOff);
+          while ((i < (unsigned)tempval) && !waiters->IsEmpty()) {
+             scheduler->MoveThreadToReadyQueue((NachOSThread *)waiters->Remove());
+             i++;
+          }
+          (void) interrupt->SetLevel(oldLevel);
+          if (waiters->IsEmpty()) {
+             futexTable->Remove(id);
+             delete waiters;
+          }
+       }
+       machine->WriteRegister(2, i);
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
     } else if ((which == SyscallException) && (type == SysCall_ShmAllocate)) {
         // TODO: Check whether contiguous memory needed
         unsigned requestedPages = machine->ReadRegister(4);
@@ -314,10 +503,115 @@ ExceptionHandler(ExceptionType which)
          machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
        machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
        machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    } else if ((which == SyscallException) && (type == SysCall_NetSend)) {
+#ifdef NETWORK
+       pktHdr.to = machine->ReadRegister(4);
+       box = machine->ReadRegister(5);
+       vaddr = machine->ReadRegister(6);
+       size = machine->ReadRegister(7);
+       if ((pktHdr.to < 0) || ((fabric != NULL)
+				&& (pktHdr.to >= fabric->NumNodes()))
+				|| (box < 0) || (box >= postOffice->NumBoxes())
+				|| (size < 0) || (size > (int) MaxMailSize)) {
+          machine->WriteRegister(2, -1);
+       }
+       else {
+          // Send straight from the user's page if we can; the post
+          // office copies the data before it waits for a credit or
+          // for room in the network's queue, since the page may be
+          // evicted meanwhile
+          data = UserBuffer(vaddr, size, FALSE);
+          if (data == NULL) {
+             for (i = 0; i < (unsigned) size; i++) {
+                while(!machine->ReadMem(vaddr + i, 1, &memval));
+                buffer[i] = (char) memval;
+             }
+             data = buffer;
+          }
+          mailHdr.to = mailHdr.from = box;
+          mailHdr.length = size;
+          postOffice->Send(pktHdr, mailHdr, data);
+          machine->WriteRegister(2, size);
+       }
+#else
+       machine->WriteRegister(2, -1);
+#endif
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    } else if ((which == SyscallException) && ((type == SysCall_NetReceive)
+				|| (type == SysCall_NetTryReceive))) {
+#ifdef NETWORK
+       box = machine->ReadRegister(4);
+       vaddr = machine->ReadRegister(5);
+       size = machine->ReadRegister(6);
+       if (!postOffice->HasBox(box) || (size < 0)) {
+          machine->WriteRegister(2, -1);
+       }
+       else {
+          // Receive into a kernel buffer: the user's page may be evicted
+          // while we wait
+          if (type == SysCall_NetReceive) {
+             postOffice->Receive(box, &pktHdr, &mailHdr, buffer);
+             received = TRUE;
+          }
+          else received = postOffice->TryReceive(box, &pktHdr, &mailHdr, buffer);
+          if (!received) {
+             machine->WriteRegister(2, -1);
+          }
+          else {
+             if (size > (int) mailHdr.length) size = mailHdr.length;
+             data = UserBuffer(vaddr, size, TRUE);
+             if (data != NULL) bcopy(buffer, data, size);
+             else {
+                for (i = 0; i < (unsigned) size; i++)
+                   while(!machine->WriteMem(vaddr + i, 1, buffer[i]));
+             }
+             vaddr = machine->ReadRegister(7);
+             if (vaddr != 0) while(!machine->WriteMem(vaddr, 4, pktHdr.from));
+             machine->WriteRegister(2, size);
+          }
+       }
+#else
+       machine->WriteRegister(2, -1);
+#endif
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    } else if ((which == SyscallException) && (type == SysCall_NetPoll)) {
+#ifdef NETWORK
+       box = machine->ReadRegister(4);
+       if (!postOffice->HasBox(box)) {
+          machine->WriteRegister(2, -1);
+       }
+       else machine->WriteRegister(2, postOffice->NumMessages(box));
+#else
+       machine->WriteRegister(2, -1);
+#endif
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    } else if ((which == SyscallException) && (type == SysCall_NetAddress)) {
+#ifdef NETWORK
+       machine->WriteRegister(2, postOffice->GetAddress());
+#else
+       machine->WriteRegister(2, -1);
+#endif
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
     } else if (which == PageFaultException) {
         stats->totalPageFaults += 1;
         unsigned vaddr = machine->ReadRegister(BadVAddrReg);
         currentThread->space->PageFaultHandler(vaddr);
+    } else if ((which == ReadOnlyException)
+            && currentThread->space->CopyOnWrite(machine->ReadRegister(BadVAddrReg))) {
+        // The page was shared with others by merging; it has a frame of
+        // its own now, and the write is done again
     }
      else {
          pt();
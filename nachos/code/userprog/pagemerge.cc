@@ -0,0 +1,324 @@
+// pagemerge.cc
+//	Routines to share frames between pages with the same contents.
+//	See pagemerge.h.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "pagemerge.h"
+
+//----------------------------------------------------------------------
+// MergerThread
+// 	Start routine of the merging thread.  Need this to be a C routine,
+//	because C++ can't handle pointers to member functions.
+//----------------------------------------------------------------------
+
+static void
+MergerThread (int arg)
+{
+    PageMerger *merger = (PageMerger *)arg;
+
+    merger->Merger();
+}
+
+//----------------------------------------------------------------------
+// Checksum
+// 	Summarize the contents of a page, to find the pages that may be
+//	the same quickly.
+//----------------------------------------------------------------------
+
+static unsigned
+Checksum(char *page)
+{
+    unsigned sum = 2166136261u;
+
+    for (int i = 0; i < PageSize; i++)
+	sum = (sum ^ (page[i] & 0xff)) * 16777619;
+    return sum;
+}
+
+//----------------------------------------------------------------------
+// PageMerger::PageMerger
+// 	Take the last frame for the zero frame, and start the merging
+//	thread if there are to be merge passes.  Merged frames are only
+//	ever freed, or replaced, with page replacement.
+//----------------------------------------------------------------------
+
+PageMerger::PageMerger(int ticks)
+{
+    NachOSThread *merger;
+    int i;
+
+    ASSERT(replAlgo != 0);
+    ASSERT(NumPhysPages > 1);
+    zeroFrame = NumPhysPages - 1;
+    bzero(&machine->mainMemory[zeroFrame * PageSize], PageSize);
+    machine->sharedPages[zeroFrame] = TRUE;	// never replaced
+    machine->threadPID[zeroFrame] = -2;		// nor handed out
+    machine->threadVPN[zeroFrame] = -2;
+
+    refs = new int[NumPhysPages];
+    checksums = new unsigned[NumPhysPages];
+    nextInBucket = new int[NumPhysPages];
+    for (i = 0; i < NumPhysPages; i++) {
+	refs[i] = 0;
+	checksums[i] = 0;
+    }
+    buckets = new int[MergeBuckets];
+
+    period = ticks;
+    lastPass = stats->totalTicks;
+    passRequest = new Semaphore("page merge", 0);
+    passPending = FALSE;
+    if (period > 0) {
+	// The merging thread never exits; it must not keep Nachos from
+	// halting once all the other threads have exited.
+	merger = new NachOSThread("page merger", MIN_NICE_PRIORITY);
+	MarkThreadExited(merger->GetPID());
+	merger->ThreadFork(MergerThread, (int) this);
+    }
+}
+
+PageMerger::~PageMerger()
+{
+    delete [] refs;
+    delete [] checksums;
+    delete [] nextInBucket;
+    delete [] buckets;
+    delete passRequest;
+}
+
+//----------------------------------------------------------------------
+// PageMerger::AllZero
+// 	Does a page hold only zeros?
+//----------------------------------------------------------------------
+
+bool
+PageMerger::AllZero(char *page)
+{
+    int *words = (int *) page;
+
+    for (int i = 0; i < PageSize / (int) sizeof(int); i++)
+	if (words[i] != 0)
+	    return FALSE;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// PageMerger::Holds
+// 	Is frame "ppn" shared by merging: the zero frame, or a merged
+//	frame?
+//----------------------------------------------------------------------
+
+bool
+PageMerger::Holds(int ppn)
+{
+    return (ppn >= 0) && (ppn < NumPhysPages)
+		&& ((ppn == zeroFrame) || (refs[ppn] > 0));
+}
+
+//----------------------------------------------------------------------
+// PageMerger::Ref, PageMerger::Unref
+// 	Count the pages mapped to a merged frame.  Unref returns TRUE if
+//	no page is mapped to the frame any more; the caller frees it.  The
+//	zero frame is not counted, and is never freed.
+//----------------------------------------------------------------------
+
+void
+PageMerger::Ref(int ppn)
+{
+    if (ppn != zeroFrame)
+	refs[ppn]++;
+}
+
+bool
+PageMerger::Unref(int ppn)
+{
+    if (ppn == zeroFrame)
+	return FALSE;
+    ASSERT(refs[ppn] > 0);
+    return (--refs[ppn] == 0);
+}
+
+//----------------------------------------------------------------------
+// PageMerger::Unmerge
+// 	The only page left in a merged frame is about to write to it; the
+//	frame is its own again.
+//----------------------------------------------------------------------
+
+void
+PageMerger::Unmerge(int ppn)
+{
+    ASSERT((ppn != zeroFrame) && (refs[ppn] == 1));
+    refs[ppn] = 0;
+}
+
+//----------------------------------------------------------------------
+// PageMerger::Evict
+// 	Merged frame "ppn" is being replaced.  Save it for every page
+//	mapped to it, and unmap them.
+//----------------------------------------------------------------------
+
+void
+PageMerger::Evict(int ppn)
+{
+    ProcessAddressSpace *space;
+    TranslationEntry *entry;
+    unsigned pid, vpn;
+
+    ASSERT(ppn != zeroFrame);
+    DEBUG('a', "Evicting merged frame %d, mapped %d times\n", ppn, refs[ppn]);
+    for (pid = 0; pid < thread_index; pid++) {
+	if ((threadArray[pid] == NULL) || (threadArray[pid]->space == NULL))
+	    continue;
+	space = threadArray[pid]->space;
+	for (vpn = 0; vpn < space->GetNumPages(); vpn++) {
+	    entry = &space->KernelPageTable[vpn];
+	    if (entry->valid && !entry->shared && (entry->physicalPage == ppn))
+		space->Backup(vpn, pid);
+	}
+    }
+    refs[ppn] = 0;
+}
+
+//----------------------------------------------------------------------
+// PageMerger::Merger
+// 	Body of the merging thread: each time the timer wakes it up, make
+//	a merge pass.
+//----------------------------------------------------------------------
+
+void
+PageMerger::Merger()
+{
+    while (TRUE) {
+	passRequest->P();
+	Pass();
+	passPending = FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// PageMerger::WakeMerger
+// 	Called from the timer interrupt handler.  Wake up the merging
+//	thread every "period" ticks, if it is not busy already.
+//----------------------------------------------------------------------
+
+void
+PageMerger::WakeMerger()
+{
+    if ((period > 0) && ((stats->totalTicks - lastPass) >= period)
+		&& !passPending) {
+	lastPass = stats->totalTicks;
+	passPending = TRUE;
+	passRequest->V();
+    }
+}
+
+//----------------------------------------------------------------------
+// PageMerger::Mapping
+// 	Return the page table entry of the page in frame "ppn", found
+//	through the inverse page table, or NULL if the frame holds no
+//	page that can be merged.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+PageMerger::Mapping(int ppn)
+{
+    int pid = machine->threadPID[ppn], vpn = machine->threadVPN[ppn];
+    ProcessAddressSpace *space;
+    TranslationEntry *entry;
+
+    if ((pid < 0) || (vpn < 0) || ((unsigned) pid >= thread_index)
+		|| (threadArray[pid] == NULL)
+		|| ((space = threadArray[pid]->space) == NULL)
+		|| ((unsigned) vpn >= space->GetNumPages()))
+	return NULL;
+    entry = &space->KernelPageTable[vpn];
+    if (!entry->valid || entry->shared || (entry->physicalPage != ppn))
+	return NULL;
+    return entry;
+}
+
+//----------------------------------------------------------------------
+// PageMerger::Merge
+// 	Map the page in frame "ppn" read-only to frame "into", which has
+//	the same contents, and free "ppn".
+//----------------------------------------------------------------------
+
+void
+PageMerger::Merge(int ppn, int into)
+{
+    TranslationEntry *entry = Mapping(ppn);
+
+    DEBUG('a', "Merging frame %d into frame %d\n", ppn, into);
+    if ((into != zeroFrame) && (refs[into] == 0)) {	// its own page is
+	Mapping(into)->readOnly = TRUE;			// now shared too
+	refs[into] = 1;
+    }
+    Ref(into);
+    entry->physicalPage = into;
+    entry->readOnly = TRUE;
+    machine->threadPID[ppn] = -1;
+    machine->threadVPN[ppn] = -1;
+    checksums[ppn] = 0;
+    pagesAllocated--;
+    stats->numPagesMerged++;
+}
+
+//----------------------------------------------------------------------
+// PageMerger::Pass
+// 	Look at every frame in use, and merge the pages whose contents
+//	have not changed since the last pass with another page with the
+//	same contents, or with the zero frame.  Frames already merged are
+//	looked at too, so that more pages can join them.
+//----------------------------------------------------------------------
+
+void
+PageMerger::Pass()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    char *page;
+    unsigned sum;
+    int ppn, other, bucket;
+
+    for (bucket = 0; bucket < MergeBuckets; bucket++)
+	buckets[bucket] = -1;
+    for (ppn = 0; ppn < NumPhysPages; ppn++) {
+	if ((ppn == zeroFrame) || machine->sharedPages[ppn]
+		|| sharedCode->Holds(ppn))
+	    continue;
+	page = &machine->mainMemory[ppn * PageSize];
+	if (refs[ppn] == 0) {
+	    if (Mapping(ppn) == NULL)
+		continue;
+	    sum = Checksum(page);
+	    if (sum != checksums[ppn]) {	// still changing
+		checksums[ppn] = sum;
+		continue;
+	    }
+	    if (AllZero(page)) {
+		Merge(ppn, zeroFrame);
+		continue;
+	    }
+	} else
+	    sum = checksums[ppn];
+
+	bucket = sum % MergeBuckets;
+	for (other = buckets[bucket]; other != -1; other = nextInBucket[other])
+	    if ((checksums[other] == sum)
+		    && !bcmp(page, &machine->mainMemory[other * PageSize],
+				PageSize))
+		break;
+	if ((other != -1) && (refs[ppn] == 0)) {
+	    Merge(ppn, other);
+	    continue;
+	}
+	nextInBucket[ppn] = buckets[bucket];
+	buckets[bucket] = ppn;
+    }
+    stats->numMergePasses++;
+    (void) interrupt->SetLevel(oldLevel);
+}
@@ -0,0 +1,79 @@
+// pagemerge.h
+//	Data structures for sharing frames between pages with the same
+//	contents: the zero frame, and merged pages.
+//
+//	One frame is set aside to hold zeros, and is never replaced.  A
+//	page of the bss or the stack that has never been touched, and a
+//	page that held only zeros when it was evicted, is mapped to it
+//	read-only when it is faulted in, at no cost.
+//
+//	Every MergePeriod ticks (-ksm), a merge pass looks at every frame
+//	in use, as Linux's KSM does.  A page whose contents have not
+//	changed since the last pass is merged with a page with the same
+//	contents, of any process: both are mapped read-only to one frame,
+//	and the other frame is freed.  Pages holding only zeros are merged
+//	into the zero frame.
+//
+//	The first write to a page mapped to a merged frame (or to the
+//	zero frame) gets a ReadOnlyException, and the page gets a frame
+//	of its own, with a copy of the contents (copy-on-write).  A merged
+//	frame that is replaced is saved for every process that maps it.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PAGEMERGE_H
+#define PAGEMERGE_H
+
+#include "copyright.h"
+#include "synch.h"
+#include "translate.h"
+
+#define MergeBuckets	64		// Hash buckets of a merge pass
+
+// The following class defines the frames shared between pages with the
+// same contents.  Merge passes run in a thread of their own, woken by
+// the timer interrupt; a pass never waits, and runs with interrupts off,
+// so that no page is faulted in or replaced in the middle of it.
+
+class PageMerger {
+  public:
+    PageMerger(int period);		// Set the zero frame aside; merge
+					// every "period" ticks, if it is
+					// not 0
+    ~PageMerger();
+
+    int ZeroFrame() { return zeroFrame; }
+    bool AllZero(char *page);		// Does the page hold only zeros?
+    bool Holds(int ppn);		// Is the frame shared by merging?
+    void Ref(int ppn);			// One more page maps the frame
+    bool Unref(int ppn);		// One fewer; TRUE if it was the last
+					// one, and the frame is to be freed
+    int Refs(int ppn) { return refs[ppn]; }
+    void Unmerge(int ppn);		// The frame has only one page left,
+					// which is about to write to it
+    void Evict(int ppn);		// The frame is being replaced
+
+    void Merger();			// Body of the merging thread
+    void WakeMerger();			// Called from the timer interrupt
+
+  private:
+    int period;				// Ticks between merge passes
+    int lastPass;			// When the last one was started
+    int zeroFrame;
+    int *refs;				// Pages mapped to each frame, 0 if it
+					// is not merged
+    unsigned *checksums;		// Contents of each frame at the last
+					// pass
+    int *buckets;			// Frames with each checksum, in the
+    int *nextInBucket;			// pass under way
+    Semaphore *passRequest;		// To wake up the merging thread
+    bool passPending;			// Woken up, not done yet?
+
+    void Pass();			// Merge what can be merged
+    TranslationEntry *Mapping(int ppn);	// Entry of the page in the frame
+    void Merge(int ppn, int into);	// Map the page in "ppn" to "into"
+};
+
+#endif // PAGEMERGE_H
@@ -129,9 +129,17 @@ ReadInputAndFork (char *filename)
 
    //printf("%d\n", schedulingAlgo);
 
-   if ((schedulingAlgo == ROUND_ROBIN) || (schedulingAlgo == UNIX_SCHED)) {
+   ASSERT((schedulingAlgo > 0) && (schedulingAlgo <= MAX_SCHED_ALGO));
+   if (scheduler->IsPreemptive()) {
       ASSERT (SCHED_QUANTUM > 0);
    }
+   if (schedulingAlgo == MLFQ_SCHED) {
+      currentThread->SetPriority(0);
+      currentThread->SetUsage(0);
+   }
+   else if (schedulingAlgo == STRIDE_SCHED) {
+      currentThread->SetPriority(scheduler->GetMinPass());
+   }
 
    bytesRead = inFile->Read(&c, 1);
    while (bytesRead != 0) {
@@ -180,11 +188,9 @@ ReadInputAndFork (char *filename)
    // Cleanly exit current thread
    // Assume exit code zero
    printf("[pid %d]: Exit called. Code: %d\n", currentThread->GetPID(), 0);
-   exitThreadArray[currentThread->GetPID()] = true;
+   // The main thread is left out of the completion time statistics
+   MarkThreadExited(currentThread->GetPID());
 
-   // Find out if all threads have called exit
-   for (i=0; i<thread_index; i++) {
-       if (!exitThreadArray[i]) break;
-   }
-   currentThread->Exit(i==thread_index, 0);
+   // Terminate if all threads have called exit
+   currentThread->Exit(numLiveThreads == 0, 0);
 }
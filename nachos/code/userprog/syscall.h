@@ -49,6 +49,13 @@
 #define SysCall_CondOp		25
 #define SysCall_CondRemove	26
 #define SysCall_ShmAllocate	27
+#define SysCall_WaitOnAddress	28
+#define SysCall_WakeAddress	29
+#define SysCall_NetSend		30
+#define SysCall_NetReceive	31
+#define SysCall_NetTryReceive	32
+#define SysCall_NetPoll		33
+#define SysCall_NetAddress	34
 #define SysCall_NumInstr        50
 
 #ifndef IN_ASM
@@ -166,7 +173,17 @@ void syscall_wrapper_Sleep (unsigned);
 
 int syscall_wrapper_GetTime (void);
 
-int systm_SemGet (int key);
+/* Semaphores and condition variables shared by processes.  SemGet and
+ * CondGet return the id of the object with "key", creating it if needed
+ * (a new semaphore has value zero); they return -1 if the kernel table
+ * is full.  SemOp does P() for a negative "adjust" and V() for a positive
+ * one, |adjust| times.  SemCtl takes a SYNCH_* command from synchop.h.
+ * CondOp takes a COND_OP_* op; a wait releases semaphore "semid" and
+ * sleeps atomically, and acquires the semaphore again before returning.
+ * SemCtl and CondRemove return 0 on success and -1 for a bad id or for
+ * an object that threads are waiting on.
+ */
+int syscall_wrapper_SemGet (int key);
 
 void syscall_wrapper_SemOp (int semid, int adjust);
 
@@ -180,6 +197,52 @@ int syscall_wrapper_CondRemove (int condid);
 
 unsigned syscall_wrapper_ShmAllocate (unsigned size);
 
+/* Futex-style waiting on a word of shared memory.  WaitOnAddress goes
+ * to sleep if *addr still equals "expected" (checked atomically with
+ * going to sleep), and returns 0 once woken up; it returns 1 at once if
+ * *addr has changed, and -1 if the kernel is out of wait queues.
+ * WakeAddress wakes up at most "count" processes sleeping on "addr" and
+ * returns how many it woke.  Waiters are matched by physical address,
+ * so processes sharing the page through ShmAllocate find each other.
+ */
+int syscall_wrapper_WaitOnAddress (int *addr, int expected);
+
+int syscall_wrapper_WakeAddress (int *addr, int count);
+
+/* Messages to and from mailboxes on other machines, through the post
+ * office; they are lost if the network drops them (-l).  A message holds
+ * at most NetMaxMessage bytes.  NetSend sends "size" bytes to mailbox
+ * "box" of machine "to", with mailbox "box" of this machine as the one
+ * to reply to, and returns "size"; it waits if that mailbox already
+ * holds as many of our messages as it can take.  NetReceive waits for a message in
+ * mailbox "box", copies at most "size" bytes of it to "data", and
+ * returns how many; the machine that sent it goes in *from, unless
+ * "from" is 0.  NetTryReceive does the same, but returns -1 at once if
+ * there is no message.  NetPoll returns the number of messages waiting
+ * in "box", and NetAddress the id of this machine.  All of them return
+ * -1 for a bad mailbox or size, or if Nachos has no network.
+ */
+#define NetMaxMessage	40	/* MaxMailSize in network/post.h */
+
+int syscall_wrapper_NetSend (int to, int box, char *data, int size);
+
+int syscall_wrapper_NetReceive (int box, char *data, int size, int *from);
+
+int syscall_wrapper_NetTryReceive (int box, char *data, int size, int *from);
+
+int syscall_wrapper_NetPoll (int box);
+
+int syscall_wrapper_NetAddress (void);
+
+/* Atomic operations, done in user mode (see start.s).  
+ * AtomicCompareAndSwap stores "newval" in *addr if it holds "oldval"; 
+ * AtomicFetchAdd adds "delta" to *addr.  Both return the previous 
+ * value of *addr.
+ */
+int AtomicCompareAndSwap (int *addr, int oldval, int newval);
+
+int AtomicFetchAdd (int *addr, int delta);
+
 int syscall_wrapper_GetNumInstr (void);
 #endif /* IN_ASM */
 
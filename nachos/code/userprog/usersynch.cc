@@ -0,0 +1,207 @@
+// usersynch.cc 
+//	Routines to manage the semaphores and condition variables of
+//	user programs.
+//
+//	The tables are kept in the global variables semTable and 
+//	condTable; the system calls are in exception.cc.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "usersynch.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// SynchTable::SynchTable
+// 	Initialize an empty table of "entries" entries.  There are as many
+//	hash chains as entries.
+//----------------------------------------------------------------------
+
+SynchTable::SynchTable(int entries)
+{
+    int i;
+
+    size = entries;
+    objects = new void*[size];
+    keys = new int[size];
+    buckets = new int[size];
+    nextInChain = new int[size];
+    for (i = 0; i < size; i++) {
+	objects[i] = NULL;
+	buckets[i] = -1;
+	nextInChain[i] = i + 1;
+    }
+    nextInChain[size - 1] = -1;
+    firstFree = 0;
+}
+
+//----------------------------------------------------------------------
+// SynchTable::~SynchTable
+// 	De-allocate the table.  The objects in it are not deleted.
+//----------------------------------------------------------------------
+
+SynchTable::~SynchTable()
+{
+    delete [] objects;
+    delete [] keys;
+    delete [] buckets;
+    delete [] nextInChain;
+}
+
+//----------------------------------------------------------------------
+// SynchTable::Lookup
+// 	Return the id of the object entered under "key", or -1.
+//----------------------------------------------------------------------
+
+int
+SynchTable::Lookup(int key)
+{
+    int id;
+
+    for (id = buckets[Hash(key)]; id != -1; id = nextInChain[id]) {
+	if (keys[id] == key)
+	    return id;
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// SynchTable::Insert
+// 	Enter "object" under "key", which must not be in the table yet.
+//	Return the id of the new entry, or -1 if the table is full.
+//----------------------------------------------------------------------
+
+int
+SynchTable::Insert(int key, void *object)
+{
+    int id = firstFree;
+
+    ASSERT(Lookup(key) == -1);
+    if (id == -1)
+	return -1;
+    firstFree = nextInChain[id];
+    objects[id] = object;
+    keys[id] = key;
+    nextInChain[id] = buckets[Hash(key)];
+    buckets[Hash(key)] = id;
+    return id;
+}
+
+//----------------------------------------------------------------------
+// SynchTable::Get
+// 	Return the object with "id", or NULL if there is none (including
+//	when "id" is out of range, since ids come from user programs).
+//----------------------------------------------------------------------
+
+void *
+SynchTable::Get(int id)
+{
+    if ((id < 0) || (id >= size))
+	return NULL;
+    return objects[id];
+}
+
+//----------------------------------------------------------------------
+// SynchTable::Remove
+// 	Take object "id" out of the table, and make the id free.
+//----------------------------------------------------------------------
+
+void
+SynchTable::Remove(int id)
+{
+    int *ptr;
+
+    ASSERT(Get(id) != NULL);
+    for (ptr = &buckets[Hash(keys[id])]; *ptr != id; ptr = &nextInChain[*ptr])
+	ASSERT(*ptr != -1);
+    *ptr = nextInChain[id];
+    objects[id] = NULL;
+    nextInChain[id] = firstFree;
+    firstFree = id;
+}
+
+//----------------------------------------------------------------------
+// UserCondition::UserCondition
+// 	Initialize a condition variable, with no one waiting.
+//----------------------------------------------------------------------
+
+UserCondition::UserCondition()
+{
+    queue = new List;
+}
+
+//----------------------------------------------------------------------
+// UserCondition::~UserCondition
+// 	De-allocate a condition variable.  Assume no one is waiting on it!
+//----------------------------------------------------------------------
+
+UserCondition::~UserCondition()
+{
+    delete queue;
+}
+
+//----------------------------------------------------------------------
+// UserCondition::Wait
+// 	Release "mutex" and go to sleep until signalled, atomically: 
+//	interrupts stay off from the moment we join the queue until we
+//	are asleep, so no Signal can slip in between.  Then acquire
+//	"mutex" again.
+//----------------------------------------------------------------------
+
+void
+UserCondition::Wait(Semaphore *mutex)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    queue->Append((void *)currentThread);
+    mutex->V();
+    currentThread->PutThreadToSleep();
+    (void) interrupt->SetLevel(oldLevel);
+    mutex->P();
+}
+
+//----------------------------------------------------------------------
+// UserCondition::Signal
+// 	Wake up one thread waiting on the condition, if any.
+//----------------------------------------------------------------------
+
+void
+UserCondition::Signal()
+{
+    NachOSThread *thread;
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    thread = (NachOSThread *)queue->Remove();
+    if (thread != NULL)
+	scheduler->MoveThreadToReadyQueue(thread);
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// UserCondition::Broadcast
+// 	Wake up all threads waiting on the condition.
+//----------------------------------------------------------------------
+
+void
+UserCondition::Broadcast()
+{
+    NachOSThread *thread;
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    while ((thread = (NachOSThread *)queue->Remove()) != NULL)
+	scheduler->MoveThreadToReadyQueue(thread);
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// UserCondition::HasWaiters
+// 	Return TRUE if some thread is waiting on the condition.
+//----------------------------------------------------------------------
+
+bool
+UserCondition::HasWaiters()
+{
+    return !queue->IsEmpty();
+}
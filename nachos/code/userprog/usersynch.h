@@ -0,0 +1,72 @@
+// usersynch.h 
+//	Data structures for the synchronization objects user programs
+//	get through SemGet and CondGet.
+//
+//	A user program names a semaphore or condition variable by an 
+//	integer key of its choosing; processes that use the same key get
+//	the same object.  The kernel returns a small integer id for the
+//	object, which is what SemOp, SemCtl, CondOp and CondRemove take.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef USERSYNCH_H
+#define USERSYNCH_H
+
+#include "copyright.h"
+#include "list.h"
+#include "synch.h"
+
+#define MAX_USER_SEMAPHORES	256	// Semaphores in the system at once
+#define MAX_USER_CONDITIONS	256	// Condition variables at once
+#define MAX_FUTEX_QUEUES	256	// Addresses slept on at once
+
+// The following class defines a table of synchronization objects,
+// looked up by key (through a hash table) or by id (an index into the
+// table).  Both take constant time.
+
+class SynchTable {
+  public:
+    SynchTable(int entries);		// initialize an empty table
+    ~SynchTable();			// de-allocate the table
+
+    int Lookup(int key);		// id of the object with "key", 
+					// -1 if there is none
+    int Insert(int key, void *object);	// enter "object" under "key";
+					// returns its id, -1 if full
+    void *Get(int id);			// object with "id", NULL if none
+    void Remove(int id);		// take object "id" out of the table
+
+  private:
+    int size;				// number of entries
+    void **objects;			// the objects, indexed by id
+    int *keys;				// and their keys
+    int *buckets;			// first id in each hash chain
+    int *nextInChain;			// next id in the same hash chain,
+					// or in the free list
+    int firstFree;			// free list of ids
+
+    int Hash(int key) { return (unsigned)key % size; }
+};
+
+// The following class defines a condition variable for user programs.
+// A user-level semaphore plays the part of the lock: Wait releases it
+// and goes to sleep atomically, and acquires it again once woken up.
+
+class UserCondition {
+  public:
+    UserCondition();			// initialize to "no one waiting"
+    ~UserCondition();			// deallocate the condition
+
+    void Wait(Semaphore *mutex);	// V "mutex", sleep until signalled,
+					// then P "mutex"
+    void Signal();			// wake up one waiting thread
+    void Broadcast();			// wake up all waiting threads
+    bool HasWaiters();			// is anyone waiting?
+
+  private:
+    List *queue;			// threads waiting in Wait
+};
+
+#endif // USERSYNCH_H
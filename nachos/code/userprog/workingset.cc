@@ -0,0 +1,145 @@
+// workingset.cc
+//	Routines to estimate the working set of each process, and to keep
+//	the processes from thrashing.  See workingset.h.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "workingset.h"
+
+//----------------------------------------------------------------------
+// WorkingSets::WorkingSets
+// 	Initialize the working-set manager.
+//
+//	"window" -- the working-set window, in ticks
+//	"quota" -- frames a process may have, 0 for no limit
+//	"local" -- replace only the faulting process's pages, if it has any
+//	"loadControl" -- suspend processes when their working sets do not
+//		fit in memory
+//----------------------------------------------------------------------
+
+WorkingSets::WorkingSets(int ticks, int frames, bool localOnly, bool control)
+{
+    ASSERT((ticks >= WSSamples) && (frames >= 0));
+    window = ticks;
+    quota = frames;
+    local = localOnly;
+    loadControl = control;
+    lastSample = stats->totalTicks;
+    suspended = new List;
+}
+
+WorkingSets::~WorkingSets()
+{
+    delete suspended;
+}
+
+//----------------------------------------------------------------------
+// WorkingSets::OverQuota
+// 	Does the process have as many frames as its quota allows?  Then
+//	it has to replace one of its own pages to get another.
+//----------------------------------------------------------------------
+
+bool
+WorkingSets::OverQuota(ProcessAddressSpace *space)
+{
+    return (quota > 0) && (space->ResidentPages() >= quota);
+}
+
+//----------------------------------------------------------------------
+// WorkingSets::Sample
+// 	Called from the timer interrupt handler, with interrupts off.
+//	Every window / WSSamples ticks, note which pages have been used
+//	since the last sample, and recompute the size of every working
+//	set.  Then, with load control, pick a process to suspend if the
+//	working sets do not fit in memory, or resume one if they leave
+//	room for it.
+//----------------------------------------------------------------------
+
+void
+WorkingSets::Sample()
+{
+    ProcessAddressSpace *space, *largest = NULL;
+    TranslationEntry *entry;
+    NachOSThread *thread;
+    unsigned pid, vpn;
+    int now = stats->totalTicks, total = 0, running = 0;
+
+    if ((now - lastSample) < window / WSSamples)
+	return;
+    lastSample = now;
+
+    for (pid = 0; pid < thread_index; pid++) {
+	if ((threadArray[pid] == NULL)
+		|| ((space = threadArray[pid]->space) == NULL))
+	    continue;
+	if (space->suspendedAt != -1)	// its working set is what it was
+	    continue;			// when it was suspended
+	space->workingSet = 0;
+	space->suspendPending = FALSE;	// picked again below, if need be
+	for (vpn = 0; vpn < space->GetNumPages(); vpn++) {
+	    entry = &space->KernelPageTable[vpn];
+	    if (entry->valid && entry->use) {
+		entry->lastUse = now;
+		entry->use = FALSE;
+	    }
+	    if ((entry->lastUse != -1) && (now - entry->lastUse <= window))
+		space->workingSet++;
+	}
+	total += space->workingSet;
+	running++;
+	if ((largest == NULL) || (space->workingSet > largest->workingSet))
+	    largest = space;
+
+	stats->numWorkingSetSamples++;
+	stats->workingSetSum += space->workingSet;
+	if (space->workingSet > stats->maxWorkingSet)
+	    stats->maxWorkingSet = space->workingSet;
+    }
+    if (!loadControl)
+	return;
+
+    if ((total > NumPhysPages) && (running > 1)) {
+	DEBUG('a', "Working sets add up to %d frames; suspending process %d\n",
+		total, largest->cpid);
+	largest->suspendPending = TRUE;
+    } else if (!suspended->IsEmpty()) {
+	thread = (NachOSThread *) suspended->Remove();
+	if ((running == 0)
+		|| (total + thread->space->workingSet <= NumPhysPages)) {
+	    DEBUG('a', "Resuming process %d\n", thread->space->cpid);
+	    stats->suspendedTicks += now - thread->space->suspendedAt;
+	    thread->space->suspendedAt = -1;
+	    thread->Schedule();
+	} else
+	    suspended->Prepend((void *) thread);
+    }
+}
+
+//----------------------------------------------------------------------
+// WorkingSets::Admit
+// 	Called at the start of each page fault of "space", the address
+//	space of the current thread.  If load control has picked the
+//	process, give up all its frames, and sleep until Sample resumes it.
+//----------------------------------------------------------------------
+
+void
+WorkingSets::Admit(ProcessAddressSpace *space)
+{
+    IntStatus oldLevel;
+
+    if (!space->suspendPending)
+	return;
+    space->suspendPending = FALSE;
+    space->ReleaseFrames();
+    stats->numLoadSuspends++;
+
+    oldLevel = interrupt->SetLevel(IntOff);
+    space->suspendedAt = stats->totalTicks;
+    suspended->Append((void *) currentThread);
+    currentThread->PutThreadToSleep();
+    (void) interrupt->SetLevel(oldLevel);
+}
@@ -0,0 +1,73 @@
+// workingset.h
+//	Data structures for working sets, resident-set quotas, local page
+//	replacement and load control.
+//
+//	The working set of a process is the set of its pages it has used
+//	in the last "window" ticks.  It is estimated by sampling: every
+//	window / WSSamples ticks, the timer interrupt handler looks at the
+//	use bit of every page in memory, records when it was last seen set
+//	in the page table entry (lastUse), and clears it.
+//
+//	With a quota (-rss), a process that has as many frames as its
+//	quota replaces one of its own pages to get another one, even if
+//	some frames are free.  With local replacement (-local), a process
+//	that needs a frame when none is free always replaces one of its
+//	own pages, if it has one; otherwise, the replacement algorithm
+//	chosen with -R picks any page in memory.  The page replaced is the
+//	one of the process used longest ago.
+//
+//	With load control (-lc), when the working sets of the processes
+//	that are running add up to more than physical memory, the process
+//	with the largest one is suspended at its next page fault: its
+//	pages are all evicted, and it sleeps until the others' working
+//	sets leave room for its own.  Suspended processes are resumed in
+//	the order they were suspended.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef WORKINGSET_H
+#define WORKINGSET_H
+
+#include "copyright.h"
+#include "list.h"
+
+class ProcessAddressSpace;
+
+#define WSDefaultWindow	10000		// Window, in ticks, if not given
+#define WSSamples	4		// Samples in one window
+
+// The following class defines the working-set manager.  There is one,
+// if any of -ws, -rss, -local or -lc is given.
+
+class WorkingSets {
+  public:
+    WorkingSets(int window, int quota, bool local, bool loadControl);
+					// Sample every "window" / WSSamples
+					// ticks; "quota" is 0 for none
+    ~WorkingSets();
+
+    bool OverQuota(ProcessAddressSpace *space);
+					// Has the process all the frames it
+					// may have?
+    bool LocalReplacement() { return local; }
+
+    void Sample();			// Called from the timer interrupt
+    void Admit(ProcessAddressSpace *space);
+					// Called at each page fault; suspends
+					// the process if load control has
+					// picked it
+
+  private:
+    int window;				// Working-set window, in ticks
+    int quota;				// Frames a process may have, 0 if
+					// there is no limit
+    bool local;				// Replace only our own pages?
+    bool loadControl;			// Suspend processes if need be?
+    int lastSample;			// When the last sample was taken
+    List *suspended;			// Threads suspended by load control,
+					// oldest first
+};
+
+#endif // WORKINGSET_H
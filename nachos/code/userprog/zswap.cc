@@ -0,0 +1,410 @@
+// zswap.cc
+//	Routines to keep evicted pages compressed in memory, in front of
+//	the backup store.  See zswap.h.
+//
+//	A compressed page is a sequence of runs, each starting with a
+//	control byte c:
+//
+//		c < 128		the next c + 1 bytes are copied as they are
+//		c >= 128	c - 128 + MinMatch bytes are copied from the
+//				page as decompressed so far, starting the
+//				number of bytes given by the next byte back
+//
+//	A copy may overlap the bytes it produces, so a run of one byte, or
+//	of a short pattern, takes a single match.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "zswap.h"
+
+#define MinMatch	3		// Shortest match worth a run
+#define MaxMatch	(127 + MinMatch)
+#define MaxLiterals	128
+#define MaxOffset	255
+
+//----------------------------------------------------------------------
+// Compress
+// 	Compress a page into "out", and return the number of bytes it
+//	took, or -1 if that would be more than ZSwapMaxSize.
+//----------------------------------------------------------------------
+
+static int
+Compress(char *page, char *out)
+{
+    int i = 0, j, k, length = 0, literals = 0;
+    int best, bestOffset;
+
+    while (i < PageSize) {
+	best = 0;
+	bestOffset = 0;
+	for (j = i - 1; (j >= 0) && (i - j <= MaxOffset); j--) {
+	    for (k = 0; (i + k < PageSize) && (k < MaxMatch)
+				&& (page[j + k] == page[i + k]); k++)
+		;
+	    if (k > best) {
+		best = k;
+		bestOffset = i - j;
+	    }
+	}
+	if (best >= MinMatch) {
+	    if (length + 2 > ZSwapMaxSize)
+		return -1;
+	    out[length++] = (char) (128 + best - MinMatch);
+	    out[length++] = (char) bestOffset;
+	    literals = 0;
+	    i += best;
+	} else {
+	    if (literals == 0) {	// start a new literal run
+		if (length + 2 > ZSwapMaxSize)
+		    return -1;
+		length++;
+	    } else if (length + 1 > ZSwapMaxSize)
+		return -1;
+	    out[length - literals - 1] = (char) literals;
+	    out[length++] = page[i++];
+	    if (++literals == MaxLiterals)
+		literals = 0;
+	}
+    }
+    return length;
+}
+
+//----------------------------------------------------------------------
+// Decompress
+// 	Undo Compress: expand the "length" bytes at "in" into a page.
+//----------------------------------------------------------------------
+
+static void
+Decompress(char *in, int length, char *page)
+{
+    int i = 0, n, offset, control;
+    char *end = in + length;
+
+    while (in < end) {
+	control = *in++ & 0xff;
+	if (control < 128) {
+	    for (n = control + 1; n > 0; n--)
+		page[i++] = *in++;
+	} else {
+	    offset = *in++ & 0xff;
+	    for (n = control - 128 + MinMatch; n > 0; n--, i++)
+		page[i] = page[i - offset];
+	}
+    }
+    ASSERT(i == PageSize);
+}
+
+//----------------------------------------------------------------------
+// SameFilled
+// 	Is the page one word over and over?  Then return the word in
+//	"fill".
+//----------------------------------------------------------------------
+
+static bool
+SameFilled(char *page, int *fill)
+{
+    int *words = (int *) page;
+
+    for (int i = 1; i < PageSize / (int) sizeof(int); i++)
+	if (words[i] != words[0])
+	    return FALSE;
+    *fill = words[0];
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// ZSwap::ZSwap
+// 	Initialize an empty cache, in the "numFrames" frames at "memory".
+//----------------------------------------------------------------------
+
+ZSwap::ZSwap(char *mem, int frames)
+{
+    int i;
+
+    ASSERT(PageSize <= MaxOffset + 1);
+    memory = mem;
+    numFrames = frames;
+    atStart = new CompressedPage*[numFrames];
+    atEndOf = new CompressedPage*[numFrames];
+    for (i = 0; i < numFrames; i++)
+	atStart[i] = atEndOf[i] = NULL;
+    buckets = new CompressedPage*[ZSwapBuckets];
+    for (i = 0; i < ZSwapBuckets; i++)
+	buckets[i] = NULL;
+    oldest = newest = NULL;
+    packed = new char[PageSize];
+    buffer = new char[PageSize];
+}
+
+//----------------------------------------------------------------------
+// ZSwap::~ZSwap
+// 	Forget every page, and free the cache's tables.
+//----------------------------------------------------------------------
+
+ZSwap::~ZSwap()
+{
+    while (oldest != NULL)
+	Remove(oldest);
+    delete [] atStart;
+    delete [] atEndOf;
+    delete [] buckets;
+    delete [] packed;
+    delete [] buffer;
+}
+
+//----------------------------------------------------------------------
+// ZSwap::Find
+// 	Return where in its bucket the page "vpn" of "space" is kept, or
+//	would be; the pointer there is NULL if it is not kept.
+//----------------------------------------------------------------------
+
+CompressedPage **
+ZSwap::Find(ProcessAddressSpace *space, int vpn)
+{
+    CompressedPage **where =
+	&buckets[(unsigned) (space->cpid * 31 + vpn) % ZSwapBuckets];
+
+    while ((*where != NULL)
+		&& (((*where)->space != space) || ((*where)->vpn != vpn)))
+	where = &(*where)->next;
+    return where;
+}
+
+//----------------------------------------------------------------------
+// ZSwap::Place
+// 	Find a frame with room for a compressed page: the free half of a
+//	frame holding one page, if it is big enough, or else an empty
+//	frame.  Return FALSE if there is none.
+//----------------------------------------------------------------------
+
+bool
+ZSwap::Place(CompressedPage *page)
+{
+    int i, empty = -1;
+
+    for (i = 0; i < numFrames; i++) {
+	if ((atStart[i] == NULL) && (atEndOf[i] == NULL)) {
+	    if (empty == -1)
+		empty = i;
+	} else if (atStart[i] == NULL) {
+	    if (atEndOf[i]->length + page->length <= PageSize) {
+		page->frame = i;
+		page->atEnd = FALSE;
+		atStart[i] = page;
+		return TRUE;
+	    }
+	} else if (atEndOf[i] == NULL) {
+	    if (atStart[i]->length + page->length <= PageSize) {
+		page->frame = i;
+		page->atEnd = TRUE;
+		atEndOf[i] = page;
+		return TRUE;
+	    }
+	}
+    }
+    if (empty == -1)
+	return FALSE;
+    page->frame = empty;
+    page->atEnd = FALSE;
+    atStart[empty] = page;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// ZSwap::Data
+// 	Return where the compressed bytes of a page are kept.
+//----------------------------------------------------------------------
+
+char *
+ZSwap::Data(CompressedPage *page)
+{
+    char *frame = &memory[page->frame * PageSize];
+
+    return page->atEnd ? frame + PageSize - page->length : frame;
+}
+
+//----------------------------------------------------------------------
+// ZSwap::Expand
+// 	Decompress a page into "into".
+//----------------------------------------------------------------------
+
+void
+ZSwap::Expand(CompressedPage *page, char *into)
+{
+    int *words = (int *) into;
+
+    if (page->frame == -1) {
+	for (int i = 0; i < PageSize / (int) sizeof(int); i++)
+	    words[i] = page->fill;
+    } else
+	Decompress(Data(page), page->length, into);
+}
+
+//----------------------------------------------------------------------
+// ZSwap::Store
+// 	Keep page "vpn" of "space", which is being evicted, making room by
+//	writing the pages stored longest ago back to the backup store.
+//	Return FALSE if the page does not compress to ZSwapMaxSize bytes;
+//	then the caller writes it to the backup store itself.
+//
+//	"page" -- the contents of the page
+//----------------------------------------------------------------------
+
+bool
+ZSwap::Store(ProcessAddressSpace *space, int vpn, char *page)
+{
+    CompressedPage *p, **where = Find(space, vpn);
+    int fill, length = 0;
+    bool same = SameFilled(page, &fill);
+
+    if (*where != NULL)			// an old copy
+	Remove(*where);
+    if (!same) {
+	length = Compress(page, packed);
+	if (length < 0) {
+	    DEBUG('a', "Page %d of %d does not compress\n", vpn, space->cpid);
+	    stats->numZSwapRejects++;
+	    return FALSE;
+	}
+    }
+
+    p = new CompressedPage;
+    p->space = space;
+    p->vpn = vpn;
+    p->frame = -1;
+    p->length = length;
+    p->fill = fill;
+    if (!same) {
+	while (!Place(p)) {
+	    ASSERT(oldest != NULL);
+	    WriteBack(oldest);
+	}
+	bcopy(packed, Data(p), length);
+    }
+    DEBUG('a', "Page %d of %d compressed to %d bytes, in frame %d\n", vpn,
+		space->cpid, length, p->frame);
+
+    where = Find(space, vpn);		// writing back may have changed
+    p->next = *where;			// the bucket
+    *where = p;
+    p->older = newest;
+    p->newer = NULL;
+    if (newest != NULL)
+	newest->newer = p;
+    else
+	oldest = p;
+    newest = p;
+
+    stats->numZSwapStores++;
+    if (same)
+	stats->numZSwapSameFilled++;
+    stats->zswapPageBytes += PageSize;
+    stats->zswapCompressedBytes += same ? sizeof(int) : length;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// ZSwap::Load
+// 	If page "vpn" of "space" is in the cache, decompress it into
+//	"page", take it out of the cache, and return TRUE.
+//----------------------------------------------------------------------
+
+bool
+ZSwap::Load(ProcessAddressSpace *space, int vpn, char *page)
+{
+    CompressedPage *p = *Find(space, vpn);
+
+    if (p == NULL) {
+	stats->numZSwapMisses++;
+	return FALSE;
+    }
+    Expand(p, page);
+    Remove(p);
+    stats->numZSwapHits++;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// ZSwap::Copy
+// 	"to" has just been forked from "from", and has a copy of its
+//	backup store; the pages of "from" in the cache go to it as well.
+//	They are written to the backup store of "to", rather than taking
+//	more room in the cache.
+//----------------------------------------------------------------------
+
+void
+ZSwap::Copy(ProcessAddressSpace *from, ProcessAddressSpace *to)
+{
+    for (CompressedPage *p = oldest; p != NULL; p = p->newer)
+	if (p->space == from) {
+	    Expand(p, buffer);
+	    to->WriteBackup(p->vpn, buffer);
+	}
+}
+
+//----------------------------------------------------------------------
+// ZSwap::Free
+// 	"space" is going away; forget its pages.
+//----------------------------------------------------------------------
+
+void
+ZSwap::Free(ProcessAddressSpace *space)
+{
+    CompressedPage *p, *newer;
+
+    for (p = oldest; p != NULL; p = newer) {
+	newer = p->newer;
+	if (p->space == space)
+	    Remove(p);
+    }
+}
+
+//----------------------------------------------------------------------
+// ZSwap::Remove
+// 	Forget a page, and give its room back.
+//----------------------------------------------------------------------
+
+void
+ZSwap::Remove(CompressedPage *page)
+{
+    CompressedPage **where = Find(page->space, page->vpn);
+
+    ASSERT(*where == page);
+    *where = page->next;
+    if (page->older != NULL)
+	page->older->newer = page->newer;
+    else
+	oldest = page->newer;
+    if (page->newer != NULL)
+	page->newer->older = page->older;
+    else
+	newest = page->older;
+    if (page->frame != -1) {
+	if (page->atEnd)
+	    atEndOf[page->frame] = NULL;
+	else
+	    atStart[page->frame] = NULL;
+    }
+    delete page;
+}
+
+//----------------------------------------------------------------------
+// ZSwap::WriteBack
+// 	Make room: move a page from the cache to the backup store of its
+//	process.
+//----------------------------------------------------------------------
+
+void
+ZSwap::WriteBack(CompressedPage *page)
+{
+    DEBUG('a', "Writing page %d of %d back from the cache\n", page->vpn,
+		page->space->cpid);
+    Expand(page, buffer);
+    page->space->WriteBackup(page->vpn, buffer);
+    Remove(page);
+    stats->numZSwapWriteBacks++;
+}
@@ -0,0 +1,97 @@
+// zswap.h
+//	Data structures for a cache of compressed pages, kept in memory
+//	between page replacement and the backup store.
+//
+//	A dirty page that is evicted is compressed and kept in a few
+//	frames of physical memory set aside for the cache (-zswap), and
+//	only goes to the backup store when the cache needs the room.  A
+//	fault on a page in the cache decompresses it, which takes far
+//	less time than bringing it back from swap.
+//
+//	Pages filled with one word over and over (most often zero) are
+//	kept as that word alone.  The others are compressed with a small
+//	LZ77 codec, and stored at most two to a frame: one from the start
+//	of the frame and one from its end, as Linux's zbud does.  A page
+//	that does not shrink to ZSwapMaxSize bytes is not worth keeping,
+//	and goes straight to the backup store.
+//
+//	The cache is exclusive: a page is taken out of it when it is
+//	faulted back in.  When room is needed, the pages stored longest
+//	ago are written back to the backup store of their process.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef ZSWAP_H
+#define ZSWAP_H
+
+#include "copyright.h"
+#include "machine.h"
+
+class ProcessAddressSpace;
+
+#define ZSwapMaxSize	(PageSize * 3 / 4)	// Largest compressed page kept
+#define ZSwapBuckets	64		// Hash buckets of the cache
+
+// The following class defines a page kept in the cache.
+
+class CompressedPage {
+  public:
+    ProcessAddressSpace *space;		// Address space it belongs to
+    int vpn;				// Its virtual page number there
+    int frame;				// Frame of the cache holding it, or
+					// -1 if it is filled with "fill"
+    bool atEnd;				// At the end of the frame, rather
+					// than at its start?
+    int length;				// Bytes it was compressed to
+    int fill;				// Word the page is filled with
+    CompressedPage *next;		// Next in the same bucket
+    CompressedPage *older, *newer;	// Neighbours, in the order the
+					// pages were stored
+};
+
+// The following class defines the cache.  It is only used by the page
+// fault handler and the page replacement routines, which expect nothing
+// else to run until they are done; so it never waits, and needs no
+// lock.
+
+class ZSwap {
+  public:
+    ZSwap(char *memory, int numFrames);	// Keep compressed pages in the
+					// "numFrames" frames at "memory"
+    ~ZSwap();
+
+    bool Store(ProcessAddressSpace *space, int vpn, char *page);
+					// Keep an evicted page; FALSE if it
+					// does not compress well enough
+    bool Load(ProcessAddressSpace *space, int vpn, char *page);
+					// Decompress a page into "page", and
+					// forget it; FALSE if it is not kept
+    void Copy(ProcessAddressSpace *from, ProcessAddressSpace *to);
+					// "to" is a fork of "from"; give it
+					// the pages "from" has in the cache
+    void Free(ProcessAddressSpace *space); // Forget the pages of "space"
+
+  private:
+    char *memory;			// The cache's frames
+    int numFrames;
+    CompressedPage **atStart, **atEndOf;// Page at the start, and at the end,
+					// of each frame, or NULL
+    CompressedPage **buckets;		// Pages, hashed on (space, vpn)
+    CompressedPage *oldest, *newest;	// Pages, in the order they were
+					// stored
+    char *packed;			// Where pages are compressed to
+    char *buffer;			// And decompressed to, to be copied
+
+    CompressedPage **Find(ProcessAddressSpace *space, int vpn);
+					// Where the page is, or would go
+    bool Place(CompressedPage *page);	// Find room for a compressed page
+    char *Data(CompressedPage *page);	// Where it is kept
+    void Expand(CompressedPage *page, char *into);
+					// Decompress a page
+    void Remove(CompressedPage *page);	// Forget a page
+    void WriteBack(CompressedPage *page); // Move a page to the backup store
+};
+
+#endif // ZSWAP_H